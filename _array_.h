@@ -118,6 +118,7 @@ public:
 	// operations
 	
 	void resize(int newLength);
+	void reserve(int newCapacity);
 
 	int find(const elem_type& elem) const
 	{
@@ -149,6 +150,72 @@ public:
 		if(descending) reverse();
 	}
 
+	// sorting in the order of a comparator or on a key taken
+	// from each element (see _sort_.h for both)
+	template<typename comparator> void sort(comparator cmp)
+	{
+		_sort_<elem_type> sorter;
+		sorter.sort(_array, _length, cmp);
+	}
+	template<typename key_extractor> void sortByKey(key_extractor key)
+	{
+		_sort_<elem_type> sorter;
+		sorter.sortByKey(_array, _length, key);
+	}
+
+	// stable sorting: equal elements keep their relative order
+	// (also when descending, which is why it doesn't reverse())
+	void stableSort(bool descending = false)
+	{
+		_sort_<elem_type> sorter;
+		if(descending)
+			sorter.stableSort(_array, _length,
+				_reverse_comparator_< _comparator_<elem_type> >(_comparator_<elem_type>()));
+		else
+			sorter.stableSort(_array, _length);
+	}
+	template<typename comparator> void stableSort(comparator cmp)
+	{
+		_sort_<elem_type> sorter;
+		sorter.stableSort(_array, _length, cmp);
+	}
+	template<typename key_extractor> void stableSortByKey(key_extractor key)
+	{
+		_sort_<elem_type> sorter;
+		sorter.stableSortByKey(_array, _length, key);
+	}
+
+	// partial ordering: only the first k elements get sorted,
+	// or only the element at index gets its sorted place
+	void partialSort(int k, bool descending = false)
+	{
+		_sort_<elem_type> sorter;
+		if(descending)
+			sorter.partialSort(_array, _length, k,
+				_reverse_comparator_< _comparator_<elem_type> >(_comparator_<elem_type>()));
+		else
+			sorter.partialSort(_array, _length, k);
+	}
+	template<typename comparator> void partialSort(int k, comparator cmp)
+	{
+		_sort_<elem_type> sorter;
+		sorter.partialSort(_array, _length, k, cmp);
+	}
+	void nthElement(int index, bool descending = false)
+	{
+		_sort_<elem_type> sorter;
+		if(descending)
+			sorter.nthElement(_array, _length, index,
+				_reverse_comparator_< _comparator_<elem_type> >(_comparator_<elem_type>()));
+		else
+			sorter.nthElement(_array, _length, index);
+	}
+	template<typename comparator> void nthElement(int index, comparator cmp)
+	{
+		_sort_<elem_type> sorter;
+		sorter.nthElement(_array, _length, index, cmp);
+	}
+
 	void reverse()
 	{
 		if(_length < 2) return;
@@ -233,6 +300,25 @@ template<typename elem_type>
 	_length = newLength;
 }
 
+//------------------------------------------------------------
+// Make room for at least the specified number of elements,
+// so that the array can grow to that length without
+// reallocating. Never shrinks the array.
+template<typename elem_type>
+	void _array_<elem_type>::reserve ( int newCapacity )
+{
+	if(newCapacity <= _allocSize) return;
+	elem_type* newarray = (elem_type*) malloc(newCapacity*sizeof(elem_type));
+	_constructN<elem_type>(newarray, _array, _length);
+	if(_array)
+	{
+		_destroyN<elem_type>(_array, _length);
+		free(_array);
+	}
+	_array = newarray;
+	_allocSize = newCapacity;
+}
+
 //------------------------------------------------------------
 // Insert the specified number of elements from a normal C
 // array of same-typed elements into this array starting at
@@ -10,6 +10,7 @@
 
 #include "_common_.h"
 #include "_strfuncs_.h"
+#include "_string_view_.h"
 
 #if defined(UNICODE) || defined(_UNICODE)
 	#error soige utils: _boyer_moore_ does not support Unicode compilation
@@ -35,6 +36,9 @@ public:
 
 	bool match (LPCTSTR pString, long  stringLen,
 				long* pMatchStart = NULL, long* pMatchLength = NULL);
+	bool match (const _string_view_& str,
+				long* pMatchStart = NULL, long* pMatchLength = NULL)
+		{ return match(str.data(), str.length(), pMatchStart, pMatchLength); }
 
 private:
 	LPTSTR	_pattern;
@@ -0,0 +1,303 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _column_table_.cpp - implementation file for the
+// _column_table_ class and its dictionary string column.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_column_table_.h"
+
+namespace soige {
+
+//------------------------------------------------------------
+// dict_string_column
+//------------------------------------------------------------
+bool dict_string_column::equals(const table_column& other) const
+{
+	if(other.type() != column_dict_string || other.length() != length())
+		return false;
+	// the codes of the same value can differ between two columns
+	const dict_string_column& o = static_cast<const dict_string_column&>(other);
+	for(int row=0; row<length(); row++)
+		if(_compare(get(row), o.get(row)) != 0)
+			return false;
+	return true;
+}
+
+
+//------------------------------------------------------------
+// _column_table_
+//------------------------------------------------------------
+_column_table_& _column_table_::operator=(const _column_table_& other)
+{
+	if(this == &other)
+		return *this;
+	_colNames = other._colNames;
+	_columns.clear();
+	for(int i=0; i<other._columns.length(); i++)
+		_columns.append(_ptr_<table_column>(other._columns[i]->clone()));
+	_rowCount = other._rowCount;
+	return *this;
+}
+
+bool _column_table_::operator==(const _column_table_& other) const
+{
+	if(this == &other) return true;
+	if(_rowCount != other._rowCount || _colNames != other._colNames) return false;
+	for(int i=0; i<_columns.length(); i++)
+		if( !_columns[i]->equals(*other._columns[i]) ) return false;
+	return true;
+}
+
+table_column* _column_table_::_newColumn(column_type type)
+{
+	switch(type)
+	{
+	case column_int:
+		return new _table_column_<int>();
+	case column_int64:
+		return new _table_column_<__int64>();
+	case column_double:
+		return new _table_column_<double>();
+	case column_string:
+		return new _table_column_<_string_>();
+	default:
+		return new dict_string_column();
+	}
+}
+
+void _column_table_::insertColumn(const _string_& colName, column_type type, int index)
+{
+	if(index < 0)
+		return;
+	if(index > _colNames.length())
+		index = _colNames.length();
+
+	_colNames.insert(colName, index);
+	_columns.insert(_ptr_<table_column>(_newColumn(type)), index);
+	if(_rowCount > 0)
+		_columns[index]->insertEmpty(0, _rowCount);
+}
+
+bool _column_table_::swapColumns(int col1, int col2)
+{
+	if( col1 < 0 || col2 < 0 || col1 >= _colNames.length() || col2 >= _colNames.length() )
+		return false;
+	_string_ tempName = _colNames[col1];
+	_colNames[col1] = _colNames[col2];
+	_colNames[col2] = tempName;
+	_ptr_<table_column> temp = _columns[col1];
+	_columns[col1] = _columns[col2];
+	_columns[col2] = temp;
+	return true;
+}
+
+bool _column_table_::insertRows(int index, int count)
+{
+	if(index < 0 || count < 1)
+		return false;
+	if(index > _rowCount)
+		index = _rowCount;
+	for(int i=0; i<_columns.length(); i++)
+		_columns[i]->insertEmpty(index, count);
+	_rowCount += count;
+	return true;
+}
+
+bool _column_table_::removeRows(int row, int count)
+{
+	if(row < 0 || row >= _rowCount || count < 1)
+		return false;
+	if(count > _rowCount - row)
+		count = _rowCount - row;
+	for(int i=0; i<_columns.length(); i++)
+		_columns[i]->remove(row, count);
+	_rowCount -= count;
+	return true;
+}
+
+bool _column_table_::swapRows(int row1, int row2)
+{
+	if(row1 < 0 || row2 < 0 || row1 >= _rowCount || row2 >= _rowCount)
+		return false;
+	for(int i=0; i<_columns.length(); i++)
+		_columns[i]->swap(row1, row2);
+	return true;
+}
+
+__int64 _column_table_::getInt64(int row, int col) const
+{
+	const table_column* column = &(*_columns.get(col));
+	if(column->type() == column_int)
+		return static_cast<const _table_column_<int>*>(column)->values[row];
+	return _typedColumn(col, (__int64*)NULL)->values[row];
+}
+
+double _column_table_::getDouble(int row, int col) const
+{
+	const table_column* column = &(*_columns.get(col));
+	switch(column->type())
+	{
+	case column_int:
+		return static_cast<const _table_column_<int>*>(column)->values[row];
+	case column_int64:
+		return (double)static_cast<const _table_column_<__int64>*>(column)->values[row];
+	default:
+		return _typedColumn(col, (double*)NULL)->values[row];
+	}
+}
+
+const _string_& _column_table_::getString(int row, int col) const
+{
+	const table_column* column = &(*_columns.get(col));
+	if(column->type() == column_dict_string)
+		return static_cast<const dict_string_column*>(column)->get(row);
+	return _typedColumn(col, (_string_*)NULL)->values[row];
+}
+
+void _column_table_::setString(int row, int col, const _string_& val)
+{
+	table_column* column = _columns.get(col).operator->();
+	if(column->type() == column_dict_string)
+		static_cast<dict_string_column*>(column)->set(row, val);
+	else
+		_typedColumn(col, (_string_*)NULL)->values[row] = val;
+}
+
+//------------------------------------------------------------
+// Finding
+int _column_table_::findInt(int col, int val, int fromRow) const
+{
+	const int* values = getIntData(col);
+	if(values == NULL)
+		return -1;
+	if(fromRow < 0)
+		fromRow = 0;
+	for(int row=fromRow; row<_rowCount; row++)
+		if(values[row] == val)
+			return row;
+	return -1;
+}
+
+int _column_table_::findInt64(int col, __int64 val, int fromRow) const
+{
+	const __int64* values = getInt64Data(col);
+	if(values == NULL)
+		return -1;
+	if(fromRow < 0)
+		fromRow = 0;
+	for(int row=fromRow; row<_rowCount; row++)
+		if(values[row] == val)
+			return row;
+	return -1;
+}
+
+int _column_table_::findDouble(int col, double val, int fromRow) const
+{
+	const double* values = getDoubleData(col);
+	if(values == NULL)
+		return -1;
+	if(fromRow < 0)
+		fromRow = 0;
+	for(int row=fromRow; row<_rowCount; row++)
+		if(values[row] == val)
+			return row;
+	return -1;
+}
+
+int _column_table_::findString(int col, const _string_& val, int fromRow) const
+{
+	if(col < 0 || col >= _columns.length())
+		return -1;
+	if(fromRow < 0)
+		fromRow = 0;
+	int row;
+	const table_column* column = &(*_columns[col]);
+	if(column->type() == column_dict_string)
+	{
+		// look the value up once, then compare the codes
+		const dict_string_column* dict = static_cast<const dict_string_column*>(column);
+		int code = dict->findCode(val);
+		if(code < 0)
+			return -1;
+		return dict->findRow(code, fromRow);
+	}
+	else if(column->type() == column_string)
+	{
+		const _array_<_string_>& values = static_cast<const _table_column_<_string_>*>(column)->values;
+		for(row=fromRow; row<_rowCount; row++)
+			if(_compare(values[row], val) == 0)
+				return row;
+	}
+	return -1;
+}
+
+//------------------------------------------------------------
+// Sorting
+
+// orders row indexes on several columns of any type;
+// equal rows stay in their order
+class _column_row_order_
+{
+public:
+	_column_row_order_(const table_column* const* columns, const int* signs, int ncolumns) :
+		_columns(columns), _signs(signs), _ncolumns(ncolumns)
+	{ }
+	int operator()(const int& row1, const int& row2) const
+	{
+		for(int i=0; i<_ncolumns; i++)
+		{
+			int c = _columns[i]->compareRows(row1, row2);
+			if(c != 0)
+				return c * _signs[i];
+		}
+		return row1 - row2;
+	}
+protected:
+	const table_column* const*	_columns;
+	const int*	_signs;
+	int			_ncolumns;
+};
+
+bool _column_table_::getSortPermutation(const sort_key* keys, int nkeys, _array_<int>& perm) const
+{
+	int i;
+	if(nkeys < 1)
+		return false;
+	for(i=0; i<nkeys; i++)
+		if(keys[i].col < 0 || keys[i].col >= _colNames.length())
+			return false;
+
+	perm.resize(_rowCount);
+	for(i=0; i<_rowCount; i++)
+		perm[i] = i;
+	if(_rowCount < 2)
+		return true;
+
+	_array_<const table_column*> columns;
+	_array_<int> signs;
+	columns.resize(nkeys);
+	signs.resize(nkeys);
+	for(i=0; i<nkeys; i++)
+	{
+		columns[i] = &(*_columns[keys[i].col]);
+		signs[i] = keys[i].descending ? -1 : 1;
+	}
+	_sort_<int> sorter;
+	sorter.sort(&perm[0], _rowCount, _column_row_order_(&columns[0], &signs[0], nkeys));
+	return true;
+}
+
+bool _column_table_::sort(const sort_key* keys, int nkeys)
+{
+	_array_<int> perm;
+	if( !getSortPermutation(keys, nkeys, perm) )
+		return false;
+	if(_rowCount < 2)
+		return true;
+	for(int i=0; i<_columns.length(); i++)
+		_columns[i]->permute(perm);
+	return true;
+}
+
+
+};	// namespace soige
@@ -0,0 +1,421 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _column_table_.h - header file for the _column_table_ class.
+//
+// Provides a two-dimensional (rows-columns) table where
+// each column has a type of its own: int, __int64, double,
+// string, or string stored through a dictionary of its
+// distinct values. Each column keeps its values densely in
+// an array of their own type, as _table_<> does for its
+// single type, so numeric columns can be scanned directly.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __column_table_already_included_vasya__
+#define __column_table_already_included_vasya__
+
+#include "_string_.h"
+#include "_array_.h"
+#include "_ptr_.h"
+#include "_table_.h"
+
+namespace soige {
+
+// the physical types of the columns
+enum column_type
+{
+	column_int,			// int
+	column_int64,		// __int64
+	column_double,		// double
+	column_string,		// _string_
+	column_dict_string	// _string_, each distinct value stored once
+};
+
+// the column type holding values of a C++ type
+inline column_type _columnType(const int*)			{ return column_int; }
+inline column_type _columnType(const __int64*)		{ return column_int64; }
+inline column_type _columnType(const double*)		{ return column_double; }
+inline column_type _columnType(const _string_*)		{ return column_string; }
+
+//------------------------------------------------------------
+// A column of a _column_table_: the operations the table
+// needs without knowing the type of the values
+//------------------------------------------------------------
+class table_column
+{
+public:
+	virtual ~table_column() { }
+
+	virtual column_type type() const = 0;
+	virtual int length() const = 0;
+	virtual table_column* clone() const = 0;
+	virtual bool equals(const table_column& other) const = 0;
+
+	// adds count empty values (0 or "") at row
+	virtual void insertEmpty(int row, int count) = 0;
+	virtual void remove(int row, int count) = 0;
+	virtual void reserve(int rows) = 0;
+	virtual void clear() = 0;
+	virtual void swap(int row1, int row2) = 0;
+	// moves row perm[i] to row i, for all the rows
+	virtual void permute(const _array_<int>& perm) = 0;
+	// <0, 0 or >0 as the value in row1 is less than, equal
+	// to or greater than the one in row2
+	virtual int compareRows(int row1, int row2) const = 0;
+};
+
+//------------------------------------------------------------
+// A column of plain values: int, __int64, double or _string_
+//------------------------------------------------------------
+template<typename value_type> class _table_column_ : public table_column
+{
+public:
+	_array_<value_type> values;
+
+	column_type type() const
+	{
+		return _columnType((const value_type*)NULL);
+	}
+	int length() const
+	{
+		return values.length();
+	}
+	table_column* clone() const
+	{
+		_table_column_<value_type>* column = new _table_column_<value_type>();
+		column->values = values;
+		return column;
+	}
+	bool equals(const table_column& other) const
+	{
+		return ( other.type() == type() &&
+				 static_cast<const _table_column_<value_type>&>(other).values == values );
+	}
+
+	void insertEmpty(int row, int count)
+	{
+		if(count == 1)
+		{
+			values.insert(value_type(), row);
+			return;
+		}
+		// resize() leaves numbers uninitialized
+		_array_<value_type> empty;
+		empty.resize(count);
+		for(int i=0; i<count; i++)
+			empty[i] = value_type();
+		values.insertNAt(row, &empty[0], count);
+	}
+	void remove(int row, int count)
+	{
+		values.removeNAt(row, count);
+	}
+	void reserve(int rows)
+	{
+		values.reserve(rows);
+	}
+	void clear()
+	{
+		values.clear();
+	}
+	void swap(int row1, int row2)
+	{
+		value_type temp = values[row1];
+		values[row1] = values[row2];
+		values[row2] = temp;
+	}
+	void permute(const _array_<int>& perm)
+	{
+		_array_<value_type> moved;
+		moved.resize(values.length());
+		for(int row=0; row<moved.length(); row++)
+			moved[row] = values[perm[row]];
+		_copyN<value_type>(&values[0], &moved[0], moved.length());
+	}
+	int compareRows(int row1, int row2) const
+	{
+		return _compare(values[row1], values[row2]);
+	}
+};
+
+//------------------------------------------------------------
+// A string column that keeps each distinct value once, in
+// a dictionary, and a code per row pointing into it: the
+// _table_dict_column_ of _table_<> made a table_column, with
+// codes as narrow as the dictionary allows. Code 0 is the
+// empty string.
+//------------------------------------------------------------
+class dict_string_column : public table_column, public _table_dict_column_<_string_>
+{
+public:
+	typedef _table_dict_column_<_string_> dict_column;
+
+	dict_string_column()
+	{
+		encode(_string_());
+	}
+
+	column_type type() const
+	{
+		return column_dict_string;
+	}
+	int length() const
+	{
+		return dict_column::length();
+	}
+	table_column* clone() const
+	{
+		return new dict_string_column(*this);
+	}
+	bool equals(const table_column& other) const;
+
+	void insertEmpty(int row, int count)
+	{
+		insertValue(row, _string_(), count);
+	}
+	void remove(int row, int count)
+	{
+		dict_column::remove(row, count);
+	}
+	void reserve(int rows)
+	{
+		dict_column::reserve(rows);
+	}
+	// clears the rows; the dictionary stays
+	void clear()
+	{
+		dict_column::clear();
+	}
+	void swap(int row1, int row2)
+	{
+		dict_column::swap(row1, row2);
+	}
+	void permute(const _array_<int>& perm)
+	{
+		dict_column::permute(perm);
+	}
+	int compareRows(int row1, int row2) const
+	{
+		int code1 = getCode(row1), code2 = getCode(row2);
+		if(code1 == code2)
+			return 0;
+		return _compare(decode(code1), decode(code2));
+	}
+};
+
+//------------------------------------------------------------
+// The column table class
+//------------------------------------------------------------
+class _column_table_
+{
+public:
+	//-------------------------------------------------
+	// constructors
+	_column_table_()
+	{
+		_rowCount = 0;
+	}
+	_column_table_(const _column_table_& other)
+	{
+		_rowCount = 0;
+		operator=(other);
+	}
+	virtual ~_column_table_()
+	{
+		clear();
+	}
+
+	//-------------------------------------------------
+	// operators
+	virtual _column_table_& operator=(const _column_table_& other);
+	bool operator==(const _column_table_& other) const;
+	bool operator!=(const _column_table_& other) const
+	{
+		return ( !this->operator==(other) );
+	}
+
+	//-------------------------------------------------
+	// attributes
+
+	// Column operations
+	void insertColumn(const _string_& colName, column_type type, int index);
+	void appendColumn(const _string_& colName, column_type type)
+	{
+		insertColumn(colName, type, _colNames.length());
+	}
+	void removeColumn(int index)
+	{
+		_colNames.removeAt(index);
+		_columns.removeAt(index);
+	}
+	bool swapColumns(int col1, int col2);
+	void setColumnName(int col, const _string_& colName)
+	{
+		if(col < 0 || col >= _colNames.length())
+			return;
+		_colNames[col] = colName;
+	}
+	int getColumnCount() const
+	{
+		return _colNames.length();
+	}
+	_string_ getColumnName(int col) const
+	{
+		return _colNames[col];
+	}
+	int getColumnByName(const _string_& colName) const
+	{
+		return _colNames.find(colName);
+	}
+	column_type getColumnType(int col) const
+	{
+		return _columns.get(col)->type();
+	}
+
+	// Row operations: rows are added with empty values
+	// (0 or ""), to be set with the set...() functions
+	int getRowCount() const
+	{
+		return _rowCount;
+	}
+	bool insertRows(int index, int count);
+	bool insertRow(int index)
+	{
+		return insertRows(index, 1);
+	}
+	// returns the index of the new row
+	int appendRow()
+	{
+		insertRows(_rowCount, 1);
+		return _rowCount - 1;
+	}
+	bool removeRows(int row, int count);
+	bool removeRow(int row)
+	{
+		return removeRows(row, 1);
+	}
+	bool swapRows(int row1, int row2);
+	void reserveRows(int rows)
+	{
+		for(int i=0; i<_columns.length(); i++)
+			_columns[i]->reserve(rows);
+	}
+	// Clear all the rows, but leave all column definitions intact
+	void removeAllRows()
+	{
+		for(int i=0; i<_columns.length(); i++)
+			_columns[i]->clear();
+		_rowCount = 0;
+	}
+	// Removes everything from the table,
+	// including both columns and data
+	void clear()
+	{
+		_colNames.clear();
+		_columns.clear();
+		_rowCount = 0;
+	}
+
+	// Values: each column is read and written as its own type;
+	// the wrong type for the column throws. Numeric columns can
+	// also be read as any wider type (int as __int64 or double,
+	// __int64 as double).
+	int getInt(int row, int col) const
+	{
+		return _typedColumn(col, (int*)NULL)->values[row];
+	}
+	__int64 getInt64(int row, int col) const;
+	double getDouble(int row, int col) const;
+	const _string_& getString(int row, int col) const;
+
+	void setInt(int row, int col, int val)
+	{
+		_typedColumn(col, (int*)NULL)->values[row] = val;
+	}
+	void setInt64(int row, int col, __int64 val)
+	{
+		_typedColumn(col, (__int64*)NULL)->values[row] = val;
+	}
+	void setDouble(int row, int col, double val)
+	{
+		_typedColumn(col, (double*)NULL)->values[row] = val;
+	}
+	void setString(int row, int col, const _string_& val);
+
+	// The values of a whole column, to scan without going through
+	// the accessors; NULL if the column is of another type
+	const int* getIntData(int col) const
+	{
+		return _columnData(col, (int*)NULL);
+	}
+	const __int64* getInt64Data(int col) const
+	{
+		return _columnData(col, (__int64*)NULL);
+	}
+	const double* getDoubleData(int col) const
+	{
+		return _columnData(col, (double*)NULL);
+	}
+	// the column itself, for the dictionary of a column_dict_string
+	// one and the like
+	const table_column* getColumn(int col) const
+	{
+		return &(*_columns.get(col));
+	}
+
+	// Finding: the first row from fromRow on having the value in
+	// the column, or -1; a negative fromRow is the first row
+	int findInt(int col, int val, int fromRow = 0) const;
+	int findInt64(int col, __int64 val, int fromRow = 0) const;
+	int findDouble(int col, double val, int fromRow = 0) const;
+	// compares codes, not strings, in a column_dict_string column
+	int findString(int col, const _string_& val, int fromRow = 0) const;
+
+	// Sorting: as in _table_, the row indexes are sorted on the
+	// columns' values and then each column is rearranged once.
+	// Rows with equal keys keep their order; the tables have no
+	// null values, so sort_key::nulls doesn't matter.
+	bool sort(int col)
+	{
+		sort_key key(col);
+		return sort(&key, 1);
+	}
+	bool sort(const sort_key* keys, int nkeys);
+	bool getSortPermutation(const sort_key* keys, int nkeys, _array_<int>& perm) const;
+
+protected:
+	// column names
+	_array_<_string_> _colNames;
+	// the columns, each holding the values of all the rows
+	_array_< _ptr_<table_column> > _columns;
+
+	int _rowCount;
+
+protected:
+	// the column as the typed column of value_type, or throws
+	template<typename value_type>
+		_table_column_<value_type>* _typedColumn(int col, value_type*) const
+	{
+		table_column* column = _columns.get(col).operator->();
+		if(column->type() != _columnType((const value_type*)NULL))
+			throw exception( "Column type mismatch" );
+		return static_cast<_table_column_<value_type>*>(column);
+	}
+	// the values of the column if it holds value_type, or NULL
+	template<typename value_type>
+		const value_type* _columnData(int col, value_type*) const
+	{
+		if(col < 0 || col >= _columns.length())
+			return NULL;
+		const table_column* column = &(*_columns[col]);
+		if(column->type() != _columnType((const value_type*)NULL) || _rowCount == 0)
+			return NULL;
+		return &static_cast<const _table_column_<value_type>*>(column)->values[0];
+	}
+	// a new empty column of a type
+	static table_column* _newColumn(column_type type);
+};
+
+
+};	// namespace soige
+
+#endif // __column_table_already_included_vasya__
@@ -226,18 +226,21 @@ template<> inline int _compare<short>(const short& a, const short& b)
 	{ return (a - b); }
 template<> inline int _compare<unsigned short>(const unsigned short& a, const unsigned short& b)
 	{ return (int)(a - b); }
+// wider types can't return the plain difference: it overflows (ints)
+// or truncates to zero (floating point), so the order would disagree
+// with the one produced by the radix sorts in _sort_.h
 template<> inline int _compare<int>(const int& a, const int& b)
-	{ return (a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<unsigned int>(const unsigned int& a, const unsigned int& b)
-	{ return (int)(a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<long>(const long& a, const long& b)
-	{ return (int)(a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<unsigned long>(const unsigned long& a, const unsigned long& b)
-	{ return (int)(a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<float>(const float& a, const float& b)
-	{ return (int)(a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<double>(const double& a, const double& b)
-	{ return (int)(a - b); }
+	{ return (a > b) - (a < b); }
 template<> inline int _compare<LPCTSTR>(const LPTSTR& a, const LPTSTR& b)
 	{ return lstrcmp(a, b); }
 template<> inline int _compare<LPTSTR>(const LPTSTR& a, const LPTSTR& b)
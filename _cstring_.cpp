@@ -4,6 +4,7 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include "_cstring_.h"
+#include "_num_conv_.h"
 
 namespace soige {
 
@@ -64,6 +65,13 @@ _cstring_::_cstring_(double val)
 	this->operator=(val);
 }
 
+_cstring_::_cstring_(const _string_view_& view)
+{
+	_p = NULL;
+	_len = _buflen = 0;
+	this->operator=(view);
+}
+
 _cstring_::~_cstring_()
 {
 	_free();
@@ -94,6 +102,18 @@ _cstring_& _cstring_::operator=(LPCSTR lpstr)
 	return *this;
 }
 
+_cstring_& _cstring_::operator=(const _string_view_& view)
+{
+	if(view.isNull()) return _free(), *this;
+	// the view can be of this string
+	_cstring_ s;
+	if( !s._alloc(view.length()+1) ) return *this;
+	memcpy(s._p, view.data(), view.length());
+	s._p[s._len = view.length()] = '\0';
+	swap(s);
+	return *this;
+}
+
 _cstring_& _cstring_::operator=(char chr)
 {
 	_free();
@@ -137,6 +157,8 @@ _cstring_& _cstring_::operator+=(const _cstring_& refstr)
 _cstring_& _cstring_::operator+=(LPCSTR lpstr)
 {
 	if(NULL==lpstr || 0==lpstr[0]) return *this;
+	// lpstr can be in this string, which is about to move
+	if(lpstr >= _p && lpstr < _p+_buflen) return this->operator+=(_cstring_(lpstr));
 	
 	int addsize = lstrlenA(lpstr);
 	if(_len+addsize >= _buflen)
@@ -146,12 +168,17 @@ _cstring_& _cstring_::operator+=(LPCSTR lpstr)
 	return *this;
 }
 
+_cstring_& _cstring_::operator+=(const _string_view_& view)
+{
+	return replaceBytes(view.data(), view.length(), _len, 0);
+}
+
 _cstring_& _cstring_::operator+=(char chr)
 {
 	int cch = _len+1;
 
 	if(cch >= _buflen)
-		if( !_realloc(cch) ) return *this;
+		if( !_realloc(cch+1) ) return *this;
 	_p[_len] = chr;
 	_p[++_len] = '\0';
 	return *this;
@@ -159,15 +186,15 @@ _cstring_& _cstring_::operator+=(char chr)
 
 _cstring_& _cstring_::operator+=(long val)
 {
-	char buf[32];
-	_ltoa(val, buf, 10);
+	char buf[NUM_CONV_CHARS];
+	_formatLong(val, buf);
 	return this->operator+=(buf);
 }
 
 _cstring_& _cstring_::operator+=(double val)
 {
-	char buf[64];
-	_gcvt(val, 8, buf);
+	char buf[NUM_CONV_CHARS];
+	_formatDouble(val, buf);
 	return this->operator+=(buf);
 }
 
@@ -201,7 +228,7 @@ bool _cstring_::operator<(LPCSTR lpstr) const
 
 bool _cstring_::operator==(const _cstring_& refstr) const
 {
-	if( _len == refstr._len && memcmp(_p, refstr._p, _len) == 0 )
+	if( _len == refstr._len && _compareChars(_p, refstr._p, _len, true) == 0 )
 		return true;
 	return false;
 }
@@ -213,7 +240,7 @@ bool _cstring_::operator==(LPCSTR lpstr) const
 
 bool _cstring_::operator!=(const _cstring_& refstr) const
 {
-	if( _len == refstr._len && memcmp(_p, refstr._p, _len) == 0 )
+	if( _len == refstr._len && _compareChars(_p, refstr._p, _len, true) == 0 )
 		return false;
 	return true;
 }
@@ -223,15 +250,26 @@ bool _cstring_::operator!=(LPCSTR lpstr) const
 	return (compare(lpstr, false) != 0);
 }
 
+bool _cstring_::operator==(const _string_view_& view) const
+{
+	return ( _len == view.length() && _compareChars(_p, view.data(), _len, true) == 0 );
+}
+
+bool _cstring_::operator!=(const _string_view_& view) const
+{
+	return !this->operator==(view);
+}
+
+int _cstring_::compare(const _string_view_& view, bool case_sensitive) const
+{
+	return this->view().compare(view, case_sensitive);
+}
+
 int _cstring_::compare(const _cstring_& refstr, bool case_sensitive) const
 {
 
-	int result;
 	// one or both strings can be null, have to guard against that
-	if(case_sensitive)
-		result = memcmp ( _p, refstr._p, (_len <= refstr._len)? _len : refstr._len );
-	else
-		result = memicmp( _p, refstr._p, (_len <= refstr._len)? _len : refstr._len );
+	int result = _compareChars( _p, refstr._p, (_len <= refstr._len)? _len : refstr._len, case_sensitive );
 	
 	if(result == 0) return ( (_len == refstr._len) ? 0 : ((_len > refstr._len) ? 1 : -1) );
 	else			return result;
@@ -243,13 +281,22 @@ int _cstring_::compare(LPCSTR lpstr, bool case_sensitive) const
 	else				return lstrcmpiA(_p, lpstr);
 }
 
+bool _cstring_::startsWith(const _string_view_& view, bool case_sensitive) const
+{
+	return this->view().startsWith(view, case_sensitive);
+}
+
+bool _cstring_::endsWith(const _string_view_& view, bool case_sensitive) const
+{
+	return this->view().endsWith(view, case_sensitive);
+}
+
 bool _cstring_::startsWith(LPCSTR lpstr, bool case_sensitive) const
 {
 	int len = lstrlenA(lpstr);
 	if(len > _len) return false;
 
-	if(case_sensitive)	return memcmp (_p, lpstr, len) == 0;
-	else				return memicmp(_p, lpstr, len) == 0;
+	return _compareChars(_p, lpstr, len, case_sensitive) == 0;
 }
 
 bool _cstring_::endsWith(LPCSTR lpstr, bool case_sensitive) const
@@ -257,8 +304,7 @@ bool _cstring_::endsWith(LPCSTR lpstr, bool case_sensitive) const
 	int len = lstrlenA(lpstr);
 	if(len > _len) return false;
 
-	if(case_sensitive)	return memcmp (&_p[_len-len], lpstr, len) == 0;
-	else				return memicmp(&_p[_len-len], lpstr, len) == 0;
+	return _compareChars(&_p[_len-len], lpstr, len, case_sensitive) == 0;
 }
 
 _cstring_& _cstring_::append(const _cstring_& refstr)
@@ -271,6 +317,11 @@ _cstring_& _cstring_::append(LPCSTR lpstr)
 	return this->operator+=(lpstr);
 }
 
+_cstring_& _cstring_::append(const _string_view_& view)
+{
+	return this->operator+=(view);
+}
+
 _cstring_& _cstring_::append(char chr)
 {
 	return this->operator+=(chr);
@@ -288,6 +339,14 @@ _cstring_& _cstring_::append(double val)
 
 void _cstring_::swap(_cstring_& refstr)
 {
+	if(this == &refstr) return;
+	// the local buffers swap their chars, and a string
+	// that was in one is then in the other
+	char temp_local[CSTRING_LOCAL_SIZE];
+	memcpy(temp_local, _local, sizeof(_local));
+	memcpy(_local, refstr._local, sizeof(_local));
+	memcpy(refstr._local, temp_local, sizeof(_local));
+
 	LPSTR temp_p = _p;
 	int temp_len = _len;
 	int temp_buflen = _buflen;
@@ -299,6 +358,9 @@ void _cstring_::swap(_cstring_& refstr)
 	refstr._p = temp_p;
 	refstr._len = temp_len;
 	refstr._buflen = temp_buflen;
+
+	if(_p == refstr._local) _p = _local;
+	if(refstr._p == _local) refstr._p = refstr._local;
 }
 
 _cstring_& _cstring_::insert(LPCSTR insert_str, int start)
@@ -330,8 +392,16 @@ _cstring_& _cstring_::replaceBytes(const void* pData, int byteCount, int start,
 {
 	if(start < 0 || bytes_to_del < 0 || NULL == pData || byteCount < 0) return *this;
 	if(start+bytes_to_del > _len) bytes_to_del = _len-start;
+	// pData can be in this string, which is about to move
+	if((LPCSTR)pData >= _p && (LPCSTR)pData < _p+_buflen)
+	{
+		_cstring_ s;
+		if( !s._alloc(byteCount+1) ) return *this;
+		memcpy(s._p, pData, byteCount);
+		return replaceBytes(s._p, byteCount, start, bytes_to_del);
+	}
 	int newlen = _len + byteCount - bytes_to_del;
-	if( !_realloc(newlen) ) return *this;
+	if( !_realloc(newlen+1) ) return *this;
 	memmove ( &_p[start+byteCount], &_p[start+bytes_to_del], _len-start-bytes_to_del );
 	memcpy ( &_p[start], pData, byteCount );
 	_len = newlen;
@@ -399,27 +469,36 @@ long _cstring_::split( _array_<_cstring_>& ret_arr,
 }
 
 // default for @delim = " "; @first_index = 0; @last_index = -1 (until last elem)
+// The length is added up first, and the chars copied once.
 /* static */
 _cstring_ _cstring_::join ( const _array_<_cstring_>& str_array,
 						  LPCSTR delim, int first_index, int last_index )
 {
 	_cstring_ retval;
-	bool empty_delim = (NULL == delim || delim[0] == '\0');
-	if( str_array.length() == 0 ) return retval;
-	
-	// use @delim to join the values in the string array
-	// from @first_index to @last_index into one string
 	if(first_index < 0)
 		first_index = 0;
 	if( last_index == -1 || last_index > str_array.length()-1 )
 		last_index = str_array.length() - 1;
-	for(int i=first_index; i<=last_index; i++)
+	int delim_len = delim ? lstrlenA(delim) : 0;
+	int total = 0, i;
+	for(i=first_index; i<=last_index; i++)
+		total += str_array[i]._len + ((i != last_index) ? delim_len : 0);
+	if(total == 0) return retval;
+
+	if( !retval._alloc(total+1) ) return retval;
+	LPSTR p = retval._p;
+	for(i=first_index; i<=last_index; i++)
 	{
-		retval.append(str_array[i]);
-		if( !empty_delim && i != last_index )
-			retval.append(delim);
+		memcpy(p, str_array[i]._p, str_array[i]._len);
+		p += str_array[i]._len;
+		if(i != last_index && delim_len > 0)
+		{
+			memcpy(p, delim, delim_len);
+			p += delim_len;
+		}
 	}
-	
+	*p = '\0';
+	retval._len = total;
 	return retval;
 }
 
@@ -515,6 +594,16 @@ _cstring_& _cstring_::formatDate( LPCSTR date_format, LPCSTR time_format,
 
 #endif // ALL_STRING_STUFF
 
+_string_view_ _cstring_::view() const
+{
+	return _string_view_(_p, _len);
+}
+
+_string_view_ _cstring_::view(int start, int count) const
+{
+	return view().substring(start, count);
+}
+
 _cstring_ _cstring_::substring(int start) const
 {
 	return substring(start, _len);
@@ -527,7 +616,7 @@ _cstring_ _cstring_::substring(int start, int count) const
 	if( start < 0 || start >= _len || count <= 0 )
 		return ( newstr.operator=("") );
 	int tocopy = (count>_len-start) ? (_len-start) : count;
-	if( !newstr._alloc(tocopy) ) return newstr;
+	if( !newstr._alloc(tocopy+1) ) return newstr;
 	memmove(newstr._p, &_p[start], tocopy);
 	newstr._p[tocopy] = '\0';
 	newstr._len = tocopy;
@@ -705,29 +794,13 @@ int _cstring_::find(const _cstring_& refstr, int start, bool case_sensitive) con
 	if(start < 0 || start >= _len || refstr._len > _len) return -1;
 	if(refstr._len == 0) return start;
 
-	int i;
-	int until = _len - refstr._len;
-
-	for(; start<=until; start++)
-	{
-		if( (_p[start] == refstr._p[0] ) ||
-			(!case_sensitive && tolower(_p[start]) == tolower(refstr._p[0]))
-		  )
-		{
-			i = 0;
-			while(i < refstr._len)
-			{
-				if( (_p[start+i] == refstr._p[i] ) ||
-					(!case_sensitive && tolower(_p[start+i]) == tolower(refstr._p[i]))
-				  )
-					i++;
-				else break;
-			}
-			if(i == refstr._len) return start; // reached the end and matched so far - full match
-		}
-	}
+	return _findChars(_p, _len, refstr._p, refstr._len, start, case_sensitive);
+}
 
-	return -1;
+int _cstring_::find(const _string_view_& view, int start, bool case_sensitive) const
+{
+	if(start < 0 || start >= _len) return -1;
+	return this->view().find(view, start, case_sensitive);
 }
 
 int _cstring_::find(LPCSTR lpstr, int start, bool case_sensitive) const
@@ -736,30 +809,8 @@ int _cstring_::find(LPCSTR lpstr, int start, bool case_sensitive) const
 	if(lpstr[0] == '\0') return start;
 	int slen = lstrlenA(lpstr);
 	if(slen > _len) return -1;
-	int i;
-	int until = _len - slen;
-
 	// there can be embedded null chars in this->_p, so can't just use strstr
-	for(; start<=until; start++)
-	{
-		if( (_p[start] == lpstr[0] ) ||
-			(!case_sensitive && tolower(_p[start]) == tolower(lpstr[0]))
-		  )
-		{
-			i = 0;
-			while(i < slen)
-			{
-				if( (_p[start+i] == lpstr[i] ) ||
-					(!case_sensitive && tolower(_p[start+i]) == tolower(lpstr[i]))
-				  )
-					i++;
-				else break;
-			}
-			if(i == slen) return start; // reached the end and matched so far - full match
-		}
-	}
-
-	return -1;
+	return _findChars(_p, _len, lpstr, slen, start, case_sensitive);
 }
 
 // The arg @start is from the beginning of the string, not from the end.
@@ -770,41 +821,39 @@ int _cstring_::findReverse(LPCSTR lpstr, int start, bool case_sensitive) const
 	if(0 == lpstr[0]) return _len-1;
 
 	if(start >= _len) start = _len-1;
-	int match_pos = -1;
-	while(start >= 0)
-	{
-		if( (match_pos = find(lpstr, start, case_sensitive)) >= 0 )
-			return match_pos;
-		start--;
-	}
-	return -1;
+	// a match at or after start comes first, as it always has;
+	// then the last one before it
+	int match_pos = find(lpstr, start, case_sensitive);
+	if(match_pos >= 0)
+		return match_pos;
+	return _findCharsReverse(_p, _len, lpstr, lstrlenA(lpstr), start-1, case_sensitive);
 }
 
 bool _cstring_::isNumeric() const
 {
 	if(!_p || _len<1) return false;
-	
-	char* p = _p;
-	while( isspace(*p) ) p++;
-	if(*p == '-' || *p == '+') p++;
-	if(*p == '.') p++;
-	if(*p == 'd' || *p == 'D' || *p == 'e' || *p == 'E') p++;
-	if(*p == '-' || *p == '+') p++;
-	if( (p >= _p+_len) || (*p != '0' && strtod(_p, NULL) == 0) )
-		return false;
-	return true;
+
+	const char* p = _p;
+	const char* end = _p + _len;
+	// a number starts here, after any blanks
+	while(p < end && isspace((unsigned char)*p)) p++;
+	if(p < end && (*p == '-' || *p == '+')) p++;
+	if(p < end && *p == '.') p++;
+	return (p < end && *p >= '0' && *p <= '9');
 }
 
 long _cstring_::longVal() const
 {
-	if(_len < 1) return 0;
-	return atol(_p);
+	long val;
+	_parseLong(_p, _len, &val);
+	return val;
 }
 
 double _cstring_::doubleVal() const
 {
-	if(_len < 1) return 0.0;
-	return strtod(_p, NULL);
+	double val;
+	_parseDouble(_p, _len, &val);
+	return val;
 }
 
 bool _cstring_::isNull() const
@@ -837,9 +886,25 @@ bool _cstring_::_alloc(int cch)
 // and move the existing string (if any) over to it
 bool _cstring_::_realloc(int cch)
 {
+	// a short string goes to the local buffer
+	if(cch <= CSTRING_LOCAL_SIZE && (NULL == _p || _p == _local))
+	{
+		if(NULL == _p) _local[0] = '\0';
+		_p = _local;
+		_buflen = CSTRING_LOCAL_SIZE;
+		return true;
+	}
+
 	cch = (cch>=160) ? ((int)(cch*1.25)) : (cch+16);
 
-	if(_p) _p = (LPSTR) realloc(_p, cch);
+	if(_p == _local) {
+		// outgrowing it
+		LPSTR p = (LPSTR) malloc(cch);
+		if(!p) return false;
+		memcpy(p, _local, CSTRING_LOCAL_SIZE);
+		_p = p;
+	}
+	else if(_p) _p = (LPSTR) realloc(_p, cch);
 	else {
 		_p = (LPSTR) malloc(cch);
 		if(_p) _p[0] = '\0';
@@ -853,7 +918,7 @@ bool _cstring_::_realloc(int cch)
 
 void _cstring_::_free()
 {
-	if(_p) free(_p);
+	if(_p && _p != _local) free(_p);
 	_p = NULL;
 	_len = _buflen = 0;
 }
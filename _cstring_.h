@@ -5,6 +5,9 @@
 // allows having '\0' chars in the middle of the string
 // (which, by the way, considerably slows down many operations)
 //
+// Strings shorter than CSTRING_LOCAL_SIZE are kept in the
+// object's own buffer, without allocating.
+//
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 //-------------------------------------------------------------
@@ -20,11 +23,18 @@
 
 #include "_common_.h"
 #include "_wstring_.h"
+#include "_sort_.h"
+#include "_string_view_.h"
 // some operations are compiled only if requested
 #ifdef ALL_STRING_STUFF
 	#include "_array_.h"
 #endif
 
+// the size of the buffer in the string object itself
+#ifndef CSTRING_LOCAL_SIZE
+	#define CSTRING_LOCAL_SIZE  24
+#endif
+
 namespace soige {
 
 //------------------------------------------------------------
@@ -33,6 +43,7 @@ namespace soige {
 class _cstring_
 {
 friend class _wstring_;
+friend LPCSTR _radixKeyBytes(const _cstring_&, int*);
 public:
 	_cstring_();
 	_cstring_(const _cstring_& refstr);
@@ -40,6 +51,7 @@ public:
 	_cstring_(char chr, int count = 1);
 	_cstring_(long val);
 	_cstring_(double val);
+	explicit _cstring_(const _string_view_& view);
 	virtual ~_cstring_();
 
 	_cstring_&	operator= (const _cstring_&);
@@ -48,6 +60,7 @@ public:
 	_cstring_&	operator= (long val);
 	_cstring_&	operator= (double val);
 	_cstring_&	operator= (const _wstring_&);
+	_cstring_&	operator= (const _string_view_& view);
 
 	_cstring_&	operator+=(const _cstring_&);
 	_cstring_&	operator+=(LPCSTR);
@@ -55,6 +68,7 @@ public:
 	_cstring_&	operator+=(long val);
 	_cstring_&	operator+=(double val);
 	_cstring_&	operator+=(const _wstring_&);
+	_cstring_&	operator+=(const _string_view_& view);
 
 	bool		operator! () const;
 	bool		operator< (const _cstring_&) const;
@@ -63,16 +77,22 @@ public:
 	bool		operator==(LPCSTR) const;
 	bool		operator!=(const _cstring_&) const;
 	bool		operator!=(LPCSTR) const;
+	bool		operator==(const _string_view_& view) const;
+	bool		operator!=(const _string_view_& view) const;
 	int			compare (const _cstring_& refstr, bool case_sensitive = true) const;
 	int			compare (LPCSTR lpstr, bool case_sensitive = true) const;
+	int			compare (const _string_view_& view, bool case_sensitive = true) const;
 	bool		startsWith(LPCSTR lpstr, bool case_sensitive = true) const;
+	bool		startsWith(const _string_view_& view, bool case_sensitive = true) const;
 	bool		endsWith  (LPCSTR lpstr, bool case_sensitive = true) const;
+	bool		endsWith  (const _string_view_& view, bool case_sensitive = true) const;
 
 	_cstring_&	append(const _cstring_& refstr);
 	_cstring_&	append(LPCSTR lpstr);
 	_cstring_&	append(char chr);
 	_cstring_&	append(long val);
 	_cstring_&	append(double val);
+	_cstring_&	append(const _string_view_& view);
 
 	// more efficient swap from another string
 	// than just copying byval back and forth
@@ -101,6 +121,9 @@ public:
 	_cstring_	substring(int start, int count) const;
 	_cstring_	left (int count) const;
 	_cstring_	right(int count) const;
+	// the chars, or some of them, as a view, valid until the string changes
+	_string_view_	view() const;
+	_string_view_	view(int start, int count = MAX_INT) const;
 	
 	_cstring_&	reverse();
 	_cstring_&	trim(char char_to_trim = ' ');
@@ -123,6 +146,7 @@ public:
 
 	int			find(const _cstring_& refstr, int start = 0, bool case_sensitive = true) const;
 	int			find(LPCSTR lpstr, int start = 0, bool case_sensitive = true) const;
+	int			find(const _string_view_& view, int start = 0, bool case_sensitive = true) const;
 	int			findReverse(LPCSTR lpstr, int start = MAX_INT, bool case_sensitive = true) const;
 
 	bool		isNumeric() const;
@@ -137,6 +161,7 @@ protected:
 	LPSTR	_p;
 	int		_len;		// current length of the string, in characters
 	int		_buflen;	// size of buffer, in characters
+	char	_local[CSTRING_LOCAL_SIZE];	// the buffer of a short string
 	
 private:
 	// memory operations
@@ -151,6 +176,11 @@ template<> inline int _compare<_cstring_>(const _cstring_& a, const _cstring_& b
 // global swap func specialization
 template<> inline void _swap<_cstring_>(_cstring_* a, _cstring_* b)
 	{ a->swap(*b); }
+// radix sort support (see _sort_.h)
+inline LPCSTR _radixKeyBytes(const _cstring_& s, int* pLen)
+	{ *pLen = s._len; return s._p; }
+template<> inline bool _radixSort<_cstring_>(_cstring_ Array[], int cElems)
+	{ _msdRadixSort(Array, cElems); return true; }
 
 // externals
 _cstring_ operator+(const _cstring_&, const _cstring_&);
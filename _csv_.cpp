@@ -0,0 +1,288 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _csv_.cpp - implementation file for the _csv_reader_ and
+// _csv_writer_ classes.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_csv_.h"
+
+namespace soige {
+
+//------------------------------------------------------------
+// Splitting blocks into records
+//------------------------------------------------------------
+const char* _csvSplit(const char* begin, const char* end, const csv_options& options,
+					  int parts, const char** bounds)
+{
+	const char* last = NULL;
+	const char* p = begin;
+	// a quote character of 0 means no quoting: look for line breaks only
+	char quote = options.quote, delim = options.delimiter;
+	char q = quote ? quote : '\n';
+	int k = 1;
+	const char* target = begin + (int)((__int64)(end - begin) * k / parts);
+	for(;;)
+	{
+		p = _csvScan(p, end, q, '\n', '\n', '\n');
+		if(p == end)
+			break;
+		if(quote && *p == quote)
+		{
+			// a quote anywhere but at the start of a field is just a
+			// character; the start of the block is that of a record
+			if(p == begin || p[-1] == delim || p[-1] == '\n' || p[-1] == '\r')
+			{
+				// on to the closing quote, past the doubled ones
+				for(;;)
+				{
+					p = (const char*)memchr(p + 1, quote, end - (p + 1));
+					if(p == NULL || p + 1 == end || p[1] != quote)
+						break;
+					p++;
+				}
+				if(p == NULL)
+					break;
+			}
+		}
+		else
+		{
+			last = p + 1;
+			for(; k < parts && last >= target; k++)
+			{
+				bounds[k] = last;
+				target = begin + (int)((__int64)(end - begin) * (k + 1) / parts);
+			}
+		}
+		p++;
+	}
+	for(; k < parts; k++)
+		bounds[k] = last ? last : begin;
+	bounds[0] = begin;
+	bounds[parts] = last;
+	return last;
+}
+
+
+//------------------------------------------------------------
+// _csv_reader_
+//------------------------------------------------------------
+_csv_reader_::_csv_reader_(const csv_options& options, int blockBytes) :
+	_options(options), _blockBytes(blockBytes)
+{
+	if(_blockBytes < 1024)
+		_blockBytes = 1024;
+	_buf = NULL;
+	_bufSize = 0;
+	close();
+}
+
+_csv_reader_::~_csv_reader_()
+{
+	close();
+}
+
+bool _csv_reader_::open(LPCTSTR fileName)
+{
+	close();
+	_file.reset(fileName);
+	return _file.open(access_read, share_read, open_existing);
+}
+
+void _csv_reader_::close()
+{
+	_file.close();
+	if(_buf)
+		free(_buf);
+	_buf = NULL;
+	_bufSize = _dataLen = 0;
+	_pos = _blockEnd = NULL;
+	_blockParts = 1;
+	_bounds.clear();
+	_bytesRead = _records = 0;
+	_eof = false;
+}
+
+bool _csv_reader_::readRecord(_array_<_string_>& fields)
+{
+	_csv_field_sink_ sink(&fields);
+	for(;;)
+	{
+		if(_pos == _blockEnd && !_nextBlock(1))
+			return false;
+		if( _csvParseRecord(_pos, _blockEnd, _options, _scratch, sink) )
+		{
+			_records++;
+			return true;
+		}
+		// only blank lines were left in the block
+		_pos = _blockEnd;
+	}
+}
+
+bool _csv_reader_::_nextBlock(int parts)
+{
+	if( !isOpen() )
+		return false;
+	// the incomplete record at the end of the last block comes first
+	int kept = 0;
+	if(_blockEnd)
+	{
+		kept = _dataLen - (int)(_blockEnd - _buf);
+		memmove(_buf, _blockEnd, kept);
+	}
+	_dataLen = kept;
+	_pos = _blockEnd = NULL;
+
+	for(;;)
+	{
+		if( !_eof )
+		{
+			if(_dataLen == _bufSize)
+			{
+				// the first block, or a record longer than the block
+				int size = _bufSize ? _bufSize * 2 : _blockBytes;
+				char* buf = (char*) realloc(_buf, size);
+				if(buf == NULL)
+					return false;
+				_buf = buf;
+				_bufSize = size;
+			}
+			long read = _file.read(_buf + _dataLen, _bufSize - _dataLen);
+			if(read <= 0)
+				_eof = true;
+			else
+			{
+				_dataLen += read;
+				_bytesRead += read;
+			}
+		}
+		if(_dataLen == 0)
+			return false;
+
+		const char* begin = _buf;
+		const char* end = _buf + _dataLen;
+		parts = _partsOf(_dataLen, parts);
+		_bounds.resize(parts + 1);
+		const char* last = _csvSplit(begin, end, _options, parts, &_bounds[0]);
+		// at the end of the file, the last record needs no line break
+		if(_eof)
+			last = end;
+		if(last)
+		{
+			_pos = begin;
+			_blockEnd = last;
+			_bounds[parts] = last;
+			_blockParts = parts;
+			return true;
+		}
+	}
+}
+
+
+//------------------------------------------------------------
+// _csv_writer_
+//------------------------------------------------------------
+_csv_writer_::_csv_writer_(const csv_options& options) :
+	_options(options)
+{
+	_buf = (char*) malloc(CSV_WRITE_BYTES);
+	_len = 0;
+	_bytesWritten = 0;
+	_failed = false;
+	_recordStart = _recordEmpty = true;
+}
+
+_csv_writer_::~_csv_writer_()
+{
+	close();
+	free(_buf);
+}
+
+bool _csv_writer_::open(LPCTSTR fileName)
+{
+	close();
+	_file.reset(fileName);
+	_len = 0;
+	_bytesWritten = 0;
+	_failed = false;
+	_recordStart = _recordEmpty = true;
+	return _file.open(access_write, share_read, create_always);
+}
+
+bool _csv_writer_::close()
+{
+	if( !isOpen() )
+		return true;
+	bool ok = flush();
+	_file.close();
+	return ok;
+}
+
+bool _csv_writer_::flush()
+{
+	if(_len > 0)
+	{
+		if(_file.write(_buf, _len) < 0)
+			_failed = true;
+		_bytesWritten += _len;
+		_len = 0;
+	}
+	return !_failed;
+}
+
+void _csv_writer_::writeField(const char* p, int len)
+{
+	char delim = _options.delimiter, quote = _options.quote;
+	if( !_recordStart )
+	{
+		_put(&delim, 1);
+		_recordEmpty = false;
+	}
+	_recordStart = false;
+	if(len <= 0)
+		return;
+	_recordEmpty = false;
+	const char* end = p + len;
+	if(quote == 0 || _csvScan(p, end, delim, quote, '\n', '\r') == end)
+	{
+		_put(p, len);
+		return;
+	}
+	// quoted, with each quote inside doubled
+	_put(&quote, 1);
+	for(;;)
+	{
+		const char* q = (const char*)memchr(p, quote, end - p);
+		if(q == NULL)
+			break;
+		_put(p, (int)(q + 1 - p));
+		_put(&quote, 1);
+		p = q + 1;
+	}
+	_put(p, (int)(end - p));
+	_put(&quote, 1);
+}
+
+void _csv_writer_::endRecord()
+{
+	// a record of one empty field would be a blank line, which
+	// holds no record at all
+	if(_recordEmpty && _options.quote)
+	{
+		_put(&_options.quote, 1);
+		_put(&_options.quote, 1);
+	}
+	_put("\r\n", 2);
+	_recordStart = _recordEmpty = true;
+}
+
+bool _csv_writer_::writeRecord(const _array_<_string_>& fields)
+{
+	for(int i=0; i<fields.length(); i++)
+		writeField(fields[i]);
+	endRecord();
+	return !_failed;
+}
+
+
+};	// namespace soige
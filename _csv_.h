@@ -0,0 +1,604 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _csv_.h - header file for the _csv_reader_ and _csv_writer_
+// classes.
+//
+// Read and write delimited text - CSV, TSV and the like - as
+// spreadsheets do: a field holding the delimiter, a quote or
+// a line break is quoted, and a quote inside a quoted field
+// is doubled. The reader takes the file in large blocks and
+// looks for the delimiters and line breaks 16 bytes at a time
+// (with SSE2). It reads a record at a time, or loads a whole
+// _table_<> at once: the blocks are then cut into parts at
+// record boundaries, the parts are parsed on the threads of a
+// _thread_pool_, and their rows go into the table with
+// appendRows().
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __csv_already_included_vasya__
+#define __csv_already_included_vasya__
+
+#include "_common_.h"
+#include "_array_.h"
+#include "_string_.h"
+#include "_table_.h"
+#include "_sort_.h"
+#include "_thread_pool_.h"
+#include "_win32_file_.h"
+#include "_num_conv_.h"
+
+// whether the scanner uses SSE2; it uses _cpuHasSSE2() from _sort_.h
+#ifndef CSV_SSE2
+	#define CSV_SSE2  SORT_NETWORK_SSE2
+#endif
+
+// default bytes the reader takes from the file at a time; a
+// block grows past this only for a record longer than that
+#ifndef CSV_BLOCK_BYTES
+	#define CSV_BLOCK_BYTES  (16 * 1024 * 1024)
+#endif
+// blocks are split for the threads into parts of at least this
+#ifndef CSV_PART_MIN
+	#define CSV_PART_MIN  (64 * 1024)
+#endif
+// the writer's buffer
+#ifndef CSV_WRITE_BYTES
+	#define CSV_WRITE_BYTES  (64 * 1024)
+#endif
+
+namespace soige {
+
+//------------------------------------------------------------
+// The format of the text
+//------------------------------------------------------------
+struct csv_options
+{
+	char	delimiter;	// ',' for CSV, '\t' for TSV
+	char	quote;		// the quote character, 0 for none
+	bool	header;		// whether the first record names the columns
+
+	csv_options(char delim = ',', bool hdr = true, char q = '"') :
+		delimiter(delim), quote(q), header(hdr)
+	{ }
+};
+
+
+//------------------------------------------------------------
+// Scanning
+//------------------------------------------------------------
+
+// the first of c1..c4 in [p, end), or end
+inline const char* _csvScan(const char* p, const char* end, char c1, char c2, char c3, char c4)
+{
+#if CSV_SSE2
+	if( end - p >= 16 && _cpuHasSSE2() )
+	{
+		__m128i v1 = _mm_set1_epi8(c1), v2 = _mm_set1_epi8(c2);
+		__m128i v3 = _mm_set1_epi8(c3), v4 = _mm_set1_epi8(c4);
+		for(; p + 16 <= end; p += 16)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)p);
+			__m128i m = _mm_or_si128( _mm_or_si128(_mm_cmpeq_epi8(x, v1), _mm_cmpeq_epi8(x, v2)),
+									  _mm_or_si128(_mm_cmpeq_epi8(x, v3), _mm_cmpeq_epi8(x, v4)) );
+			int mask = _mm_movemask_epi8(m);
+			if(mask)
+				return p + _lowestBit(mask);
+		}
+	}
+#endif
+	for(; p < end; p++)
+		if(*p == c1 || *p == c2 || *p == c3 || *p == c4)
+			return p;
+	return end;
+}
+
+// One pass over [begin, end) keeping track of the quotes: the
+// end (past the line break) of the last complete record, or NULL
+// if there's none. bounds[k], for 0 < k < parts, gets the end of
+// the first record ending at or after the k-th of parts even
+// split points, bounds[0] begin and bounds[parts] the returned end.
+// The quotes are read as _csvParseRecord() reads them: one opens
+// a quoted field only at the start of a field, and inside one a
+// doubled quote stands for a quote.
+const char* _csvSplit(const char* begin, const char* end, const csv_options& options,
+					  int parts, const char** bounds);
+
+
+//------------------------------------------------------------
+// Field values: from text, and to text
+//------------------------------------------------------------
+inline void _csvValue(const char* p, int len, _string_& val)
+{
+	if(len == 0)
+		val = _string_();
+	else
+		val.replaceBytes(p, len, 0, val.length());
+}
+inline void _csvValue(const char* p, int len, __int64& val)
+{
+	// blanks before the number are skipped; anything not a digit ends it
+	const char* end = p + len;
+	while(p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+	__int64 v = 0;
+	for(; p < end && *p >= '0' && *p <= '9'; p++)
+		v = v * 10 + (*p - '0');
+	val = negative ? -v : v;
+}
+inline void _csvValue(const char* p, int len, int& val)
+{
+	__int64 v;
+	_csvValue(p, len, v);
+	val = (int)v;
+}
+inline void _csvValue(const char* p, int len, double& val)
+{
+	_parseDouble(p, len, &val);
+}
+inline void _csvValue(const char* p, int len, float& val)
+{
+	double v;
+	_csvValue(p, len, v);
+	val = (float)v;
+}
+
+// the text of a value: points *pText to it (at buf, which has
+// room for 32 chars, if it had to be made) and returns its length
+inline int _csvText(const _string_& val, char* buf, LPCSTR* pText)
+{
+	*pText = val.c_str();
+	return val.length();
+}
+inline int _csvText(__int64 val, char* buf, LPCSTR* pText)
+{
+	*pText = buf;
+	return _formatInt64(val, buf);
+}
+inline int _csvText(int val, char* buf, LPCSTR* pText)
+{
+	return _csvText((__int64)val, buf, pText);
+}
+inline int _csvText(double val, char* buf, LPCSTR* pText)
+{
+	// the fewest digits that read back as the same double
+	*pText = buf;
+	return _formatDouble(val, buf);
+}
+inline int _csvText(float val, char* buf, LPCSTR* pText)
+{
+	// and for a float, the fewest that read back as the float
+	*pText = buf;
+	return _formatFloat(val, buf);
+}
+
+
+//------------------------------------------------------------
+// Parsing
+//------------------------------------------------------------
+
+// Parses the record at p, passing its fields to sink.field(p, len)
+// and then calling sink.endRecord(), and moves p past it; false
+// if there are only blank lines left. Quoted fields have their
+// quotes taken off, using scratch for the ones with doubled quotes.
+template<typename sink_type>
+	bool _csvParseRecord(const char*& p, const char* end, const csv_options& options,
+						 _array_<char>& scratch, sink_type& sink)
+{
+	while(p < end && (*p == '\n' || *p == '\r'))
+		p++;
+	if(p == end)
+		return false;
+	char delim = options.delimiter, quote = options.quote;
+	for(;;)
+	{
+		if(quote && p < end && *p == quote)
+		{
+			const char* start = ++p;
+			const char* q;
+			scratch.clear();
+			for(;;)
+			{
+				q = (const char*)memchr(p, quote, end - p);
+				if(q == NULL)
+					q = end;
+				if(q + 1 < end && q[1] == quote)
+				{
+					// a doubled quote stands for one
+					scratch.insertNAt(scratch.length(), p, (int)(q + 1 - p));
+					p = q + 2;
+					continue;
+				}
+				break;
+			}
+			if(scratch.length() == 0)
+				sink.field(start, (int)(q - start));
+			else
+			{
+				scratch.insertNAt(scratch.length(), p, (int)(q - p));
+				sink.field(&scratch[0], scratch.length());
+			}
+			// anything between the closing quote and the delimiter is dropped
+			p = (q < end) ? q + 1 : end;
+			p = _csvScan(p, end, delim, '\n', '\r', delim);
+		}
+		else
+		{
+			const char* q = _csvScan(p, end, delim, '\n', '\r', delim);
+			sink.field(p, (int)(q - p));
+			p = q;
+		}
+		if(p < end && *p == delim)
+		{
+			p++;
+			continue;
+		}
+		break;
+	}
+	if(p < end && *p == '\r')
+		p++;
+	if(p < end && *p == '\n')
+		p++;
+	sink.endRecord();
+	return true;
+}
+
+// gathers the fields of a record as strings
+struct _csv_field_sink_
+{
+	_array_<_string_>*	fields;
+	int		count;
+
+	_csv_field_sink_(_array_<_string_>* f) : fields(f), count(0)
+	{ }
+	void field(const char* p, int len)
+	{
+		if(count == fields->length())
+			fields->append(_string_());
+		_csvValue(p, len, (*fields)[count++]);
+	}
+	void endRecord()
+	{
+		if(fields->length() > count)
+			fields->removeNAt(count, fields->length() - count);
+	}
+};
+
+// gathers the records as rows of cols values, row after row;
+// fields past the last column are dropped, missing ones are
+// left empty
+template<typename elem_type> struct _csv_row_sink_
+{
+	_array_<elem_type>	values;
+	int		rows;
+	int		cols;
+	int		col;	// of the next field
+
+	_csv_row_sink_() : rows(0), cols(0), col(0)
+	{ }
+	void field(const char* p, int len)
+	{
+		if(col == 0)
+		{
+			// a row of empty values, then filled in
+			if(_emptyRow.length() != cols)
+			{
+				_emptyRow.resize(cols);
+				for(int i=0; i<cols; i++)
+					_emptyRow[i] = elem_type();
+			}
+			// room for twice the rows: fewer copies than the array's own growth
+			if(values.length() + cols > values.capacity())
+				values.reserve(2 * values.length() + 64 * cols);
+			values.insertNAt(values.length(), &_emptyRow[0], cols);
+		}
+		if(col < cols && len > 0)
+			_csvValue(p, len, values[rows * cols + col]);
+		col++;
+	}
+	void endRecord()
+	{
+		rows++;
+		col = 0;
+	}
+
+protected:
+	_array_<elem_type> _emptyRow;
+};
+
+// one part of a block, parsed on a thread of the pool
+template<typename elem_type> struct _csv_parse_job_
+{
+	const char*		begin;
+	const char*		end;
+	const csv_options*	options;
+	_csv_row_sink_<elem_type>	sink;
+	// the parts still running, and the event set by the last one
+	long*	pending;
+	HANDLE	done;
+
+	void parse()
+	{
+		_array_<char> scratch;
+		const char* p = begin;
+		while( _csvParseRecord(p, end, *options, scratch, sink) )
+			;
+	}
+	static int __stdcall run(void* pParam)
+	{
+		_csv_parse_job_* job = (_csv_parse_job_*) pParam;
+		job->parse();
+		if(InterlockedDecrement(job->pending) == 0)
+			SetEvent(job->done);
+		return 0;
+	}
+};
+
+
+//------------------------------------------------------------
+// Reads delimited text from a file
+//------------------------------------------------------------
+class _csv_reader_
+{
+public:
+	_csv_reader_(const csv_options& options = csv_options(), int blockBytes = CSV_BLOCK_BYTES);
+	virtual ~_csv_reader_();
+
+	bool open(LPCTSTR fileName);
+	void close();
+	bool isOpen() const
+	{
+		return _file.isOpen();
+	}
+	const csv_options& getOptions() const
+	{
+		return _options;
+	}
+	// the bytes taken from the file so far
+	__int64 getBytesRead() const
+	{
+		return _bytesRead;
+	}
+
+	// The next record's fields; false at the end of the file.
+	// The header, if there is one, is the first record.
+	bool readRecord(_array_<_string_>& fields);
+
+	// Appends the rest of the records to the table as rows, in
+	// bulk; on a pool, each block is split into parts (0 for the
+	// number of processors) parsed on its threads. If the table
+	// has no columns yet, it gets those of the file, named by the
+	// header if there is one; otherwise the fields go into the
+	// table's columns in order.
+	template<typename elem_type>
+		bool readTable(_table_<elem_type>& tbl, _thread_pool_* pool = NULL, int parts = 0)
+	{
+		if( !isOpen() )
+			return false;
+		if(parts <= 0)
+		{
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			parts = (int)si.dwNumberOfProcessors;
+		}
+		if(parts < 1 || pool == NULL)
+			parts = 1;
+
+		if(_pos == _blockEnd && !_nextBlock(parts))
+			return true;
+		if(_records == 0)
+		{
+			// the header, or the first record for the number of fields
+			_array_<_string_> first;
+			if( !readRecord(first) )
+				return true;
+			if(tbl.getColumnCount() == 0)
+			{
+				if(_options.header)
+					tbl.setHeader(first);
+				else
+					tbl.setColumnCount(first.length());
+			}
+			if( !_options.header && tbl.getColumnCount() > 0 )
+			{
+				// which is a row, then
+				_csv_row_sink_<elem_type> sink;
+				sink.cols = tbl.getColumnCount();
+				for(int i=0; i<first.length(); i++)
+					sink.field(first[i].c_str(), first[i].length());
+				sink.endRecord();
+				tbl.appendRows(&sink.values[0], 1);
+			}
+		}
+		int cols = tbl.getColumnCount();
+		if(cols == 0)
+			return true;
+
+		tbl.beginUpdate();
+		_csv_parse_job_<elem_type>* jobs = new _csv_parse_job_<elem_type>[parts];
+		HANDLE done = (parts > 1) ? CreateEvent(NULL, FALSE, FALSE, NULL) : NULL;
+		int reserved = 0;
+		while(_pos < _blockEnd || _nextBlock(parts))
+		{
+			// the block's parts, split again if records were read from it
+			int n = _blockParts;
+			if(_pos != _bounds[0])
+			{
+				n = _partsOf((int)(_blockEnd - _pos), parts);
+				_bounds.resize(n + 1);
+				_csvSplit(_pos, _blockEnd, _options, n, &_bounds[0]);
+				_bounds[n] = _blockEnd;
+			}
+			long pending = n;
+			int i;
+			for(i=0; i<n; i++)
+			{
+				_csv_parse_job_<elem_type>& job = jobs[i];
+				job.begin = _bounds[i];
+				job.end = _bounds[i + 1];
+				job.options = &_options;
+				job.sink.values.clear();
+				job.sink.rows = 0;
+				job.sink.cols = cols;
+				job.pending = &pending;
+				job.done = done;
+			}
+			if(n == 1)
+				jobs[0].parse();
+			else
+			{
+				for(i=0; i<n; i++)
+					pool->queueJob(_csv_parse_job_<elem_type>::run, &jobs[i]);
+				WaitForSingleObject(done, INFINITE);
+			}
+			// room for the rows, again growing twice at a time
+			int rows = tbl.getRowCount();
+			for(i=0; i<n; i++)
+				rows += jobs[i].sink.rows;
+			if(rows > reserved)
+			{
+				reserved = 2 * rows;
+				tbl.reserveRows(reserved);
+			}
+			// in order, so the rows stay in the order of the file
+			for(i=0; i<n; i++)
+			{
+				if(jobs[i].sink.rows > 0)
+					tbl.appendRows(&jobs[i].sink.values[0], jobs[i].sink.rows);
+				_records += jobs[i].sink.rows;
+			}
+			_pos = _blockEnd;
+		}
+		if(done)
+			CloseHandle(done);
+		delete [] jobs;
+		tbl.endUpdate();
+		return true;
+	}
+
+protected:
+	csv_options		_options;
+	_win32_file_	_file;
+	__int64	_bytesRead;
+	__int64	_records;	// records read so far
+	bool	_eof;
+	int		_blockBytes;
+
+	// the block: _buf holds _dataLen bytes from the file, of which
+	// the records up to _blockEnd are complete; reading is at _pos
+	char*	_buf;
+	int		_bufSize;
+	int		_dataLen;
+	const char*	_pos;
+	const char*	_blockEnd;
+	// the parts of the block: part i is [_bounds[i], _bounds[i + 1])
+	_array_<const char*>	_bounds;
+	int		_blockParts;
+	_array_<char>	_scratch;
+
+	// reads the next block of complete records, splitting it
+	// into parts; false at the end of the file
+	bool _nextBlock(int parts);
+	// how many of parts a block of bytes is split into
+	static int _partsOf(int bytes, int parts)
+	{
+		if(parts > bytes / CSV_PART_MIN)
+			parts = bytes / CSV_PART_MIN;
+		return (parts < 1) ? 1 : parts;
+	}
+};
+
+
+//------------------------------------------------------------
+// Writes delimited text to a file
+//------------------------------------------------------------
+class _csv_writer_
+{
+public:
+	_csv_writer_(const csv_options& options = csv_options());
+	virtual ~_csv_writer_();
+
+	// creates the file, or empties it if it exists
+	bool open(LPCTSTR fileName);
+	bool close();
+	bool isOpen() const
+	{
+		return _file.isOpen();
+	}
+	bool flush();
+	__int64 getBytesWritten() const
+	{
+		return _bytesWritten;
+	}
+
+	// A record field by field, then endRecord(); fields get
+	// quoted when they have to be
+	void writeField(const char* p, int len);
+	void writeField(const _string_& val)
+	{
+		writeField(val.c_str(), val.length());
+	}
+	void endRecord();
+	bool writeRecord(const _array_<_string_>& fields);
+
+	// the table's header (if the options have one) and rows;
+	// false if writing failed
+	template<typename elem_type>
+		bool writeTable(const _table_<elem_type>& tbl)
+	{
+		int cols = tbl.getColumnCount(), row, col;
+		if(_options.header)
+		{
+			for(col=0; col<cols; col++)
+				writeField(tbl.getColumnName(col));
+			endRecord();
+		}
+		char buf[32];
+		for(row=0; row<tbl.getRowCount(); row++)
+		{
+			for(col=0; col<cols; col++)
+			{
+				LPCSTR text;
+				int len = _csvText(tbl.getValueAt(row, col), buf, &text);
+				writeField(text, len);
+			}
+			endRecord();
+		}
+		return flush();
+	}
+
+protected:
+	csv_options		_options;
+	_win32_file_	_file;
+	__int64	_bytesWritten;
+	bool	_failed;
+	// no field, or just one empty field, written in the current record
+	bool	_recordStart;
+	bool	_recordEmpty;
+	char*	_buf;
+	int		_len;
+
+	void _put(const char* p, int len)
+	{
+		if(_len + len > CSV_WRITE_BYTES)
+		{
+			flush();
+			if(len > CSV_WRITE_BYTES)
+			{
+				if(_file.write(p, len) < 0)
+					_failed = true;
+				_bytesWritten += len;
+				return;
+			}
+		}
+		memcpy(_buf + _len, p, len);
+		_len += len;
+	}
+};
+
+
+};	// namespace soige
+
+#endif // __csv_already_included_vasya__
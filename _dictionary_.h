@@ -107,6 +107,19 @@ public:
 		return _elems.get(index);
 	}
 
+	// lookups by a key of another type, as in _set_::findLike();
+	// NULL if there's no such key
+	template<typename key_like> elem_type* lookup(const key_like& key)
+	{
+		int index = _keys.findLike(key);
+		return (index < 0) ? NULL : &_elems.get(index);
+	}
+	template<typename key_like> const elem_type* lookup(const key_like& key) const
+	{
+		int index = _keys.findLike(key);
+		return (index < 0) ? NULL : &_elems.get(index);
+	}
+
 	bool remove(const key_type& key)
 	{
 		int index = _keys.find(key);
@@ -0,0 +1,586 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _external_sort_.h - header/impl file for the external
+// (out-of-core) merge sort.
+//
+// Sorts record files that don't fit in memory: the records
+// are read through a _file_input_stream_, runs of as many of
+// them as fit in the memory budget are sorted with _sort_<>
+// and spilled to temporary file streams, and the runs are
+// then merged through a heap, EXTERNAL_SORT_MAX_FANIN runs
+// at a time (in several passes if there are more runs).
+//
+// A record file is a file stream holding blocks of records,
+// each block written with writeArray(); _record_writer_ and
+// _record_reader_ write and read such files one record at a
+// time, with one stream call per block. Records are copied
+// bitwise, so item_type can't own pointers (numbers, plain
+// structs, fixed-size char arrays are all fine).
+//
+// The memory budget bounds the records held at once: a run
+// and the block of its writer while the runs are made, and a
+// block of each run merged and of the output while they are
+// merged (EXTERNAL_SORT_MAX_FANIN + 1 blocks of a budget's
+// share each). Only the block of the input file being read
+// comes on top of it, as large as the blocks it was written
+// in. The runs are sorted without the radix sort, which would
+// want a scratch copy of the run.
+//
+// The file streams keep their positions and sizes in longs,
+// and their header keeps the stream size in an int, so each
+// input, run and output file is limited to 2 GB; bigger data
+// sets have to be split into several input files (sorted
+// separately and merged) until the streams go 64-bit.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __external_sort_already_included_vasya__
+#define __external_sort_already_included_vasya__
+
+#include "_sort_.h"
+#include "_string_array_.h"
+#include "_file_stream_.h"
+
+namespace soige {
+
+// default memory budget of the sort, in bytes
+#ifndef EXTERNAL_SORT_MEMORY
+	#define EXTERNAL_SORT_MEMORY  (64L * 1024 * 1024)
+#endif
+// most runs merged at once (each gets a share of the budget)
+#ifndef EXTERNAL_SORT_MAX_FANIN
+	#define EXTERNAL_SORT_MAX_FANIN  64
+#endif
+// default size of the record blocks, in bytes
+#ifndef RECORD_BLOCK_BYTES
+	#define RECORD_BLOCK_BYTES  (256 * 1024)
+#endif
+// records merged between two progress reports
+#ifndef EXTERNAL_SORT_PROGRESS_STEP
+	#define EXTERNAL_SORT_PROGRESS_STEP  65536
+#endif
+
+//------------------------------------------------------------
+// Writes records in blocks of blockItems
+//------------------------------------------------------------
+template<typename item_type> class _record_writer_
+{
+public:
+	// blockItems <= 0 means blocks of about RECORD_BLOCK_BYTES
+	_record_writer_(output_stream* pOut, int blockItems = 0) :
+		_pOut(pOut), _count(0), _written(0), _failed(false)
+	{
+		_blockItems = (blockItems > 0) ? blockItems : (int)(RECORD_BLOCK_BYTES / sizeof(item_type));
+		if(_blockItems < 1)
+			_blockItems = 1;
+		_block = (item_type*)malloc(_blockItems * sizeof(item_type));
+		if(!_block)
+			_failed = true;
+	}
+	virtual ~_record_writer_()
+	{
+		flush();
+		if(_block)
+			free(_block);
+	}
+
+	bool write(const item_type& item)
+	{
+		if(_failed)
+			return false;
+		memcpy(&_block[_count++], &item, sizeof(item_type));
+		if(_count == _blockItems)
+			return flush();
+		return true;
+	}
+
+	// writes an array of records straight from where it is
+	bool writeN(const item_type items[], int count)
+	{
+		if( !flush() )
+			return false;
+		while(count > 0)
+		{
+			int n = (count < _blockItems) ? count : _blockItems;
+			if( !_pOut->writeArray(items, sizeof(item_type), n) )
+			{
+				_failed = true;
+				return false;
+			}
+			items += n;
+			count -= n;
+			_written += n;
+		}
+		return true;
+	}
+
+	// writes out the records still in the block
+	bool flush()
+	{
+		if(_failed)
+			return false;
+		if(_count == 0)
+			return true;
+		if( !_pOut->writeArray(_block, sizeof(item_type), _count) )
+		{
+			_failed = true;
+			return false;
+		}
+		_written += _count;
+		_count = 0;
+		return true;
+	}
+
+	__int64 recordCount() const
+	{ return _written + _count; }
+	bool failed() const
+	{ return _failed; }
+
+protected:
+	output_stream*	_pOut;
+	item_type*		_block;
+	int				_blockItems;
+	int				_count;		// records in the block
+	__int64			_written;
+	bool			_failed;
+
+private:
+	// no byval operations
+	_record_writer_(const _record_writer_&) { }
+	void operator=(const _record_writer_&) { }
+};
+
+//------------------------------------------------------------
+// Reads records a block at a time
+//------------------------------------------------------------
+template<typename item_type> class _record_reader_
+{
+public:
+	_record_reader_(input_stream* pIn) :
+		_pIn(pIn), _block(NULL), _blockItems(0), _count(0), _pos(0), _failed(false)
+	{ }
+	virtual ~_record_reader_()
+	{
+		if(_block)
+			free(_block);
+	}
+
+	// returns the next record, or NULL at the end of the records;
+	// the record stays valid until the next call
+	const item_type* next()
+	{
+		if( atEnd() )
+			return NULL;
+		return &_block[_pos++];
+	}
+
+	bool read(item_type& item)
+	{
+		const item_type* p = next();
+		if(!p)
+			return false;
+		memcpy(&item, p, sizeof(item_type));
+		return true;
+	}
+
+	bool atEnd()
+	{
+		return ( _pos == _count && !_nextBlock() );
+	}
+
+	// true if the records ended in something other than the end
+	// of the stream (a block of another record size, a bad read)
+	bool failed() const
+	{ return _failed; }
+
+protected:
+	bool _nextBlock()
+	{
+		for(;;)
+		{
+			if(_failed)
+				return false;
+			basic_stream::data_type dt = _pIn->nextType();
+			if(dt != basic_stream::dt_array)
+			{
+				if(dt != basic_stream::_eof)
+					_failed = true;
+				return false;
+			}
+			int count = _pIn->nextSize() / sizeof(item_type);
+			if(count > _blockItems)
+			{
+				item_type* p = (item_type*)realloc(_block, count * sizeof(item_type));
+				if(!p)
+				{
+					_failed = true;
+					return false;
+				}
+				_block = p;
+				_blockItems = count;
+			}
+			if( !_pIn->readArray(_block, sizeof(item_type), count) )
+			{
+				_failed = true;
+				return false;
+			}
+			_count = count;
+			_pos = 0;
+			if(count > 0)
+				return true;
+		}
+	}
+
+	input_stream*	_pIn;
+	item_type*		_block;
+	int				_blockItems;	// allocated
+	int				_count;			// read into the block
+	int				_pos;
+	bool			_failed;
+
+private:
+	// no byval operations
+	_record_reader_(const _record_reader_&) { }
+	void operator=(const _record_reader_&) { }
+};
+
+//------------------------------------------------------------
+// Progress reports of the external sort
+//------------------------------------------------------------
+class external_sort_listener
+{
+public:
+	enum sort_phase
+	{
+		phase_runs,		// done/total: bytes of the input file read
+		phase_merge		// done/total: records written by the merges
+	};
+	// return false to cancel the sort
+	virtual bool onSortProgress(sort_phase phase, __int64 done, __int64 total) = 0;
+};
+
+//------------------------------------------------------------
+// The external sort class
+//------------------------------------------------------------
+template<typename item_type, typename comparator = _comparator_<item_type> > class _external_sort_
+{
+public:
+	// memoryBudget is the number of bytes for records held in
+	// memory, both by the runs and by the merge buffers;
+	// the runs go to tempDir, or the system temp directory
+	_external_sort_(long memoryBudget = EXTERNAL_SORT_MEMORY, LPCTSTR tempDir = NULL,
+			comparator cmp = comparator()) :
+		_memory(memoryBudget), _cmp(cmp), _pListener(NULL), _recordCount(0), _runCount(0), _passes(0)
+	{
+		_tempDir[0] = 0;
+		if(tempDir)
+			lstrcpyn(_tempDir, tempDir, MAX_PATH);
+	}
+	virtual ~_external_sort_()
+	{
+		_removeRuns();
+	}
+
+	void setListener(external_sort_listener* pL)
+	{ _pListener = pL; }
+
+	// sorts the records of inFile into outFile (a different
+	// file); on failure or cancellation outFile is removed
+	bool sort(LPCTSTR inFile, LPCTSTR outFile);
+
+	// stats of the last sort()
+	__int64 recordCount() const
+	{ return _recordCount; }
+	int runCount() const
+	{ return _runCount; }
+	int mergePasses() const
+	{ return _passes; }
+
+protected:
+	// the run order for the merge heap: the root is the run
+	// whose head record sorts first (the earlier run on ties)
+	class _run_order_
+	{
+	public:
+		_run_order_(const item_type** heads, const comparator& cmp) :
+			_heads(heads), _cmp(cmp)
+		{ }
+		int operator()(int a, int b) const
+		{
+			int c = _cmp(*_heads[b], *_heads[a]);
+			return c ? c : b - a;
+		}
+	protected:
+		const item_type**	_heads;
+		comparator			_cmp;
+	};
+
+	bool _makeRuns(LPCTSTR inFile, LPCTSTR outFile, bool& sorted);
+	bool _mergeRuns(int first, int count, LPCTSTR outFile, __int64& done, __int64 total);
+	bool _newRunName(TCHAR* name);
+	void _removeRuns();
+	bool _progress(external_sort_listener::sort_phase phase, __int64 done, __int64 total)
+	{
+		return ( _pListener == NULL || _pListener->onSortProgress(phase, done, total) );
+	}
+	// records per run file block, for merging as many runs as
+	// the largest merge holds at once within the budget
+	int _runBlockItems() const
+	{
+		int n = (int)(_memory / (EXTERNAL_SORT_MAX_FANIN + 1) / sizeof(item_type));
+		return (n > 0) ? n : 1;
+	}
+
+protected:
+	long			_memory;
+	comparator		_cmp;
+	external_sort_listener*	_pListener;
+	TCHAR			_tempDir[MAX_PATH];
+	_string_array_	_runs;		// run file names
+	__int64			_recordCount;
+	int				_runCount;
+	int				_passes;
+
+private:
+	// no byval operations
+	_external_sort_(const _external_sort_&) { }
+	void operator=(const _external_sort_&) { }
+};
+
+
+template<typename item_type, typename comparator>
+	bool _external_sort_<item_type, comparator>::sort (LPCTSTR inFile, LPCTSTR outFile)
+{
+	_removeRuns();
+	_recordCount = 0;
+	_runCount = 0;
+	_passes = 0;
+
+	bool sorted = false;
+	bool ok = _makeRuns(inFile, outFile, sorted);
+	_runCount = sorted ? 1 : _runs.length();
+	if(ok && !sorted)
+	{
+		// passes of merges of up to EXTERNAL_SORT_MAX_FANIN runs
+		// into new runs, until the last one can go to outFile
+		int passes = 1;
+		int runs;
+		for(runs = _runCount; runs > EXTERNAL_SORT_MAX_FANIN;
+				runs = (runs + EXTERNAL_SORT_MAX_FANIN - 1) / EXTERNAL_SORT_MAX_FANIN)
+			++passes;
+		__int64 total = _recordCount * passes;
+		__int64 done = 0;
+
+		int passFirst = 0;
+		int passEnd = _runs.length();
+		while( ok && passEnd - passFirst > EXTERNAL_SORT_MAX_FANIN )
+		{
+			for(int group = passFirst; ok && group < passEnd; group += EXTERNAL_SORT_MAX_FANIN)
+			{
+				int count = passEnd - group;
+				if(count > EXTERNAL_SORT_MAX_FANIN)
+					count = EXTERNAL_SORT_MAX_FANIN;
+				if(count == 1)
+				{
+					// a lone run goes on to the next pass as it is
+					_runs.append(_runs[group]);
+					continue;
+				}
+				TCHAR name[MAX_PATH];
+				ok = _newRunName(name) && _mergeRuns(group, count, name, done, total);
+				// the merged runs aren't needed anymore
+				for(int i = group; i < group + count; ++i)
+					DeleteFile(_runs[i]);
+			}
+			passFirst = passEnd;
+			passEnd = _runs.length();
+			++_passes;
+		}
+		if(ok)
+		{
+			ok = _mergeRuns(passFirst, passEnd - passFirst, outFile, done, total) &&
+				_progress(external_sort_listener::phase_merge, total, total);
+			++_passes;
+		}
+	}
+
+	_removeRuns();
+	if(!ok)
+		DeleteFile(outFile);
+	return ok;
+}
+
+// Reads as many records as fit in the budget at a time, sorts
+// them and writes them out as a run; if they all fit at once,
+// they go straight to outFile and @sorted is set
+template<typename item_type, typename comparator>
+	bool _external_sort_<item_type, comparator>::_makeRuns (LPCTSTR inFile, LPCTSTR outFile, bool& sorted)
+{
+	_file_input_stream_ in;
+	if( !in.reset(inFile) )
+		return false;
+	long inSize = in.sizeOfData();
+
+	// the run and the block of the run writer share the budget
+	int bufItems = (int)(_memory / sizeof(item_type)) - _runBlockItems();
+	if(bufItems < 1)
+		bufItems = 1;
+	item_type* buf = (item_type*)malloc(bufItems * sizeof(item_type));
+	if(!buf)
+		return false;
+
+	// the comparison sort, which takes no memory of its own
+	_sort_<item_type> sorter(16, -1);
+	_record_reader_<item_type> reader(&in);
+	bool ok = true;
+	for(;;)
+	{
+		int n = 0;
+		const item_type* p;
+		while( n < bufItems && (p = reader.next()) != NULL )
+			memcpy(&buf[n++], p, sizeof(item_type));
+		if( reader.failed() )
+		{
+			ok = false;
+			break;
+		}
+		bool lastRun = reader.atEnd();
+		long inPos = in.peekPos();
+		if(lastRun)
+			in.close();
+
+		sorter.sort(buf, n, _cmp);
+		_recordCount += n;
+
+		TCHAR name[MAX_PATH];
+		LPCTSTR runFile = name;
+		if(lastRun && _runs.length() == 0)
+			runFile = outFile;	// a single run is the result
+		else if( !_newRunName(name) )
+		{
+			ok = false;
+			break;
+		}
+		_file_output_stream_ out(runFile);
+		{
+			// the writer goes before the stream is closed
+			_record_writer_<item_type> writer(&out, _runBlockItems());
+			ok = writer.writeN(buf, n) && writer.flush();
+		}
+		ok = out.close() && ok;
+		if( !ok || !_progress(external_sort_listener::phase_runs, inPos, inSize) )
+		{
+			ok = false;
+			break;
+		}
+		if(lastRun)
+		{
+			sorted = (runFile == outFile);
+			break;
+		}
+	}
+	free(buf);
+	return ok;
+}
+
+// Heap-merges runs [first, first+count) into outFile
+template<typename item_type, typename comparator>
+	bool _external_sort_<item_type, comparator>::_mergeRuns (int first, int count, LPCTSTR outFile,
+		__int64& done, __int64 total)
+{
+	_file_input_stream_ ins[EXTERNAL_SORT_MAX_FANIN];
+	_record_reader_<item_type>* readers[EXTERNAL_SORT_MAX_FANIN];
+	const item_type* heads[EXTERNAL_SORT_MAX_FANIN];
+	int heap[EXTERNAL_SORT_MAX_FANIN];
+	int heapSize = 0;
+	int r;
+	bool ok = true;
+
+	for(r = 0; r < count; ++r)
+	{
+		readers[r] = new _record_reader_<item_type>(&ins[r]);
+		heads[r] = NULL;
+		if( ok && !ins[r].reset(_runs[first + r]) )
+			ok = false;
+		if(ok)
+		{
+			heads[r] = readers[r]->next();
+			if(heads[r])
+				heap[heapSize++] = r;
+			else if( readers[r]->failed() )
+				ok = false;
+		}
+	}
+
+	_run_order_ order(heads, _cmp);
+	_file_output_stream_ out(outFile);
+	{
+		// the writer is flushed and goes before the stream is closed
+		_record_writer_<item_type> writer(&out, _runBlockItems());
+		if(ok)
+		{
+			for(r = (heapSize >> 1) - 1; r >= 0; --r)
+				_heapSiftDown(heap, heapSize, r, order);
+		}
+		while(ok && heapSize > 0)
+		{
+			r = heap[0];
+			if( !writer.write(*heads[r]) )
+			{
+				ok = false;
+				break;
+			}
+			heads[r] = readers[r]->next();
+			if(heads[r] == NULL)
+			{
+				if( readers[r]->failed() )
+				{
+					ok = false;
+					break;
+				}
+				heap[0] = heap[--heapSize];
+			}
+			if(heapSize > 1)
+				_heapSiftDown(heap, heapSize, 0, order);
+			if( ++done % EXTERNAL_SORT_PROGRESS_STEP == 0 &&
+				!_progress(external_sort_listener::phase_merge, done, total) )
+				ok = false;
+		}
+		if( !writer.flush() )
+			ok = false;
+	}
+	ok = out.close() && ok;
+
+	for(r = 0; r < count; ++r)
+	{
+		delete readers[r];
+		ins[r].close();
+	}
+	return ok;
+}
+
+template<typename item_type, typename comparator>
+	bool _external_sort_<item_type, comparator>::_newRunName (TCHAR* name)
+{
+	TCHAR dir[MAX_PATH];
+	if(_tempDir[0])
+		lstrcpy(dir, _tempDir);
+	else if( GetTempPath(MAX_PATH, dir) == 0 )
+		return false;
+	if( GetTempFileName(dir, _T("srt"), 0, name) == 0 )
+		return false;
+	_runs.append(name);
+	return true;
+}
+
+template<typename item_type, typename comparator>
+	void _external_sort_<item_type, comparator>::_removeRuns ()
+{
+	for(int i = 0; i < _runs.length(); ++i)
+		DeleteFile(_runs[i]);
+	_runs.clear();
+}
+
+
+};	// namespace soige
+
+#endif  // __external_sort_already_included_vasya__
@@ -0,0 +1,512 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _format_.cpp - implementation of the formatting functions.
+//
+// The text goes out through a _format_out, which writes what
+// fits in the buffer and counts all of it, so the same pass
+// both writes the text and measures it.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "_format_.h"
+#include "_string_.h"
+#include "_num_conv_.h"
+
+namespace soige {
+
+_format_arg_::_format_arg_(const _string_& val) : _kind(STR)
+{
+	_p = val.c_str();
+	_len = val.length();
+}
+
+//------------------------------------------------
+// The output
+//------------------------------------------------
+struct _format_out
+{
+	LPSTR	buf;
+	int		size;	// the room for chars, without the 0
+	int		len;	// the chars of the whole text so far
+
+	inline void put( char c )
+	{
+		if( len < size ) buf[len] = c;
+		len++;
+	}
+	inline void put( const char* p, int n )
+	{
+		if( n <= 0 ) return;
+		if( len < size ) memcpy( buf + len, p, min(n, size - len) );
+		len += n;
+	}
+	inline void fill( char c, int n )
+	{
+		if( n <= 0 ) return;
+		if( len < size ) memset( buf + len, c, min(n, size - len) );
+		len += n;
+	}
+};
+
+// one % spec
+struct _format_spec
+{
+	bool	left, plus, space, alt, zero;
+	int		width;
+	int		precision;	// -1 if there's none
+	char	length;		// 'h', 'H' for hh, or 0 for the others
+	char	type;
+};
+
+//------------------------------------------------
+// The writing of each argument
+//------------------------------------------------
+class _formatter
+{
+public:
+	static void	write		( _format_out& out, const _format_spec& spec, const _format_arg_& arg );
+	static int	intOf		( const _format_arg_& arg );
+
+private:
+	static void	_padded		( _format_out& out, const _format_spec& spec, const char* prefix, int prefixLen,
+							  int zeros, const char* body, int bodyLen, bool zeroPad );
+	static void	_text		( _format_out& out, const _format_spec& spec, const _format_arg_& arg );
+	static void	_wide		( _format_out& out, const _format_spec& spec, LPCWSTR p, int len );
+	static void	_integer	( _format_out& out, const _format_spec& spec, const _format_arg_& arg );
+	static void	_floating	( _format_out& out, const _format_spec& spec, double val );
+	static __int64			_signed		( const _format_arg_& arg, char length );
+	static unsigned __int64	_unsigned	( const _format_arg_& arg, char length );
+};
+
+// prefix, zeros and body in spec.width chars: blanks before
+// them (or after them, for '-'), or for zeroPad more zeros
+void _formatter::_padded(_format_out& out, const _format_spec& spec, const char* prefix, int prefixLen,
+						 int zeros, const char* body, int bodyLen, bool zeroPad)
+{
+	int pad = spec.width - prefixLen - zeros - bodyLen;
+	if( pad > 0 && zeroPad && !spec.left )
+	{
+		zeros += pad;
+		pad = 0;
+	}
+	if( !spec.left ) out.fill( ' ', pad );
+	out.put( prefix, prefixLen );
+	out.fill( '0', zeros );
+	out.put( body, bodyLen );
+	if( spec.left ) out.fill( ' ', pad );
+}
+
+void _formatter::write(_format_out& out, const _format_spec& spec, const _format_arg_& arg)
+{
+	switch( spec.type )
+	{
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'p':
+		if( arg._kind == _format_arg_::STR || arg._kind == _format_arg_::WSTR )
+			_text( out, spec, arg );
+		else
+			_integer( out, spec, arg );
+		break;
+
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		if( arg._kind == _format_arg_::DOUBLE )
+			_floating( out, spec, arg._d );
+		else if( arg._kind == _format_arg_::STR || arg._kind == _format_arg_::WSTR )
+			_text( out, spec, arg );
+		else if( arg._kind == _format_arg_::UINT64 || arg._kind == _format_arg_::UINT )
+			// (VC6 can't convert an unsigned __int64 to a double)
+			_floating( out, spec, (double)(__int64)((unsigned __int64)arg._i >> 1) * 2 + (double)(arg._i & 1) );
+		else
+			_floating( out, spec, (double)_signed(arg, 0) );
+		break;
+
+	case 'c':
+		if( arg._kind == _format_arg_::STR || arg._kind == _format_arg_::WSTR )
+			_text( out, spec, arg );
+		else
+		{
+			char c = (char)_signed( arg, 0 );
+			_padded( out, spec, NULL, 0, 0, &c, 1, false );
+		}
+		break;
+
+	default:	// 's', 'S'
+		_text( out, spec, arg );
+		break;
+	}
+}
+
+// the argument as a string, and a number as its text
+void _formatter::_text(_format_out& out, const _format_spec& spec, const _format_arg_& arg)
+{
+	char buf[NUM_CONV_CHARS];
+	const char* p = buf;
+	int len;
+	switch( arg._kind )
+	{
+	case _format_arg_::STR:
+		p = (const char*)arg._p;
+		len = arg._len;
+		// as the CRT writes it
+		if( !p )
+		{
+			p = "(null)";
+			len = 6;
+		}
+		break;
+	case _format_arg_::WSTR:
+		_wide( out, spec, (LPCWSTR)arg._p, arg._len );
+		return;
+	case _format_arg_::CHAR:
+		buf[0] = (char)arg._i;
+		len = 1;
+		break;
+	case _format_arg_::DOUBLE:
+		len = _formatDouble( arg._d, buf );
+		break;
+	case _format_arg_::UINT:
+	case _format_arg_::UINT64:
+	case _format_arg_::PTR:
+		len = _formatUInt64( _unsigned(arg, 0), buf );
+		break;
+	default:
+		len = _formatInt64( arg._i, buf );
+		break;
+	}
+	// only %s has a precision for strings, the most chars
+	if( spec.precision >= 0 && spec.precision < len && (spec.type == 's' || spec.type == 'S') )
+		len = spec.precision;
+	_padded( out, spec, NULL, 0, 0, p, len, false );
+}
+
+// a wide string, one char after another through wctomb(), as
+// the wide string functions of _string_ do with wcstombs()
+void _formatter::_wide(_format_out& out, const _format_spec& spec, LPCWSTR p, int len)
+{
+	if( !p )
+	{
+		_format_spec s = spec;
+		s.type = 's';
+		_format_arg_ null_arg( (LPCSTR)NULL );
+		_text( out, s, null_arg );
+		return;
+	}
+	// the length of the chars, for the padding
+	char mb[16];
+	int i, n = 0;
+	for( i = 0; i < len; i++ )
+	{
+		int k = wctomb( mb, p[i] );
+		if( k < 0 ) k = 1;
+		if( spec.precision >= 0 && n + k > spec.precision ) break;
+		n += k;
+	}
+	int pad = spec.width - n;
+	if( !spec.left ) out.fill( ' ', pad );
+	for( i = 0; n > 0; i++ )
+	{
+		int k = wctomb( mb, p[i] );
+		if( k < 0 )
+		{
+			mb[0] = '?';
+			k = 1;
+		}
+		out.put( mb, k );
+		n -= k;
+	}
+	if( spec.left ) out.fill( ' ', pad );
+}
+
+// %d, %u, %o, %x and %p
+void _formatter::_integer(_format_out& out, const _format_spec& spec, const _format_arg_& arg)
+{
+	char digits[24];
+	int n;
+	char prefix[2];
+	int prefixLen = 0;
+	int precision = spec.precision;
+	unsigned __int64 v;
+
+	if( spec.type == 'd' || spec.type == 'i' )
+	{
+		__int64 s = _signed( arg, spec.length );
+		v = (s < 0) ? 0 - (unsigned __int64)s : (unsigned __int64)s;
+		if( s < 0 )					prefix[prefixLen++] = '-';
+		else if( spec.plus )		prefix[prefixLen++] = '+';
+		else if( spec.space )		prefix[prefixLen++] = ' ';
+		n = _formatUInt64( v, digits );
+	}
+	else if( spec.type == 'u' )
+	{
+		v = _unsigned( arg, spec.length );
+		n = _formatUInt64( v, digits );
+	}
+	else
+	{
+		// back from the end of digits, 3 or 4 bits at a time
+		const char* hex = (spec.type == 'x') ? "0123456789abcdef" : "0123456789ABCDEF";
+		int shift = (spec.type == 'o') ? 3 : 4;
+		v = _unsigned( arg, spec.length );
+		if( spec.type == 'p' )
+		{
+			// all the digits of a pointer, as the CRT writes it
+			if( arg._kind == _format_arg_::PTR )
+				v = (unsigned long)arg._p;
+			precision = 2 * sizeof(void*);
+		}
+		char* p = digits + sizeof(digits);
+		unsigned __int64 w = v;
+		do
+		{
+			*--p = hex[(int)w & ((1 << shift) - 1)];
+			w >>= shift;
+		} while( w );
+		n = (int)(digits + sizeof(digits) - p);
+		memmove( digits, p, n );
+		if( spec.alt && v != 0 && (spec.type == 'x' || spec.type == 'X') )
+		{
+			prefix[prefixLen++] = '0';
+			prefix[prefixLen++] = spec.type;
+		}
+		// %#o starts with a 0, even for a 0 of precision 0
+		if( spec.alt && spec.type == 'o' )
+		{
+			if( v != 0 && precision <= n )	precision = n + 1;
+			else if( precision == 0 )		precision = 1;
+		}
+	}
+
+	// no digits for a 0 of precision 0
+	if( precision == 0 && v == 0 ) n = 0;
+	int zeros = (precision > n) ? precision - n : 0;
+	_padded( out, spec, prefix, prefixLen, zeros, digits, n, spec.zero && precision < 0 );
+}
+
+static const double _pow10[] =
+	{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+// %f of a value whose shortest digits have no more than precision
+// after the point is those digits and zeros: they're within half a
+// unit in the last place of the value, which is less than half of
+// 10^-precision while the value times 10^precision is under 2^52;
+// returns -1 for the others
+static int _fixed(double val, int precision, LPSTR buf)
+{
+	if( precision > 9 || !(fabs(val) * _pow10[precision] < 4503599627370496.0) )
+		return -1;
+	int len = _formatDouble( val, buf );
+	if( memchr(buf, 'e', len) ) return -1;
+	const char* point = (const char*)memchr( buf, '.', len );
+	int decimals = point ? len - (int)(point - buf) - 1 : 0;
+	if( decimals > precision ) return -1;
+	if( !point && precision > 0 ) buf[len++] = '.';
+	memset( buf + len, '0', precision - decimals );
+	len += precision - decimals;
+	buf[len] = '\0';
+	return len;
+}
+
+// %f, %e, %g and %a of the CRT, in a buffer on the stack; the
+// sign is taken off, to go before the zeros of the padding
+void _formatter::_floating(_format_out& out, const _format_spec& spec, double val)
+{
+	char buf[FORMAT_MAX_PRECISION + 330];
+	int len;
+#if defined(_USE_NO_CRT) && !defined(_DEBUG) && !defined(DEBUG)
+	// no _snprintf(): the shortest digits, whatever the spec
+	len = _formatDouble( val, buf );
+#else
+	len = -1;
+	if( (spec.type == 'f' || spec.type == 'F') && !spec.alt )
+		len = _fixed( val, (spec.precision < 0) ? 6 : spec.precision, buf );
+	if( len < 0 )
+	{
+		char fmt[16];
+		char* f = fmt;
+		*f++ = '%';
+		if( spec.alt ) *f++ = '#';
+		if( spec.precision >= 0 )
+		{
+			*f++ = '.';
+			f += _formatLong( min(spec.precision, FORMAT_MAX_PRECISION), f );
+		}
+		*f++ = spec.type;
+		*f = '\0';
+		len = _snprintf( buf, sizeof(buf), fmt, val );
+		if( len < 0 || len >= (int)sizeof(buf) ) len = sizeof(buf) - 1;
+	}
+#endif
+
+	const char* body = buf;
+	char sign = 0;
+	if( buf[0] == '-' )
+	{
+		sign = '-';
+		body++;
+		len--;
+	}
+	else if( spec.plus )	sign = '+';
+	else if( spec.space )	sign = ' ';
+	// NaN and Infinity aren't padded with zeros
+	bool zeroPad = spec.zero && body[0] >= '0' && body[0] <= '9';
+	_padded( out, spec, &sign, sign ? 1 : 0, 0, body, len, zeroPad );
+}
+
+// the argument as %d and %i want it
+__int64 _formatter::_signed(const _format_arg_& arg, char length)
+{
+	__int64 v;
+	switch( arg._kind )
+	{
+	case _format_arg_::DOUBLE:	v = (__int64)arg._d;			break;
+	case _format_arg_::PTR:		v = (long)arg._p;				break;
+	case _format_arg_::STR:
+	case _format_arg_::WSTR:	v = 0;							break;
+	default:					v = arg._i;						break;
+	}
+	if( length == 'h' ) v = (short)v;
+	else if( length == 'H' ) v = (signed char)v;
+	return v;
+}
+
+// the argument as %u, %o and %x want it: a negative 32-bit value
+// is 32 bits of unsigned, as it would be passed through ...
+unsigned __int64 _formatter::_unsigned(const _format_arg_& arg, char length)
+{
+	unsigned __int64 v;
+	switch( arg._kind )
+	{
+	case _format_arg_::CHAR:
+	case _format_arg_::INT:
+	case _format_arg_::UINT:	v = (DWORD)arg._i;						break;
+	case _format_arg_::DOUBLE:	v = (unsigned __int64)(__int64)arg._d;	break;
+	case _format_arg_::PTR:		v = (unsigned long)arg._p;				break;
+	case _format_arg_::STR:
+	case _format_arg_::WSTR:	v = 0;									break;
+	default:					v = (unsigned __int64)arg._i;			break;
+	}
+	if( length == 'h' ) v = (WORD)v;
+	else if( length == 'H' ) v = (BYTE)v;
+	return v;
+}
+
+// the argument as a * width or precision
+int _formatter::intOf(const _format_arg_& arg)
+{
+	return (int)_signed( arg, 0 );
+}
+
+
+//------------------------------------------------
+// The spec
+//------------------------------------------------
+int _formatArgs(LPSTR buf, int size, LPCSTR format_spec, const _format_arg_* const* args, int count)
+{
+	_format_out out;
+	out.buf = buf;
+	out.size = (buf && size > 0) ? size - 1 : 0;
+	out.len = 0;
+	// what's written for an argument that isn't there
+	static const _format_arg_ none( "" );
+	int next = 0;
+
+	const char* p = format_spec;
+	while( p && *p )
+	{
+		// the chars up to the next %, in one go
+		const char* start = p;
+		while( *p && *p != '%' ) p++;
+		out.put( start, (int)(p - start) );
+		if( !*p ) break;
+		if( *++p == '%' )
+		{
+			out.put( '%' );
+			p++;
+			continue;
+		}
+
+		_format_spec spec;
+		spec.left = spec.plus = spec.space = spec.alt = spec.zero = false;
+		spec.width = 0;
+		spec.precision = -1;
+		spec.length = 0;
+		for( ; ; p++ )
+		{
+			if( *p == '-' )			spec.left = true;
+			else if( *p == '+' )	spec.plus = true;
+			else if( *p == ' ' )	spec.space = true;
+			else if( *p == '#' )	spec.alt = true;
+			else if( *p == '0' )	spec.zero = true;
+			else break;
+		}
+		if( *p == '*' )
+		{
+			spec.width = _formatter::intOf( next < count ? *args[next] : none );
+			next++;
+			p++;
+			if( spec.width < 0 )
+			{
+				spec.left = true;
+				spec.width = -spec.width;
+			}
+		}
+		else
+			for( ; *p >= '0' && *p <= '9'; p++ )
+				spec.width = spec.width * 10 + (*p - '0');
+		if( *p == '.' )
+		{
+			p++;
+			spec.precision = 0;
+			if( *p == '*' )
+			{
+				spec.precision = _formatter::intOf( next < count ? *args[next] : none );
+				next++;
+				p++;
+				if( spec.precision < 0 ) spec.precision = -1;
+			}
+			else
+				for( ; *p >= '0' && *p <= '9'; p++ )
+					spec.precision = spec.precision * 10 + (*p - '0');
+		}
+		// the lengths; the arguments know their sizes, only h and
+		// hh cut them down
+		for( ; ; p++ )
+		{
+			if( *p == 'h' )			spec.length = (spec.length == 'h') ? 'H' : 'h';
+			else if( *p == 'I' && p[1] == '6' && p[2] == '4' )	p += 2;
+			else if( *p == 'I' && p[1] == '3' && p[2] == '2' )	p += 2;
+			else if( *p != 'l' && *p != 'L' && *p != 'I' && *p != 'w' &&
+					 *p != 'q' && *p != 'j' && *p != 'z' && *p != 't' )
+				break;
+		}
+
+		spec.type = *p;
+		if( !spec.type ) break;
+		p++;
+		switch( spec.type )
+		{
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'p':
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		case 'c': case 's': case 'S': case 'C':
+			if( spec.type == 'C' ) spec.type = 'c';
+			_formatter::write( out, spec, next < count ? *args[next] : none );
+			next++;
+			break;
+		case 'n':
+			next++;
+			break;
+		default:
+			// not a type: the char itself, as the CRT does
+			out.put( spec.type );
+			break;
+		}
+	}
+
+	if( buf && size > 0 )
+		buf[min(out.len, out.size)] = '\0';
+	return out.len;
+}
+
+
+};	// namespace soige
@@ -0,0 +1,171 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _format_.h - type-safe sprintf-style formatting.
+//
+// The arguments of _formatTo() and of _string_::format() are
+// _format_arg_s, each made (implicitly) from a number, a char,
+// a string or a pointer, and knowing what it was made from.
+// The % specs are those of printf():
+//     %[flags][width][.precision][length]type
+// with the flags - + space # 0, * for the width or precision
+// (taken from the next argument), the lengths h hh l ll L I64
+// I32 I w (which only matter for h and hh: the argument knows
+// its size), and the types d i u o x X c s S f F e E g G a A
+// p and %. A spec and an argument that don't match can't
+// write garbage: an argument is converted to what the type
+// wants (a double to an integer for %d, an integer to a double
+// for %f), and a string is written as it is for any number
+// type, as a number is written as text (see _num_conv_.h) for
+// %s. Arguments beyond those given are empty, and %n writes
+// nothing.
+//
+// Integers and strings are written right into the buffer, with
+// _num_conv_'s digits, without the CRT. The floating point
+// types (with a precision) go through _snprintf() into a small
+// buffer on the stack; the precision is at most
+// FORMAT_MAX_PRECISION.
+//
+// Nothing allocates: _formatTo() writes into the caller's
+// buffer and returns the length the whole text needs, as
+// _snprintf() would if it counted; _string_::format() writes
+// into a buffer on the stack, and only a longer text is
+// written again, straight into a string of its length.
+//
+// C++98 has no variadic templates, so there is an overload for
+// each count of arguments, up to FORMAT_MAX_ARGS; the spec is
+// parsed as it's written, in the one pass.
+//
+// Usage:
+//     _string_ s;
+//     s.format( "%-10s|%5d|%.2f|%s", name, count, price, ok ? "yes" : "no" );
+//     char buf[64];
+//     if( _formatTo( buf, sizeof(buf), "%08X", crc ) >= sizeof(buf) ) ...
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __format_already_included_vasya__
+#define __format_already_included_vasya__
+
+#include "_common_.h"
+#include "_string_view_.h"
+
+// the most arguments of the overloads below
+#define FORMAT_MAX_ARGS  8
+
+// the most digits after the point of %f, %e and %g
+#ifndef FORMAT_MAX_PRECISION
+	#define FORMAT_MAX_PRECISION  100
+#endif
+
+// the stack buffer of _string_::format(); longer texts are
+// written twice
+#ifndef FORMAT_STACK_CHARS
+	#define FORMAT_STACK_CHARS  256
+#endif
+
+namespace soige {
+
+class _string_;
+
+//------------------------------------------------------------
+// An argument: a value and what it was made from
+//------------------------------------------------------------
+class _format_arg_
+{
+public:
+	_format_arg_	( char val )				: _kind(CHAR)		{ _i = val; }
+	_format_arg_	( int val )					: _kind(INT)		{ _i = val; }
+	_format_arg_	( unsigned int val )		: _kind(UINT)		{ _i = val; }
+	_format_arg_	( long val )				: _kind(sizeof(long) > 4 ? INT64 : INT)		{ _i = val; }
+	_format_arg_	( unsigned long val )		: _kind(sizeof(long) > 4 ? UINT64 : UINT)	{ _i = (__int64)val; }
+	_format_arg_	( __int64 val )				: _kind(INT64)		{ _i = val; }
+	_format_arg_	( unsigned __int64 val )	: _kind(UINT64)		{ _i = (__int64)val; }
+	_format_arg_	( double val )				: _kind(DOUBLE)		{ _d = val; }
+	_format_arg_	( LPCSTR val )				: _kind(STR)		{ _p = val; _len = val ? lstrlenA(val) : 0; }
+	_format_arg_	( LPCWSTR val )				: _kind(WSTR)		{ _p = val; _len = val ? lstrlenW(val) : 0; }
+	_format_arg_	( const _string_view_& val ): _kind(STR)		{ _p = val.data(); _len = val.length(); }
+	_format_arg_	( const _string_& val );
+	_format_arg_	( const void* val )			: _kind(PTR)		{ _p = val; }
+
+private:
+	enum kind { CHAR, INT, UINT, INT64, UINT64, DOUBLE, STR, WSTR, PTR };
+
+	kind		_kind;
+	union
+	{
+		__int64		_i;
+		double		_d;
+		const void*	_p;
+	};
+	int			_len;	// of a string
+
+	// writes the arguments, in _format_.cpp
+	friend class _formatter;
+};
+
+//------------------------------------------------------------
+// Formatting into a buffer: writes as much of the text as fits
+// in size chars, with the 0 (if size > 0), and returns the
+// length of the whole text. A NULL buf only measures it.
+//------------------------------------------------------------
+int _formatArgs	( LPSTR buf, int size, LPCSTR format_spec,
+				  const _format_arg_* const* args, int count );
+
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec )
+	{ return _formatArgs( buf, size, format_spec, NULL, 0 ); }
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1 )
+{
+	const _format_arg_* args[] = { &a1 };
+	return _formatArgs( buf, size, format_spec, args, 1 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2 )
+{
+	const _format_arg_* args[] = { &a1, &a2 };
+	return _formatArgs( buf, size, format_spec, args, 2 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3 };
+	return _formatArgs( buf, size, format_spec, args, 3 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4 };
+	return _formatArgs( buf, size, format_spec, args, 4 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+					  const _format_arg_& a5 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5 };
+	return _formatArgs( buf, size, format_spec, args, 5 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+					  const _format_arg_& a5, const _format_arg_& a6 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6 };
+	return _formatArgs( buf, size, format_spec, args, 6 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+					  const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6, &a7 };
+	return _formatArgs( buf, size, format_spec, args, 7 );
+}
+inline int _formatTo( LPSTR buf, int size, LPCSTR format_spec, const _format_arg_& a1,
+					  const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+					  const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7,
+					  const _format_arg_& a8 )
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6, &a7, &a8 };
+	return _formatArgs( buf, size, format_spec, args, 8 );
+}
+
+
+};	// namespace soige
+
+#endif  // __format_already_included_vasya__
@@ -0,0 +1,282 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _hash_.h - hash functions, and the hash tables used by the
+// hash joins (_join_.h) and the hash group-by (_query_.h).
+//
+// _hashOf() hashes a value to a DWORD; values that are equal
+// (operator ==) hash the same. It's specialized like
+// _compare(): integers are mixed, doubles hashed on their
+// bits, strings on their bytes.
+//
+// _hash_index_<> indexes the rows of a key column: each row
+// is chained to the other rows in its bucket, so all the
+// rows with a key can be found. _hash_groups_<> numbers the
+// distinct keys it's given, in the order they first come.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __hash_already_included_vasya__
+#define __hash_already_included_vasya__
+
+#include "_common_.h"
+#include "_array_.h"
+#include "_string_.h"
+
+namespace soige {
+
+//------------------------------------------------------------
+// Hash functions
+//------------------------------------------------------------
+
+// spreads every bit of h over all the others (the murmur3
+// finalizer), so that the low bits can pick a bucket
+inline DWORD _hashMix(DWORD h)
+{
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+
+// FNV-1a over the bytes, mixed
+inline DWORD _hashBytes(const char* p, int len)
+{
+	DWORD h = 2166136261u;
+	for(int i=0; i<len; i++)
+	{
+		h ^= (unsigned char)p[i];
+		h *= 16777619;
+	}
+	return _hashMix(h);
+}
+
+template<typename T> inline DWORD _hashOf(const T& val)
+	{ return _hashMix((DWORD)val); }
+template<> inline DWORD _hashOf<__int64>(const __int64& val)
+	{ return _hashMix((DWORD)val ^ _hashMix((DWORD)(val >> 32))); }
+template<> inline DWORD _hashOf<unsigned __int64>(const unsigned __int64& val)
+	{ return _hashMix((DWORD)val ^ _hashMix((DWORD)(val >> 32))); }
+// 0.0 and -0.0 are equal, but their bits aren't
+template<> inline DWORD _hashOf<double>(const double& val)
+	{ double v = (val == 0) ? 0.0 : val; __int64 bits; memcpy(&bits, &v, sizeof(bits));
+	  return _hashOf(bits); }
+template<> inline DWORD _hashOf<float>(const float& val)
+	{ return _hashOf((double)val); }
+// an interned string has its hash already
+template<> inline DWORD _hashOf<_string_>(const _string_& val)
+	{ return val.isInterned() ? val.internedHash() : _hashBytes(val.c_str(), val.length()); }
+template<> inline DWORD _hashOf<_string_view_>(const _string_view_& val)
+	{ return _hashBytes(val.data(), val.length()); }
+
+
+//------------------------------------------------------------
+// Hash index of the rows of a key column. The keys aren't
+// copied and have to stay put while the index is used.
+//------------------------------------------------------------
+template<typename key_type> class _hash_index_
+{
+public:
+	_hash_index_()
+	{
+		_keys = NULL;
+		_count = 0;
+		_mask = 0;
+	}
+
+	// builds the index of keys[0] to keys[count - 1]
+	void build(const key_type* keys, int count)
+	{
+		init(keys, count);
+		hashRows(0, count);
+		// backwards, so that each chain is in increasing row order
+		for(int row=count-1; row>=0; row--)
+			_link(row);
+	}
+
+	// The steps of build(), for building in parts: init(), then
+	// hashRows() for parts of the rows, then splitRows() into as
+	// many parts of the buckets, and linkRows() for each of them.
+	// The parts of hashRows() and of linkRows() can run at once
+	// on threads of their own.
+	void init(const key_type* keys, int count)
+	{
+		_keys = keys;
+		_count = count;
+		int buckets = 16;
+		while(buckets < count)
+			buckets <<= 1;
+		_mask = buckets - 1;
+		_heads.resize(buckets);
+		memset(&_heads[0], 0xFF, buckets*sizeof(int));
+		_next.resize(count);
+		_hashes.resize(count);
+		_partRows.clear();
+		_partStarts.clear();
+	}
+	void hashRows(int first, int last)
+	{
+		for(int row=first; row<last; row++)
+			_hashes[row] = _hashOf(_keys[row]);
+	}
+	// the rows of each part of the buckets, in row order (a
+	// counting sort on the part), so that a part links only its
+	// own rows
+	void splitRows(int parts)
+	{
+		int buckets = getBucketCount(), row, part;
+		_partStarts.resize(parts + 1);
+		memset(&_partStarts[0], 0, (parts + 1)*sizeof(int));
+		for(row=0; row<_count; row++)
+			_partStarts[_partOf(row, parts, buckets) + 1]++;
+		for(part=0; part<parts; part++)
+			_partStarts[part + 1] += _partStarts[part];
+		_array_<int> ends;
+		ends = _partStarts;
+		_partRows.resize(_count);
+		for(row=0; row<_count; row++)
+			_partRows[ends[_partOf(row, parts, buckets)]++] = row;
+	}
+	void linkRows(int part)
+	{
+		for(int i=_partStarts[part + 1]-1; i>=_partStarts[part]; i--)
+			_link(_partRows[i]);
+	}
+
+	int getRowCount() const
+	{
+		return _count;
+	}
+	int getBucketCount() const
+	{
+		return _mask + 1;
+	}
+
+	// the first row having the key (whose hash is given), -1 if
+	// none; then nextRow() gives the others, in increasing order
+	int findRow(const key_type& key, DWORD hash) const
+	{
+		return _match(_heads[hash & _mask], key, hash);
+	}
+	int nextRow(int row, const key_type& key, DWORD hash) const
+	{
+		return _match(_next[row], key, hash);
+	}
+
+protected:
+	const key_type* _keys;
+	int _count;
+	DWORD _mask;
+	_array_<int> _heads;	// the first row of each bucket, -1 if none
+	_array_<int> _next;		// the next row in the row's bucket
+	_array_<DWORD> _hashes;
+	// after splitRows(): the rows of each part, from _partStarts[part]
+	_array_<int> _partRows;
+	_array_<int> _partStarts;
+
+	// the part of the buckets the row's bucket is in
+	int _partOf(int row, int parts, int buckets) const
+	{
+		return (int)((__int64)(_hashes[row] & _mask) * parts / buckets);
+	}
+	void _link(int row)
+	{
+		int bucket = (int)(_hashes[row] & _mask);
+		_next[row] = _heads[bucket];
+		_heads[bucket] = row;
+	}
+	int _match(int row, const key_type& key, DWORD hash) const
+	{
+		while(row >= 0 && !(_hashes[row] == hash && _keys[row] == key))
+			row = _next[row];
+		return row;
+	}
+};
+
+
+//------------------------------------------------------------
+// Hash table numbering the distinct keys: the first key
+// inserted is group 0, the next new one group 1, and so on.
+// Keys that aren't equal to themselves (NaNs) are always new.
+//------------------------------------------------------------
+template<typename key_type> class _hash_groups_
+{
+public:
+	_hash_groups_()
+	{
+		clear();
+	}
+
+	int length() const
+	{
+		return _keys.length();
+	}
+	const key_type& getKey(int group) const
+	{
+		return _keys[group];
+	}
+	DWORD getHash(int group) const
+	{
+		return _hashes[group];
+	}
+	const _array_<key_type>& getKeys() const
+	{
+		return _keys;
+	}
+
+	// the group of the key (whose hash is given), a new one at
+	// the end if the key hasn't been inserted before
+	int insert(const key_type& key, DWORD hash)
+	{
+		int slot = (int)(hash & _mask);
+		for(;;)
+		{
+			int group = _slots[slot];
+			if(group < 0)
+				break;
+			if(_hashes[group] == hash && _keys[group] == key)
+				return group;
+			slot = (slot + 1) & _mask;
+		}
+		int group = _keys.length();
+		_keys.append(key);
+		_hashes.append(hash);
+		_slots[slot] = group;
+		// kept at most half full
+		if(group*2 >= _slots.length())
+			_rehash(_slots.length()*2);
+		return group;
+	}
+
+	void clear()
+	{
+		_keys.clear();
+		_hashes.clear();
+		_rehash(16);
+	}
+
+protected:
+	_array_<int> _slots;	// the group in each slot, -1 if none
+	DWORD _mask;
+	_array_<key_type> _keys;
+	_array_<DWORD> _hashes;
+
+	void _rehash(int slots)
+	{
+		_slots.resize(slots);
+		memset(&_slots[0], 0xFF, slots*sizeof(int));
+		_mask = slots - 1;
+		for(int group=0; group<_keys.length(); group++)
+		{
+			int slot = (int)(_hashes[group] & _mask);
+			while(_slots[slot] >= 0)
+				slot = (slot + 1) & _mask;
+			_slots[slot] = group;
+		}
+	}
+};
+
+
+};	// namespace soige
+
+#endif // __hash_already_included_vasya__
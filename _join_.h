@@ -0,0 +1,520 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _join_.h - header file for _join_<>, the hash join and
+// sort-merge join of key columns and of _table_<>s.
+//
+// A join matches the rows of two key columns (plain arrays,
+// as kept by _table_<>::getColumnData() and _column_table_)
+// having equal keys, and gives the matching row pairs; the
+// keys aren't copied. The hash join indexes one column (see
+// _hash_.h) and looks up the keys of the other; with a
+// _thread_pool_, large columns are indexed and looked up in
+// parts on the pool's threads. The sort-merge join sorts row
+// indexes of both columns and walks them together.
+//
+// joinTables() joins two _table_<>s on a column each into a
+// new table. For group-by, see _column_query_<> (_query_.h).
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __join_already_included_vasya__
+#define __join_already_included_vasya__
+
+#include "_common_.h"
+#include "_array_.h"
+#include "_sort_.h"
+#include "_hash_.h"
+#include "_query_.h"
+#include "_table_.h"
+#include "_thread_pool_.h"
+
+namespace soige {
+
+// which rows a join gives
+enum join_kind
+{
+	join_inner,		// the pairs of rows with equal keys
+	join_left		// and the left rows that have no pair, with -1
+};
+
+//------------------------------------------------------------
+// The result of a join: pairs of row indexes, getLeft(i) of
+// the left column with getRight(i) of the right one
+//------------------------------------------------------------
+class _join_pairs_
+{
+public:
+	_join_pairs_()
+	{
+		_left = _right = NULL;
+		_length = _capacity = 0;
+	}
+	_join_pairs_(const _join_pairs_& other)
+	{
+		_left = _right = NULL;
+		_length = _capacity = 0;
+		append(other);
+	}
+	virtual ~_join_pairs_()
+	{
+		free(_left);
+		free(_right);
+		_left = _right = NULL;
+	}
+	_join_pairs_& operator=(const _join_pairs_& other)
+	{
+		if(this == &other) return *this;
+		_length = 0;
+		append(other);
+		return *this;
+	}
+
+	int length() const
+	{
+		return _length;
+	}
+	int getLeft(int index) const
+	{
+		return _left[index];
+	}
+	int getRight(int index) const
+	{
+		return _right[index];
+	}
+	const int* leftRows() const
+	{
+		return _left;
+	}
+	const int* rightRows() const
+	{
+		return _right;
+	}
+	void clear()
+	{
+		_length = 0;
+	}
+	void reserve(int capacity)
+	{
+		if(capacity <= _capacity)
+			return;
+		_left = (int*) realloc(_left, capacity*sizeof(int));
+		_right = (int*) realloc(_right, capacity*sizeof(int));
+		_capacity = capacity;
+	}
+	void append(int left, int right)
+	{
+		if(_length == _capacity)
+			reserve((int)(_length*ALLOC_SLACK) + 16);
+		_left[_length] = left;
+		_right[_length] = right;
+		_length++;
+	}
+	void append(const _join_pairs_& other)
+	{
+		if(other._length == 0)
+			return;
+		reserve(_length + other._length);
+		memcpy(_left + _length, other._left, other._length*sizeof(int));
+		memcpy(_right + _length, other._right, other._length*sizeof(int));
+		_length += other._length;
+	}
+
+protected:
+	int* _left;
+	int* _right;
+	int _length;
+	int _capacity;
+};
+
+
+//------------------------------------------------------------
+// The parts of a hash join run on the pool
+//------------------------------------------------------------
+
+// hashing rows [first, last) of the indexed column, or linking
+// the rows of part first of its buckets
+template<typename key_type> struct _join_build_job_
+{
+	_hash_index_<key_type>* index;
+	int first, last;
+	bool link;
+
+	static int __stdcall run(void* pParam)
+	{
+		_join_build_job_* job = (_join_build_job_*) pParam;
+		if(job->link)
+			job->index->linkRows(job->first);
+		else
+			job->index->hashRows(job->first, job->last);
+		return 0;
+	}
+};
+
+// looking up the keys of rows [first, last) of the other column
+template<typename key_type> struct _join_probe_job_
+{
+	const _hash_index_<key_type>* index;
+	const key_type* keys;
+	int first, last;
+	bool outer;		// rows with no match are kept, paired with -1
+	bool swapped;	// the indexed column is the left one
+	_join_pairs_ pairs;
+
+	static int __stdcall run(void* pParam)
+	{
+		_join_probe_job_* job = (_join_probe_job_*) pParam;
+		const _hash_index_<key_type>& index = *job->index;
+		for(int row=job->first; row<job->last; row++)
+		{
+			const key_type& key = job->keys[row];
+			DWORD hash = _hashOf(key);
+			int match = index.findRow(key, hash);
+			if(match < 0 && job->outer)
+				job->pairs.append(row, -1);
+			for(; match >= 0; match = index.nextRow(match, key, hash))
+			{
+				if(job->swapped)
+					job->pairs.append(match, row);
+				else
+					job->pairs.append(row, match);
+			}
+		}
+		return 0;
+	}
+};
+
+// The order of the merge join: _compare(), but with the keys
+// that aren't equal to themselves (NaNs) after all the others,
+// where they're left without a pair, as hashJoin() leaves them
+template<typename key_type> inline int _joinCompare(const key_type& a, const key_type& b)
+	{ return _compare(a, b); }
+template<> inline int _joinCompare<double>(const double& a, const double& b)
+	{ return (a != a || b != b) ? (a != a) - (b != b) : _compare(a, b); }
+template<> inline int _joinCompare<float>(const float& a, const float& b)
+	{ return (a != a || b != b) ? (a != a) - (b != b) : _compare(a, b); }
+
+template<typename key_type> class _join_key_order_
+{
+public:
+	_join_key_order_(const key_type* keys) : _keys(keys)
+	{ }
+	int operator()(const int& row1, const int& row2) const
+	{
+		int c = _joinCompare(_keys[row1], _keys[row2]);
+		return c ? c : row1 - row2;
+	}
+protected:
+	const key_type* _keys;
+};
+
+// sorting the row indexes of a column on their keys
+template<typename key_type> struct _join_sort_job_
+{
+	const key_type* keys;
+	_array_<int>* order;
+
+	static int __stdcall run(void* pParam)
+	{
+		_join_sort_job_* job = (_join_sort_job_*) pParam;
+		_array_<int>& order = *job->order;
+		if(order.length() > 1)
+		{
+			_sort_<int> sorter;
+			sorter.sort(&order[0], order.length(), _join_key_order_<key_type>(job->keys));
+		}
+		return 0;
+	}
+};
+
+
+//------------------------------------------------------------
+// Joins of key columns, and of tables on a key column each
+//------------------------------------------------------------
+template<typename key_type> class _join_
+{
+public:
+	// parts: how many pieces large columns are split into, 0 for
+	// the number of processors; without a pool, everything runs
+	// on the calling thread
+	_join_(_thread_pool_* pool = NULL, int parts = 0) :
+		_pool(pool), _parts(parts)
+	{
+		if(_parts <= 0)
+		{
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			_parts = (int)si.dwNumberOfProcessors;
+		}
+		if(_parts < 1)
+			_parts = 1;
+	}
+
+	// Hash join: the pairs of rows (l, r) with leftKeys[l] ==
+	// rightKeys[r], ordered by l, then by r. The smaller column
+	// of an inner join is the one indexed.
+	void hashJoin(const key_type* leftKeys, int leftCount,
+				  const key_type* rightKeys, int rightCount,
+				  _join_pairs_& pairs, join_kind kind = join_inner) const
+	{
+		pairs.clear();
+		bool swapped = ( kind == join_inner && leftCount < rightCount );
+		const key_type* indexKeys = swapped ? leftKeys : rightKeys;
+		const key_type* probeKeys = swapped ? rightKeys : leftKeys;
+		int indexCount = swapped ? leftCount : rightCount;
+		int probeCount = swapped ? rightCount : leftCount;
+
+		_hash_index_<key_type> index;
+		_buildIndex(index, indexKeys, indexCount);
+
+		int parts = _partsOf(probeCount);
+		_join_probe_job_<key_type>* jobs = new _join_probe_job_<key_type>[parts];
+		void** params = new void*[parts];
+		int i;
+		for(i=0; i<parts; i++)
+		{
+			jobs[i].index = &index;
+			jobs[i].keys = probeKeys;
+			jobs[i].first = (int)((__int64)probeCount * i / parts);
+			jobs[i].last = (int)((__int64)probeCount * (i + 1) / parts);
+			jobs[i].outer = ( kind == join_left );
+			jobs[i].swapped = swapped;
+			params[i] = &jobs[i];
+		}
+		_queryRunParts(_pool, _join_probe_job_<key_type>::run, params, parts);
+		// the parts in order, so the pairs stay in order
+		if(parts == 1)
+			pairs = jobs[0].pairs;
+		else
+			for(i=0; i<parts; i++)
+				pairs.append(jobs[i].pairs);
+		delete [] params;
+		delete [] jobs;
+
+		// the pairs come ordered by the right row: reorder them
+		if(swapped)
+			_orderByLeft(pairs, leftCount);
+	}
+
+	// Sort-merge join: the same pairs as hashJoin(), ordered by
+	// the key, then by l, then by r. The keys are matched with
+	// _compare(), which is what they're sorted on; NaNs sort
+	// last and match nothing.
+	void mergeJoin(const key_type* leftKeys, int leftCount,
+				   const key_type* rightKeys, int rightCount,
+				   _join_pairs_& pairs, join_kind kind = join_inner) const
+	{
+		pairs.clear();
+		_array_<int> left, right;
+		_sortRows(leftKeys, leftCount, left, rightKeys, rightCount, right);
+
+		int i = 0, j = 0;
+		while(i < leftCount)
+		{
+			int c = (j < rightCount) ? _joinCompare(leftKeys[left[i]], rightKeys[right[j]]) : -1;
+			// a NaN on the left has no pair, even with the NaNs on the right
+			if(c == 0 && !(leftKeys[left[i]] == leftKeys[left[i]]))
+				c = -1;
+			if(c < 0)
+			{
+				if(kind == join_left)
+					pairs.append(left[i], -1);
+				i++;
+			}
+			else if(c > 0)
+				j++;
+			else
+			{
+				// the rows with this key on both sides
+				const key_type& key = rightKeys[right[j]];
+				int end = j + 1;
+				while(end < rightCount && _joinCompare(rightKeys[right[end]], key) == 0)
+					end++;
+				for(; i < leftCount && _joinCompare(leftKeys[left[i]], key) == 0; i++)
+					for(int k=j; k<end; k++)
+						pairs.append(left[i], right[k]);
+				j = end;
+			}
+		}
+	}
+
+	// Joins two tables on a column of each: the result gets the
+	// columns of left, then those of right, and a row for each
+	// pair the join gives (hashJoin(), or mergeJoin() if
+	// sortMerge is set). Right's columns are empty in the rows
+	// of left rows with no pair.
+	bool joinTables(const _table_<key_type>& left, int leftCol,
+					const _table_<key_type>& right, int rightCol,
+					_table_<key_type>& result, join_kind kind = join_inner,
+					bool sortMerge = false) const
+	{
+		if(leftCol < 0 || leftCol >= left.getColumnCount() ||
+		   rightCol < 0 || rightCol >= right.getColumnCount())
+			return false;
+		_array_<key_type> leftCopy, rightCopy;
+		const key_type* leftKeys = _columnKeys(left, leftCol, leftCopy);
+		const key_type* rightKeys = _columnKeys(right, rightCol, rightCopy);
+		_join_pairs_ pairs;
+		if(sortMerge)
+			mergeJoin(leftKeys, left.getRowCount(), rightKeys, right.getRowCount(), pairs, kind);
+		else
+			hashJoin(leftKeys, left.getRowCount(), rightKeys, right.getRowCount(), pairs, kind);
+		makeTable(left, right, pairs, result);
+		return true;
+	}
+
+	// the table of the pairs of a join of left and right, as
+	// joinTables() makes it
+	static void makeTable(const _table_<key_type>& left, const _table_<key_type>& right,
+						  const _join_pairs_& pairs, _table_<key_type>& result)
+	{
+		result.clear();
+		_array_<_string_> header;
+		int col;
+		for(col=0; col<left.getColumnCount(); col++)
+			header.append(left.getColumnName(col));
+		for(col=0; col<right.getColumnCount(); col++)
+			header.append(right.getColumnName(col));
+		result.setHeader(header);
+		if(pairs.length() == 0)
+			return;
+
+		_array_<key_type> values;
+		values.resize(pairs.length());
+		for(col=0; col<header.length(); col++)
+		{
+			bool isLeft = ( col < left.getColumnCount() );
+			const _table_<key_type>& source = isLeft ? left : right;
+			int sourceCol = isLeft ? col : col - left.getColumnCount();
+			_gather(source, sourceCol, isLeft ? pairs.leftRows() : pairs.rightRows(),
+					pairs.length(), &values[0]);
+			result.setColumnData(col, &values[0], values.length());
+			if( source.isEncoded(sourceCol) )
+				result.encodeColumn(col);
+		}
+	}
+
+protected:
+	_thread_pool_* _pool;
+	int _parts;
+
+	int _partsOf(int count) const
+	{
+		return (_pool && count >= QUERY_PARALLEL_MIN) ? _parts : 1;
+	}
+
+	void _buildIndex(_hash_index_<key_type>& index, const key_type* keys, int count) const
+	{
+		int parts = _partsOf(count);
+		if(parts == 1)
+		{
+			index.build(keys, count);
+			return;
+		}
+		index.init(keys, count);
+		_join_build_job_<key_type>* jobs = new _join_build_job_<key_type>[parts];
+		void** params = new void*[parts];
+		int i, step;
+		// the rows are hashed in parts, split by the parts of the
+		// buckets they go to, and each part's rows linked
+		for(step=0; step<2; step++)
+		{
+			if(step == 1)
+				index.splitRows(parts);
+			for(i=0; i<parts; i++)
+			{
+				jobs[i].index = &index;
+				jobs[i].first = step ? i : (int)((__int64)count * i / parts);
+				jobs[i].last = step ? i + 1 : (int)((__int64)count * (i + 1) / parts);
+				jobs[i].link = ( step == 1 );
+				params[i] = &jobs[i];
+			}
+			_queryRunParts(_pool, _join_build_job_<key_type>::run, params, parts);
+		}
+		delete [] params;
+		delete [] jobs;
+	}
+
+	// the row indexes of both columns, sorted on their keys; the
+	// two are sorted at once if they're large and there's a pool
+	void _sortRows(const key_type* leftKeys, int leftCount, _array_<int>& left,
+				   const key_type* rightKeys, int rightCount, _array_<int>& right) const
+	{
+		int i;
+		left.resize(leftCount);
+		for(i=0; i<leftCount; i++)
+			left[i] = i;
+		right.resize(rightCount);
+		for(i=0; i<rightCount; i++)
+			right[i] = i;
+		_join_sort_job_<key_type> jobs[2];
+		jobs[0].keys = leftKeys;
+		jobs[0].order = &left;
+		jobs[1].keys = rightKeys;
+		jobs[1].order = &right;
+		void* params[2] = { &jobs[0], &jobs[1] };
+		bool large = ( _parts > 1 && leftCount + rightCount >= QUERY_PARALLEL_MIN );
+		_queryRunParts(large ? _pool : NULL, _join_sort_job_<key_type>::run, params, 2);
+	}
+
+	// reorders pairs ordered by the right row to be ordered by
+	// the left one (a counting sort, which keeps the right rows
+	// of each left row in order)
+	static void _orderByLeft(_join_pairs_& pairs, int leftCount)
+	{
+		int n = pairs.length();
+		if(n < 2)
+			return;
+		_array_<int> starts;
+		starts.resize(leftCount + 1);
+		memset(&starts[0], 0, (leftCount + 1)*sizeof(int));
+		const int* left = pairs.leftRows();
+		const int* right = pairs.rightRows();
+		int i;
+		for(i=0; i<n; i++)
+			starts[left[i] + 1]++;
+		for(i=0; i<leftCount; i++)
+			starts[i + 1] += starts[i];
+		_join_pairs_ ordered;
+		ordered.reserve(n);
+		_array_<int> rows;
+		rows.resize(n);
+		for(i=0; i<n; i++)
+			rows[starts[left[i]]++] = i;
+		for(i=0; i<n; i++)
+			ordered.append(left[rows[i]], right[rows[i]]);
+		pairs = ordered;
+	}
+
+	// a column's values as an array: the table's own, or decoded
+	// into copy if the column is encoded
+	static const key_type* _columnKeys(const _table_<key_type>& tbl, int col,
+									   _array_<key_type>& copy)
+	{
+		const key_type* data = tbl.getColumnData(col);
+		if(data || tbl.getRowCount() == 0)
+			return data;
+		copy.resize(tbl.getRowCount());
+		for(int row=0; row<tbl.getRowCount(); row++)
+			copy[row] = tbl.getValueAt(row, col);
+		return &copy[0];
+	}
+
+	// the values of the rows of a column, and empty values for -1
+	static void _gather(const _table_<key_type>& tbl, int col, const int* rows, int count,
+						key_type* values)
+	{
+		const key_type* data = tbl.getColumnData(col);
+		for(int i=0; i<count; i++)
+		{
+			int row = rows[i];
+			if(row < 0)
+				values[i] = key_type();
+			else
+				values[i] = data ? data[row] : tbl.getValueAt(row, col);
+		}
+	}
+};
+
+
+};	// namespace soige
+
+#endif // __join_already_included_vasya__
@@ -0,0 +1,836 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _num_conv_.cpp - implementation of the number conversions.
+//
+// Grisu3 follows the paper, and the rounding of its
+// double-conversion version; the cached powers are 10^-348 to
+// 10^340 in steps of 8, each the 64 bits nearest to it. What
+// Grisu3 can't be sure of gets the exact digits of Steele and
+// White's free-format algorithm, in big integers.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "_num_conv_.h"
+
+namespace soige {
+
+//------------------------------------------------
+// Integers
+//------------------------------------------------
+static const char _digitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const DWORD _pow10[] =
+	{ 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+// the digits of v, after a '-' if it's negative
+static int _formatUnsigned(unsigned __int64 v, bool negative, LPSTR buf)
+{
+	// back from the end of tmp, two at a time
+	char tmp[24];
+	LPSTR p = tmp + sizeof(tmp);
+	// 64-bit divisions only while the value needs them
+	while( v > 0xFFFFFFFF )
+	{
+		int r = (int)(v % 100);
+		v /= 100;
+		p -= 2;
+		p[0] = _digitPairs[2 * r];
+		p[1] = _digitPairs[2 * r + 1];
+	}
+	DWORD d = (DWORD)v;
+	while( d >= 100 )
+	{
+		DWORD r = d % 100;
+		d /= 100;
+		p -= 2;
+		p[0] = _digitPairs[2 * r];
+		p[1] = _digitPairs[2 * r + 1];
+	}
+	if( d >= 10 )
+	{
+		p -= 2;
+		p[0] = _digitPairs[2 * d];
+		p[1] = _digitPairs[2 * d + 1];
+	}
+	else
+		*--p = (char)('0' + d);
+
+	int len = (int)(tmp + sizeof(tmp) - p);
+	if( negative ) *buf++ = '-';
+	memcpy( buf, p, len );
+	buf[len] = '\0';
+	return len + (negative ? 1 : 0);
+}
+
+int _formatLong(long val, LPSTR buf)
+{
+	// -val doesn't fit a long if val is the smallest one
+	unsigned long v = (val < 0) ? 0 - (unsigned long)val : (unsigned long)val;
+	return _formatUnsigned( v, val < 0, buf );
+}
+
+int _formatInt64(__int64 val, LPSTR buf)
+{
+	unsigned __int64 v = (val < 0) ? 0 - (unsigned __int64)val : (unsigned __int64)val;
+	return _formatUnsigned( v, val < 0, buf );
+}
+
+int _formatUInt64(unsigned __int64 val, LPSTR buf)
+{
+	return _formatUnsigned( val, false, buf );
+}
+
+// moves past the blanks and the sign before a number
+static const char* _skipSign(const char* p, const char* end, bool* negative)
+{
+	while( p < end && isspace((unsigned char)*p) ) p++;
+	*negative = false;
+	if( p < end && (*p == '-' || *p == '+') )
+		*negative = ( *p++ == '-' );
+	return p;
+}
+
+int _parseInt64(const char* p, int len, __int64* pVal)
+{
+	const char* end = p + len;
+	bool negative;
+	const char* s = _skipSign( p, end, &negative );
+	const char* digits = s;
+	unsigned __int64 limit = ((unsigned __int64)1 << 63) - (negative ? 0 : 1);
+	unsigned __int64 v = 0;
+	bool over = false;
+	for( ; s < end && *s >= '0' && *s <= '9'; s++ )
+	{
+		int d = *s - '0';
+		// 18 digits always fit
+		if( s - digits < 18 )
+			v = v * 10 + d;
+		else if( over || v > (limit - d) / 10 )
+			over = true;
+		else
+			v = v * 10 + d;
+	}
+	if( s == digits )
+	{
+		*pVal = 0;
+		return 0;
+	}
+	if( over ) v = limit;
+	*pVal = negative ? (__int64)(0 - v) : (__int64)v;
+	return (int)(s - p);
+}
+
+int _parseLong(const char* p, int len, long* pVal)
+{
+	__int64 v;
+	int n = _parseInt64( p, len, &v );
+	*pVal = (v > LONG_MAX) ? LONG_MAX : (v < LONG_MIN) ? LONG_MIN : (long)v;
+	return n;
+}
+
+//------------------------------------------------
+// Doubles, in "do it yourself floating point": f * 2^e,
+// with a 64-bit f
+//------------------------------------------------
+struct _diy_fp
+{
+	unsigned __int64	f;
+	int					e;
+};
+
+struct _cached_power
+{
+	DWORD	hi, lo;
+	short	e;
+};
+
+static const _cached_power _cachedPowers[] =
+{
+	{ 0xFA8FD5A0, 0x081C0288, -1220 }, { 0xBAAEE17F, 0xA23EBF76, -1193 }, { 0x8B16FB20, 0x3055AC76, -1166 },
+	{ 0xCF42894A, 0x5DCE35EA, -1140 }, { 0x9A6BB0AA, 0x55653B2D, -1113 }, { 0xE61ACF03, 0x3D1A45DF, -1087 },
+	{ 0xAB70FE17, 0xC79AC6CA, -1060 }, { 0xFF77B1FC, 0xBEBCDC4F, -1034 }, { 0xBE5691EF, 0x416BD60C, -1007 },
+	{ 0x8DD01FAD, 0x907FFC3C, -980 }, { 0xD3515C28, 0x31559A83, -954 }, { 0x9D71AC8F, 0xADA6C9B5, -927 },
+	{ 0xEA9C2277, 0x23EE8BCB, -901 }, { 0xAECC4991, 0x4078536D, -874 }, { 0x823C1279, 0x5DB6CE57, -847 },
+	{ 0xC2109436, 0x4DFB5637, -821 }, { 0x9096EA6F, 0x3848984F, -794 }, { 0xD77485CB, 0x25823AC7, -768 },
+	{ 0xA086CFCD, 0x97BF97F4, -741 }, { 0xEF340A98, 0x172AACE5, -715 }, { 0xB23867FB, 0x2A35B28E, -688 },
+	{ 0x84C8D4DF, 0xD2C63F3B, -661 }, { 0xC5DD4427, 0x1AD3CDBA, -635 }, { 0x936B9FCE, 0xBB25C996, -608 },
+	{ 0xDBAC6C24, 0x7D62A584, -582 }, { 0xA3AB6658, 0x0D5FDAF6, -555 }, { 0xF3E2F893, 0xDEC3F126, -529 },
+	{ 0xB5B5ADA8, 0xAAFF80B8, -502 }, { 0x87625F05, 0x6C7C4A8B, -475 }, { 0xC9BCFF60, 0x34C13053, -449 },
+	{ 0x964E858C, 0x91BA2655, -422 }, { 0xDFF97724, 0x70297EBD, -396 }, { 0xA6DFBD9F, 0xB8E5B88F, -369 },
+	{ 0xF8A95FCF, 0x88747D94, -343 }, { 0xB9447093, 0x8FA89BCF, -316 }, { 0x8A08F0F8, 0xBF0F156B, -289 },
+	{ 0xCDB02555, 0x653131B6, -263 }, { 0x993FE2C6, 0xD07B7FAC, -236 }, { 0xE45C10C4, 0x2A2B3B06, -210 },
+	{ 0xAA242499, 0x697392D3, -183 }, { 0xFD87B5F2, 0x8300CA0E, -157 }, { 0xBCE50864, 0x92111AEB, -130 },
+	{ 0x8CBCCC09, 0x6F5088CC, -103 }, { 0xD1B71758, 0xE219652C, -77 }, { 0x9C400000, 0x00000000, -50 },
+	{ 0xE8D4A510, 0x00000000, -24 }, { 0xAD78EBC5, 0xAC620000, 3 }, { 0x813F3978, 0xF8940984, 30 },
+	{ 0xC097CE7B, 0xC90715B3, 56 }, { 0x8F7E32CE, 0x7BEA5C70, 83 }, { 0xD5D238A4, 0xABE98068, 109 },
+	{ 0x9F4F2726, 0x179A2245, 136 }, { 0xED63A231, 0xD4C4FB27, 162 }, { 0xB0DE6538, 0x8CC8ADA8, 189 },
+	{ 0x83C7088E, 0x1AAB65DB, 216 }, { 0xC45D1DF9, 0x42711D9A, 242 }, { 0x924D692C, 0xA61BE758, 269 },
+	{ 0xDA01EE64, 0x1A708DEA, 295 }, { 0xA26DA399, 0x9AEF774A, 322 }, { 0xF209787B, 0xB47D6B85, 348 },
+	{ 0xB454E4A1, 0x79DD1877, 375 }, { 0x865B8692, 0x5B9BC5C2, 402 }, { 0xC83553C5, 0xC8965D3D, 428 },
+	{ 0x952AB45C, 0xFA97A0B3, 455 }, { 0xDE469FBD, 0x99A05FE3, 481 }, { 0xA59BC234, 0xDB398C25, 508 },
+	{ 0xF6C69A72, 0xA3989F5C, 534 }, { 0xB7DCBF53, 0x54E9BECE, 561 }, { 0x88FCF317, 0xF22241E2, 588 },
+	{ 0xCC20CE9B, 0xD35C78A5, 614 }, { 0x98165AF3, 0x7B2153DF, 641 }, { 0xE2A0B5DC, 0x971F303A, 667 },
+	{ 0xA8D9D153, 0x5CE3B396, 694 }, { 0xFB9B7CD9, 0xA4A7443C, 720 }, { 0xBB764C4C, 0xA7A44410, 747 },
+	{ 0x8BAB8EEF, 0xB6409C1A, 774 }, { 0xD01FEF10, 0xA657842C, 800 }, { 0x9B10A4E5, 0xE9913129, 827 },
+	{ 0xE7109BFB, 0xA19C0C9D, 853 }, { 0xAC2820D9, 0x623BF429, 880 }, { 0x80444B5E, 0x7AA7CF85, 907 },
+	{ 0xBF21E440, 0x03ACDD2D, 933 }, { 0x8E679C2F, 0x5E44FF8F, 960 }, { 0xD433179D, 0x9C8CB841, 986 },
+	{ 0x9E19DB92, 0xB4E31BA9, 1013 }, { 0xEB96BF6E, 0xBADF77D9, 1039 }, { 0xAF87023B, 0x9BF0EE6B, 1066 }
+};
+
+static const double _exactPow10[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const unsigned __int64 _hiddenBit = (unsigned __int64)1 << 52;
+static const unsigned __int64 _fractionMask = ((unsigned __int64)1 << 52) - 1;
+static const int _exponentBias = 1075;	// 1023, and the 52 bits of the fraction
+
+static inline _diy_fp _diy(unsigned __int64 f, int e)
+{
+	_diy_fp x;
+	x.f = f;
+	x.e = e;
+	return x;
+}
+
+static inline unsigned __int64 _bitsOf(double val)
+{
+	unsigned __int64 bits;
+	memcpy( &bits, &val, sizeof(bits) );
+	return bits;
+}
+
+// a * b, rounded to 64 bits
+static inline _diy_fp _multiply(const _diy_fp& a, const _diy_fp& b)
+{
+	const unsigned __int64 M32 = 0xFFFFFFFF;
+	unsigned __int64 ah = a.f >> 32, al = a.f & M32;
+	unsigned __int64 bh = b.f >> 32, bl = b.f & M32;
+	unsigned __int64 hh = ah * bh, hl = ah * bl, lh = al * bh, ll = al * bl;
+	unsigned __int64 mid = (ll >> 32) + (hl & M32) + (lh & M32) + ((unsigned __int64)1 << 31);
+	return _diy( hh + (hl >> 32) + (lh >> 32) + (mid >> 32), a.e + b.e + 64 );
+}
+
+// shifted up until the top bit is set; x.f isn't 0
+static inline _diy_fp _normalize(_diy_fp x)
+{
+	if( !(x.f >> 32) ) { x.f <<= 32; x.e -= 32; }
+	if( !(x.f >> 48) ) { x.f <<= 16; x.e -= 16; }
+	if( !(x.f >> 56) ) { x.f <<= 8;  x.e -= 8; }
+	if( !(x.f >> 60) ) { x.f <<= 4;  x.e -= 4; }
+	if( !(x.f >> 62) ) { x.f <<= 2;  x.e -= 2; }
+	if( !(x.f >> 63) ) { x.f <<= 1;  x.e -= 1; }
+	return x;
+}
+
+static inline _diy_fp _cachedPower(int i)
+{
+	return _diy( ((unsigned __int64)_cachedPowers[i].hi << 32) | _cachedPowers[i].lo, _cachedPowers[i].e );
+}
+
+//------------------------------------------------
+// Writing doubles
+//------------------------------------------------
+
+// A double or a float as f * 2^e
+struct _fp_value
+{
+	unsigned __int64	f;
+	int					e;
+	bool				closer;	// the value below is half as far, at a power of 2
+};
+
+static _fp_value _fpOfDouble(double val)
+{
+	unsigned __int64 bits = _bitsOf( val );
+	int biased = (int)((bits >> 52) & 0x7FF);
+	unsigned __int64 fraction = bits & _fractionMask;
+	_fp_value v;
+	v.f = biased ? fraction + _hiddenBit : fraction;
+	v.e = biased ? biased - _exponentBias : 1 - _exponentBias;
+	// not so at the smallest normal one: below it are the denormals
+	v.closer = ( fraction == 0 && biased > 1 );
+	return v;
+}
+
+static _fp_value _fpOfFloat(DWORD bits)
+{
+	int biased = (int)((bits >> 23) & 0xFF);
+	DWORD fraction = bits & 0x7FFFFF;
+	_fp_value v;
+	v.f = biased ? fraction + 0x800000 : fraction;
+	v.e = biased ? biased - 150 : 1 - 150;	// 127, and the 23 bits of the fraction
+	v.closer = ( fraction == 0 && biased > 1 );
+	return v;
+}
+
+// The cached power c that brings a number with exponent e to
+// one with an exponent of -60 to -32 (by c * it), and the
+// power of 10 that c undoes, in K.
+static _diy_fp _cachedPowerFor(int e, int* K)
+{
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int k = (int)dk;
+	if( dk - k > 0.0 ) k++;
+	int index = (k >> 3) + 1;
+	*K = 348 - index * 8;
+	return _cachedPower( index );
+}
+
+// Takes the last digit down, a unit of ten_kappa at a time,
+// while the digits get closer to w and stay inside the unsafe
+// interval; rest is how far they are under its top, and w is
+// too_high_w under it, give or take a unit. True if the digits
+// are sure to be the closest, and sure to read back as w: the
+// units of error of the products can't change either.
+static bool _roundWeed(LPSTR buf, int len, unsigned __int64 too_high_w, unsigned __int64 unsafe,
+					   unsigned __int64 rest, unsigned __int64 ten_kappa, unsigned __int64 unit)
+{
+	unsigned __int64 small_w = too_high_w - unit;
+	unsigned __int64 big_w = too_high_w + unit;
+	while( rest < small_w && unsafe - rest >= ten_kappa &&
+		   (rest + ten_kappa < small_w || small_w - rest >= rest + ten_kappa - small_w) )
+	{
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+	// if w could be a unit higher, the next digit down could be closer
+	if( rest < big_w && unsafe - rest >= ten_kappa &&
+		(rest + ten_kappa < big_w || big_w - rest > rest + ten_kappa - big_w) )
+		return false;
+	// and the digits have to be inside the interval even if it's
+	// smaller by the error of its bounds
+	return ( 2 * unit <= rest && rest <= unsafe - 4 * unit );
+}
+
+// The digits of the top of the unsafe interval (the products
+// low to high widened by their unit of error), until the rest
+// is inside it; then _roundWeed() brings them closer to w.
+// False if they can't be sure to be the shortest.
+static bool _digitGen(const _diy_fp& low, const _diy_fp& w, const _diy_fp& high,
+					  LPSTR buf, int* len, int* K)
+{
+	unsigned __int64 unit = 1;
+	unsigned __int64 too_high = high.f + unit;
+	unsigned __int64 unsafe = too_high - (low.f - unit);
+	_diy_fp one = _diy( (unsigned __int64)1 << -w.e, w.e );
+	DWORD integrals = (DWORD)(too_high >> -one.e);
+	unsigned __int64 fractionals = too_high & (one.f - 1);
+	int kappa = 1;
+	while( kappa < 10 && integrals >= _pow10[kappa] )
+		kappa++;
+
+	*len = 0;
+	// the digits of the integer part
+	while( kappa > 0 )
+	{
+		DWORD divisor = _pow10[kappa - 1];
+		buf[(*len)++] = (char)('0' + integrals / divisor);
+		integrals %= divisor;
+		kappa--;
+		unsigned __int64 rest = ((unsigned __int64)integrals << -one.e) + fractionals;
+		if( rest < unsafe )
+		{
+			*K += kappa;
+			return _roundWeed( buf, *len, too_high - w.f, unsafe, rest,
+							   (unsigned __int64)divisor << -one.e, unit );
+		}
+	}
+	// and of the fraction, the error growing with it
+	for( ;; )
+	{
+		fractionals *= 10;
+		unit *= 10;
+		unsafe *= 10;
+		buf[(*len)++] = (char)('0' + (int)(fractionals >> -one.e));
+		fractionals &= one.f - 1;
+		kappa--;
+		if( fractionals < unsafe )
+		{
+			*K += kappa;
+			return _roundWeed( buf, *len, (too_high - w.f) * unit, unsafe, fractionals, one.f, unit );
+		}
+	}
+}
+
+// The shortest digits that read back as v, which isn't 0, with
+// Grisu3; v is the digits times 10^K. False, for about one
+// double in 200, if it can't be sure they are.
+static bool _grisu3(const _fp_value& v, LPSTR buf, int* len, int* K)
+{
+	// v and halfway to the values above and below it, with the
+	// exponent of the upper one
+	_diy_fp w = _normalize( _diy(v.f, v.e) );
+	_diy_fp plus = _normalize( _diy( (v.f << 1) + 1, v.e - 1 ) );
+	_diy_fp minus = v.closer ? _diy( (v.f << 2) - 1, v.e - 2 ) : _diy( (v.f << 1) - 1, v.e - 1 );
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	_diy_fp c = _cachedPowerFor( plus.e, K );
+	return _digitGen( _multiply(minus, c), _multiply(w, c), _multiply(plus, c), buf, len, K );
+}
+
+//------------------------------------------------
+// The exact digits, for what Grisu3 can't be sure of: Steele
+// and White's free-format digits (as Burger and Dybvig have
+// them), in big integers
+//------------------------------------------------
+
+// an unsigned integer in 32-bit words, the lowest first; the
+// scaled doubles take up to about 1140 bits
+struct _bignum
+{
+	DWORD	w[40];
+	int		n;		// the words in use, the top one not 0
+};
+
+static void _bigSet(_bignum& a, unsigned __int64 v)
+{
+	a.w[0] = (DWORD)v;
+	a.w[1] = (DWORD)(v >> 32);
+	a.n = a.w[1] ? 2 : a.w[0] ? 1 : 0;
+}
+
+static void _bigMultiply(_bignum& a, DWORD m)
+{
+	unsigned __int64 carry = 0;
+	for( int i = 0; i < a.n; i++ )
+	{
+		carry += (unsigned __int64)a.w[i] * m;
+		a.w[i] = (DWORD)carry;
+		carry >>= 32;
+	}
+	if( carry ) a.w[a.n++] = (DWORD)carry;
+}
+
+static void _bigMultiplyPow10(_bignum& a, int k)
+{
+	for( ; k >= 9; k -= 9 )
+		_bigMultiply( a, _pow10[9] );
+	if( k ) _bigMultiply( a, _pow10[k] );
+}
+
+static void _bigShiftLeft(_bignum& a, int bits)
+{
+	if( a.n == 0 ) return;
+	int words = bits >> 5, b = bits & 31;
+	int i;
+	a.w[a.n] = 0;
+	for( i = a.n; i > 0; i-- )
+		a.w[i + words] = b ? (a.w[i] << b) | (a.w[i - 1] >> (32 - b)) : a.w[i];
+	a.w[words] = a.w[0] << b;
+	for( i = 0; i < words; i++ )
+		a.w[i] = 0;
+	a.n += words + 1;
+	while( a.n > 0 && a.w[a.n - 1] == 0 ) a.n--;
+}
+
+static void _bigAdd(_bignum& a, const _bignum& b)
+{
+	unsigned __int64 carry = 0;
+	int n = (a.n > b.n) ? a.n : b.n;
+	for( int i = 0; i < n; i++ )
+	{
+		carry += (unsigned __int64)(i < a.n ? a.w[i] : 0) + (i < b.n ? b.w[i] : 0);
+		a.w[i] = (DWORD)carry;
+		carry >>= 32;
+	}
+	a.n = n;
+	if( carry ) a.w[a.n++] = (DWORD)carry;
+}
+
+// a - b, which isn't negative
+static void _bigSubtract(_bignum& a, const _bignum& b)
+{
+	DWORD borrow = 0;
+	for( int i = 0; i < a.n; i++ )
+	{
+		unsigned __int64 d = (unsigned __int64)a.w[i] - (i < b.n ? b.w[i] : 0) - borrow;
+		a.w[i] = (DWORD)d;
+		borrow = (DWORD)(d >> 63);
+	}
+	while( a.n > 0 && a.w[a.n - 1] == 0 ) a.n--;
+}
+
+static int _bigCompare(const _bignum& a, const _bignum& b)
+{
+	if( a.n != b.n ) return (a.n < b.n) ? -1 : 1;
+	for( int i = a.n - 1; i >= 0; i-- )
+		if( a.w[i] != b.w[i] ) return (a.w[i] < b.w[i]) ? -1 : 1;
+	return 0;
+}
+
+// a + b compared to c
+static int _bigComparePlus(const _bignum& a, const _bignum& b, const _bignum& c)
+{
+	_bignum sum = a;
+	_bigAdd( sum, b );
+	return _bigCompare( sum, c );
+}
+
+// The shortest digits that read back as v, and of those the
+// closest; v is the digits times 10^K. v is r / s, and the
+// halfway points to the values above and below it are mp / s
+// above and mm / s below it. When f is even, the halfway points
+// read back as v too, rounding to even.
+static void _exactDigits(const _fp_value& v, LPSTR buf, int* len, int* K)
+{
+	bool even = !(v.f & 1);
+	_bignum r, s, mp, mm;
+	_bigSet( r, v.f );
+	_bigShiftLeft( r, v.closer ? 2 : 1 );
+	_bigSet( s, v.closer ? 4 : 2 );
+	_bigSet( mm, 1 );
+	if( v.e >= 0 )
+	{
+		_bigShiftLeft( r, v.e );
+		_bigShiftLeft( mm, v.e );
+	}
+	else
+		_bigShiftLeft( s, -v.e );
+	mp = mm;
+	if( v.closer ) _bigShiftLeft( mp, 1 );
+
+	// 10^k above the top of the interval: k from the bits of v,
+	// rather one too few (put right below) than too many
+	int bits = 0;
+	for( unsigned __int64 f = v.f; f; f >>= 1 )
+		bits++;
+	double dk = (v.e + bits - 1) * 0.30102999566398114 - 1e-10;
+	int k = (int)dk;
+	if( dk - k > 0.0 ) k++;
+	if( k >= 0 )
+		_bigMultiplyPow10( s, k );
+	else
+	{
+		_bigMultiplyPow10( r, -k );
+		_bigMultiplyPow10( mp, -k );
+		_bigMultiplyPow10( mm, -k );
+	}
+	for( ;; )
+	{
+		int c = _bigComparePlus( r, mp, s );
+		if( even ? c < 0 : c <= 0 ) break;
+		_bigMultiply( s, 10 );
+		k++;
+	}
+
+	*len = 0;
+	for( ;; )
+	{
+		_bigMultiply( r, 10 );
+		_bigMultiply( mp, 10 );
+		_bigMultiply( mm, 10 );
+		int d = 0;
+		while( _bigCompare(r, s) >= 0 )
+		{
+			_bigSubtract( r, s );
+			d++;
+		}
+		// whether the digits so far, or the next ones up, are inside
+		int c = _bigCompare( r, mm );
+		bool low = even ? c <= 0 : c < 0;
+		c = _bigComparePlus( r, mp, s );
+		bool high = even ? c >= 0 : c > 0;
+		if( !low && !high )
+		{
+			buf[(*len)++] = (char)('0' + d);
+			continue;
+		}
+		if( low && high )
+		{
+			// the closer one, and the even one halfway
+			c = _bigComparePlus( r, r, s );
+			if( c > 0 || (c == 0 && (d & 1)) ) d++;
+		}
+		else if( high )
+			d++;
+		buf[(*len)++] = (char)('0' + d);
+		break;
+	}
+	*K = k - *len;
+}
+
+// the n digits, times 10^K, laid out as JavaScript does
+static int _layout(const char* digits, int n, int K, LPSTR buf)
+{
+	LPSTR p = buf;
+	int point = n + K;	// where the decimal point goes
+	if( n <= point && point <= 21 )
+	{
+		// 1500
+		memcpy( p, digits, n );
+		p += n;
+		memset( p, '0', point - n );
+		p += point - n;
+	}
+	else if( 0 < point && point <= 21 )
+	{
+		// 1.5
+		memcpy( p, digits, point );
+		p += point;
+		*p++ = '.';
+		memcpy( p, digits + point, n - point );
+		p += n - point;
+	}
+	else if( -6 < point && point <= 0 )
+	{
+		// 0.0015
+		*p++ = '0';
+		*p++ = '.';
+		memset( p, '0', -point );
+		p += -point;
+		memcpy( p, digits, n );
+		p += n;
+	}
+	else
+	{
+		// 1.5e-7
+		*p++ = digits[0];
+		if( n > 1 )
+		{
+			*p++ = '.';
+			memcpy( p, digits + 1, n - 1 );
+			p += n - 1;
+		}
+		*p++ = 'e';
+		*p++ = (point - 1 < 0) ? '-' : '+';
+		return (int)(p - buf) + _formatLong( (point - 1 < 0) ? 1 - point : point - 1, p );
+	}
+	*p = '\0';
+	return (int)(p - buf);
+}
+
+// the shortest digits of v, which isn't 0, laid out
+static int _formatShortest(const _fp_value& v, LPSTR buf)
+{
+	char digits[24];
+	int n, K;
+	if( !_grisu3( v, digits, &n, &K ) )
+		_exactDigits( v, digits, &n, &K );
+	return _layout( digits, n, K, buf );
+}
+
+int _formatDouble(double val, LPSTR buf)
+{
+	unsigned __int64 bits = _bitsOf( val );
+	if( ((bits >> 52) & 0x7FF) == 0x7FF )
+	{
+		LPCSTR text = (bits & _fractionMask) ? "NaN" : (bits >> 63) ? "-Infinity" : "Infinity";
+		lstrcpyA( buf, text );
+		return lstrlenA( text );
+	}
+	LPSTR p = buf;
+	if( bits >> 63 ) *p++ = '-';
+	if( !(bits << 1) )
+	{
+		*p++ = '0';
+		*p = '\0';
+		return (int)(p - buf);
+	}
+	return (int)(p - buf) + _formatShortest( _fpOfDouble(val), p );
+}
+
+int _formatFloat(float val, LPSTR buf)
+{
+	DWORD bits;
+	memcpy( &bits, &val, sizeof(bits) );
+	// NaN and the infinities are the same text
+	if( ((bits >> 23) & 0xFF) == 0xFF )
+		return _formatDouble( val, buf );
+	LPSTR p = buf;
+	if( bits >> 31 ) *p++ = '-';
+	if( !(bits << 1) )
+	{
+		*p++ = '0';
+		*p = '\0';
+		return (int)(p - buf);
+	}
+	return (int)(p - buf) + _formatShortest( _fpOfFloat(bits), p );
+}
+
+//------------------------------------------------
+// Reading doubles
+//------------------------------------------------
+
+// w * 10^q into *pVal, if it can be told for sure; w < 10^19
+static bool _toDouble(unsigned __int64 w, int q, double* pVal)
+{
+	if( w == 0 || q < -348 )
+	{
+		// under 10^-329, half the smallest double
+		*pVal = 0.0;
+		return true;
+	}
+	if( q > 347 )
+	{
+		unsigned __int64 inf = (unsigned __int64)0x7FF << 52;
+		memcpy( pVal, &inf, sizeof(inf) );
+		return true;
+	}
+	// both exact, and so is the division or product (Clinger)
+	if( w <= ((unsigned __int64)1 << 53) && q >= -22 && q <= 22 )
+	{
+		double d = (double)(__int64)w;
+		*pVal = (q < 0) ? d / _exactPow10[-q] : d * _exactPow10[q];
+		return true;
+	}
+
+	// w * 10^k * 10^adj to 64 bits, within 9 units of the last
+	// bit: each of the three roundings is off by at most a unit
+	// of the 63 or 64 bits it keeps
+	int i = (q + 348) >> 3;
+	int adj = q + 348 - (i << 3);
+	_diy_fp c = _cachedPower( i );
+	if( adj ) c = _normalize( _multiply( c, _normalize( _diy(_pow10[adj], 0) ) ) );
+	_diy_fp r = _normalize( _multiply( _normalize( _diy(w, 0) ), c ) );
+
+	// a double keeps 53 bits, and the other 11 round them;
+	// too close to halfway, the error can go either way
+	int low = (int)(r.f & 0x7FF);
+	if( low > 1024 - 16 && low < 1024 + 16 )
+		return false;
+	unsigned __int64 m = (r.f >> 11) + (low > 1024 ? 1 : 0);
+	int e = r.e + 11;
+	if( m == ((unsigned __int64)1 << 53) )
+	{
+		m >>= 1;
+		e++;
+	}
+	// denormals and infinity are left to strtod()
+	int biased = e + _exponentBias;
+	if( biased <= 0 || biased >= 0x7FF )
+		return false;
+	unsigned __int64 bits = ((unsigned __int64)biased << 52) | (m & _fractionMask);
+	memcpy( pVal, &bits, sizeof(bits) );
+	return true;
+}
+
+// strtod() of the len chars at p
+static double _strtod(const char* p, int len)
+{
+	char buf[64];
+	LPSTR s = (len < (int)sizeof(buf)) ? buf : (LPSTR) malloc( len + 1 );
+	if( !s ) return 0.0;
+	memcpy( s, p, len );
+	s[len] = '\0';
+	double val = strtod( s, NULL );
+	if( s != buf ) free( s );
+	return val;
+}
+
+// whether the chars at p are word, in any case
+static bool _isWord(const char* p, const char* end, LPCSTR word)
+{
+	for( ; *word; word++, p++ )
+		if( p >= end || tolower((unsigned char)*p) != *word )
+			return false;
+	return true;
+}
+
+int _parseDouble(const char* p, int len, double* pVal)
+{
+	const char* end = p + len;
+	bool negative;
+	const char* s = _skipSign( p, end, &negative );
+	const char* number = s;
+
+	// up to 19 digits in w, without the zeros before them; the
+	// value is w * 10^q
+	unsigned __int64 w = 0;
+	int digits = 0, q = 0;
+	bool any = false, truncated = false;
+	for( ; s < end && *s >= '0' && *s <= '9'; s++ )
+	{
+		any = true;
+		if( digits < 19 )
+		{
+			if( w || *s != '0' )
+			{
+				w = w * 10 + (*s - '0');
+				digits++;
+			}
+		}
+		else
+		{
+			q++;
+			if( *s != '0' ) truncated = true;
+		}
+	}
+	if( s < end && *s == '.' )
+	{
+		const char* point = s++;
+		for( ; s < end && *s >= '0' && *s <= '9'; s++ )
+		{
+			any = true;
+			if( digits < 19 )
+			{
+				if( w || *s != '0' )
+				{
+					w = w * 10 + (*s - '0');
+					digits++;
+				}
+				q--;
+			}
+			else if( *s != '0' )
+				truncated = true;
+		}
+		// a lone point isn't a number
+		if( !any ) s = point;
+	}
+	if( !any )
+	{
+		double special = 0.0;
+		int n = 0;
+		if( _isWord(s, end, "infinity") )	n = 8;
+		else if( _isWord(s, end, "inf") )	n = 3;
+		else if( _isWord(s, end, "nan") )	n = 3;
+		if( n )
+		{
+			unsigned __int64 bits = (unsigned __int64)((n == 3 && tolower((unsigned char)*s) == 'n') ? 0x7FF8 : 0x7FF0) << 48;
+			memcpy( &special, &bits, sizeof(bits) );
+			*pVal = negative ? -special : special;
+			return (int)(s + n - p);
+		}
+		*pVal = 0.0;
+		return 0;
+	}
+	if( s < end && (*s == 'e' || *s == 'E') )
+	{
+		const char* e = s + 1;
+		bool eneg = false;
+		if( e < end && (*e == '-' || *e == '+') )
+			eneg = ( *e++ == '-' );
+		if( e < end && *e >= '0' && *e <= '9' )
+		{
+			int x = 0;
+			for( ; e < end && *e >= '0' && *e <= '9'; e++ )
+				if( x < 100000 ) x = x * 10 + (*e - '0');
+			q += eneg ? -x : x;
+			s = e;
+		}
+	}
+
+	double val;
+	if( truncated || !_toDouble(w, q, &val) )
+		val = _strtod( number, (int)(s - number) );
+	*pVal = negative ? -val : val;
+	return (int)(s - p);
+}
+
+
+};	// namespace soige
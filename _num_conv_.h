@@ -0,0 +1,73 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _num_conv_.h - numbers to text and back, without the CRT.
+//
+// _formatLong(), _formatInt64() and _formatUInt64() write the
+// digits two at a time, from a table of the pairs 00 to 99,
+// rather than with a division for every digit.
+//
+// _formatDouble() writes the fewest digits that read back as
+// the same double, and of those the closest, with Grisu3
+// (Loitsch, "Printing floating-point numbers quickly and
+// accurately with integers"): all its arithmetic is in 64-bit
+// integers, with a table of cached powers of 10. Grisu3 knows
+// when its error could have cost it the shortest digits; for
+// those doubles (about one in 200) the digits are worked out
+// exactly, in big integers, which takes some ten times longer.
+// _formatFloat() does the same for a float: the fewest digits
+// that read back as the same float. The layout is JavaScript's:
+// 100, 1.5, 0.001, 1e+21, 1.5e-7, and NaN, Infinity and
+// -Infinity.
+//
+// _parseLong(), _parseInt64() and _parseDouble() read a number
+// the way atol() and strtod() do: after any blanks, as much of
+// a number as there is. A double of up to 2^53 times a power
+// of 10 up to 22 is exact in doubles (Clinger); others are
+// multiplied out from the same cached powers, and only if the
+// product is too close to halfway between two doubles to tell
+// which one it is does strtod() get to say.
+//
+// They all work in the caller's buffer, and none allocates.
+//
+// Usage:
+//     char buf[NUM_CONV_CHARS];
+//     int len = _formatDouble( 0.1 + 0.2, buf );   // 0.30000000000000004
+//     double val;
+//     if( _parseDouble( buf, len, &val ) == len ) ...
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __num_conv_already_included_vasya__
+#define __num_conv_already_included_vasya__
+
+#include "_common_.h"
+
+// room for any number the _format functions write, with the 0
+#define NUM_CONV_CHARS  32
+
+namespace soige {
+
+//------------------------------------------------------------
+// Writing numbers: the chars go into buf, followed by a 0;
+// returns the number of chars (without the 0)
+//------------------------------------------------------------
+int _formatLong		( long val, LPSTR buf );
+int _formatInt64	( __int64 val, LPSTR buf );
+int _formatUInt64	( unsigned __int64 val, LPSTR buf );
+int _formatDouble	( double val, LPSTR buf );
+int _formatFloat		( float val, LPSTR buf );
+
+//------------------------------------------------------------
+// Reading numbers: reads the number at the start of the len
+// chars at p (which don't have to end with a 0) into *pVal;
+// returns the number of chars read, with the blanks before
+// it, or 0 (and *pVal is 0) if there's no number there.
+// Integers too large for the type give its largest value.
+//------------------------------------------------------------
+int _parseLong		( const char* p, int len, long* pVal );
+int _parseInt64		( const char* p, int len, __int64* pVal );
+int _parseDouble	( const char* p, int len, double* pVal );
+
+
+};	// namespace soige
+
+#endif  // __num_conv_already_included_vasya__
@@ -141,6 +141,18 @@ public:
 		return _p;
 	}
 
+	// the number of smart pointers to the object, 0 if none
+	long getRefCount() const
+	{
+		return (_pRefCount != NULL) ? *_pRefCount : 0;
+	}
+	// whether other smart pointers point to the object too, so
+	// that changing it through this one changes it for them
+	bool isShared() const
+	{
+		return (getRefCount() > 1);
+	}
+
 	obj_type& operator*()
 	{
 		return (*_p);
@@ -170,10 +182,11 @@ protected:
 	void _release()
 	{
 		if(_pRefCount == NULL)  { _p = NULL; return; }
-		InterlockedDecrement(_pRefCount);
 		// see if the object is no longer referenced
 		// by any other ptrs and destroy it if this is so
-		if(*_pRefCount <= 0)
+		// (on the count this decrement left, as other
+		// threads may be releasing their ptrs too)
+		if(InterlockedDecrement(_pRefCount) <= 0)
 		{
 			delete _pRefCount;
 			delete _p;
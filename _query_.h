@@ -0,0 +1,894 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _query_.h - header file for _column_query_<> and the
+// column filter and aggregate functions.
+//
+// Works on whole columns - plain arrays of values, as kept
+// by _table_<> (getColumnData()) and _column_table_. A
+// filter turns a condition on the values into a selection
+// vector: the indexes of the rows that pass, in row order.
+// Aggregates (count, sum, min, max, average) and group-by
+// run over all the rows or over a selection. The int, float
+// and double kernels use SSE2 when the CPU has it, and
+// _column_query_<> can split a column across the threads of
+// a _thread_pool_. Group-by can sort the rows on their keys
+// or hash the keys (see _hash_.h).
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __query_already_included_vasya__
+#define __query_already_included_vasya__
+
+#include "_common_.h"
+#include "_array_.h"
+#include "_sort_.h"
+#include "_hash_.h"
+#include "_thread_pool_.h"
+
+// whether the filters and aggregates have SSE2 kernels;
+// they use _cpuHasSSE2() from _sort_.h
+#ifndef QUERY_SSE2
+	#define QUERY_SSE2  SORT_NETWORK_SSE2
+#endif
+
+// columns shorter than this are never split across threads
+#ifndef QUERY_PARALLEL_MIN
+	#define QUERY_PARALLEL_MIN  65536
+#endif
+
+namespace soige {
+
+// the comparisons a filter can make: value op constant
+enum query_op
+{
+	op_equal,
+	op_not_equal,
+	op_less,
+	op_less_equal,
+	op_greater,
+	op_greater_equal
+};
+
+//------------------------------------------------------------
+// Selection vector: row indexes, in increasing order
+//------------------------------------------------------------
+class _selection_
+{
+public:
+	_selection_()
+	{
+		_rows = NULL;
+		_length = _capacity = 0;
+	}
+	_selection_(const _selection_& other)
+	{
+		_rows = NULL;
+		_length = _capacity = 0;
+		append(other._rows, other._length);
+	}
+	virtual ~_selection_()
+	{
+		free(_rows);
+		_rows = NULL;
+	}
+	_selection_& operator=(const _selection_& other)
+	{
+		if(this == &other) return *this;
+		_length = 0;
+		append(other._rows, other._length);
+		return *this;
+	}
+
+	int length() const
+	{
+		return _length;
+	}
+	int operator[](int index) const
+	{
+		return _rows[index];
+	}
+	const int* rows() const
+	{
+		return _rows;
+	}
+	void clear()
+	{
+		_length = 0;
+	}
+	void reserve(int capacity)
+	{
+		if(capacity <= _capacity)
+			return;
+		_rows = (int*) realloc(_rows, capacity*sizeof(int));
+		_capacity = capacity;
+	}
+	void append(int row)
+	{
+		if(_length == _capacity)
+			reserve((int)(_length*ALLOC_SLACK) + 16);
+		_rows[_length++] = row;
+	}
+	void append(const int* rows, int count)
+	{
+		if(count <= 0)
+			return;
+		memcpy(appendSpace(count), rows, count*sizeof(int));
+		_length += count;
+	}
+
+	// For the filter kernels: room for up to maxCount more rows
+	// at the end; write them there and then call appended()
+	int* appendSpace(int maxCount)
+	{
+		if(_length + maxCount > _capacity)
+			reserve((int)((_length + maxCount)*ALLOC_SLACK) + 1);
+		return _rows + _length;
+	}
+	void appended(int count)
+	{
+		_length += count;
+	}
+
+protected:
+	int* _rows;
+	int _length;
+	int _capacity;
+};
+
+
+//------------------------------------------------------------
+// Aggregates: the count, sum, minimum and maximum of values;
+// integers are summed as __int64, everything else as double
+//------------------------------------------------------------
+template<typename value_type> struct _query_sum_		{ typedef double type; };
+template<> struct _query_sum_<short>					{ typedef __int64 type; };
+template<> struct _query_sum_<unsigned short>			{ typedef __int64 type; };
+template<> struct _query_sum_<int>						{ typedef __int64 type; };
+template<> struct _query_sum_<unsigned int>				{ typedef __int64 type; };
+template<> struct _query_sum_<long>						{ typedef __int64 type; };
+template<> struct _query_sum_<unsigned long>			{ typedef __int64 type; };
+template<> struct _query_sum_<__int64>					{ typedef __int64 type; };
+
+template<typename value_type> struct _aggregate_
+{
+	typedef typename _query_sum_<value_type>::type sum_type;
+
+	int			count;
+	sum_type	sum;
+	value_type	min;	// min and max are valid only if count > 0
+	value_type	max;
+
+	_aggregate_()
+	{
+		count = 0;
+		sum = 0;
+		min = max = value_type();
+	}
+	double avg() const
+	{
+		return count ? (double)sum / count : 0.0;
+	}
+	void add(const value_type& val)
+	{
+		if(count == 0)
+			min = max = val;
+		else if(val < min)
+			min = val;
+		else if(max < val)
+			max = val;
+		sum += val;
+		count++;
+	}
+	void merge(const _aggregate_& other)
+	{
+		if(other.count == 0)
+			return;
+		if(count == 0 || other.min < min)
+			min = other.min;
+		if(count == 0 || max < other.max)
+			max = other.max;
+		sum += other.sum;
+		count += other.count;
+	}
+};
+
+
+//------------------------------------------------------------
+// Filter kernels: write the indexes of the rows in [first,
+// last) whose values pass to out, which has room for
+// last-first of them, and return how many passed
+//------------------------------------------------------------
+template<typename value_type, typename test>
+	inline int _filterLoop(const value_type* values, int first, int last,
+						   const value_type& value, test t, int* out)
+{
+	// no branch on the outcome: write the row, count it if it passed
+	int n = 0;
+	for(int row=first; row<last; row++)
+	{
+		out[n] = row;
+		n += t(values[row], value) ? 1 : 0;
+	}
+	return n;
+}
+
+// the comparisons as written, so that NaNs fail all but !=
+template<typename value_type> struct _query_equal_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a == b; } };
+template<typename value_type> struct _query_not_equal_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a != b; } };
+template<typename value_type> struct _query_less_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a < b; } };
+template<typename value_type> struct _query_less_equal_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a <= b; } };
+template<typename value_type> struct _query_greater_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a > b; } };
+template<typename value_type> struct _query_greater_equal_
+	{ bool operator()(const value_type& a, const value_type& b) const { return a >= b; } };
+
+template<typename value_type>
+	int _scalarFilter(const value_type* values, int first, int last,
+					  query_op op, const value_type& value, int* out)
+{
+	switch(op)
+	{
+	case op_equal:
+		return _filterLoop(values, first, last, value, _query_equal_<value_type>(), out);
+	case op_not_equal:
+		return _filterLoop(values, first, last, value, _query_not_equal_<value_type>(), out);
+	case op_less:
+		return _filterLoop(values, first, last, value, _query_less_<value_type>(), out);
+	case op_less_equal:
+		return _filterLoop(values, first, last, value, _query_less_equal_<value_type>(), out);
+	case op_greater:
+		return _filterLoop(values, first, last, value, _query_greater_<value_type>(), out);
+	default:
+		return _filterLoop(values, first, last, value, _query_greater_equal_<value_type>(), out);
+	}
+}
+
+// the generic filter; int, float and double have SSE2 overloads below
+template<typename value_type>
+	int _filterRange(const value_type* values, int first, int last,
+					 query_op op, const value_type& value, int* out)
+{
+	return _scalarFilter(values, first, last, op, value, out);
+}
+
+// the rows of a selection whose values pass, in the same order
+template<typename value_type>
+	int _filterRows(const value_type* values, const int* rows, int count,
+					query_op op, const value_type& value, int* out)
+{
+	int n = 0, i;
+	switch(op)
+	{
+	case op_equal:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] == value) ? 1 : 0; }
+		break;
+	case op_not_equal:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] != value) ? 1 : 0; }
+		break;
+	case op_less:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] < value) ? 1 : 0; }
+		break;
+	case op_less_equal:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] <= value) ? 1 : 0; }
+		break;
+	case op_greater:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] > value) ? 1 : 0; }
+		break;
+	default:
+		for(i=0; i<count; i++) { out[n] = rows[i]; n += (values[rows[i]] >= value) ? 1 : 0; }
+		break;
+	}
+	return n;
+}
+
+
+//------------------------------------------------------------
+// Aggregate kernels
+//------------------------------------------------------------
+template<typename value_type>
+	void _scalarAggregate(const value_type* values, int first, int last,
+						  _aggregate_<value_type>& agg)
+{
+	for(int row=first; row<last; row++)
+		agg.add(values[row]);
+}
+
+template<typename value_type>
+	void _aggregateRange(const value_type* values, int first, int last,
+						 _aggregate_<value_type>& agg)
+{
+	_scalarAggregate(values, first, last, agg);
+}
+
+template<typename value_type>
+	void _aggregateRows(const value_type* values, const int* rows, int count,
+						_aggregate_<value_type>& agg)
+{
+	for(int i=0; i<count; i++)
+		agg.add(values[rows[i]]);
+}
+
+
+#if QUERY_SSE2
+//------------------------------------------------------------
+// SSE2 kernels: 4 ints or floats, or 2 doubles, at a time.
+// The comparisons give all-ones lanes for the values that
+// pass, and movemask turns these into a bit per lane.
+//------------------------------------------------------------
+
+// writes the rows of the lanes set in mask (bit k: row + k)
+#define QUERY_EMIT_LANE(k, shift) \
+	out[n] = row + k; n += (mask >> (shift)) & 1;
+
+inline int _sse2Filter(const int* values, int first, int last,
+					   query_op op, const int& value, int* out)
+{
+	// only ==, < and > for ints; the others are their negation
+	__m128i v = _mm_set1_epi32(value);
+	int flip = (op == op_not_equal || op == op_less_equal || op == op_greater_equal) ? 0xFFFF : 0;
+	int n = 0, row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)&values[row]);
+		__m128i m;
+		if(op == op_equal || op == op_not_equal)
+			m = _mm_cmpeq_epi32(x, v);
+		else if(op == op_less || op == op_greater_equal)
+			m = _mm_cmplt_epi32(x, v);
+		else
+			m = _mm_cmpgt_epi32(x, v);
+		// a byte per bit: lane k is bit 4k
+		int mask = _mm_movemask_epi8(m) ^ flip;
+		QUERY_EMIT_LANE(0, 0)
+		QUERY_EMIT_LANE(1, 4)
+		QUERY_EMIT_LANE(2, 8)
+		QUERY_EMIT_LANE(3, 12)
+	}
+	return n + _scalarFilter(values, row, last, op, value, out + n);
+}
+
+inline int _sse2Filter(const float* values, int first, int last,
+					   query_op op, const float& value, int* out)
+{
+	// all six comparisons, so that NaNs fail the way they do in C
+	__m128 v = _mm_set1_ps(value);
+	int n = 0, row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128 x = _mm_loadu_ps(&values[row]);
+		__m128 m;
+		switch(op)
+		{
+		case op_equal:			m = _mm_cmpeq_ps(x, v); break;
+		case op_not_equal:		m = _mm_cmpneq_ps(x, v); break;
+		case op_less:			m = _mm_cmplt_ps(x, v); break;
+		case op_less_equal:		m = _mm_cmple_ps(x, v); break;
+		case op_greater:		m = _mm_cmpgt_ps(x, v); break;
+		default:				m = _mm_cmpge_ps(x, v); break;
+		}
+		int mask = _mm_movemask_ps(m);
+		QUERY_EMIT_LANE(0, 0)
+		QUERY_EMIT_LANE(1, 1)
+		QUERY_EMIT_LANE(2, 2)
+		QUERY_EMIT_LANE(3, 3)
+	}
+	return n + _scalarFilter(values, row, last, op, value, out + n);
+}
+
+inline int _sse2Filter(const double* values, int first, int last,
+					   query_op op, const double& value, int* out)
+{
+	__m128d v = _mm_set1_pd(value);
+	int n = 0, row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128d x0 = _mm_loadu_pd(&values[row]);
+		__m128d x1 = _mm_loadu_pd(&values[row + 2]);
+		__m128d m0, m1;
+		switch(op)
+		{
+		case op_equal:			m0 = _mm_cmpeq_pd(x0, v); m1 = _mm_cmpeq_pd(x1, v); break;
+		case op_not_equal:		m0 = _mm_cmpneq_pd(x0, v); m1 = _mm_cmpneq_pd(x1, v); break;
+		case op_less:			m0 = _mm_cmplt_pd(x0, v); m1 = _mm_cmplt_pd(x1, v); break;
+		case op_less_equal:		m0 = _mm_cmple_pd(x0, v); m1 = _mm_cmple_pd(x1, v); break;
+		case op_greater:		m0 = _mm_cmpgt_pd(x0, v); m1 = _mm_cmpgt_pd(x1, v); break;
+		default:				m0 = _mm_cmpge_pd(x0, v); m1 = _mm_cmpge_pd(x1, v); break;
+		}
+		int mask = _mm_movemask_pd(m0) | (_mm_movemask_pd(m1) << 2);
+		QUERY_EMIT_LANE(0, 0)
+		QUERY_EMIT_LANE(1, 1)
+		QUERY_EMIT_LANE(2, 2)
+		QUERY_EMIT_LANE(3, 3)
+	}
+	return n + _scalarFilter(values, row, last, op, value, out + n);
+}
+#undef QUERY_EMIT_LANE
+
+#define QUERY_SSE2_FILTER(type) \
+	inline int _filterRange(const type* values, int first, int last, \
+							query_op op, const type& value, int* out) \
+	{ \
+		if( _cpuHasSSE2() ) \
+			return _sse2Filter(values, first, last, op, value, out); \
+		return _scalarFilter(values, first, last, op, value, out); \
+	}
+QUERY_SSE2_FILTER(int)
+QUERY_SSE2_FILTER(float)
+QUERY_SSE2_FILTER(double)
+#undef QUERY_SSE2_FILTER
+
+inline void _sse2Aggregate(const int* values, int first, int last, _aggregate_<int>& agg)
+{
+	if(last - first < 8)
+	{
+		_scalarAggregate(values, first, last, agg);
+		return;
+	}
+	// the sum goes into two 64-bit lanes: each int is widened
+	// with its sign (all ones for negative values)
+	__m128i sum = _mm_setzero_si128();
+	__m128i mn = _mm_loadu_si128((const __m128i*)&values[first]);
+	__m128i mx = mn;
+	int row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)&values[row]);
+		__m128i sign = _mm_srai_epi32(x, 31);
+		sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(x, sign));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(x, sign));
+		// no integer min/max before SSE4.1: blend on the comparison
+		__m128i lt = _mm_cmplt_epi32(x, mn);
+		mn = _mm_or_si128(_mm_and_si128(lt, x), _mm_andnot_si128(lt, mn));
+		__m128i gt = _mm_cmpgt_epi32(x, mx);
+		mx = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, mx));
+	}
+	__int64 sums[2];
+	int mins[4], maxs[4];
+	_mm_storeu_si128((__m128i*)sums, sum);
+	_mm_storeu_si128((__m128i*)mins, mn);
+	_mm_storeu_si128((__m128i*)maxs, mx);
+	_aggregate_<int> part;
+	part.count = row - first;
+	part.sum = sums[0] + sums[1];
+	part.min = mins[0];
+	part.max = maxs[0];
+	for(int i=1; i<4; i++)
+	{
+		if(mins[i] < part.min) part.min = mins[i];
+		if(maxs[i] > part.max) part.max = maxs[i];
+	}
+	_scalarAggregate(values, row, last, part);
+	agg.merge(part);
+}
+
+inline void _sse2Aggregate(const float* values, int first, int last, _aggregate_<float>& agg)
+{
+	if(last - first < 8)
+	{
+		_scalarAggregate(values, first, last, agg);
+		return;
+	}
+	// summed as doubles, like the scalar code does
+	__m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+	__m128 mn = _mm_loadu_ps(&values[first]);
+	__m128 mx = mn;
+	int row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128 x = _mm_loadu_ps(&values[row]);
+		sum0 = _mm_add_pd(sum0, _mm_cvtps_pd(x));
+		sum1 = _mm_add_pd(sum1, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+		mn = _mm_min_ps(mn, x);
+		mx = _mm_max_ps(mx, x);
+	}
+	double sums[2];
+	float mins[4], maxs[4];
+	_mm_storeu_pd(sums, _mm_add_pd(sum0, sum1));
+	_mm_storeu_ps(mins, mn);
+	_mm_storeu_ps(maxs, mx);
+	_aggregate_<float> part;
+	part.count = row - first;
+	part.sum = sums[0] + sums[1];
+	part.min = mins[0];
+	part.max = maxs[0];
+	for(int i=1; i<4; i++)
+	{
+		if(mins[i] < part.min) part.min = mins[i];
+		if(maxs[i] > part.max) part.max = maxs[i];
+	}
+	_scalarAggregate(values, row, last, part);
+	agg.merge(part);
+}
+
+inline void _sse2Aggregate(const double* values, int first, int last, _aggregate_<double>& agg)
+{
+	if(last - first < 8)
+	{
+		_scalarAggregate(values, first, last, agg);
+		return;
+	}
+	__m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+	__m128d mn = _mm_loadu_pd(&values[first]);
+	__m128d mx = mn;
+	int row = first;
+	for(; row + 4 <= last; row += 4)
+	{
+		__m128d x0 = _mm_loadu_pd(&values[row]);
+		__m128d x1 = _mm_loadu_pd(&values[row + 2]);
+		sum0 = _mm_add_pd(sum0, x0);
+		sum1 = _mm_add_pd(sum1, x1);
+		mn = _mm_min_pd(mn, _mm_min_pd(x0, x1));
+		mx = _mm_max_pd(mx, _mm_max_pd(x0, x1));
+	}
+	double sums[2], mins[2], maxs[2];
+	_mm_storeu_pd(sums, _mm_add_pd(sum0, sum1));
+	_mm_storeu_pd(mins, mn);
+	_mm_storeu_pd(maxs, mx);
+	_aggregate_<double> part;
+	part.count = row - first;
+	part.sum = sums[0] + sums[1];
+	part.min = (mins[1] < mins[0]) ? mins[1] : mins[0];
+	part.max = (maxs[1] > maxs[0]) ? maxs[1] : maxs[0];
+	_scalarAggregate(values, row, last, part);
+	agg.merge(part);
+}
+
+#define QUERY_SSE2_AGGREGATE(type) \
+	inline void _aggregateRange(const type* values, int first, int last, \
+								_aggregate_<type>& agg) \
+	{ \
+		if( _cpuHasSSE2() ) \
+			_sse2Aggregate(values, first, last, agg); \
+		else \
+			_scalarAggregate(values, first, last, agg); \
+	}
+QUERY_SSE2_AGGREGATE(int)
+QUERY_SSE2_AGGREGATE(float)
+QUERY_SSE2_AGGREGATE(double)
+#undef QUERY_SSE2_AGGREGATE
+#endif // QUERY_SSE2
+
+
+// orders row indexes on the keys of the rows, then on the row
+template<typename key_type> class _query_key_order_
+{
+public:
+	_query_key_order_(const key_type* keys) : _keys(keys)
+	{ }
+	int operator()(const int& row1, const int& row2) const
+	{
+		int c = _compare(_keys[row1], _keys[row2]);
+		return c ? c : row1 - row2;
+	}
+protected:
+	const key_type* _keys;
+};
+
+
+//------------------------------------------------------------
+// Running the parts of a query: func(params[i]) for each part,
+// on the pool's threads if there are more parts than one, and
+// back when all are done
+//------------------------------------------------------------
+struct query_task
+{
+	JOB_PROCESSING_FUNC func;
+	void* param;
+	// the parts still running, and the event set by the last one
+	long* pending;
+	HANDLE done;
+};
+
+inline int __stdcall _queryRunTask(void* pParam)
+{
+	query_task* task = (query_task*) pParam;
+	task->func(task->param);
+	if(InterlockedDecrement(task->pending) == 0)
+		SetEvent(task->done);
+	return 0;
+}
+
+inline void _queryRunParts(_thread_pool_* pool, JOB_PROCESSING_FUNC func, void** params, int parts)
+{
+	int i;
+	if(pool == NULL || parts == 1)
+	{
+		for(i=0; i<parts; i++)
+			func(params[i]);
+		return;
+	}
+	query_task* tasks = new query_task[parts];
+	long pending = parts;
+	HANDLE done = CreateEvent(NULL, TRUE, FALSE, NULL);
+	for(i=0; i<parts; i++)
+	{
+		tasks[i].func = func;
+		tasks[i].param = params[i];
+		tasks[i].pending = &pending;
+		tasks[i].done = done;
+		pool->queueJob(_queryRunTask, &tasks[i]);
+	}
+	WaitForSingleObject(done, INFINITE);
+	CloseHandle(done);
+	delete [] tasks;
+}
+
+// one part of a hash group-by: the groups of rows [first, last),
+// or of positions [first, last) of a selection
+template<typename key_type, typename value_type> struct _query_group_job_
+{
+	const key_type* keys;
+	const value_type* values;
+	const _selection_* rows;
+	int first, last;
+	_hash_groups_<key_type> groups;
+	_array_<_aggregate_<value_type> > aggs;
+
+	static int __stdcall run(void* pParam)
+	{
+		_query_group_job_* job = (_query_group_job_*) pParam;
+		for(int i=job->first; i<job->last; i++)
+		{
+			int row = job->rows ? (*job->rows)[i] : i;
+			int group = job->groups.insert(job->keys[row], _hashOf(job->keys[row]));
+			if(group == job->aggs.length())
+				job->aggs.append(_aggregate_<value_type>());
+			job->aggs[group].add(job->values[row]);
+		}
+		return 0;
+	}
+};
+
+
+//------------------------------------------------------------
+// Query over one column: filters and aggregates, split into
+// parts run on a thread pool for large columns. The values
+// aren't copied and have to stay put while the query runs.
+//------------------------------------------------------------
+template<typename value_type> class _column_query_
+{
+public:
+	typedef _aggregate_<value_type> aggregate;
+
+	// parts: how many pieces a large column is split into,
+	// 0 for the number of processors; without a pool,
+	// everything runs on the calling thread
+	_column_query_(const value_type* values, int count,
+				   _thread_pool_* pool = NULL, int parts = 0) :
+		_values(values), _count(count), _pool(pool), _parts(parts)
+	{
+		if(_parts <= 0)
+		{
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			_parts = (int)si.dwNumberOfProcessors;
+		}
+		if(_parts < 1)
+			_parts = 1;
+	}
+
+	int getCount() const
+	{
+		return _count;
+	}
+
+	// Filters: the rows (of all, or of those in rows) whose
+	// value satisfies "value op constant", in row order
+	void filter(query_op op, const value_type& constant, _selection_& result) const
+	{
+		_run(job_filter, op, constant, NULL, &result, NULL);
+	}
+	void filter(const _selection_& rows, query_op op, const value_type& constant,
+				_selection_& result) const
+	{
+		_run(job_filter, op, constant, &rows, &result, NULL);
+	}
+
+	// Aggregates of all the rows, or of those in rows
+	aggregate getAggregate() const
+	{
+		aggregate agg;
+		_run(job_aggregate, op_equal, value_type(), NULL, NULL, &agg);
+		return agg;
+	}
+	aggregate getAggregate(const _selection_& rows) const
+	{
+		aggregate agg;
+		_run(job_aggregate, op_equal, value_type(), &rows, NULL, &agg);
+		return agg;
+	}
+
+	// Group-by: the distinct keys (keys[row] for each row, or for
+	// each row in rows) in increasing order, and the aggregate of
+	// the values of the rows having each one
+	template<typename key_type>
+		void groupBy(const key_type* keys, const _selection_* rows,
+					 _array_<key_type>& groupKeys, _array_<aggregate>& groups) const
+	{
+		groupKeys.clear();
+		groups.clear();
+		int count = rows ? rows->length() : _count;
+		if(count == 0)
+			return;
+		_array_<int> order;
+		order.resize(count);
+		int i;
+		for(i=0; i<count; i++)
+			order[i] = rows ? (*rows)[i] : i;
+		_sort_<int> sorter;
+		sorter.sort(&order[0], count, _query_key_order_<key_type>(keys));
+
+		aggregate agg;
+		for(i=0; i<count; i++)
+		{
+			int row = order[i];
+			if(i > 0 && _compare(keys[row], keys[order[i - 1]]) != 0)
+			{
+				groupKeys.append(keys[order[i - 1]]);
+				groups.append(agg);
+				agg = aggregate();
+			}
+			agg.add(_values[row]);
+		}
+		groupKeys.append(keys[order[count - 1]]);
+		groups.append(agg);
+	}
+
+	// Hash group-by: the same groups as groupBy(), without the
+	// sort, in the order of the first row of each. The parts of a
+	// large column are grouped on their own, then merged in order.
+	template<typename key_type>
+		void hashGroupBy(const key_type* keys, const _selection_* rows,
+						 _array_<key_type>& groupKeys, _array_<aggregate>& groups) const
+	{
+		int count = rows ? rows->length() : _count;
+		int parts = (_pool && count >= QUERY_PARALLEL_MIN) ? _parts : 1;
+		typedef _query_group_job_<key_type, value_type> group_job;
+		group_job* jobs = new group_job[parts];
+		void** params = new void*[parts];
+		int i, g;
+		for(i=0; i<parts; i++)
+		{
+			jobs[i].keys = keys;
+			jobs[i].values = _values;
+			jobs[i].rows = rows;
+			jobs[i].first = (int)((__int64)count * i / parts);
+			jobs[i].last = (int)((__int64)count * (i + 1) / parts);
+			params[i] = &jobs[i];
+		}
+		_queryRunParts(_pool, group_job::run, params, parts);
+
+		_hash_groups_<key_type>& merged = jobs[0].groups;
+		_array_<aggregate>& aggs = jobs[0].aggs;
+		for(i=1; i<parts; i++)
+		{
+			const _hash_groups_<key_type>& part = jobs[i].groups;
+			for(g=0; g<part.length(); g++)
+			{
+				int group = merged.insert(part.getKey(g), part.getHash(g));
+				if(group == aggs.length())
+					aggs.append(jobs[i].aggs[g]);
+				else
+					aggs[group].merge(jobs[i].aggs[g]);
+			}
+		}
+		groupKeys = merged.getKeys();
+		groups = aggs;
+		delete [] params;
+		delete [] jobs;
+	}
+
+protected:
+	const value_type* _values;
+	int _count;
+	_thread_pool_* _pool;
+	int _parts;
+
+	enum job_kind { job_filter, job_aggregate };
+
+	// one part of a query: rows [first, last), or positions
+	// [first, last) of a selection
+	struct query_job
+	{
+		const _column_query_* query;
+		job_kind kind;
+		query_op op;
+		const value_type* constant;
+		const _selection_* rows;
+		int first, last;
+		// where the part's rows go: its own selection, or the
+		// caller's when there's only one part
+		_selection_* result;
+		_selection_ partResult;
+		aggregate agg;
+		// the parts still running, and the event set by the last one
+		long* pending;
+		HANDLE done;
+	};
+
+	static int __stdcall _runJob(void* pParam)
+	{
+		query_job* job = (query_job*) pParam;
+		job->query->_runPart(*job);
+		if(job->pending && InterlockedDecrement(job->pending) == 0)
+			SetEvent(job->done);
+		return 0;
+	}
+
+	void _runPart(query_job& job) const
+	{
+		int count = job.last - job.first;
+		if(job.kind == job_filter)
+		{
+			int* out = job.result->appendSpace(count);
+			if(job.rows)
+				job.result->appended(_filterRows(_values, job.rows->rows() + job.first, count,
+												job.op, *job.constant, out));
+			else
+				job.result->appended(_filterRange(_values, job.first, job.last,
+												 job.op, *job.constant, out));
+		}
+		else
+		{
+			if(job.rows)
+				_aggregateRows(_values, job.rows->rows() + job.first, count, job.agg);
+			else
+				_aggregateRange(_values, job.first, job.last, job.agg);
+		}
+	}
+
+	void _run(job_kind kind, query_op op, const value_type& constant, const _selection_* rows,
+			  _selection_* result, aggregate* agg) const
+	{
+		int count = rows ? rows->length() : _count;
+		int parts = (_pool && count >= QUERY_PARALLEL_MIN) ? _parts : 1;
+		if(result)
+			result->clear();
+
+		query_job* jobs = new query_job[parts];
+		long pending = parts;
+		HANDLE done = (parts > 1) ? CreateEvent(NULL, TRUE, FALSE, NULL) : NULL;
+		int i;
+		for(i=0; i<parts; i++)
+		{
+			query_job& job = jobs[i];
+			job.query = this;
+			job.kind = kind;
+			job.op = op;
+			job.constant = &constant;
+			job.rows = rows;
+			job.result = (parts == 1 && result) ? result : &job.partResult;
+			job.first = (int)((__int64)count * i / parts);
+			job.last = (int)((__int64)count * (i + 1) / parts);
+			job.pending = (parts > 1) ? &pending : NULL;
+			job.done = done;
+		}
+		if(parts == 1)
+			_runPart(jobs[0]);
+		else
+		{
+			for(i=0; i<parts; i++)
+				_pool->queueJob(_runJob, &jobs[i]);
+			WaitForSingleObject(done, INFINITE);
+			CloseHandle(done);
+		}
+
+		// the parts in order, so the rows stay in order
+		for(i=0; i<parts; i++)
+		{
+			if(result && parts > 1)
+				result->append(jobs[i].partResult.rows(), jobs[i].partResult.length());
+			if(agg)
+				agg->merge(jobs[i].agg);
+		}
+		delete [] jobs;
+	}
+};
+
+
+};	// namespace soige
+
+#endif // __query_already_included_vasya__
@@ -82,6 +82,7 @@ TODO:
 
 #include "_array_.h"
 #include "_strfuncs_.h"
+#include "_string_view_.h"
 
 #if defined(UNICODE) || defined(_UNICODE)
 	#error soige utils: _regex_ does not support Unicode compilation
@@ -395,6 +396,11 @@ public:
 				long* pMatchStart = NULL,
 				long* pMatchLength = NULL,
 				bool fastReturn = false);
+	bool match (const _string_view_& str,
+				long* pMatchStart = NULL,
+				long* pMatchLength = NULL,
+				bool fastReturn = false)
+		{ return match(str.data(), str.length(), pMatchStart, pMatchLength, fastReturn); }
 
 	const char* errstr() const;
 
@@ -0,0 +1,404 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _rope_.cpp - implementation of _rope_.
+//
+// The tree functions take over the references they're given
+// and hand back the ones they return. A node is changed in
+// place only if nobody else has it (refs is 1); otherwise it's
+// copied, along with the path to it.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_rope_.h"
+
+namespace soige {
+
+//------------------------------------------------
+// Constructors
+//------------------------------------------------
+_rope_::_rope_()
+{
+	_root = NULL;
+	_seed = 0x2545F491;
+}
+
+_rope_::_rope_(const _rope_& rope)
+{
+	_root = _ref( rope._root );
+	_seed = rope._seed;
+}
+
+_rope_::_rope_(const _string_view_& view)
+{
+	_root = _build( view.data(), view.length(), true );
+	_seed = 0x2545F491;
+}
+
+_rope_::_rope_(const _string_& refstr)
+{
+	_root = _build( refstr.c_str(), refstr.length(), true );
+	_seed = 0x2545F491;
+}
+
+_rope_::~_rope_()
+{
+	_release( _root );
+}
+
+//------------------------------------------------
+// Operations
+//------------------------------------------------
+_rope_& _rope_::operator=(const _rope_& rope)
+{
+	rope_node* root = _ref( rope._root );
+	_release( _root );
+	_root = root;
+	return *this;
+}
+
+_rope_& _rope_::operator=(const _string_view_& view)
+{
+	rope_node* root = _build( view.data(), view.length(), true );
+	_release( _root );
+	_root = root;
+	return *this;
+}
+
+_rope_& _rope_::append(const _rope_& rope)
+{
+	_root = _merge( _root, _ref(rope._root) );
+	return *this;
+}
+
+_rope_& _rope_::append(const _string_view_& view)
+{
+	_root = _appendChars( _root, view.data(), view.length(), true );
+	return *this;
+}
+
+_rope_& _rope_::insert(const _rope_& rope, int start)
+{
+	if( start < 0 ) start = 0;
+	rope_node *left, *right;
+	// before the split, in case rope is this one
+	rope_node* middle = _ref( rope._root );
+	_split( _root, start, left, right );
+	_root = _merge( _merge(left, middle), right );
+	return *this;
+}
+
+_rope_& _rope_::insert(const _string_view_& view, int start)
+{
+	if( start < 0 ) start = 0;
+	rope_node *left, *right;
+	_split( _root, start, left, right );
+	// only the end of the text gets room to grow
+	_root = _merge( _appendChars(left, view.data(), view.length(), right == NULL), right );
+	return *this;
+}
+
+_rope_& _rope_::remove(int start, int count)
+{
+	if( start < 0 ) start = 0;
+	if( count <= 0 || start >= length() ) return *this;
+	rope_node *left, *middle, *right;
+	_split( _root, start, left, right );
+	_split( right, count, middle, right );
+	_release( middle );
+	_root = _merge( left, right );
+	return *this;
+}
+
+void _rope_::clear()
+{
+	_release( _root );
+	_root = NULL;
+}
+
+char _rope_::charAt(int pos) const
+{
+	rope_node* t = _root;
+	while( t )
+	{
+		int leftLen = _total( t->left );
+		if( pos < leftLen )
+			t = t->left;
+		else if( pos < leftLen + t->len )
+			return t->chunk->chars()[t->offset + pos - leftLen];
+		else
+		{
+			pos -= leftLen + t->len;
+			t = t->right;
+		}
+	}
+	return '\0';
+}
+
+_rope_ _rope_::substring(int start, int count) const
+{
+	_rope_ ret;
+	if( start < 0 ) start = 0;
+	if( count <= 0 || start >= length() ) return ret;
+	rope_node *left, *middle, *right;
+	_split( _ref(_root), start, left, right );
+	_split( right, count, middle, right );
+	_release( left );
+	_release( right );
+	ret._root = middle;
+	return ret;
+}
+
+_string_view_ _rope_::piece(int pos) const
+{
+	rope_node* t = _root;
+	while( t )
+	{
+		int leftLen = _total( t->left );
+		if( pos < leftLen )
+			t = t->left;
+		else if( pos < leftLen + t->len )
+		{
+			pos -= leftLen;
+			return _string_view_( t->chunk->chars() + t->offset + pos, t->len - pos );
+		}
+		else
+		{
+			pos -= leftLen + t->len;
+			t = t->right;
+		}
+	}
+	return _string_view_();
+}
+
+void _rope_::copyTo(LPSTR buf, int start, int count) const
+{
+	if( start < 0 ) start = 0;
+	if( count > length() - start ) count = length() - start;
+	if( count > 0 ) _copy( _root, buf, start, count );
+}
+
+_string_ _rope_::toString() const
+{
+	_string_ ret;
+	int len = length();
+	LPSTR p = ret._setLength( len );
+	if( p ) _copy( _root, p, 0, len );
+	return ret;
+}
+
+int _rope_::depth() const
+{
+	return _depth( _root );
+}
+
+
+//------------------------------------------------
+// Nodes and chunks
+//------------------------------------------------
+void _rope_::_release(rope_node* t)
+{
+	if( !t || InterlockedDecrement((LPLONG)&t->refs) > 0 ) return;
+	_release( t->left );
+	_release( t->right );
+	if( InterlockedDecrement((LPLONG)&t->chunk->refs) <= 0 ) free( t->chunk );
+	free( t );
+}
+
+// a chunk of size chars, starting with len of them from p
+_rope_::rope_chunk* _rope_::_newChunk(const char* p, int len, int size)
+{
+	rope_chunk* c = (rope_chunk*) malloc( sizeof(rope_chunk) + size );
+	c->refs = 0;
+	c->used = len;
+	c->size = size;
+	memcpy( c->chars(), p, len );
+	return c;
+}
+
+// a node without children
+_rope_::rope_node* _rope_::_newNode(rope_chunk* chunk, int offset, int len)
+{
+	rope_node* t = (rope_node*) malloc( sizeof(rope_node) );
+	t->refs = 1;
+	InterlockedIncrement( (LPLONG)&chunk->refs );
+	t->chunk = chunk;
+	t->offset = offset;
+	t->len = len;
+	t->left = t->right = NULL;
+	t->total = len;
+	t->count = 1;
+	return t;
+}
+
+// Takes t apart to be changed: returns t itself if nobody else
+// has it, or a copy, and its children in left and right.
+// _close() puts it back together.
+_rope_::rope_node* _rope_::_open(rope_node* t, rope_node*& left, rope_node*& right)
+{
+	if( t->refs == 1 )
+	{
+		left = t->left;
+		right = t->right;
+		t->left = t->right = NULL;
+		return t;
+	}
+	left = _ref( t->left );
+	right = _ref( t->right );
+	rope_node* copy = _newNode( t->chunk, t->offset, t->len );
+	_release( t );
+	return copy;
+}
+
+_rope_::rope_node* _rope_::_close(rope_node* t, rope_node* left, rope_node* right)
+{
+	t->left = left;
+	t->right = right;
+	t->total = _total(left) + t->len + _total(right);
+	t->count = _count(left) + 1 + _count(right);
+	return t;
+}
+
+// splits t into the chars before pos and those from pos on
+void _rope_::_split(rope_node* t, int pos, rope_node*& left, rope_node*& right)
+{
+	if( !t )
+	{
+		left = right = NULL;
+		return;
+	}
+	int leftLen = _total( t->left );
+	rope_node *tl, *tr;
+	t = _open( t, tl, tr );
+	if( pos <= leftLen )
+	{
+		_split( tl, pos, left, tl );
+		right = _close( t, tl, tr );
+	}
+	else if( pos >= leftLen + t->len )
+	{
+		_split( tr, pos - leftLen - t->len, tr, right );
+		left = _close( t, tl, tr );
+	}
+	else
+	{
+		// inside the node: both halves keep the chunk
+		int cut = pos - leftLen;
+		rope_node* rest = _newNode( t->chunk, t->offset + cut, t->len - cut );
+		t->len = cut;
+		left = _close( t, tl, NULL );
+		right = _close( rest, NULL, tr );
+	}
+}
+
+// joins the text of a to that of b
+_rope_::rope_node* _rope_::_merge(rope_node* a, rope_node* b)
+{
+	if( !a ) return b;
+	if( !b ) return a;
+	rope_node *l, *r;
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	if( _seed % (DWORD)(a->count + b->count) < (DWORD)a->count )
+	{
+		a = _open( a, l, r );
+		return _close( a, l, _merge(r, b) );
+	}
+	b = _open( b, l, r );
+	return _close( b, _merge(a, l), r );
+}
+
+// A balanced tree of new nodes for the chars, the middle piece
+// at the root. The last piece gets a whole chunk if the text is
+// to grow there, else the pieces are just their size.
+_rope_::rope_node* _rope_::_build(const char* p, int len, bool room_to_grow)
+{
+	if( len <= 0 ) return NULL;
+	int pieces = (len + ROPE_CHUNK_SIZE - 1) / ROPE_CHUNK_SIZE;
+	int start = (pieces / 2) * ROPE_CHUNK_SIZE;
+	int n = min( ROPE_CHUNK_SIZE, len - start );
+	bool last = ( start + n == len );
+	rope_chunk* chunk = _newChunk( p + start, n, (last && room_to_grow) ? ROPE_CHUNK_SIZE : n );
+	rope_node* t = _newNode( chunk, 0, n );
+	return _close( t, _build(p, start, false),
+					  _build(p + start + n, len - start - n, room_to_grow) );
+}
+
+// the last node of t, count chars longer
+_rope_::rope_node* _rope_::_extendLast(rope_node* t, int count)
+{
+	rope_node *l, *r;
+	t = _open( t, l, r );
+	if( r ) r = _extendLast( r, count );
+	else	t->len += count;
+	return _close( t, l, r );
+}
+
+// Adds the chars at the end of t. As many as fit go into the
+// chunk of its last node, if that one ends where the chunk's
+// used chars do; the chunk can be shared with other ropes, so
+// the chars are claimed with an interlocked add, and whoever
+// loses the race (used isn't where it was) makes a new chunk.
+_rope_::rope_node* _rope_::_appendChars(rope_node* t, const char* p, int len, bool room_to_grow)
+{
+	if( len <= 0 ) return t;
+	if( t )
+	{
+		rope_node* last = t;
+		while( last->right )
+			last = last->right;
+		rope_chunk* chunk = last->chunk;
+		int end = last->offset + last->len;
+		int n = min( len, chunk->size - end );
+		if( n > 0 && chunk->used == end &&
+			InterlockedExchangeAdd((LPLONG)&chunk->used, n) == end )
+		{
+			memcpy( chunk->chars() + end, p, n );
+			t = _extendLast( t, n );
+			p += n;
+			len -= n;
+		}
+	}
+	if( len > 0 )
+		t = _merge( t, _build(p, len, room_to_grow) );
+	return t;
+}
+
+void _rope_::_copy(rope_node* t, LPSTR buf, int start, int count)
+{
+	while( t && count > 0 )
+	{
+		int leftLen = _total( t->left );
+		if( start < leftLen )
+		{
+			int n = min( count, leftLen - start );
+			_copy( t->left, buf, start, n );
+			buf += n;
+			start += n;
+			count -= n;
+		}
+		if( count <= 0 ) break;
+		int inNode = start - leftLen;
+		if( inNode < t->len )
+		{
+			int n = min( count, t->len - inNode );
+			memcpy( buf, t->chunk->chars() + t->offset + inNode, n );
+			buf += n;
+			start += n;
+			count -= n;
+		}
+		// on to the right subtree, without recursion
+		start -= leftLen + t->len;
+		t = t->right;
+	}
+}
+
+int _rope_::_depth(rope_node* t)
+{
+	if( !t ) return 0;
+	// not in max(), which is a macro
+	int left = _depth( t->left ), right = _depth( t->right );
+	return 1 + max( left, right );
+}
+
+
+};	// namespace soige
@@ -0,0 +1,138 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _rope_.h - header file for class _rope_.
+//
+// A string for very long texts that keep changing: the chars
+// are kept in pieces of up to ROPE_CHUNK_SIZE, which are the
+// nodes of a balanced tree, so that inserting, removing or
+// taking a substring anywhere in the text costs O(log n)
+// rather than copying everything after the change.
+//
+// The nodes are reference counted and never change while they
+// are shared, so copying a rope, or taking a substring of one,
+// shares its nodes instead of copying chars (as _string_ shares
+// its rep). A rope's chars are got at piece by piece, with
+// piece(), or copied out with copyTo() and toString().
+//
+// The tree is a randomized binary search tree on the position
+// in the text (Martinez and Roura): joining two trees makes
+// either root the root, at random, in proportion to the sizes
+// of the trees, which keeps the tree balanced whatever the
+// order of the changes.
+//
+// Usage:
+//     _rope_ doc( text.view() );
+//     doc.insert( "chapter 2\n", pos );
+//     doc.remove( 100, 20 );
+//     _rope_ para = doc.substring( pos, 2000 );
+//     for( int p = 0; p < para.length(); )
+//     {
+//         _string_view_ v = para.piece(p);
+//         ...
+//         p += v.length();
+//     }
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __rope_already_included_vasya__
+#define __rope_already_included_vasya__
+
+#include "_common_.h"
+#include "_string_view_.h"
+#include "_string_.h"
+
+// the most chars in one piece of a rope
+#ifndef ROPE_CHUNK_SIZE
+	#define ROPE_CHUNK_SIZE  1024
+#endif
+
+namespace soige {
+
+//------------------------------------------------------------
+// The _rope_ class
+//------------------------------------------------------------
+class _rope_
+{
+public:
+	_rope_				( );
+	_rope_				( const _rope_& rope );
+	explicit _rope_		( const _string_view_& view );
+	explicit _rope_		( const _string_& refstr );
+	virtual ~_rope_		( );
+
+	_rope_&		operator=	( const _rope_& rope );
+	_rope_&		operator=	( const _string_view_& view );
+
+	_rope_&		append		( const _rope_& rope );
+	_rope_&		append		( const _string_view_& view );
+	_rope_&		operator+=	( const _rope_& rope )			{ return append(rope); }
+	_rope_&		operator+=	( const _string_view_& view )	{ return append(view); }
+	_rope_&		insert		( const _rope_& rope, int start );
+	_rope_&		insert		( const _string_view_& view, int start );
+	_rope_&		remove		( int start, int count );
+	void		clear		( );
+
+	inline int	length		( ) const	{ return _total(_root); }
+	inline bool	isEmpty		( ) const	{ return ( _root == NULL ); }
+	char		charAt		( int pos ) const;
+	char		operator[]	( int pos ) const	{ return charAt(pos); }
+
+	_rope_		substring	( int start, int count = MAX_INT ) const;
+	// the chars from pos to the end of the piece they're in; the
+	// view is valid while the rope (or a copy of it) is unchanged
+	_string_view_	piece	( int pos ) const;
+	// copies count chars from start into buf
+	void		copyTo		( LPSTR buf, int start = 0, int count = MAX_INT ) const;
+	_string_	toString	( ) const;
+
+	// the depth of the tree, which stays O(log n)
+	int			depth		( ) const;
+
+private:
+	// the chars of one or more nodes; more can be written past
+	// used, where no node has them yet
+	struct rope_chunk
+	{
+		long	refs;
+		long	used;
+		int		size;
+		LPSTR	chars()	{ return (LPSTR)(this + 1); }
+	};
+	// a node: len chars of its chunk from offset, between the
+	// text of the left subtree and that of the right one
+	struct rope_node
+	{
+		long		refs;
+		rope_chunk*	chunk;
+		int			offset;
+		int			len;
+		rope_node*	left;
+		rope_node*	right;
+		int			total;	// the chars in the subtree
+		int			count;	// the nodes in the subtree
+	};
+
+	rope_node*	_root;
+	DWORD		_seed;
+
+	static inline int _total( rope_node* t )	{ return t ? t->total : 0; }
+	static inline int _count( rope_node* t )	{ return t ? t->count : 0; }
+	static inline rope_node* _ref( rope_node* t )
+		{ if( t ) InterlockedIncrement((LPLONG)&t->refs); return t; }
+	static void			_release	( rope_node* t );
+	static rope_chunk*	_newChunk	( const char* p, int len, int size );
+	static rope_node*	_newNode	( rope_chunk* chunk, int offset, int len );
+	static rope_node*	_open		( rope_node* t, rope_node*& left, rope_node*& right );
+	static rope_node*	_close		( rope_node* t, rope_node* left, rope_node* right );
+	static void			_split		( rope_node* t, int pos, rope_node*& left, rope_node*& right );
+	static rope_node*	_build		( const char* p, int len, bool room_to_grow );
+	static rope_node*	_extendLast	( rope_node* t, int count );
+	static void			_copy		( rope_node* t, LPSTR buf, int start, int count );
+	static int			_depth		( rope_node* t );
+	rope_node*			_merge		( rope_node* a, rope_node* b );
+	rope_node*			_appendChars( rope_node* t, const char* p, int len, bool room_to_grow );
+};
+
+
+};	// namespace soige
+
+#endif  // __rope_already_included_vasya__
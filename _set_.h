@@ -114,6 +114,26 @@ public:
 		return (exists ? index : -1);
 	}
 	
+	// find() by a key of another type, one the elements compare to
+	// (by a _compare(elem, key) overload): _string_ elements can be
+	// found by a _string_view_, without making a _string_ of it
+	template<typename key_like> int findLike(const key_like& key) const
+	{
+		int low = 0, high = _size - 1;
+		while(low <= high)
+		{
+			int mid = (low + high) >> 1;
+			int cmp = _compare(_array[mid], key);
+			if(cmp < 0)
+				low = mid + 1;
+			else if(cmp > 0)
+				high = mid - 1;
+			else
+				return mid;
+		}
+		return -1;
+	}
+	
 	int insert(const elem_type& elem);
 
 	bool remove(const elem_type& elem)
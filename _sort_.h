@@ -2,12 +2,31 @@
 // _sort_.h - header/impl file for the _sort_<> class.
 //
 // Defines a sorting algorithm based on a mixture of three
-// algorithms: insertion, heap, and quick.
+// algorithms: insertion, heap, and quick. Small segments of
+// ints and floats go to sorting networks instead of the
+// insertion sort.
 // For comparisons, user-defined types have to define
 // operators == and < (which are used by the _compare
 // template routine in _common_.h).
 // Copying of item values relies on operator=.
 //
+// Large arrays of fixed-width integers and floats are
+// sorted by an LSD radix sort instead, and arrays of
+// _string_/_cstring_ by an MSD (American flag) radix sort;
+// _sort_ picks these automatically through the _radixSort
+// specializations. Other types can opt in the same way.
+//
+// stableSort() is an adaptive merge sort (natural runs,
+// galloping merges, like TimSort) which keeps equal items
+// in their input order. Both sort() and stableSort() also
+// take a comparator or a key extractor (see below); these
+// are template parameters, so the calls get inlined.
+//
+// partialSort() and nthElement() order only part of the
+// array (the k first items, or the one at a given index),
+// and _top_k_ keeps the k first items of a stream that is
+// never held in memory as a whole.
+//
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #ifndef __sort_already_included_vasya__
@@ -15,34 +34,702 @@
 
 #include "_common_.h"
 
+// whether _networkSortN() has SSE2 kernels; define this as 0
+// for compilers without <emmintrin.h>
+#ifndef SORT_NETWORK_SSE2
+	#define SORT_NETWORK_SSE2  1
+#endif
+#if SORT_NETWORK_SSE2
+	#include <emmintrin.h>
+#endif
+
 namespace soige {
 
+// MSD radix sort tuning: buckets this small are finished off by
+// insertion sort, and after this many nested bucket splits the
+// rest of a bucket goes to the comparison sort (bounds the stack)
+#ifndef MSD_INSERTION_SORT_BOUND
+	#define MSD_INSERTION_SORT_BOUND  16
+#endif
+#ifndef MSD_MAX_SPLIT_LEVEL
+	#define MSD_MAX_SPLIT_LEVEL  64
+#endif
+
+// the largest array sorted by a sorting network; 0 turns
+// them off (small segments then get insertion sort)
+#ifndef SORT_NETWORK_MAX
+	#define SORT_NETWORK_MAX  64
+#endif
+
+//------------------------------------------------------------
+// Radix sort dispatch. _radixSort() returns false for types
+// it doesn't know how to sort, and _sort_ then falls back
+// to the comparison sort; it also returns false if it could
+// not get its scratch memory.
+template<typename T> inline bool _radixSort(T Array[], int cElems)
+	{ return false; }
+
+//------------------------------------------------------------
+// Radix keys: map each value to an unsigned key whose
+// unsigned order is the value's order.
+// Signed ints get their sign bit flipped; for IEEE floats,
+// negatives get all bits flipped (which also reverses their
+// order) and positives get just the sign bit set.
+inline unsigned short _radixKey(short v)
+	{ return (unsigned short)(v ^ 0x8000); }
+inline unsigned short _radixKey(unsigned short v)
+	{ return v; }
+inline unsigned int _radixKey(int v)
+	{ return (unsigned int)v ^ 0x80000000U; }
+inline unsigned int _radixKey(unsigned int v)
+	{ return v; }
+inline unsigned long _radixKey(long v)
+	{ return (unsigned long)v ^ ((unsigned long)1 << (sizeof(long)*8 - 1)); }
+inline unsigned long _radixKey(unsigned long v)
+	{ return v; }
+inline unsigned __int64 _radixKey(__int64 v)
+	{ return (unsigned __int64)v ^ ((unsigned __int64)1 << 63); }
+inline unsigned __int64 _radixKey(unsigned __int64 v)
+	{ return v; }
+inline unsigned int _radixKey(float v)
+{
+	unsigned int bits;
+	memcpy(&bits, &v, sizeof(bits));
+	return (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+}
+inline unsigned __int64 _radixKey(double v)
+{
+	unsigned __int64 bits;
+	memcpy(&bits, &v, sizeof(bits));
+	return (bits & ((unsigned __int64)1 << 63)) ? ~bits : (bits | ((unsigned __int64)1 << 63));
+}
+
+//------------------------------------------------------------
+// LSD radix sort, one pass per key byte, ping-ponging
+// between the array and a scratch copy of it.
+// The last parameter is only there to deduce key_type
+// (pass the _radixKey() of any item).
+template<typename item_type, typename key_type>
+	bool _lsdRadixSort(item_type Array[], int cElems, key_type)
+{
+	int const key_bytes = sizeof(key_type);
+	int counts[sizeof(key_type)][256];
+	int i, pass;
+
+	item_type* scratch = (item_type*) malloc(cElems*sizeof(item_type));
+	if(scratch == NULL)
+		return false;
+
+	// histogram all key bytes in one read of the input
+	memset(counts, 0, sizeof(counts));
+	for(i=0; i<cElems; i++)
+	{
+		key_type key = _radixKey(Array[i]);
+		for(pass=0; pass<key_bytes; pass++)
+			counts[pass][(int)(key >> (pass << 3)) & 0xff]++;
+	}
+
+	item_type* src = Array;
+	item_type* dst = scratch;
+	for(pass=0; pass<key_bytes; pass++)
+	{
+		int* count = counts[pass];
+		int const shift = pass << 3;
+		// every key has the same byte here; the pass wouldn't move anything
+		if( count[(int)(_radixKey(src[0]) >> shift) & 0xff] == cElems )
+			continue;
+
+		// turn the counts into bucket starting offsets
+		int offset = 0;
+		for(i=0; i<256; i++)
+		{
+			int c = count[i];
+			count[i] = offset;
+			offset += c;
+		}
+		for(i=0; i<cElems; i++)
+			dst[count[(int)(_radixKey(src[i]) >> shift) & 0xff]++] = src[i];
+
+		item_type* t = src;
+		src = dst;
+		dst = t;
+	}
+
+	if(src != Array)
+		_copyN<item_type>(Array, src, cElems);
+	free(scratch);
+	return true;
+}
+
+// the types sorted by the LSD radix sort
+template<> inline bool _radixSort<short>(short Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<unsigned short>(unsigned short Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<int>(int Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<unsigned int>(unsigned int Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<long>(long Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<unsigned long>(unsigned long Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<__int64>(__int64 Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<unsigned __int64>(unsigned __int64 Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<float>(float Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+template<> inline bool _radixSort<double>(double Array[], int cElems)
+	{ return _lsdRadixSort(Array, cElems, _radixKey(Array[0])); }
+
+
+//------------------------------------------------------------
+// Comparators. A comparator is any class with
+//		int operator()(const item_type& a, const item_type& b) const
+// returning <0, 0, >0 like _compare() does.
+//------------------------------------------------------------
+// the default order: _compare()
+template<typename item_type> class _comparator_
+{
+public:
+	int operator()(const item_type& a, const item_type& b) const
+		{ return _compare(a, b); }
+};
+
+// reverses the order of another comparator
+template<typename comparator> class _reverse_comparator_
+{
+public:
+	_reverse_comparator_(const comparator& cmp = comparator()) : _cmp(cmp)
+		{ }
+	template<typename item_type>
+		int operator()(const item_type& a, const item_type& b) const
+		{ return _cmp(b, a); }
+protected:
+	comparator _cmp;
+};
+
+// Orders items by a key taken out of each of them. The key
+// extractor is a class defining key_type and
+//		key_type operator()(const item_type& item) const
+// (key_type may be a const reference to a field of the item);
+// keys are compared with _compare().
+template<typename key_extractor> class _key_comparator_
+{
+public:
+	_key_comparator_(const key_extractor& key) : _key(key)
+		{ }
+	template<typename item_type>
+		int operator()(const item_type& a, const item_type& b) const
+		{ return _compare(_key(a), _key(b)); }
+protected:
+	key_extractor _key;
+};
+
+
+//------------------------------------------------------------
+// Sorting networks for small arrays of ints and floats.
+// The network is Batcher's odd-even merge sort, which works
+// for any item count; its compare-exchanges don't depend on
+// the data, so they compile to min/max (or cmov) with no
+// branches to mispredict, unlike insertion sort's.
+// _quickSort() uses them for its small segments through the
+// _networkSort() overloads below, which take the default
+// comparator only (any other comparator gets insertion sort).
+// _networkSortN() sorts a batch of same-length small arrays;
+// with SSE2 it sorts 4 int/float (or 2 double) arrays at a
+// time, one per vector lane.
+//------------------------------------------------------------
+template<typename item_type, typename exchanger>
+	void _oddEvenMergeNetwork(item_type a[], int n, exchanger ex)
+{
+	for(int p = 1; p < n; p += p)
+	{
+		for(int k = p; k >= 1; k >>= 1)
+		{
+			for(int j = k & (p - 1); j + k < n; j += k + k)
+			{
+				// the pairs (i, i+k) for i in [j, j+k) are all
+				// within one 2p block or all straddle two
+				if( ((j + k) & (p + p - 1)) == 0 )
+					continue;
+				int const end = (j + k + k < n) ? j + k : n - k;
+				for(int i = j; i < end; ++i)
+					ex(a[i], a[i + k]);
+			}
+		}
+	}
+}
+
+// branch-free compare-exchange of scalars
+class _min_max_exchange_
+{
+public:
+	template<typename item_type>
+		void operator()(item_type& a, item_type& b) const
+	{
+		item_type lo = (b < a) ? b : a;
+		item_type hi = (b < a) ? a : b;
+		a = lo;
+		b = hi;
+	}
+};
+
+// there is no network for these types (or comparators)
+template<typename item_type, typename comparator>
+	inline bool _networkSort(item_type Array[], int cElems, comparator cmp)
+	{ return false; }
+
+#define SORT_NETWORK_TYPE(type) \
+	inline bool _networkSort(type Array[], int cElems, _comparator_<type>) \
+	{ \
+		if(cElems > SORT_NETWORK_MAX) \
+			return false; \
+		_oddEvenMergeNetwork(Array, cElems, _min_max_exchange_()); \
+		return true; \
+	}
+SORT_NETWORK_TYPE(int)
+SORT_NETWORK_TYPE(unsigned int)
+SORT_NETWORK_TYPE(long)
+SORT_NETWORK_TYPE(unsigned long)
+SORT_NETWORK_TYPE(__int64)
+SORT_NETWORK_TYPE(unsigned __int64)
+SORT_NETWORK_TYPE(float)
+SORT_NETWORK_TYPE(double)
+#undef SORT_NETWORK_TYPE
+
+// index of the lowest set bit of a non-zero mask (as made
+// by _mm_movemask_epi8())
+inline int _lowestBit(unsigned int mask)
+{
+	static const int bits[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9 };
+	return bits[((mask & (0 - mask)) * 0x077CB531U) >> 27];
+}
+// index of the highest set bit of a non-zero mask
+inline int _highestBit(unsigned int mask)
+{
+	mask |= mask >> 1;
+	mask |= mask >> 2;
+	mask |= mask >> 4;
+	mask |= mask >> 8;
+	mask |= mask >> 16;
+	return _lowestBit( (mask >> 1) + 1 );
+}
+
+#if SORT_NETWORK_SSE2
+// checked once at run time, so that the same binary still
+// runs on CPUs without SSE2
+inline bool _cpuHasSSE2()
+{
+	static int has = -1;
+	if(has < 0)
+		has = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+	return has != 0;
+}
+
+class _sse2_exchange_
+{
+public:
+	// a blend on b < a, as _min_max_exchange_ does, and not
+	// min/max: those give the second operand if either is a NaN,
+	// which would lose one of the two (as they lose -0 from +0)
+	void operator()(__m128& a, __m128& b) const
+	{
+		__m128 lt = _mm_cmplt_ps(b, a);
+		__m128 lo = _mm_or_ps(_mm_and_ps(lt, b), _mm_andnot_ps(lt, a));
+		b = _mm_or_ps(_mm_and_ps(lt, a), _mm_andnot_ps(lt, b));
+		a = lo;
+	}
+	void operator()(__m128d& a, __m128d& b) const
+	{
+		__m128d lt = _mm_cmplt_pd(b, a);
+		__m128d lo = _mm_or_pd(_mm_and_pd(lt, b), _mm_andnot_pd(lt, a));
+		b = _mm_or_pd(_mm_and_pd(lt, a), _mm_andnot_pd(lt, b));
+		a = lo;
+	}
+	void operator()(__m128i& a, __m128i& b) const
+	{
+		// no integer min/max before SSE4.1: blend on a > b
+		__m128i gt = _mm_cmpgt_epi32(a, b);
+		__m128i lo = _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+		b = _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+		a = lo;
+	}
+};
+#endif // SORT_NETWORK_SSE2
+
+
+//------------------------------------------------------------
+// The stable merge sort (TimSort).
+// Finds the natural runs in the array (reversing strictly
+// descending ones), extends short runs to a minimum length
+// with binary insertion sort, and merges runs off a stack
+// whose lengths are kept in a balanced shape. Merges skip
+// the parts of the runs that are already in place, and
+// switch to galloping (exponential search) while one run
+// keeps winning.
+// Merging copies the shorter run into a scratch buffer of
+// at most maxScratch items; if a merge needs more than that
+// (or the memory can't be had), the runs are split in half
+// by rotation and merged piecewise instead.
+//------------------------------------------------------------
+template<typename item_type, typename comparator> class _merge_sort_
+{
+public:
+	// maxScratch < 0 means no limit (at most cElems/2 items are used)
+	_merge_sort_(item_type Array[], int cElems, comparator cmp, int maxScratch = -1) :
+		_a(Array), _n(cElems), _cmp(cmp), _tmp(NULL), _tmpLen(0),
+		_maxScratch(maxScratch < 0 ? MAX_INT : maxScratch),
+		_stackSize(0), _minGallop(MIN_GALLOP)
+	{ }
+	virtual ~_merge_sort_()
+	{
+		_freeScratch();
+	}
+
+	void sort();
+
+protected:
+	enum
+	{
+		MIN_MERGE = 32,		// shorter arrays are just binary-insertion-sorted
+		MIN_GALLOP = 7,		// initial wins in a row before galloping
+		MAX_RUNS = 85		// enough run stack for 2^64 items
+	};
+
+	item_type*	_a;
+	int			_n;
+	comparator	_cmp;
+	item_type*	_tmp;		// scratch for merges
+	int			_tmpLen;
+	int const	_maxScratch;
+	int			_runBase[MAX_RUNS];
+	int			_runLen[MAX_RUNS];
+	int			_stackSize;
+	int			_minGallop;
+
+	static int _minRunLength(int n)
+	{
+		int r = 0;	// becomes 1 if any 1 bits are shifted off
+		while(n >= MIN_MERGE)
+		{
+			r |= (n & 1);
+			n >>= 1;
+		}
+		return n + r;
+	}
+
+	void _binarySort(int lo, int hi, int start);
+	int  _countRunAndMakeAscending(int lo, int hi);
+	void _reverseRange(int lo, int hi)
+	{
+		for(--hi; lo < hi; ++lo, --hi)
+			_swap<item_type>(&_a[lo], &_a[hi]);
+	}
+	void _rotate(int first, int len1, int len2)
+	{
+		_reverseRange(first, first + len1);
+		_reverseRange(first + len1, first + len1 + len2);
+		_reverseRange(first, first + len1 + len2);
+	}
+
+	void _pushRun(int base, int len)
+	{
+		_runBase[_stackSize] = base;
+		_runLen[_stackSize++] = len;
+	}
+	void _mergeCollapse();
+	void _mergeForceCollapse();
+	void _mergeAt(int i);
+	void _mergeRuns(int base1, int len1, int len2);
+	void _mergeLo(int base1, int len1, int base2, int len2);
+	void _mergeHi(int base1, int len1, int base2, int len2);
+	int  _gallopLeft(const item_type& key, const item_type* arr, int base, int len, int hint);
+	int  _gallopRight(const item_type& key, const item_type* arr, int base, int len, int hint);
+
+	bool _ensureScratch(int len);
+	void _freeScratch()
+	{
+		if(_tmp)
+		{
+			_destroyN<item_type>(_tmp, _tmpLen);
+			free(_tmp);
+			_tmp = NULL;
+		}
+		_tmpLen = 0;
+	}
+
+private:
+	// no byval operations
+	_merge_sort_(const _merge_sort_&) : _maxScratch(0) { }
+	void operator=(const _merge_sort_&) { }
+};
+
+
+//------------------------------------------------------------
+// Binary heap helpers (0-based, the root is the item that
+// sorts last under cmp)
+//------------------------------------------------------------
+template<typename item_type, typename comparator>
+	void _heapSiftDown(item_type heap[], int count, int index, comparator cmp)
+{
+	item_type temp = heap[index];
+	for(;;)
+	{
+		int child = index + index + 1;
+		if(child >= count)
+			break;
+		if( child + 1 < count && cmp(heap[child + 1], heap[child]) > 0 )
+			++child;
+		if( cmp(heap[child], temp) <= 0 )
+			break;
+		heap[index] = heap[child];
+		index = child;
+	}
+	heap[index] = temp;
+}
+
+template<typename item_type, typename comparator>
+	void _heapSiftUp(item_type heap[], int index, comparator cmp)
+{
+	item_type temp = heap[index];
+	while(index > 0)
+	{
+		int parent = (index - 1) >> 1;
+		if( cmp(heap[parent], temp) >= 0 )
+			break;
+		heap[index] = heap[parent];
+		index = parent;
+	}
+	heap[index] = temp;
+}
+
+
+//------------------------------------------------------------
+// Top-K accumulator: keeps the k items that sort first among
+// all the items pushed to it (the k smallest; pass a
+// _reverse_comparator_ for the k largest), in a max-heap of
+// k items. A push costs one comparison when the item doesn't
+// make it, O(log k) when it does.
+//------------------------------------------------------------
+template<typename item_type, typename comparator = _comparator_<item_type> > class _top_k_
+{
+public:
+	_top_k_(int k, comparator cmp = comparator()) :
+		_cmp(cmp), _heap(NULL), _count(0), _capacity(0), _sorted(false)
+	{
+		if(k > 0)
+		{
+			_heap = (item_type*)malloc(k * sizeof(item_type));
+			if(_heap)
+			{
+				_createN<item_type>(_heap, k);
+				_capacity = k;
+			}
+		}
+	}
+	virtual ~_top_k_()
+	{
+		if(_heap)
+		{
+			_destroyN<item_type>(_heap, _capacity);
+			free(_heap);
+		}
+	}
+
+	// returns true if the item is (for now) among the top k
+	bool push(const item_type& item)
+	{
+		if(_capacity == 0)
+			return false;
+		if(_sorted)
+			_heapify();
+		if(_count < _capacity)
+		{
+			_heap[_count] = item;
+			_heapSiftUp(_heap, _count++, _cmp);
+			return true;
+		}
+		// the root is the worst item kept
+		if( _cmp(item, _heap[0]) >= 0 )
+			return false;
+		_heap[0] = item;
+		_heapSiftDown(_heap, _count, 0, _cmp);
+		return true;
+	}
+
+	int size() const
+	{ return _count; }
+	int capacity() const
+	{ return _capacity; }
+	bool full() const
+	{ return _count == _capacity; }
+
+	// the worst of the items kept, which a new item has to beat
+	// once the accumulator is full; size() must be > 0
+	const item_type& threshold() const
+	{ return _sorted ? _heap[_count - 1] : _heap[0]; }
+
+	// items in heap order, or best first after sort()
+	const item_type& operator[](int index) const
+	{ return _heap[index]; }
+	const item_type* data() const
+	{ return _heap; }
+
+	// puts the items kept in order, best first; pushing more
+	// items afterwards is fine (the heap is rebuilt)
+	void sort()
+	{
+		if(_sorted)
+			return;
+		for(int n = _count - 1; n > 0; --n)
+		{
+			_swap<item_type>(&_heap[0], &_heap[n]);
+			_heapSiftDown(_heap, n, 0, _cmp);
+		}
+		_sorted = true;
+	}
+
+	void clear()
+	{
+		// drop the references the kept items may hold
+		for(int i = 0; i < _count; ++i)
+			_heap[i] = item_type();
+		_count = 0;
+		_sorted = false;
+	}
+
+protected:
+	void _heapify()
+	{
+		for(int i = (_count >> 1) - 1; i >= 0; --i)
+			_heapSiftDown(_heap, _count, i, _cmp);
+		_sorted = false;
+	}
+
+	comparator	_cmp;
+	item_type*	_heap;
+	int			_count;
+	int			_capacity;
+	bool		_sorted;
+
+private:
+	// no byval operations
+	_top_k_(const _top_k_&) { }
+	void operator=(const _top_k_&) { }
+};
+
+
 //------------------------------------------------------------
 // The sort class
 //------------------------------------------------------------
 template<typename item_type> class _sort_
 {
 public:
-	_sort_(int insertBound = 16) : INSERTION_SORT_BOUND(insertBound)
+	// arrays of at least radixBound items go to the radix sort
+	// if there is one for item_type; pass -1 to never use it.
+	// stableSort() allocates at most maxScratch items of scratch
+	// memory; -1 means as much as it needs (half the array).
+	_sort_(int insertBound = 16, int radixBound = 256, int maxScratch = -1) :
+		INSERTION_SORT_BOUND(insertBound), RADIX_SORT_BOUND(radixBound),
+		MERGE_SCRATCH_BOUND(maxScratch)
 	{ }
 
 	void sort(item_type Array[], int cElems)
 	{
 		if( cElems <= 1 )
 			return;
-		_quickSort(Array, 0, cElems - 1);
+		if( RADIX_SORT_BOUND >= 0 && cElems >= RADIX_SORT_BOUND &&
+			_radixSort<item_type>(Array, cElems) )
+			return;
+		_quickSort(Array, 0, cElems - 1, _comparator_<item_type>());
+	}
+
+	// the default order is the plain sort(), radix sort and all
+	void sort(item_type Array[], int cElems, _comparator_<item_type>)
+	{
+		sort(Array, cElems);
+	}
+
+	// unstable sort in the order given by a comparator
+	template<typename comparator>
+		void sort(item_type Array[], int cElems, comparator cmp)
+	{
+		if( cElems <= 1 )
+			return;
+		_quickSort(Array, 0, cElems - 1, cmp);
+	}
+
+	// unstable sort on keys taken from the items
+	template<typename key_extractor>
+		void sortByKey(item_type Array[], int cElems, key_extractor key)
+	{
+		sort(Array, cElems, _key_comparator_<key_extractor>(key));
+	}
+
+	// stable sort: items that compare equal keep their order
+	void stableSort(item_type Array[], int cElems)
+	{
+		stableSort(Array, cElems, _comparator_<item_type>());
+	}
+
+	template<typename comparator>
+		void stableSort(item_type Array[], int cElems, comparator cmp)
+	{
+		if( cElems <= 1 )
+			return;
+		_merge_sort_<item_type, comparator> sorter(Array, cElems, cmp, MERGE_SCRATCH_BOUND);
+		sorter.sort();
+	}
+
+	template<typename key_extractor>
+		void stableSortByKey(item_type Array[], int cElems, key_extractor key)
+	{
+		stableSort(Array, cElems, _key_comparator_<key_extractor>(key));
+	}
+
+	// puts the k first items in order into Array[0..k-1];
+	// the rest of the items end up in no particular order
+	void partialSort(item_type Array[], int cElems, int k)
+	{
+		partialSort(Array, cElems, k, _comparator_<item_type>());
+	}
+
+	template<typename comparator>
+		void partialSort(item_type Array[], int cElems, int k, comparator cmp);
+
+	// puts into Array[nth] the item a full sort would put there,
+	// with no greater item before it and no smaller one after it
+	// (introselect: quickselect, heap sort if it goes quadratic)
+	void nthElement(item_type Array[], int cElems, int nth)
+	{
+		nthElement(Array, cElems, nth, _comparator_<item_type>());
 	}
 
+	template<typename comparator>
+		void nthElement(item_type Array[], int cElems, int nth, comparator cmp);
+
 	virtual ~_sort_()
 	{ }
 
 protected:
 	// these two things are too large to make them inline
-	void _quickSort(item_type Array[], int first, int last);
-	void _heapSort(item_type Array[], int first, int cElems);
+	template<typename comparator>
+		void _quickSort(item_type Array[], int first, int last, comparator cmp);
+	template<typename comparator>
+		void _heapSort(item_type Array[], int first, int cElems, comparator cmp);
+	template<typename comparator>
+		int _partition(item_type Array[], int first, int last, comparator cmp);
+	template<typename comparator>
+		void _insertionSort(item_type Array[], int first, int last, comparator cmp);
 
 protected:
 	int const INSERTION_SORT_BOUND;	// boundary point to use insertion sort
+	int const RADIX_SORT_BOUND;		// smallest array given to the radix sort
+	int const MERGE_SCRATCH_BOUND;	// largest scratch buffer of stableSort()
 	static size_t const item_size;
 };
 
@@ -50,8 +737,8 @@ protected:
 template<typename item_type> const size_t _sort_<item_type>::item_size = sizeof(item_type);
 
 
-template<typename item_type>
-	void _sort_<item_type>::_quickSort (item_type Array[], int first, int last)
+template<typename item_type> template<typename comparator>
+	void _sort_<item_type>::_quickSort (item_type Array[], int first, int last, comparator cmp)
 {
 	int stack_pointer = 0;
 	int first_stack[32];
@@ -61,83 +748,15 @@ template<typename item_type>
 	{
 		if (last - first <= INSERTION_SORT_BOUND)
 		{
-			// for small sort (or subsort), use insertion sort
-			int indx;
-			item_type prev_val;
-			item_type cur_val;
-			prev_val = Array[first];
-
-			for (indx = first + 1; indx <= last; ++indx)
-			{
-				cur_val = Array[indx];
-				if ( _compare(prev_val, cur_val) > 0 )
-				{
-					int indx2;
-					// out of order
-					Array[indx] = prev_val;
-
-					for (indx2 = indx - 1; indx2 > first; --indx2)
-					{
-						item_type temp_val;
-						temp_val = Array[indx2 - 1];
-						if ( _compare(temp_val, cur_val) > 0 )
-							Array[indx2] = temp_val;
-						else
-							break;
-					}
-					Array[indx2] = cur_val;
-				}
-				else
-				{
-					// in order, advance to next element
-					prev_val = cur_val;
-				}
-			}
+			// for small sort (or subsort), use a sorting network
+			// if there is one for the items, else insertion sort
+			if( !_networkSort(Array + first, last - first + 1, cmp) )
+				_insertionSort(Array, first, last, cmp);
 		} // end if (insertion sort)
 		else
 		{
 			// try quick sort
-			item_type pivot;
-			int med = (first + last) >> 1;
-
-			// Choose pivot from first, last, and median position.
-			// Sort the three elements.
-			if ( _compare(Array[first], Array[last]) > 0 )
-				_swap<item_type>(&Array[first], &Array[last]);
-
-			if ( _compare(Array[first], Array[med]) > 0 )
-				_swap<item_type>(&Array[med], &Array[first]);
-
-			if ( _compare(Array[med], Array[last]) > 0 )
-				_swap<item_type>(&Array[last], &Array[med]);
-
-			pivot = Array[med];
-
-			int up;
-			int down;
-			// First and last element will be loop stopper.
-			// Split array into two partitions.
-			down = first;
-			up = last;
-			for (;;)
-			{
-				do
-				{
-					++down;
-				} while ( _compare(pivot, Array[down]) > 0 );
-				// while ( down <= last && _compare(pivot, Array[down]) > 0 );
-
-				do
-				{
-					--up;
-				} while ( _compare(Array[up], pivot) > 0 );
-				// while ( up >= first && _compare(Array[up], pivot) > 0 );
-
-				if (up > down)
-					_swap<item_type>(&Array[down], &Array[up]);  // interchange L[down] and L[up]
-				else
-					break;
-			}
+			int up = _partition(Array, first, last, cmp);
 
 			int len1; // length of first segment
 			int len2; // length of second segment
@@ -148,7 +767,7 @@ template<typename item_type>
 				if ((len1 >> 5) > len2)
 				{
 					// badly balanced partitions, heap sort first segment
-					_heapSort(Array, first, len1);
+					_heapSort(Array, first, len1, cmp);
 				}
 				else
 				{
@@ -164,7 +783,7 @@ template<typename item_type>
 				if ( (len2 >> 5) > len1 )
 				{
 					// badly balanced partitions, heap sort second segment
-					_heapSort(Array, up + 1, len2);
+					_heapSort(Array, up + 1, len2, cmp);
 				}
 				else
 				{
@@ -193,34 +812,122 @@ template<typename item_type>
 	} // end for
 }
 
-template<typename item_type>
-	void _sort_<item_type>::_heapSort (item_type Array[], int first, int cElems)
+template<typename item_type> template<typename comparator>
+	void _sort_<item_type>::_insertionSort (item_type Array[], int first, int last, comparator cmp)
 {
-	int half;
-	int parent;
-
-	if (cElems <= 1)
-		return;
+	int indx;
+	item_type prev_val;
+	item_type cur_val;
+	prev_val = Array[first];
 
-	half = cElems >> 1;
-	for (parent = half; parent >= 1; --parent)
+	for (indx = first + 1; indx <= last; ++indx)
 	{
-		item_type temp;
-		int level = 0;
-		int child;
-
-		child = parent;
-		// bottom-up downheap
-
-		// leaf-search for largest child path
-		while (child <= half)
+		cur_val = Array[indx];
+		if ( cmp(prev_val, cur_val) > 0 )
 		{
-			++level;
-			child += child;
-			if ( (child < cElems) &&
-				 (_compare(Array[first + child], Array[first + child - 1]) > 0)
-			   )
-				++child;
+			int indx2;
+			// out of order
+			Array[indx] = prev_val;
+
+			for (indx2 = indx - 1; indx2 > first; --indx2)
+			{
+				item_type temp_val;
+				temp_val = Array[indx2 - 1];
+				if ( cmp(temp_val, cur_val) > 0 )
+					Array[indx2] = temp_val;
+				else
+					break;
+			}
+			Array[indx2] = cur_val;
+		}
+		else
+		{
+			// in order, advance to next element
+			prev_val = cur_val;
+		}
+	}
+}
+
+// Splits Array[first..last] (at least 3 items) around the
+// median of the first, middle and last items; returns @up
+// such that [first..up] are <= the pivot and [up+1..last]
+// are >= it, neither part being empty
+template<typename item_type> template<typename comparator>
+	int _sort_<item_type>::_partition (item_type Array[], int first, int last, comparator cmp)
+{
+	item_type pivot;
+	int med = (first + last) >> 1;
+
+	// Choose pivot from first, last, and median position.
+	// Sort the three elements.
+	if ( cmp(Array[first], Array[last]) > 0 )
+		_swap<item_type>(&Array[first], &Array[last]);
+
+	if ( cmp(Array[first], Array[med]) > 0 )
+		_swap<item_type>(&Array[med], &Array[first]);
+
+	if ( cmp(Array[med], Array[last]) > 0 )
+		_swap<item_type>(&Array[last], &Array[med]);
+
+	pivot = Array[med];
+
+	int up;
+	int down;
+	// First and last element will be loop stopper.
+	// Split array into two partitions.
+	down = first;
+	up = last;
+	for (;;)
+	{
+		do
+		{
+			++down;
+		} while ( cmp(pivot, Array[down]) > 0 );
+		// while ( down <= last && _compare(pivot, Array[down]) > 0 );
+
+		do
+		{
+			--up;
+		} while ( cmp(Array[up], pivot) > 0 );
+		// while ( up >= first && _compare(Array[up], pivot) > 0 );
+
+		if (up > down)
+			_swap<item_type>(&Array[down], &Array[up]);  // interchange L[down] and L[up]
+		else
+			break;
+	}
+
+	return up;
+}
+
+template<typename item_type> template<typename comparator>
+	void _sort_<item_type>::_heapSort (item_type Array[], int first, int cElems, comparator cmp)
+{
+	int half;
+	int parent;
+
+	if (cElems <= 1)
+		return;
+
+	half = cElems >> 1;
+	for (parent = half; parent >= 1; --parent)
+	{
+		item_type temp;
+		int level = 0;
+		int child;
+
+		child = parent;
+		// bottom-up downheap
+
+		// leaf-search for largest child path
+		while (child <= half)
+		{
+			++level;
+			child += child;
+			if ( (child < cElems) &&
+				 (cmp(Array[first + child], Array[first + child - 1]) > 0)
+			   )
+				++child;
 		}
 		// bottom-up-search for rotation point
 		temp = Array[first + parent - 1];
@@ -228,7 +935,7 @@ template<typename item_type>
 		{
 			if (parent == child)
 				break;
-			if ( _compare(temp, Array[first + child - 1]) <= 0 )
+			if ( cmp(temp, Array[first + child - 1]) <= 0 )
 				break;
 			child >>= 1;
 			--level;
@@ -263,7 +970,7 @@ template<typename item_type>
 			++level;
 			child += child;
 			if ( (child < cElems) &&
-				 (_compare(Array[first + child], Array[first + child - 1]) > 0)
+				 (cmp(Array[first + child], Array[first + child - 1]) > 0)
 			   )
 				++child;
 		}
@@ -272,7 +979,7 @@ template<typename item_type>
 		{
 			if (parent == child)
 				break;
-			if ( _compare(temp, Array[first + child - 1]) <= 0 )
+			if ( cmp(temp, Array[first + child - 1]) <= 0 )
 				break;
 			child >>= 1;
 			--level;
@@ -288,6 +995,811 @@ template<typename item_type>
 }
 
 
+template<typename item_type> template<typename comparator>
+	void _sort_<item_type>::partialSort (item_type Array[], int cElems, int k, comparator cmp)
+{
+	if( k <= 0 || cElems <= 1 )
+		return;
+	if( k >= cElems )
+	{
+		_quickSort(Array, 0, cElems - 1, cmp);
+		return;
+	}
+
+	if( k > (cElems >> 3) )
+	{
+		// large k: select, then sort what is in front
+		nthElement(Array, cElems, k - 1, cmp);
+		if(k > 1)
+			_quickSort(Array, 0, k - 2, cmp);
+		return;
+	}
+
+	// small k: keep the k first items in a max-heap at the front,
+	// one comparison with its root for each of the other items
+	int i;
+	for(i = (k >> 1) - 1; i >= 0; --i)
+		_heapSiftDown(Array, k, i, cmp);
+	for(i = k; i < cElems; ++i)
+	{
+		if( cmp(Array[i], Array[0]) < 0 )
+		{
+			_swap<item_type>(&Array[i], &Array[0]);
+			_heapSiftDown(Array, k, 0, cmp);
+		}
+	}
+	for(i = k - 1; i > 0; --i)
+	{
+		_swap<item_type>(&Array[0], &Array[i]);
+		_heapSiftDown(Array, i, 0, cmp);
+	}
+}
+
+template<typename item_type> template<typename comparator>
+	void _sort_<item_type>::nthElement (item_type Array[], int cElems, int nth, comparator cmp)
+{
+	if( nth < 0 || nth >= cElems )
+		return;
+
+	// partitions allowed before giving up on the pivots
+	int depth = 0;
+	for(int n = cElems; n > 1; n >>= 1)
+		depth += 2;
+
+	int first = 0;
+	int last = cElems - 1;
+	while( last - first > INSERTION_SORT_BOUND )
+	{
+		if( depth-- == 0 )
+		{
+			// too many bad partitions, heap sort what is left
+			_heapSort(Array, first, last - first + 1, cmp);
+			return;
+		}
+		int up = _partition(Array, first, last, cmp);
+		if( nth <= up )
+			last = up;
+		else
+			first = up + 1;
+	}
+	_quickSort(Array, first, last, cmp);
+}
+
+//------------------------------------------------------------
+// Sorts arrayCount arrays of arrayLength items each, stored
+// back to back from arrays[0] (like the rows of a matrix).
+// Small arrays of int, float and double are sorted several
+// at a time by the SSE2 networks, if the CPU has SSE2.
+template<typename item_type>
+	void _sortEachN(item_type arrays[], int arrayCount, int arrayLength)
+{
+	if(arrayLength < 2)
+		return;
+	_sort_<item_type> sorter;
+	for(int i = 0; i < arrayCount; ++i)
+		sorter.sort(arrays + i * arrayLength, arrayLength);
+}
+
+template<typename item_type>
+	void _networkSortN(item_type arrays[], int arrayCount, int arrayLength)
+{
+	_sortEachN(arrays, arrayCount, arrayLength);
+}
+
+#if SORT_NETWORK_SSE2
+// gather item j of each of the arrays into the vector lanes
+// and scatter them back
+inline void _sse2Load(__m128& v, const float* a, int stride)
+	{ v = _mm_setr_ps(a[0], a[stride], a[stride*2], a[stride*3]); }
+inline void _sse2Load(__m128d& v, const double* a, int stride)
+	{ v = _mm_setr_pd(a[0], a[stride]); }
+inline void _sse2Load(__m128i& v, const int* a, int stride)
+	{ v = _mm_setr_epi32(a[0], a[stride], a[stride*2], a[stride*3]); }
+
+inline void _sse2Store(const __m128& v, float* a, int stride)
+{
+	float lanes[4];
+	_mm_storeu_ps(lanes, v);
+	a[0] = lanes[0]; a[stride] = lanes[1]; a[stride*2] = lanes[2]; a[stride*3] = lanes[3];
+}
+inline void _sse2Store(const __m128d& v, double* a, int stride)
+{
+	double lanes[2];
+	_mm_storeu_pd(lanes, v);
+	a[0] = lanes[0]; a[stride] = lanes[1];
+}
+inline void _sse2Store(const __m128i& v, int* a, int stride)
+{
+	int lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, v);
+	a[0] = lanes[0]; a[stride] = lanes[1]; a[stride*2] = lanes[2]; a[stride*3] = lanes[3];
+}
+
+// sorts as many of the arrays as fill all the lanes, and
+// returns how many that was; arrayLength <= SORT_NETWORK_MAX
+template<typename item_type, typename vector_type>
+	int _sse2NetworkSortN(item_type arrays[], int arrayCount, int arrayLength, vector_type*)
+{
+	int const lanes = sizeof(vector_type) / sizeof(item_type);
+	vector_type v[SORT_NETWORK_MAX + 1];
+	int i;
+	for(i = 0; i + lanes <= arrayCount; i += lanes)
+	{
+		item_type* a = arrays + i * arrayLength;
+		int j;
+		for(j = 0; j < arrayLength; ++j)
+			_sse2Load(v[j], a + j, arrayLength);
+		_oddEvenMergeNetwork(v, arrayLength, _sse2_exchange_());
+		for(j = 0; j < arrayLength; ++j)
+			_sse2Store(v[j], a + j, arrayLength);
+	}
+	return i;
+}
+
+#define SORT_NETWORK_SSE2_TYPE(type, vector_type) \
+	template<> inline void _networkSortN<type>(type arrays[], int arrayCount, int arrayLength) \
+	{ \
+		int done = 0; \
+		if( arrayLength >= 2 && arrayLength <= SORT_NETWORK_MAX && _cpuHasSSE2() ) \
+			done = _sse2NetworkSortN(arrays, arrayCount, arrayLength, (vector_type*)NULL); \
+		_sortEachN(arrays + done * arrayLength, arrayCount - done, arrayLength); \
+	}
+SORT_NETWORK_SSE2_TYPE(float, __m128)
+SORT_NETWORK_SSE2_TYPE(double, __m128d)
+SORT_NETWORK_SSE2_TYPE(int, __m128i)
+#undef SORT_NETWORK_SSE2_TYPE
+#endif // SORT_NETWORK_SSE2
+
+//------------------------------------------------------------
+// _merge_sort_ implementation
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::sort ()
+{
+	if(_n < 2)
+		return;
+
+	// small arrays: one run, binary-insertion-sorted
+	if(_n < MIN_MERGE)
+	{
+		int initRunLen = _countRunAndMakeAscending(0, _n);
+		_binarySort(0, _n, initRunLen);
+		return;
+	}
+
+	int minRun = _minRunLength(_n);
+	int lo = 0;
+	int remaining = _n;
+	do
+	{
+		int runLen = _countRunAndMakeAscending(lo, _n);
+		// extend a short run to minRun items
+		if(runLen < minRun)
+		{
+			int force = (remaining <= minRun) ? remaining : minRun;
+			_binarySort(lo, lo + force, lo + runLen);
+			runLen = force;
+		}
+		_pushRun(lo, runLen);
+		_mergeCollapse();
+		lo += runLen;
+		remaining -= runLen;
+	} while(remaining != 0);
+
+	_mergeForceCollapse();
+	_freeScratch();
+}
+
+// Sorts [lo, hi) given that [lo, start) is already sorted;
+// binary search keeps the comparisons at O(n log n)
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_binarySort ( int lo, int hi, int start )
+{
+	if(start == lo)
+		++start;
+	for(; start < hi; ++start)
+	{
+		int left = lo;
+		int right = start;
+		// the pivot goes after all the items equal to it (stability)
+		while(left < right)
+		{
+			int mid = (left + right) >> 1;
+			if( _cmp(_a[start], _a[mid]) < 0 )
+				right = mid;
+			else
+				left = mid + 1;
+		}
+		if(left == start)
+			continue;
+		item_type pivot = _a[start];
+		for(int i = start; i > left; --i)
+			_a[i] = _a[i-1];
+		_a[left] = pivot;
+	}
+}
+
+// Returns the length of the run starting at lo; a strictly
+// descending run (strictly, to keep the sort stable) is
+// reversed in place
+template<typename item_type, typename comparator>
+	int _merge_sort_<item_type, comparator>::_countRunAndMakeAscending ( int lo, int hi )
+{
+	int runHi = lo + 1;
+	if(runHi == hi)
+		return 1;
+
+	if( _cmp(_a[runHi++], _a[lo]) < 0 )
+	{
+		while( runHi < hi && _cmp(_a[runHi], _a[runHi-1]) < 0 )
+			++runHi;
+		_reverseRange(lo, runHi);
+	}
+	else
+	{
+		while( runHi < hi && _cmp(_a[runHi], _a[runHi-1]) >= 0 )
+			++runHi;
+	}
+	return runHi - lo;
+}
+
+// Merges runs until the stack satisfies
+//		runLen[i-3] > runLen[i-2] + runLen[i-1]
+//		runLen[i-2] > runLen[i-1]
+// for the top runs, which keeps the run lengths growing at
+// least as fast as Fibonacci numbers down the stack
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeCollapse ()
+{
+	while(_stackSize > 1)
+	{
+		int n = _stackSize - 2;
+		if( (n > 0 && _runLen[n-1] <= _runLen[n] + _runLen[n+1]) ||
+			(n > 1 && _runLen[n-2] <= _runLen[n] + _runLen[n-1]) )
+		{
+			if(_runLen[n-1] < _runLen[n+1])
+				--n;
+		}
+		else if(_runLen[n] > _runLen[n+1])
+			break;
+		_mergeAt(n);
+	}
+}
+
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeForceCollapse ()
+{
+	while(_stackSize > 1)
+	{
+		int n = _stackSize - 2;
+		if(n > 0 && _runLen[n-1] < _runLen[n+1])
+			--n;
+		_mergeAt(n);
+	}
+}
+
+// merges stack runs i and i+1
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeAt ( int i )
+{
+	int base1 = _runBase[i];
+	int len1 = _runLen[i];
+	int len2 = _runLen[i+1];
+
+	_runLen[i] = len1 + len2;
+	if(i == _stackSize - 3)
+	{
+		_runBase[i+1] = _runBase[i+2];
+		_runLen[i+1] = _runLen[i+2];
+	}
+	--_stackSize;
+
+	_mergeRuns(base1, len1, len2);
+}
+
+// merges the adjacent sorted runs [base1, base1+len1) and [base1+len1, base1+len1+len2)
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeRuns ( int base1, int len1, int len2 )
+{
+	if(len1 == 0 || len2 == 0)
+		return;
+	int base2 = base1 + len1;
+
+	// items of run1 that are <= run2's first are already in place
+	int k = _gallopRight(_a[base2], _a, base1, len1, 0);
+	base1 += k;
+	len1 -= k;
+	if(len1 == 0)
+		return;
+
+	// items of run2 that are >= run1's last are already in place
+	len2 = _gallopLeft(_a[base1 + len1 - 1], _a, base2, len2, len2 - 1);
+	if(len2 == 0)
+		return;
+
+	// merge through the scratch buffer when the shorter run fits in it
+	int minLen = (len1 <= len2) ? len1 : len2;
+	if( minLen <= _maxScratch && _ensureScratch(minLen) )
+	{
+		if(len1 <= len2)
+			_mergeLo(base1, len1, base2, len2);
+		else
+			_mergeHi(base1, len1, base2, len2);
+		return;
+	}
+
+	// otherwise cut the longer run in half, find the matching cut
+	// in the other one, rotate the middle pieces into place and
+	// merge the two halves separately
+	int cut1, cut2;
+	if(len1 >= len2)
+	{
+		cut1 = len1 >> 1;
+		cut2 = _gallopLeft(_a[base1 + cut1], _a, base2, len2, 0);
+	}
+	else
+	{
+		cut2 = len2 >> 1;
+		cut1 = _gallopRight(_a[base2 + cut2], _a, base1, len1, 0);
+	}
+	_rotate(base1 + cut1, len1 - cut1, cut2);
+	_mergeRuns(base1, cut1, cut2);
+	_mergeRuns(base1 + cut1 + cut2, len1 - cut1, len2 - cut2);
+}
+
+// Finds where to insert key into the sorted arr[base, base+len):
+// before all items equal to it. The search starts at base+hint
+// and gallops from there.
+template<typename item_type, typename comparator>
+	int _merge_sort_<item_type, comparator>::_gallopLeft ( const item_type& key,
+														   const item_type* arr,
+														   int base, int len, int hint )
+{
+	int lastOfs = 0;
+	int ofs = 1;
+	int maxOfs;
+	if( _cmp(key, arr[base + hint]) > 0 )
+	{
+		// gallop right until arr[base+hint+lastOfs] < key <= arr[base+hint+ofs]
+		maxOfs = len - hint;
+		while( ofs < maxOfs && _cmp(key, arr[base + hint + ofs]) > 0 )
+		{
+			lastOfs = ofs;
+			ofs = (ofs << 1) + 1;
+			if(ofs <= 0)	// overflow
+				ofs = maxOfs;
+		}
+		if(ofs > maxOfs)
+			ofs = maxOfs;
+		lastOfs += hint;
+		ofs += hint;
+	}
+	else
+	{
+		// gallop left until arr[base+hint-ofs] < key <= arr[base+hint-lastOfs]
+		maxOfs = hint + 1;
+		while( ofs < maxOfs && _cmp(key, arr[base + hint - ofs]) <= 0 )
+		{
+			lastOfs = ofs;
+			ofs = (ofs << 1) + 1;
+			if(ofs <= 0)
+				ofs = maxOfs;
+		}
+		if(ofs > maxOfs)
+			ofs = maxOfs;
+		int t = lastOfs;
+		lastOfs = hint - ofs;
+		ofs = hint - t;
+	}
+
+	// binary search in arr[base+lastOfs+1, base+ofs)
+	++lastOfs;
+	while(lastOfs < ofs)
+	{
+		int m = lastOfs + ((ofs - lastOfs) >> 1);
+		if( _cmp(key, arr[base + m]) > 0 )
+			lastOfs = m + 1;
+		else
+			ofs = m;
+	}
+	return ofs;
+}
+
+// Like _gallopLeft, but finds the position after all items equal to key
+template<typename item_type, typename comparator>
+	int _merge_sort_<item_type, comparator>::_gallopRight ( const item_type& key,
+															const item_type* arr,
+															int base, int len, int hint )
+{
+	int lastOfs = 0;
+	int ofs = 1;
+	int maxOfs;
+	if( _cmp(key, arr[base + hint]) < 0 )
+	{
+		// gallop left until arr[base+hint-ofs] <= key < arr[base+hint-lastOfs]
+		maxOfs = hint + 1;
+		while( ofs < maxOfs && _cmp(key, arr[base + hint - ofs]) < 0 )
+		{
+			lastOfs = ofs;
+			ofs = (ofs << 1) + 1;
+			if(ofs <= 0)
+				ofs = maxOfs;
+		}
+		if(ofs > maxOfs)
+			ofs = maxOfs;
+		int t = lastOfs;
+		lastOfs = hint - ofs;
+		ofs = hint - t;
+	}
+	else
+	{
+		// gallop right until arr[base+hint+lastOfs] <= key < arr[base+hint+ofs]
+		maxOfs = len - hint;
+		while( ofs < maxOfs && _cmp(key, arr[base + hint + ofs]) >= 0 )
+		{
+			lastOfs = ofs;
+			ofs = (ofs << 1) + 1;
+			if(ofs <= 0)
+				ofs = maxOfs;
+		}
+		if(ofs > maxOfs)
+			ofs = maxOfs;
+		lastOfs += hint;
+		ofs += hint;
+	}
+
+	++lastOfs;
+	while(lastOfs < ofs)
+	{
+		int m = lastOfs + ((ofs - lastOfs) >> 1);
+		if( _cmp(key, arr[base + m]) < 0 )
+			ofs = m;
+		else
+			lastOfs = m + 1;
+	}
+	return ofs;
+}
+
+// Merges two runs, copying the first (shorter) one to scratch.
+// Run1's first item is > run2's first, and its last one is
+// > all of run2 (_mergeRuns has trimmed them that way).
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeLo ( int base1, int len1, int base2, int len2 )
+{
+	_copyN<item_type>(_tmp, &_a[base1], len1);
+
+	int cursor1 = 0;		// in _tmp
+	int cursor2 = base2;	// in _a
+	int dest = base1;		// in _a
+
+	_a[dest++] = _a[cursor2++];
+	if(--len2 == 0)
+	{
+		_copyN<item_type>(&_a[dest], &_tmp[cursor1], len1);
+		return;
+	}
+	if(len1 == 1)
+	{
+		_copyN<item_type>(&_a[dest], &_a[cursor2], len2);
+		_a[dest + len2] = _tmp[cursor1];
+		return;
+	}
+
+	int minGallop = _minGallop;
+	for(;;)
+	{
+		int count1 = 0;	// number of times in a row that run1 won
+		int count2 = 0;	// number of times in a row that run2 won
+
+		// one item at a time until one run starts winning consistently
+		do
+		{
+			if( _cmp(_a[cursor2], _tmp[cursor1]) < 0 )
+			{
+				_a[dest++] = _a[cursor2++];
+				++count2;
+				count1 = 0;
+				if(--len2 == 0)
+					goto done;
+			}
+			else
+			{
+				_a[dest++] = _tmp[cursor1++];
+				++count1;
+				count2 = 0;
+				if(--len1 == 1)
+					goto done;
+			}
+		} while( (count1 | count2) < minGallop );
+
+		// gallop while that keeps paying off
+		do
+		{
+			count1 = _gallopRight(_a[cursor2], _tmp, cursor1, len1, 0);
+			if(count1 != 0)
+			{
+				_copyN<item_type>(&_a[dest], &_tmp[cursor1], count1);
+				dest += count1;
+				cursor1 += count1;
+				len1 -= count1;
+				if(len1 <= 1)
+					goto done;
+			}
+			_a[dest++] = _a[cursor2++];
+			if(--len2 == 0)
+				goto done;
+
+			count2 = _gallopLeft(_tmp[cursor1], _a, cursor2, len2, 0);
+			if(count2 != 0)
+			{
+				_copyN<item_type>(&_a[dest], &_a[cursor2], count2);
+				dest += count2;
+				cursor2 += count2;
+				len2 -= count2;
+				if(len2 == 0)
+					goto done;
+			}
+			_a[dest++] = _tmp[cursor1++];
+			if(--len1 == 1)
+				goto done;
+			--minGallop;
+		} while( count1 >= MIN_GALLOP || count2 >= MIN_GALLOP );
+
+		// penalize leaving gallop mode
+		if(minGallop < 0)
+			minGallop = 0;
+		minGallop += 2;
+	}
+
+done:
+	_minGallop = (minGallop < 1) ? 1 : minGallop;
+	if(len1 == 1)
+	{
+		_copyN<item_type>(&_a[dest], &_a[cursor2], len2);
+		_a[dest + len2] = _tmp[cursor1];	// run1's last item goes last
+	}
+	else if(len1 > 0)
+		_copyN<item_type>(&_a[dest], &_tmp[cursor1], len1);
+	// len1 == 0 only happens with an inconsistent comparator
+}
+
+// Like _mergeLo, but copies the second (shorter) run to scratch
+// and merges from the end
+template<typename item_type, typename comparator>
+	void _merge_sort_<item_type, comparator>::_mergeHi ( int base1, int len1, int base2, int len2 )
+{
+	_copyN<item_type>(_tmp, &_a[base2], len2);
+
+	int cursor1 = base1 + len1 - 1;	// in _a
+	int cursor2 = len2 - 1;			// in _tmp
+	int dest = base2 + len2 - 1;	// in _a
+
+	_a[dest--] = _a[cursor1--];
+	if(--len1 == 0)
+	{
+		_copyN<item_type>(&_a[dest - (len2 - 1)], _tmp, len2);
+		return;
+	}
+	if(len2 == 1)
+	{
+		dest -= len1;
+		cursor1 -= len1;
+		_reverseCopyN<item_type>(&_a[dest + 1], &_a[cursor1 + 1], len1);
+		_a[dest] = _tmp[cursor2];
+		return;
+	}
+
+	int minGallop = _minGallop;
+	for(;;)
+	{
+		int count1 = 0;
+		int count2 = 0;
+
+		do
+		{
+			if( _cmp(_tmp[cursor2], _a[cursor1]) < 0 )
+			{
+				_a[dest--] = _a[cursor1--];
+				++count1;
+				count2 = 0;
+				if(--len1 == 0)
+					goto done;
+			}
+			else
+			{
+				_a[dest--] = _tmp[cursor2--];
+				++count2;
+				count1 = 0;
+				if(--len2 == 1)
+					goto done;
+			}
+		} while( (count1 | count2) < minGallop );
+
+		do
+		{
+			count1 = len1 - _gallopRight(_tmp[cursor2], _a, base1, len1, len1 - 1);
+			if(count1 != 0)
+			{
+				dest -= count1;
+				cursor1 -= count1;
+				len1 -= count1;
+				_reverseCopyN<item_type>(&_a[dest + 1], &_a[cursor1 + 1], count1);
+				if(len1 == 0)
+					goto done;
+			}
+			_a[dest--] = _tmp[cursor2--];
+			if(--len2 == 1)
+				goto done;
+
+			count2 = len2 - _gallopLeft(_a[cursor1], _tmp, 0, len2, len2 - 1);
+			if(count2 != 0)
+			{
+				dest -= count2;
+				cursor2 -= count2;
+				len2 -= count2;
+				_copyN<item_type>(&_a[dest + 1], &_tmp[cursor2 + 1], count2);
+				if(len2 <= 1)
+					goto done;
+			}
+			_a[dest--] = _a[cursor1--];
+			if(--len1 == 0)
+				goto done;
+			--minGallop;
+		} while( count1 >= MIN_GALLOP || count2 >= MIN_GALLOP );
+
+		if(minGallop < 0)
+			minGallop = 0;
+		minGallop += 2;
+	}
+
+done:
+	_minGallop = (minGallop < 1) ? 1 : minGallop;
+	if(len2 == 1)
+	{
+		dest -= len1;
+		cursor1 -= len1;
+		_reverseCopyN<item_type>(&_a[dest + 1], &_a[cursor1 + 1], len1);
+		_a[dest] = _tmp[cursor2];	// run2's first item goes first
+	}
+	else if(len2 > 0)
+		_copyN<item_type>(&_a[dest - (len2 - 1)], _tmp, len2);
+}
+
+// Grows the scratch buffer to hold at least len items
+template<typename item_type, typename comparator>
+	bool _merge_sort_<item_type, comparator>::_ensureScratch ( int len )
+{
+	if(_tmpLen >= len)
+		return true;
+
+	// grow geometrically, but never past half the array or the limit
+	int newLen = (_tmpLen > 0) ? _tmpLen : 256;
+	while(newLen < len && newLen <= (MAX_INT >> 1))
+		newLen <<= 1;
+	if(newLen > (_n >> 1))
+		newLen = (_n >> 1) + 1;
+	if(newLen > _maxScratch)
+		newLen = _maxScratch;
+	if(newLen < len)
+		newLen = len;
+
+	_freeScratch();
+	_tmp = (item_type*) malloc(newLen*sizeof(item_type));
+	if(_tmp == NULL)
+		return false;
+	_createN<item_type>(_tmp, newLen);
+	_tmpLen = newLen;
+	return true;
+}
+
+
+//------------------------------------------------------------
+// MSD radix (American flag) sort for byte strings.
+// The item type hands out its bytes through an overload of
+//		LPCSTR _radixKeyBytes(const item_type&, int* pLen);
+// (see _string_.h and _cstring_.h) and has to order itself
+// the way memcmp() does: unsigned bytes, a proper prefix
+// sorting before the longer string.
+// Bucket 0 holds the strings that end before @depth;
+// byte value b goes to bucket b+1.
+template<typename item_type>
+	inline int _radixByteAt(const item_type& item, int depth)
+{
+	int len;
+	LPCSTR p = _radixKeyBytes(item, &len);
+	return (depth < len) ? ((byte)p[depth] + 1) : 0;
+}
+
+// compares two items that are known to be equal up to @depth
+template<typename item_type>
+	int _radixCompareFrom(const item_type& a, const item_type& b, int depth)
+{
+	int alen, blen;
+	LPCSTR pa = _radixKeyBytes(a, &alen);
+	LPCSTR pb = _radixKeyBytes(b, &blen);
+	int len = ((alen < blen) ? alen : blen) - depth;
+	int result = (len > 0) ? memcmp(pa + depth, pb + depth, len) : 0;
+	if(result != 0) return result;
+	return (alen == blen) ? 0 : ((alen > blen) ? 1 : -1);
+}
+
+template<typename item_type>
+	void _msdRadixSort(item_type Array[], int cElems, int depth = 0, int level = 0)
+{
+	int count[257];
+	int next[257];
+	int i, b;
+
+	for(;;)
+	{
+		if(cElems <= MSD_INSERTION_SORT_BOUND)
+		{
+			for(i=1; i<cElems; i++)
+			{
+				if( _radixCompareFrom(Array[i-1], Array[i], depth) <= 0 )
+					continue;
+				item_type cur_val = Array[i];
+				int j = i;
+				do
+				{
+					Array[j] = Array[j-1];
+				} while( --j > 0 && _radixCompareFrom(Array[j-1], cur_val, depth) > 0 );
+				Array[j] = cur_val;
+			}
+			return;
+		}
+		if(level >= MSD_MAX_SPLIT_LEVEL)
+		{
+			_sort_<item_type> sorter(MSD_INSERTION_SORT_BOUND, -1);
+			sorter.sort(Array, cElems);
+			return;
+		}
+
+		memset(count, 0, sizeof(count));
+		for(i=0; i<cElems; i++)
+			count[_radixByteAt(Array[i], depth)]++;
+
+		// a common prefix byte: nothing to permute, look at the next one
+		b = _radixByteAt(Array[0], depth);
+		if(count[b] < cElems)
+			break;
+		if(b == 0)
+			return;  // all strings ended, so they are equal
+		++depth;
+	}
+
+	// bucket starts go to next[], bucket ends replace the counts
+	int offset = 0;
+	for(b=0; b<257; b++)
+	{
+		next[b] = offset;
+		offset += count[b];
+		count[b] = offset;
+	}
+	// permute in place: keep swapping the item at the head of
+	// bucket b into its own bucket until one that belongs in b
+	// shows up there
+	for(b=0; b<257; b++)
+	{
+		while(next[b] < count[b])
+		{
+			int v = _radixByteAt(Array[next[b]], depth);
+			if(v == b)
+				++next[b];
+			else
+				_swap<item_type>(&Array[next[b]], &Array[next[v]++]);
+		}
+	}
+
+	// bucket 0 (ended strings) is all equal; sort the rest on the next byte
+	for(b=1; b<257; b++)
+	{
+		int first = count[b-1];
+		if(count[b] - first > 1)
+			_msdRadixSort(&Array[first], count[b] - first, depth + 1, level + 1);
+	}
+}
+
+
 };	// namespace soige
 
 #endif // __sort_already_included_vasya__
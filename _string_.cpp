@@ -4,10 +4,13 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include "_string_.h"
+#include "_num_conv_.h"
 
 namespace soige {
 
 const int _string_::string_rep::UNSHAREABLE = 0x80000000;
+const int _string_::string_rep::LOCAL = 0x40000000;
+const int _string_::string_rep::INTERNED = 0x20000000;
 _string_::string_rep _string_::_null_rep;
 
 //------------------------------------------------
@@ -25,7 +28,8 @@ _string_::_string_(const _string_& refstr)
 
 _string_::_string_(LPCSTR lpstr)
 {
-	_attach( lpstr? new string_rep(lpstr) : &_null_rep );
+	if( lpstr ) _assign( lpstr, lstrlenA(lpstr) );
+	else		_attach( &_null_rep );
 }
 
 _string_::_string_(LPCWSTR lpwstr)
@@ -35,11 +39,10 @@ _string_::_string_(LPCWSTR lpwstr)
 	}
 
 	int wlen = lstrlenW(lpwstr);
-	string_rep* rep = new string_rep();
-	if( !rep || !rep->ensureLen(wlen+1) ) {
-		delete rep; _attach( &_null_rep ); return;
+	_assign( "", 0 );
+	if( !_ensureLen(wlen+1) ) {
+		clear(); return;
 	}
-	_attach(rep);
 	wcstombs( _rep->_p, lpwstr, wlen + 1 );
 	_rep->len() = wlen;
 }
@@ -51,11 +54,10 @@ _string_::_string_(char chr, int count)
 	}
 
 	int cch = count + 1;
-	string_rep* rep = new string_rep();
-	if( !rep || !rep->ensureLen(cch) ) {
-		delete rep; _attach( &_null_rep ); return;
+	_assign( "", 0 );
+	if( !_ensureLen(cch) ) {
+		clear(); return;
 	}
-	_attach(rep);
 	//_strnset(_p, chr, count); doesn't work, have to do it manually
 	cch = 0;
 	while( _rep->_p[cch] = chr, ++cch < count ) ;
@@ -64,16 +66,20 @@ _string_::_string_(char chr, int count)
 
 _string_::_string_(long val)
 {
-	char buf[32];
-	_ltoa(val, buf, 10);
-	_attach( new string_rep(buf) );
+	char buf[NUM_CONV_CHARS];
+	_assign( buf, _formatLong(val, buf) );
 }
 
 _string_::_string_(double val)
 {
-	char buf[64];
-	_gcvt(val, 16, buf);
-	_attach( new string_rep(buf) );
+	char buf[NUM_CONV_CHARS];
+	_assign( buf, _formatDouble(val, buf) );
+}
+
+_string_::_string_(const _string_view_& view)
+{
+	if( view.isNull() ) _attach( &_null_rep );
+	else				_assign( view.data(), view.length() );
 }
 
 _string_::~_string_()
@@ -92,7 +98,8 @@ _string_& _string_::operator=(const _string_& refstr)
 
 _string_& _string_::operator=(LPCSTR lpstr)
 {
-	_reattach( lpstr? new string_rep(lpstr) : &_null_rep );
+	if( lpstr ) _reassign( lpstr, lstrlenA(lpstr) );
+	else		_reattach( &_null_rep );
 	return *this;
 }
 
@@ -102,32 +109,37 @@ _string_& _string_::operator=(LPCWSTR lpwstr)
 
 	_ensureUnique();
 	int wlen = lstrlenW(lpwstr);
-	if( !_rep->ensureLen( wlen+1 ) ) return *this;
+	if( !_ensureLen( wlen+1 ) ) return *this;
 	wcstombs( _rep->_p, lpwstr, wlen + 1 );
 	_rep->len() = wlen;
 	return *this;
 }
 
+_string_& _string_::operator=(const _string_view_& view)
+{
+	if( view.isNull() ) _reattach( &_null_rep );
+	else				_reassign( view.data(), view.length() );
+	return *this;
+}
+
 _string_& _string_::operator=(char chr)
 {
 	char buf[] = { chr, 0 };
-	_reattach( new string_rep(buf) );
+	_reassign( buf, lstrlenA(buf) );
 	return *this;
 }
 
 _string_& _string_::operator=(long val)
 {
-	char buf[32];
-	_ltoa(val, buf, 10);
-	_reattach( new string_rep(buf) );
+	char buf[NUM_CONV_CHARS];
+	_reassign( buf, _formatLong(val, buf) );
 	return *this;
 }
 
 _string_& _string_::operator=(double val)
 {
-	char buf[64];
-	_gcvt(val, 16, buf);
-	_reattach( new string_rep(buf) );
+	char buf[NUM_CONV_CHARS];
+	_reassign( buf, _formatDouble(val, buf) );
 	return *this;
 }
 
@@ -136,7 +148,7 @@ _string_& _string_::operator+=(const _string_& refstr)
 	if( refstr._rep->len() <= 0 ) return *this;
 	
 	_ensureUnique();
-	if( !_rep->ensureLen( _rep->len() + refstr._rep->len() + 1 ) ) return *this;
+	if( !_ensureLen( _rep->len() + refstr._rep->len() + 1 ) ) return *this;
 	memmove ( _rep->end(), refstr._rep->_p, refstr._rep->len() + 1 );
 	_rep->len() += refstr._rep->len();
 	return *this;
@@ -145,10 +157,13 @@ _string_& _string_::operator+=(const _string_& refstr)
 _string_& _string_::operator+=(LPCSTR lpstr)
 {
 	if( !lpstr || !lpstr[0] ) return *this;
+	// lpstr can be in this string, which is about to move
+	if( lpstr >= _rep->_p && lpstr < _rep->_p + _rep->allocLen() )
+		return this->operator+=( _string_(lpstr) );
 	
 	_ensureUnique();
 	int addsize = lstrlenA(lpstr);
-	if( !_rep->ensureLen( _rep->len() + addsize + 1 ) ) return *this;
+	if( !_ensureLen( _rep->len() + addsize + 1 ) ) return *this;
 	memmove ( _rep->end(), lpstr, addsize + 1 );
 	_rep->len() += addsize;
 	return *this;
@@ -160,16 +175,31 @@ _string_& _string_::operator+=(LPCWSTR lpwstr)
 	
 	_ensureUnique();
 	int wlen = lstrlenW(lpwstr);
-	if( !_rep->ensureLen( _rep->len() + wlen + 1 ) ) return *this;
+	if( !_ensureLen( _rep->len() + wlen + 1 ) ) return *this;
 	wcstombs( _rep->end(), lpwstr, wlen+1 );
 	_rep->len() += wlen;
 	return *this;
 }
 
+_string_& _string_::operator+=(const _string_view_& view)
+{
+	if( view.length() <= 0 ) return *this;
+	// the view can be of this string
+	if( view.data() >= _rep->_p && view.data() < _rep->_p + _rep->allocLen() )
+		return this->operator+=( _string_(view) );
+
+	_ensureUnique();
+	if( !_ensureLen( _rep->len() + view.length() + 1 ) ) return *this;
+	memcpy ( _rep->end(), view.data(), view.length() );
+	_rep->len() += view.length();
+	_rep->_p[_rep->len()] = '\0';
+	return *this;
+}
+
 _string_& _string_::operator+=(char chr)
 {
 	_ensureUnique();
-	if( !_rep->ensureLen( _rep->len() + 1 ) ) return *this;
+	if( !_ensureLen( _rep->len() + 2 ) ) return *this;
 	_rep->_p[_rep->len()++] = chr;
 	_rep->_p[_rep->len()] = '\0';
 	return *this;
@@ -177,15 +207,15 @@ _string_& _string_::operator+=(char chr)
 
 _string_& _string_::operator+=(long val)
 {
-	char buf[32];
-	_ltoa(val, buf, 10);
+	char buf[NUM_CONV_CHARS];
+	_formatLong(val, buf);
 	return this->operator += ( buf );
 }
 
 _string_& _string_::operator+=(double val)
 {
-	char buf[64];
-	_gcvt(val, 16, buf);
+	char buf[NUM_CONV_CHARS];
+	_formatDouble(val, buf);
 	return this->operator += ( buf );
 }
 
@@ -204,6 +234,11 @@ _string_& _string_::append(LPCWSTR lpwstr)
 	return this->operator+=(lpwstr);
 }
 
+_string_& _string_::append(const _string_view_& view)
+{
+	return this->operator+=(view);
+}
+
 _string_& _string_::append(char chr)
 {
 	return this->operator+=(chr);
@@ -228,10 +263,13 @@ bool _string_::operator!() const
 // comparison operators are case-sensitive
 bool _string_::operator==(const _string_& refstr) const
 {
-	if( (_rep == refstr._rep) ||
-		(_rep->len() == refstr._rep->len() && memcmp( _rep->_p, refstr._rep->_p, _rep->len() ) == 0) )
+	if( _rep == refstr._rep )
 		return true;
-	return false;
+	// interned strings with different hashes can't be equal
+	if( _rep->isInterned() && refstr._rep->isInterned() &&
+		_rep->internedHash() != refstr._rep->internedHash() )
+		return false;
+	return ( _rep->len() == refstr._rep->len() && _compareChars( _rep->_p, refstr._rep->_p, _rep->len(), true ) == 0 );
 }
 
 bool _string_::operator==(LPCSTR lpstr) const
@@ -249,6 +287,16 @@ bool _string_::operator!=(LPCSTR lpstr) const
 	return ( compare(lpstr, false) != 0 );
 }
 
+bool _string_::operator==(const _string_view_& view) const
+{
+	return ( view.length() == _rep->len() && _compareChars( _rep->_p, view.data(), view.length(), true ) == 0 );
+}
+
+bool _string_::operator!=(const _string_view_& view) const
+{
+	return !( this->operator==(view) );
+}
+
 bool _string_::operator<(const _string_& refstr) const
 {
 	return ( compare(refstr) < 0 );
@@ -264,15 +312,10 @@ int _string_::compare(const _string_& refstr, bool case_sensitive) const
 	if( (_rep == refstr._rep) || (!_rep->_p && !refstr._rep->_p) )
 		return 0;
 
-	int result;
 	// one or both strings may have embedded NULL chars in them,
 	// so can't use strcmp to compare
-	if(case_sensitive)
-		result = memcmp ( _rep->_p, refstr._rep->_p,
-						  min(_rep->len(), refstr._rep->len()) );
-	else
-		result = memicmp( _rep->_p, refstr._rep->_p,
-						  min(_rep->len(), refstr._rep->len()) );
+	int result = _compareChars( _rep->_p, refstr._rep->_p,
+								min(_rep->len(), refstr._rep->len()), case_sensitive );
 	
 	if(result == 0)
 		return ( (_rep->len() == refstr._rep->len()) ?
@@ -288,13 +331,19 @@ int _string_::compare(LPCSTR lpstr, bool case_sensitive) const
 	else				return lstrcmpiA(_rep->_p, lpstr);
 }
 
+int _string_::compare(const _string_view_& view, bool case_sensitive) const
+{
+	if( !_rep->_p && view.isNull() )
+		return 0;
+	return this->view().compare( view, case_sensitive );
+}
+
 bool _string_::startsWith(LPCSTR lpstr, bool case_sensitive) const
 {
 	int len = lstrlenA(lpstr);
 	if( len > _rep->len() ) return false;
 
-	if(case_sensitive)	return memcmp ( _rep->_p, lpstr, len ) == 0;
-	else				return memicmp( _rep->_p, lpstr, len ) == 0;
+	return _compareChars( _rep->_p, lpstr, len, case_sensitive ) == 0;
 }
 
 bool _string_::endsWith(LPCSTR lpstr, bool case_sensitive) const
@@ -302,8 +351,17 @@ bool _string_::endsWith(LPCSTR lpstr, bool case_sensitive) const
 	int len = lstrlenA(lpstr);
 	if( len > _rep->len() ) return false;
 
-	if(case_sensitive)	return memcmp ( &_rep->_p[_rep->len()-len], lpstr, len ) == 0;
-	else				return memicmp( &_rep->_p[_rep->len()-len], lpstr, len ) == 0;
+	return _compareChars( &_rep->_p[_rep->len()-len], lpstr, len, case_sensitive ) == 0;
+}
+
+bool _string_::startsWith(const _string_view_& view, bool case_sensitive) const
+{
+	return this->view().startsWith( view, case_sensitive );
+}
+
+bool _string_::endsWith(const _string_view_& view, bool case_sensitive) const
+{
+	return this->view().endsWith( view, case_sensitive );
 }
 
 int _string_::find(const _string_& refstr, int start, bool case_sensitive) const
@@ -313,31 +371,8 @@ int _string_::find(const _string_& refstr, int start, bool case_sensitive) const
 	if( refstr._rep->len() == 0 )
 		return start;
 
-	int i;
-	int until = _rep->len() - refstr._rep->len();
-
-	for(; start <= until; start++)
-	{
-		if(
-			(_rep->_p[start] == refstr._rep->_p[0] ) ||
-			(!case_sensitive && tolower(_rep->_p[start]) == tolower(refstr._rep->_p[0]))
-		  )
-		{
-			i = 0;
-			while(i < refstr._rep->len())
-			{
-				if(
-					(_rep->_p[start+i] == refstr._rep->_p[i] ) ||
-					(!case_sensitive && tolower(_rep->_p[start+i]) == tolower(refstr._rep->_p[i]))
-				  )
-					i++;
-				else break;
-			}
-			if( i == refstr._rep->len() ) return start; // reached the end and matched so far - full match
-		}
-	}
-
-	return -1;
+	return _findChars( _rep->_p, _rep->len(), refstr._rep->_p, refstr._rep->len(),
+					   start, case_sensitive );
 }
 
 // If you feel really ambitious and don't care about weight,
@@ -348,32 +383,14 @@ int _string_::find(LPCSTR lpstr, int start, bool case_sensitive) const
 	if( !lpstr[0] ) return start;
 	int slen = lstrlenA(lpstr);
 	if( slen > _rep->len() ) return -1;
-	int i;
-	int until = _rep->len() - slen;
-
 	// there can be embedded NULL chars in this->_p, so can't just use strstr
-	for(; start <= until; start++)
-	{
-		if(
-			(_rep->_p[start] == lpstr[0] ) ||
-			(!case_sensitive && tolower(_rep->_p[start]) == tolower(lpstr[0]))
-		  )
-		{
-			i = 0;
-			while(i < slen)
-			{
-				if(
-					(_rep->_p[start+i] == lpstr[i] ) ||
-					(!case_sensitive && tolower(_rep->_p[start+i]) == tolower(lpstr[i]))
-				  )
-					i++;
-				else break;
-			}
-			if( i == slen ) return start; // reached the end and matched so far - full match
-		}
-	}
+	return _findChars( _rep->_p, _rep->len(), lpstr, slen, start, case_sensitive );
+}
 
-	return -1;
+int _string_::find(const _string_view_& view, int start, bool case_sensitive) const
+{
+	if( start < 0 || start >= _rep->len() ) return -1;
+	return this->view().find( view, start, case_sensitive );
 }
 
 // The arg @start is from the beginning of the string, not from the end.
@@ -384,14 +401,13 @@ int _string_::findReverse(LPCSTR lpstr, int start, bool case_sensitive) const
 	if( !lpstr[0] ) return _rep->len() - 1;
 
 	if( start >= _rep->len() ) start = _rep->len() - 1;
-	int match_pos = -1;
-	while(start >= 0)
-	{
-		if( (match_pos = find(lpstr, start, case_sensitive)) >= 0 )
-			return match_pos;
-		start--;
-	}
-	return -1;
+	// a match at or after start comes first, as it always has;
+	// then the last one before it
+	int slen = lstrlenA(lpstr);
+	int match_pos = find(lpstr, start, case_sensitive);
+	if( match_pos >= 0 )
+		return match_pos;
+	return _findCharsReverse( _rep->_p, _rep->len(), lpstr, slen, start - 1, case_sensitive );
 }
 
 // Stolen almost entirely from Mark [Russinovich] and
@@ -421,7 +437,7 @@ _string_ _string_::substring(int start, int count) const
 	int chars_to_copy = (count > _rep->len() - start) ? (_rep->len() - start) : count;
 	
 	_string_ newstr;
-	newstr._reattach( new string_rep( _rep->_p + start, chars_to_copy ) );
+	newstr._reassign( _rep->_p + start, chars_to_copy );
 	return newstr;
 }
 
@@ -435,6 +451,11 @@ _string_ _string_::right(int count) const
 	return substring(_rep->len() - count, count);
 }
 
+_string_view_ _string_::view(int start, int count) const
+{
+	return this->view().substring( start, count );
+}
+
 // The following two are defined inline in the .H file
 // bool _string_::isNull() const
 // int _string_::length() const
@@ -447,40 +468,52 @@ int _string_::capacity() const
 bool _string_::isNumeric() const
 {
 	if( _rep->len() <= 0 ) return false;
-	
-	char* p = _rep->_p;
-	while( isspace(*p) ) p++;
-	if(*p == '-' || *p == '+') p++;
-	if(*p == '.') p++;
-	if(*p == 'd' || *p == 'D' || *p == 'e' || *p == 'E') p++;
-	if(*p == '-' || *p == '+') p++;
-	if( (p >= _rep->_p + _rep->len()) || (*p != '0' && strtod(_rep->_p, NULL) == 0) )
-		return false;
-	return true;
+
+	const char* p = _rep->_p;
+	const char* end = p + _rep->len();
+	// a number starts here, after any blanks
+	while( p < end && isspace((unsigned char)*p) ) p++;
+	if( p < end && (*p == '-' || *p == '+') ) p++;
+	if( p < end && *p == '.' ) p++;
+	return ( p < end && *p >= '0' && *p <= '9' );
 }
 
 long _string_::longVal() const
 {
-	if( _rep->len() <= 0 ) return 0;
-	return atol(_rep->_p);
+	long val;
+	_parseLong( _rep->_p, _rep->len(), &val );
+	return val;
 }
 
 double _string_::doubleVal() const
 {
-	if( _rep->len() <= 0 ) return 0.0;
-	return strtod(_rep->_p, NULL);
+	double val;
+	_parseDouble( _rep->_p, _rep->len(), &val );
+	return val;
 }
 
 void _string_::swap(_string_& refstr)
 {
+	if( this == &refstr ) return;
 	bool refstr_shareable  = refstr._rep->isShareable();
 	bool thisstr_shareable = _rep->isShareable();
+	if( _rep->isLocal() || refstr._rep->isLocal() )
+	{
+		// a local string's chars can't change hands, they're copied
+		_string_ temp;
+		temp._moveFrom( *this );
+		_moveFrom( refstr );
+		refstr._moveFrom( temp );
+		_keepShareable( thisstr_shareable );
+		refstr._keepShareable( refstr_shareable );
+		return;
+	}
 	string_rep* temp_rep = _rep;
 	_rep = refstr._rep;
 	refstr._rep = temp_rep;
 	// the quality of being unshareable always stays with the string
-	if( refstr_shareable ) refstr._rep->markShareable(); else refstr._rep->markUnshareable();
-	if( thisstr_shareable ) this->_rep->markShareable(); else this->_rep->markUnshareable();
+	_keepShareable( thisstr_shareable );
+	refstr._keepShareable( refstr_shareable );
 }
 
 void _string_::clear()
@@ -563,7 +596,7 @@ _string_& _string_::padLeft(int total_length, char char_to_pad)
 	if( total_length <= _rep->len() ) return *this;
 
 	_ensureUnique();
-	if( !_rep->ensureLen(total_length + 1) ) return *this;
+	if( !_ensureLen(total_length + 1) ) return *this;
 	memmove( &_rep->_p[total_length - _rep->len()], _rep->_p, _rep->len() + 1 );
 	int chars = total_length - _rep->len() - 1;
 	while ( _rep->_p[chars] = char_to_pad, --chars >= 0 ) ;
@@ -576,7 +609,7 @@ _string_& _string_::padRight(int total_length, char char_to_pad)
 	if( total_length <= _rep->len() ) return *this;
 	
 	_ensureUnique();
-	if( !_rep->ensureLen(total_length + 1) ) return *this;
+	if( !_ensureLen(total_length + 1) ) return *this;
 	while ( _rep->_p[_rep->len()] = char_to_pad, ++(_rep->len()) < total_length ) ;
 	_rep->_p[_rep->len()] = '\0';
 	return *this;
@@ -659,7 +692,7 @@ _string_& _string_::replaceBytes(const void* pdata, int byte_count, int start, i
 	if( start + bytes_to_del > _rep->len() )
 		bytes_to_del = _rep->len() - start;
 	int newlen = _rep->len() + byte_count - bytes_to_del;
-	if( !_rep->ensureLen(newlen) ) return *this;
+	if( !_ensureLen(newlen + 1) ) return *this;
 	memmove ( &_rep->_p[start + byte_count],
 			  &_rep->_p[start + bytes_to_del],
 			  _rep->len() - start - bytes_to_del );
@@ -716,7 +749,7 @@ _string_& _string_::format(LPCSTR format_spec, ...)
 	result._ensureUnique();
 	
 #if defined(_USE_NO_CRT) && !defined(_DEBUG) && !defined(DEBUG)
-	if( !result._rep->ensureLen( 8192 ) )  // hopefully is enough
+	if( !result._ensureLen( 8192 ) )  // hopefully is enough
 	{
 		va_end(args);
 		return *this;
@@ -729,14 +762,14 @@ _string_& _string_::format(LPCSTR format_spec, ...)
 		return *this;
 	}
 	// compact
-	result._rep->ensureLen( cch+1 );
+	result._ensureLen( cch+1 );
 #else
 	// try increasing buffer size until all args are written
 	int size = 16;
 	do
 	{
 		size += 32;
-		if( !result._rep->ensureLen(size) ) break;
+		if( !result._ensureLen(size) ) break;
 	} while ( (cch = _vsnprintf(result._rep->_p, size, format_spec, args)) < 0 );
 #endif
 
@@ -747,6 +780,78 @@ _string_& _string_::format(LPCSTR format_spec, ...)
 	return *this;
 }
 
+// the type-safe format()s, which write the text once into a
+// buffer on the stack, and only if it doesn't fit there, again
+// into a string of its length; the arguments may be this string
+_string_& _string_::_format(LPCSTR format_spec, const _format_arg_* const* args, int count)
+{
+	char buf[FORMAT_STACK_CHARS];
+	int len = _formatArgs( buf, sizeof(buf), format_spec, args, count );
+	if( len < (int)sizeof(buf) )
+	{
+		_reassign( buf, len );
+		return *this;
+	}
+	_string_ result;
+	LPSTR p = result._setLength( len );
+	if( !p ) return *this;
+	_formatArgs( p, len + 1, format_spec, args, count );
+	swap( result );
+	return *this;
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1)
+{
+	const _format_arg_* args[] = { &a1 };
+	return _format( format_spec, args, 1 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2)
+{
+	const _format_arg_* args[] = { &a1, &a2 };
+	return _format( format_spec, args, 2 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3 };
+	return _format( format_spec, args, 3 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4 };
+	return _format( format_spec, args, 4 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+						   const _format_arg_& a5)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5 };
+	return _format( format_spec, args, 5 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+						   const _format_arg_& a5, const _format_arg_& a6)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6 };
+	return _format( format_spec, args, 6 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+						   const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6, &a7 };
+	return _format( format_spec, args, 7 );
+}
+
+_string_& _string_::format(LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+						   const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7, const _format_arg_& a8)
+{
+	const _format_arg_* args[] = { &a1, &a2, &a3, &a4, &a5, &a6, &a7, &a8 };
+	return _format( format_spec, args, 8 );
+}
+
 /*
 +++ Date Format Specifiers +++
 d		Day of month as digits with no leading zero for single-digit days. 
@@ -871,27 +976,65 @@ long _string_::split ( _array_<_string_>& ret_arr,
 }
 
 // default for @delim = " "; @first_index = 0; @last_index = -1 (until last elem)
+// The length is added up first, so the chars are copied only
+// once, into a string of just that length.
 /* static */
 _string_  _string_::join ( const _array_<_string_>& str_array,
 							 LPCSTR delim, int first_index, int last_index )
 {
 	_string_ retval;
-	bool empty_delim = (NULL == delim || delim[0] == '\0');
-	if( str_array.length() == 0 ) return retval;
-	
-	// use @delim to join the values in the string array
-	// from @first_index to @last_index into one string
 	if( first_index < 0 )
 		first_index = 0;
 	if( last_index < 0 || last_index > str_array.length()-1 )
 		last_index = str_array.length() - 1;
-	for(int i=first_index; i<=last_index; i++)
+	int delim_len = delim ? lstrlenA(delim) : 0;
+	int total = 0, i;
+	for(i=first_index; i<=last_index; i++)
+		total += str_array[i].length() + ((i != last_index) ? delim_len : 0);
+	if( total == 0 ) return retval;
+
+	LPSTR p = retval._setLength( total );
+	if( !p ) return retval;
+	for(i=first_index; i<=last_index; i++)
 	{
-		retval.append( str_array[i] );
-		if( !empty_delim && i != last_index )
-			retval.append( delim );
+		memcpy( p, str_array[i].c_str(), str_array[i].length() );
+		p += str_array[i].length();
+		if( i != last_index && delim_len > 0 )
+		{
+			memcpy( p, delim, delim_len );
+			p += delim_len;
+		}
+	}
+	return retval;
+}
+
+/* static */
+_string_  _string_::join ( const _array_<_string_view_>& view_array,
+							 LPCSTR delim, int first_index, int last_index )
+{
+	_string_ retval;
+	if( first_index < 0 )
+		first_index = 0;
+	if( last_index < 0 || last_index > view_array.length()-1 )
+		last_index = view_array.length() - 1;
+	int delim_len = delim ? lstrlenA(delim) : 0;
+	int total = 0, i;
+	for(i=first_index; i<=last_index; i++)
+		total += view_array[i].length() + ((i != last_index) ? delim_len : 0);
+	if( total == 0 ) return retval;
+
+	LPSTR p = retval._setLength( total );
+	if( !p ) return retval;
+	for(i=first_index; i<=last_index; i++)
+	{
+		memcpy( p, view_array[i].data(), view_array[i].length() );
+		p += view_array[i].length();
+		if( i != last_index && delim_len > 0 )
+		{
+			memcpy( p, delim, delim_len );
+			p += delim_len;
+		}
 	}
-	
 	return retval;
 }
 
@@ -963,15 +1106,26 @@ bool _string_::_internalPatternMatch(LPCSTR pattern, LPCSTR name, bool case_sens
 
 void _string_::_attach ( string_rep* rep )
 {
-	if( !(_rep = rep) ) _rep = &_null_rep;
-	// if rep is unshareable, need to clone a new one from it rather than attach to it
-	if( !_rep->isShareable() )
-		_rep = new string_rep(_rep->_p, _rep->len());
-	_rep->ref();
+	if( !rep ) rep = &_null_rep;
+	// if rep is unshareable (or is another string's local one),
+	// need to copy its chars rather than attach to it
+	if( rep->isLocal() )
+	{
+		// the whole buffer, quicker than just the chars
+		_local.setLocal( _localBuf, STRING_LOCAL_SIZE );
+		memcpy( _localBuf, rep->_p, STRING_LOCAL_SIZE );
+		_local.len() = rep->len();
+		_rep = &_local;
+	}
+	else if( rep != &_null_rep && !rep->isShareable() )
+		_assign( rep->_p, rep->len() );
+	else
+		(_rep = rep)->ref();
 }
 
 void _string_::_detach ()
 {
+	if( _rep->isLocal() ) return;
 	if( _rep->deref() <= 0 && _rep != &_null_rep ) delete _rep;
 }
 
@@ -981,17 +1135,130 @@ void _string_::_reattach ( string_rep* rep )
 	bool shareable = _rep->isShareable();
 	_detach();
 	_attach( rep );
-	if( !shareable ) _rep->markUnshareable();
+	_keepShareable( shareable );
 }
 
 void _string_::_ensureUnique()
 {
 	if( _rep == &_null_rep )
-		_reattach( new string_rep() );
-	else if( _rep->refs() > 1 )
-		_reattach( new string_rep(_rep->_p, _rep->len()) );
+	{
+		_detach();
+		_assign( "", 0 );
+	}
+	else if( _rep->refs() > 1 || _rep->isInterned() )
+	{
+		string_rep* shared = _rep;
+		_assign( shared->_p, shared->len() );
+		// the pool can have let go of an interned rep
+		if( shared->deref() <= 0 ) delete shared;
+	}
 }
 
+// makes room for cch chars, with the 0, in a unique rep
+bool _string_::_ensureLen ( int cch )
+{
+	if( cch <= _rep->allocLen() ) return true;
+	if( !_rep->isLocal() ) return _rep->ensureLen(cch);
+	// outgrowing the local buffer: the chars move to a rep of their own
+	string_rep* rep = new string_rep(_rep->_p, _rep->len());
+	if( !rep || !rep->ensureLen(cch) ) {
+		delete rep; return false;
+	}
+	if( !_rep->isShareable() ) rep->markUnshareable();
+	(_rep = rep)->ref();
+	return true;
+}
+
+// points a detached string to a copy of the chars
+void _string_::_assign ( LPCSTR lpstr, int length )
+{
+	if( lpstr && length < STRING_LOCAL_SIZE )
+	{
+		_local.setLocal( _localBuf, STRING_LOCAL_SIZE );
+		memmove( _localBuf, lpstr, length );
+		_localBuf[_local.len() = length] = '\0';
+		_rep = &_local;
+	}
+	else
+		(_rep = new string_rep(lpstr, length))->ref();
+}
+
+// replaces the string with a copy of the chars, which
+// can be in this string
+void _string_::_reassign ( LPCSTR lpstr, int length )
+{
+	if( length < STRING_LOCAL_SIZE )
+	{
+		bool shareable = _rep->isShareable();
+		char buf[STRING_LOCAL_SIZE];
+		memcpy( buf, lpstr, length );
+		_detach();
+		_assign( buf, length );
+		_keepShareable( shareable );
+	}
+	else
+		_reattach( new string_rep(lpstr, length) );
+}
+
+// takes over the chars of refstr, leaving it NULL
+void _string_::_moveFrom ( _string_& refstr )
+{
+	_detach();
+	if( refstr._rep->isLocal() )
+		_assign( refstr._rep->_p, refstr._rep->len() );
+	else
+		_rep = refstr._rep;
+	refstr._rep = &_null_rep;
+	_null_rep.ref();
+}
+
+// gives the string's rep back the flag the string had before the
+// rep changed: being unshareable stays with the string. The null
+// rep and interned reps are always shareable, and the flag is only
+// written when it changes, on a rep no other string has
+void _string_::_keepShareable ( bool shareable )
+{
+	if( _rep->isShareable() == shareable || _rep == &_null_rep || _rep->isInterned() ) return;
+	if( shareable )
+		_rep->markShareable();	// an unshareable rep is this string's alone
+	else
+	{
+		_ensureUnique();
+		_rep->markUnshareable();
+	}
+}
+
+// makes this a unique string of length chars, for writing them
+// right into the buffer; the chars are garbage until they are
+// written. NULL if out of memory.
+LPSTR _string_::_setLength ( int length )
+{
+	// the old chars aren't kept, so a shared rep isn't copied
+	if( _rep->refs() > 1 || _rep->isInterned() )
+	{
+		_detach();
+		_attach( &_null_rep );
+	}
+	_ensureUnique();
+	if( !_ensureLen( length + 1 ) ) return NULL;
+	_rep->_p[_rep->len() = length] = '\0';
+	return _rep->_p;
+}
+
+// makes this a new interned string of the chars, with their
+// hash; it gets a rep of its own even if it's short
+void _string_::_intern ( const _string_view_& view, DWORD hash )
+{
+	string_rep* rep = new string_rep( view.data() ? view.data() : "", view.length() );
+	if( !rep || !rep->_p || !rep->ensureLen( view.length() + 1 + sizeof(DWORD) ) ) {
+		delete rep; return;
+	}
+	rep->markInterned( hash );
+	_detach();
+	(_rep = rep)->ref();
+}
+
+
 
 //------------------------------------------------
 // Non-member concatenation operations
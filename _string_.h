@@ -5,6 +5,13 @@
 // Operations are the same as in _cstring_.
 // Obviously, using this class is preferable to _cstring_.
 //
+// Strings shorter than STRING_LOCAL_SIZE are kept right in
+// the _string_ object, so they take no heap; copying one
+// copies its chars. Longer strings are lazy-copied.
+//
+// An interned string (see _string_pool_.h) always has a rep,
+// which is never changed, and keeps the hash of its chars.
+//
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #ifndef __string_already_included_vasya__
@@ -14,11 +21,19 @@
 // #define ALL_STRING_STUFF 1
 
 #include "_common_.h"
+#include "_sort_.h"
+#include "_string_view_.h"
+#include "_format_.h"
 // some heavy operations are compiled only if requested
 #ifdef ALL_STRING_STUFF
 	#include "_array_.h"
 #endif
 
+// the chars kept in the string object itself, with the 0
+#ifndef STRING_LOCAL_SIZE
+	#define STRING_LOCAL_SIZE  24
+#endif
+
 namespace soige {
 
 
@@ -43,21 +58,36 @@ private:
 			memcpy( _p, lpstr, length );
 			_p[_len = length] = '\0';
 		}
-		~string_rep ()			{ free(_p); }
+		~string_rep ()			{ if( !isLocal() ) free(_p); }
 
 		// char& charAt(int index)	{ return _p[index]; } // needed for subscript_proxy
 		LPSTR end()				{ return _p + _len; }
 		int&  len()				{ return _len; }
 		int   allocLen()		{ return _buflen; }
 		bool  ensureLen(int cch){ if(cch <= _buflen) return true; return _realloc(cch); }
-		int   ref()				{ InterlockedIncrement((LPLONG)&_refcount); return refs(); }
-		int   deref()			{ InterlockedDecrement((LPLONG)&_refcount); return refs(); }
-		int   refs()			{ return (_refcount & ~UNSHAREABLE); }
+		// the count that this thread's change left, not what another
+		// thread's left by now, so only one of them sees it drop to 0
+		int   ref()				{ return (InterlockedIncrement((LPLONG)&_refcount) & ~(UNSHAREABLE | LOCAL | INTERNED)); }
+		int   deref()			{ return (InterlockedDecrement((LPLONG)&_refcount) & ~(UNSHAREABLE | LOCAL | INTERNED)); }
+		int   refs()			{ return (_refcount & ~(UNSHAREABLE | LOCAL | INTERNED)); }
 
 		void  markShareable()	{ _refcount &= ~UNSHAREABLE; }
 		void  markUnshareable()	{ _refcount |= UNSHAREABLE; }
 		bool  isShareable()		{ return !(_refcount & UNSHAREABLE); }
 
+		// a local rep is a string's own, over the string's buffer;
+		// it's never attached to, and never grows
+		void  setLocal(LPSTR buf, int size)
+								{ _p = buf; _p[0] = '\0'; _len = 0; _buflen = size; _refcount = LOCAL; }
+		bool  isLocal()			{ return (_refcount & LOCAL) != 0; }
+
+		// an interned rep is copied before any change, even if it has
+		// no other strings; the hash of its chars is kept after the 0
+		void  markInterned(DWORD hash)
+								{ memcpy(_p + _len + 1, &hash, sizeof(hash)); _refcount |= INTERNED; }
+		bool  isInterned()		{ return (_refcount & INTERNED) != 0; }
+		DWORD internedHash()	{ DWORD h; memcpy(&h, _p + _len + 1, sizeof(h)); return h; }
+
 		LPSTR	_p;			// the C string represented by this rep
 	
 	private:
@@ -79,6 +109,10 @@ private:
 	
 		// The shareable flag: the highest bit of refcount
 		static const int UNSHAREABLE; // 0x80000000
+		// The local flag: the next one
+		static const int LOCAL; // 0x40000000
+		// The interned flag: the next one
+		static const int INTERNED; // 0x20000000
 	};
 	// end string_rep
 
@@ -121,6 +155,7 @@ public:
 	explicit	_string_	( char chr, int count = 1 );
 	explicit	_string_	( long val );
 	explicit	_string_	( double val );
+	explicit	_string_	( const _string_view_& view );
 	virtual		~_string_	( );
 
 	_string_&	operator=	( const _string_& refstr );
@@ -129,6 +164,7 @@ public:
 	_string_&	operator=	( char chr );
 	_string_&	operator=	( long val );
 	_string_&	operator=	( double val );
+	_string_&	operator=	( const _string_view_& view );
 
 	_string_&	operator+=	( const _string_& refstr );
 	_string_&	operator+=	( LPCSTR lpstr );
@@ -136,6 +172,7 @@ public:
 	_string_&	operator+=	( char chr );
 	_string_&	operator+=	( long val );
 	_string_&	operator+=	( double val );
+	_string_&	operator+=	( const _string_view_& view );
 
 	_string_&	append		( const _string_& refstr );
 	_string_&	append		( LPCSTR lpstr );
@@ -143,23 +180,31 @@ public:
 	_string_&	append		( char chr );
 	_string_&	append		( long val );
 	_string_&	append		( double val );
+	_string_&	append		( const _string_view_& view );
 
 	bool		operator!	( ) const;
 	bool		operator==	( const _string_& refstr ) const;
 	bool		operator==	( LPCSTR lpstr ) const;
 	bool		operator!=	( const _string_& refstr ) const;
 	bool		operator!=	( LPCSTR lpstr ) const;
+	bool		operator==	( const _string_view_& view ) const;
+	bool		operator!=	( const _string_view_& view ) const;
 	bool		operator<	( const _string_& refstr ) const;
 	bool		operator<	( LPCSTR lpstr ) const;
 	int			compare		( const _string_& refstr, bool case_sensitive = true ) const;
 	int			compare		( LPCSTR lpstr, bool case_sensitive = true ) const;
+	int			compare		( const _string_view_& view, bool case_sensitive = true ) const;
 	bool		startsWith	( LPCSTR lpstr, bool case_sensitive = true ) const;
+	bool		startsWith	( const _string_view_& view, bool case_sensitive = true ) const;
 	bool		endsWith	( LPCSTR lpstr, bool case_sensitive = true ) const;
+	bool		endsWith	( const _string_view_& view, bool case_sensitive = true ) const;
 
 	int			find		( const _string_& refstr, int start = 0,
 							  bool case_sensitive = true ) const;
 	int			find		( LPCSTR lpstr, int start = 0,
 							  bool case_sensitive = true ) const;
+	int			find		( const _string_view_& view, int start = 0,
+							  bool case_sensitive = true ) const;
 	int			findReverse ( LPCSTR lpstr, int start = MAX_INT,
 							  bool case_sensitive = true ) const;
 	// Wildcard pattern matching; supports * and ?
@@ -170,9 +215,17 @@ public:
 	_string_	substring	( int start, int count ) const;
 	_string_	left		( int count ) const;
 	_string_	right		( int count ) const;
+	// the chars, or some of them, as a view; it's valid until
+	// the string changes
+	inline _string_view_ view	( ) const	{ return _string_view_( _rep->_p, _rep->len() ); }
+	_string_view_	view	( int start, int count = MAX_INT ) const;
 	
 	inline bool	isNull		( ) const	{ return ( _rep->_p == NULL ); }
 	inline int	length		( ) const	{ return _rep->len(); }
+	// strings interned in the same pool are equal only if they
+	// share a rep; the hash is that of _hashOf() (see _hash_.h)
+	inline bool	isInterned	( ) const	{ return _rep->isInterned(); }
+	inline DWORD internedHash( ) const	{ return isInterned() ? _rep->internedHash() : 0; }
 	int			capacity	( ) const;
 
 	bool		isNumeric	( ) const;
@@ -218,6 +271,21 @@ public:
 
 	// sprintf-style formatting
 	_string_&	format		( LPCSTR format_spec, ... );
+	// the same, type-safe, and without the CRT but for floating
+	// point (see _format_.h); a call with up to FORMAT_MAX_ARGS
+	// numbers, chars, strings and pointers comes here
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+							  const _format_arg_& a5 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+							  const _format_arg_& a5, const _format_arg_& a6 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+							  const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7 );
+	_string_&	format		( LPCSTR format_spec, const _format_arg_& a1, const _format_arg_& a2, const _format_arg_& a3, const _format_arg_& a4,
+							  const _format_arg_& a5, const _format_arg_& a6, const _format_arg_& a7, const _format_arg_& a8 );
 	_string_&	formatDate	( LPCSTR date_format, LPCSTR time_format,
 							  SYSTEMTIME& systime, bool adjust_for_tz = true );
 
@@ -228,6 +296,9 @@ public:
 	static _string_ join	( const _array_<_string_>& str_array,
 							  LPCSTR delim = " ",
 							  int first_index = 0, int last_index = -1 );
+	static _string_ join	( const _array_<_string_view_>& view_array,
+							  LPCSTR delim = " ",
+							  int first_index = 0, int last_index = -1 );
 #endif
 
 	// the NULL string rep, for consistency of operations
@@ -235,6 +306,9 @@ public:
 
 protected:
 	string_rep* _rep;
+	// the rep and the buffer of a short string
+	string_rep	_local;
+	char		_localBuf[STRING_LOCAL_SIZE];
 	
 private:
 	
@@ -245,14 +319,36 @@ private:
 	inline void _detach			( );
 	inline void _reattach		( string_rep* rep );
 	inline void _ensureUnique	( );
+	inline bool _ensureLen		( int cch );
+	inline void _assign			( LPCSTR lpstr, int length );
+	inline void _reassign		( LPCSTR lpstr, int length );
+	inline void _moveFrom		( _string_& refstr );
+	inline void _keepShareable	( bool shareable );
+
+	// for the classes that write a string's chars right into it
+	friend class _string_builder_;
+	friend class _rope_;
+	LPSTR _setLength			( int length );
+	// for _string_pool_, which makes the interned strings
+	friend class _string_pool_;
+	void  _intern				( const _string_view_& view, DWORD hash );
+	_string_& _format			( LPCSTR format_spec, const _format_arg_* const* args, int count );
 };
 
 // global comparison func specialization
 template<> inline int _compare<_string_>( const _string_& a, const _string_& b )
 	{ return a.compare(b); }
+// strings compared to views, e.g. for _set_<_string_>::findLike()
+inline int _compare( const _string_& a, const _string_view_& b )
+	{ return a.compare(b); }
 // global swap func specialization
 template<> inline void _swap<_string_>( _string_* a, _string_* b )
 	{ a->swap(*b); }
+// radix sort support (see _sort_.h)
+inline LPCSTR _radixKeyBytes( const _string_& s, int* pLen )
+	{ *pLen = s.length(); return s.c_str(); }
+template<> inline bool _radixSort<_string_>( _string_ Array[], int cElems )
+	{ _msdRadixSort(Array, cElems); return true; }
 
 // externals
 _string_ operator+( const _string_&, const _string_& );
@@ -0,0 +1,167 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _string_builder_.cpp - implementation of _string_builder_.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_string_builder_.h"
+#include "_num_conv_.h"
+
+namespace soige {
+
+_string_builder_::_string_builder_()
+{
+	_first = _last = NULL;
+	_len = 0;
+}
+
+_string_builder_::~_string_builder_()
+{
+	while( _first )
+	{
+		chunk* next = _first->next;
+		free( _first );
+		_first = next;
+	}
+}
+
+//------------------------------------------------
+// Appending
+//------------------------------------------------
+_string_builder_& _string_builder_::append(const _string_view_& view)
+{
+	_write( view.data(), view.length() );
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(const _string_& refstr)
+{
+	_write( refstr.c_str(), refstr.length() );
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(LPCSTR lpstr)
+{
+	if( lpstr ) _write( lpstr, lstrlenA(lpstr) );
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(char chr)
+{
+	// the usual case, quickly
+	if( _last && _last->len < _last->size )
+	{
+		_last->chars()[_last->len++] = chr;
+		_len++;
+	}
+	else
+		_write( &chr, 1 );
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(char chr, int count)
+{
+	while( count > 0 )
+	{
+		if( (!_last || _last->len == _last->size) && !_nextChunk() ) break;
+		int n = min( count, _last->size - _last->len );
+		memset( _last->chars() + _last->len, chr, n );
+		_last->len += n;
+		_len += n;
+		count -= n;
+	}
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(long val)
+{
+	char buf[NUM_CONV_CHARS];
+	_write( buf, _formatLong(val, buf) );
+	return *this;
+}
+
+_string_builder_& _string_builder_::append(double val)
+{
+	char buf[NUM_CONV_CHARS];
+	_write( buf, _formatDouble(val, buf) );
+	return *this;
+}
+
+void _string_builder_::clear()
+{
+	for( chunk* c = _first; c; c = c->next )
+		c->len = 0;
+	_last = _first;
+	_len = 0;
+}
+
+//------------------------------------------------
+// The string
+//------------------------------------------------
+_string_ _string_builder_::toString() const
+{
+	_string_ ret;
+	toString( ret );
+	return ret;
+}
+
+void _string_builder_::toString(_string_& ret) const
+{
+	if( _len == 0 )
+	{
+		ret = "";
+		return;
+	}
+	LPSTR p = ret._setLength( _len );
+	if( p ) copyTo( p );
+}
+
+void _string_builder_::copyTo(LPSTR buf) const
+{
+	for( chunk* c = _first; c && c->len > 0; c = c->next )
+	{
+		memcpy( buf, c->chars(), c->len );
+		buf += c->len;
+	}
+}
+
+//------------------------------------------------
+// Chunks
+//------------------------------------------------
+void _string_builder_::_write(const char* p, int count)
+{
+	while( count > 0 )
+	{
+		if( (!_last || _last->len == _last->size) && !_nextChunk() ) break;
+		int n = min( count, _last->size - _last->len );
+		memcpy( _last->chars() + _last->len, p, n );
+		_last->len += n;
+		_len += n;
+		p += n;
+		count -= n;
+	}
+}
+
+// moves on to the next chunk: one left over from before
+// clear(), or a new one
+bool _string_builder_::_nextChunk()
+{
+	if( _last && _last->next )
+	{
+		_last = _last->next;
+		return true;
+	}
+	int size = STRING_BUILDER_CHUNK;
+	if( _last ) size = min( _last->size * 2, STRING_BUILDER_MAX_CHUNK );
+	chunk* c = (chunk*) malloc( sizeof(chunk) + size );
+	if( !c ) return false;
+	c->next = NULL;
+	c->len = 0;
+	c->size = size;
+	if( _last ) _last->next = c;
+	else		_first = c;
+	_last = c;
+	return true;
+}
+
+
+};	// namespace soige
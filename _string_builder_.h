@@ -0,0 +1,97 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _string_builder_.h - header file for class _string_builder_.
+//
+// Builds a long string out of many short appends. The chars
+// go into a list of chunks, each twice the size of the one
+// before (up to STRING_BUILDER_MAX_CHUNK), and never move once
+// they're written; toString() then copies them all into a
+// _string_ of just the right length, once. Appending to a
+// _string_ instead copies the whole string every time it
+// outgrows its buffer.
+//
+// Usage:
+//     _string_builder_ sb;
+//     for( ... )
+//         sb.append("row ").append(i).append('\n');
+//     _string_ report = sb.toString();
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __string_builder_already_included_vasya__
+#define __string_builder_already_included_vasya__
+
+#include "_common_.h"
+#include "_string_view_.h"
+#include "_string_.h"
+
+// the size of the first chunk, and the most a chunk grows to
+#ifndef STRING_BUILDER_CHUNK
+	#define STRING_BUILDER_CHUNK  256
+#endif
+#ifndef STRING_BUILDER_MAX_CHUNK
+	#define STRING_BUILDER_MAX_CHUNK  (1024*1024)
+#endif
+
+namespace soige {
+
+//------------------------------------------------------------
+// The _string_builder_ class
+//------------------------------------------------------------
+class _string_builder_
+{
+public:
+	_string_builder_			( );
+	virtual ~_string_builder_	( );
+
+	_string_builder_&	append	( const _string_view_& view );
+	_string_builder_&	append	( const _string_& refstr );
+	_string_builder_&	append	( LPCSTR lpstr );
+	_string_builder_&	append	( char chr );
+	_string_builder_&	append	( char chr, int count );
+	_string_builder_&	append	( long val );
+	_string_builder_&	append	( double val );
+
+	_string_builder_&	operator+=	( const _string_view_& view )	{ return append(view); }
+	_string_builder_&	operator+=	( const _string_& refstr )		{ return append(refstr); }
+	_string_builder_&	operator+=	( LPCSTR lpstr )				{ return append(lpstr); }
+	_string_builder_&	operator+=	( char chr )					{ return append(chr); }
+	_string_builder_&	operator+=	( long val )					{ return append(val); }
+	_string_builder_&	operator+=	( double val )					{ return append(val); }
+
+	inline int	length	( ) const	{ return _len; }
+	inline bool	isEmpty	( ) const	{ return ( _len == 0 ); }
+	// empties the builder, keeping its chunks for the next string
+	void		clear	( );
+
+	// all the chars appended so far
+	_string_	toString( ) const;
+	void		toString( _string_& ret ) const;
+	// copies the chars into buf, which has room for length() of them
+	void		copyTo	( LPSTR buf ) const;
+
+private:
+	// a chunk's chars follow it in the same block of memory
+	struct chunk
+	{
+		chunk*	next;
+		int		len;	// the chars written
+		int		size;	// the chars that fit
+		LPSTR	chars()	{ return (LPSTR)(this + 1); }
+	};
+
+	chunk*	_first;
+	chunk*	_last;	// the one being written to
+	int		_len;
+
+	void	_write		( const char* p, int count );
+	bool	_nextChunk	( );
+
+	// No byval operations
+	_string_builder_	( const _string_builder_& )	{ }
+	void operator=		( const _string_builder_& )	{ }
+};
+
+
+};	// namespace soige
+
+#endif  // __string_builder_already_included_vasya__
@@ -0,0 +1,148 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _string_pool_.cpp - implementation of _string_pool_.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_string_pool_.h"
+
+namespace soige {
+
+_string_pool_ _string_pool_::_global;
+
+_string_pool_::_string_pool_()
+{
+	for( int i = 0; i < STRING_POOL_SHARDS; i++ )
+	{
+		_shards[i].slots = NULL;
+		_shards[i].size = _shards[i].count = 0;
+	}
+}
+
+_string_pool_::~_string_pool_()
+{
+	clear();
+}
+
+//------------------------------------------------
+// Interning
+//------------------------------------------------
+_string_ _string_pool_::intern(const _string_view_& view)
+{
+	if( view.isNull() ) return _string_();
+	return _intern( view, _hashOf(view) );
+}
+
+_string_ _string_pool_::intern(const _string_& refstr)
+{
+	if( refstr.isNull() ) return _string_();
+	// an interned string has its hash already
+	return _intern( refstr.view(), _hashOf(refstr) );
+}
+
+_string_ _string_pool_::intern(LPCSTR lpstr)
+{
+	return intern( _string_view_(lpstr) );
+}
+
+_string_ _string_pool_::find(const _string_view_& view)
+{
+	_string_ ret;
+	if( view.isNull() ) return ret;
+	DWORD hash = _hashOf( view );
+	shard& s = _shardOf( hash );
+	s.lock.acquire();
+	int i = _slotOf( s, view, hash );
+	if( i >= 0 && !s.slots[i].isNull() ) ret = s.slots[i];
+	s.lock.release();
+	return ret;
+}
+
+int _string_pool_::count()
+{
+	int n = 0;
+	for( int i = 0; i < STRING_POOL_SHARDS; i++ )
+	{
+		_shards[i].lock.acquire();
+		n += _shards[i].count;
+		_shards[i].lock.release();
+	}
+	return n;
+}
+
+void _string_pool_::clear()
+{
+	for( int i = 0; i < STRING_POOL_SHARDS; i++ )
+	{
+		shard& s = _shards[i];
+		s.lock.acquire();
+		delete[] s.slots;
+		s.slots = NULL;
+		s.size = s.count = 0;
+		s.lock.release();
+	}
+}
+
+//------------------------------------------------
+// The hash tables
+//------------------------------------------------
+_string_ _string_pool_::_intern(const _string_view_& view, DWORD hash)
+{
+	_string_ ret;
+	shard& s = _shardOf( hash );
+	s.lock.acquire();
+	int i = _slotOf( s, view, hash );
+	if( i >= 0 && !s.slots[i].isNull() )
+		ret = s.slots[i];
+	else if( (s.count + 1) * 2 <= s.size || _grow(s) )
+	{
+		// _grow() has moved the slots
+		i = _slotOf( s, view, hash );
+		s.slots[i]._intern( view, hash );
+		if( !s.slots[i].isNull() )
+		{
+			s.count++;
+			ret = s.slots[i];
+		}
+	}
+	s.lock.release();
+	return ret;
+}
+
+// the slot of the string with the chars, or the empty one where
+// it would go; -1 if the shard has no slots
+int _string_pool_::_slotOf(const shard& s, const _string_view_& view, DWORD hash)
+{
+	if( s.size == 0 ) return -1;
+	int mask = s.size - 1;
+	int i = hash & mask;
+	while( !s.slots[i].isNull() )
+	{
+		if( s.slots[i].internedHash() == hash && s.slots[i] == view )
+			break;
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+// doubles the slots; they're never more than half full
+bool _string_pool_::_grow(shard& s)
+{
+	int size = s.size ? s.size * 2 : 64;
+	_string_* slots = new _string_[size];
+	if( !slots ) return false;
+	for( int i = 0; i < s.size; i++ )
+	{
+		if( s.slots[i].isNull() ) continue;
+		int j = s.slots[i].internedHash() & (size - 1);
+		while( !slots[j].isNull() )
+			j = (j + 1) & (size - 1);
+		slots[j] = s.slots[i];
+	}
+	delete[] s.slots;
+	s.slots = slots;
+	s.size = size;
+	return true;
+}
+
+
+};	// namespace soige
@@ -0,0 +1,101 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _string_pool_.h - header file for class _string_pool_.
+//
+// Interns strings: for any chars, intern() returns the one
+// string of the pool that has them, and all the copies of it
+// share its rep. Tables and dictionaries that hold the same
+// few values over and over then keep each of them once, and
+// two interned strings of a pool are equal if and only if
+// their c_str() is the same pointer (see same()). An interned
+// string also keeps the hash of its chars, so _hashOf() (see
+// _hash_.h) doesn't go over them again, and == of interned
+// strings with different hashes doesn't compare the chars.
+//
+// An interned string is never changed in place: changing a
+// copy of one copies its chars first, as for a shared string.
+//
+// The pool can be used by many threads at once. It's split
+// into STRING_POOL_SHARDS hash tables by the hash of the
+// chars, each with a lock of its own, so threads interning
+// different strings rarely wait for each other.
+//
+// Usage:
+//     _string_pool_& pool = _string_pool_::global();
+//     _string_ city = pool.intern( fields[3] );
+//     ...
+//     if( _string_pool_::same(city, capital) ) ...
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __string_pool_already_included_vasya__
+#define __string_pool_already_included_vasya__
+
+#include "_common_.h"
+#include "_string_view_.h"
+#include "_string_.h"
+#include "_hash_.h"
+#include "_lock_.h"
+
+// the hash tables of a pool; a power of 2
+#ifndef STRING_POOL_SHARDS
+	#define STRING_POOL_SHARDS  16
+#endif
+
+namespace soige {
+
+//------------------------------------------------------------
+// The _string_pool_ class
+//------------------------------------------------------------
+class _string_pool_
+{
+public:
+	_string_pool_			( );
+	virtual ~_string_pool_	( );
+
+	// the pool's string with the chars, added if it's new;
+	// interning a NULL string gives a NULL one
+	_string_	intern		( const _string_view_& view );
+	_string_	intern		( const _string_& refstr );
+	_string_	intern		( LPCSTR lpstr );
+	// the pool's string with the chars, or a NULL one
+	_string_	find		( const _string_view_& view );
+
+	int			count		( );
+	// forgets all the strings; those still in use stay interned
+	void		clear		( );
+
+	// for strings interned in the same pool, the same as ==
+	static inline bool same	( const _string_& a, const _string_& b )
+		{ return a.c_str() == b.c_str(); }
+	// the pool for the whole program
+	static inline _string_pool_& global	( )	{ return _global; }
+
+private:
+	// an open-addressing hash table of the strings; the empty
+	// slots are NULL strings
+	struct shard
+	{
+		_exclusive_lock_	lock;
+		_string_*			slots;
+		int					size;	// a power of 2, or 0
+		int					count;
+	};
+
+	shard	_shards[STRING_POOL_SHARDS];
+	static _string_pool_ _global;
+
+	inline shard& _shardOf	( DWORD hash )
+		{ return _shards[(hash >> 24) & (STRING_POOL_SHARDS - 1)]; }
+	static int	_slotOf		( const shard& s, const _string_view_& view, DWORD hash );
+	static bool	_grow		( shard& s );
+	_string_	_intern		( const _string_view_& view, DWORD hash );
+
+	// No byval operations
+	_string_pool_	( const _string_pool_& )	{ }
+	void operator=	( const _string_pool_& )	{ }
+};
+
+
+};	// namespace soige
+
+#endif  // __string_pool_already_included_vasya__
@@ -0,0 +1,570 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _string_view_.h - header file for class _string_view_.
+//
+// A run of chars somebody else owns: a pointer and a length.
+// Slicing, trimming and splitting a view make more views,
+// without copying the chars or allocating anything; so the
+// owner (a _string_, a buffer, a mapped file) has to stay
+// put while its views are used. Like _string_, a view can
+// contain null ('\0') chars, and isn't null terminated.
+//
+// The searches and compares of views, _string_ and _cstring_
+// all go to _findChars(), _findCharsReverse() and
+// _compareChars() below; these do 16 chars at a time with
+// SSE2 when the CPU has it. Case-insensitive means ASCII
+// case, as memicmp() in the "C" locale.
+//
+// _string_tokenizer_ hands out the tokens of a text one view
+// at a time, allocating nothing; the tokens can be split at a
+// delimiter string, or at any of a _char_set_ of chars.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __string_view_already_included_vasya__
+#define __string_view_already_included_vasya__
+
+#include "_common_.h"
+#include "_sort_.h"
+// split() is compiled only if requested, as in _string_
+#ifdef ALL_STRING_STUFF
+	#include "_array_.h"
+#endif
+
+namespace soige {
+
+// whether the searches and compares use SSE2; they use
+// _cpuHasSSE2() from _sort_.h
+#ifndef STRING_SSE2
+	#define STRING_SSE2  SORT_NETWORK_SSE2
+#endif
+
+//------------------------------------------------------------
+// Searching and comparing runs of chars
+//------------------------------------------------------------
+
+// ASCII lower case
+inline int _foldChar(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : (unsigned char)c;
+}
+
+#if STRING_SSE2
+// _foldChar() of 16 chars; the chars past 0x7F are negative,
+// so they're out of the 'A'..'Z' range as they should be
+inline __m128i _foldChars16(__m128i x)
+{
+	__m128i upper = _mm_and_si128( _mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+								   _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)) );
+	return _mm_add_epi8( x, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')) );
+}
+#endif
+
+// Compares n chars, as memcmp()/memicmp() do: the difference of
+// the first two (unsigned, folded) chars that differ, or 0.
+inline int _compareChars(const char* a, const char* b, int n, bool case_sensitive)
+{
+	int i = 0;
+#if STRING_SSE2
+	if( n >= 16 && _cpuHasSSE2() )
+	{
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+			__m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+			if( !case_sensitive )
+			{
+				x = _foldChars16(x);
+				y = _foldChars16(y);
+			}
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFF;
+			if( mask )
+			{
+				// the scalar loop stops right there
+				i += _lowestBit(mask);
+				break;
+			}
+		}
+	}
+#endif
+	if( case_sensitive )
+	{
+		for(; i < n; i++)
+			if( a[i] != b[i] )
+				return (unsigned char)a[i] - (unsigned char)b[i];
+	}
+	else
+	{
+		for(; i < n; i++)
+		{
+			int diff = _foldChar(a[i]) - _foldChar(b[i]);
+			if( diff != 0 )
+				return diff;
+		}
+	}
+	return 0;
+}
+
+// The first position, at or after start, of needle in hay, or -1.
+// The blocks of 16 positions are filtered on the first and the
+// last char of needle at once, and only the positions matching
+// both get compared; which skips most of them even when the
+// first char alone is common.
+inline int _findChars(const char* hay, int hayLen, const char* needle, int needleLen,
+					  int start, bool case_sensitive)
+{
+	int until = hayLen - needleLen;	// the last position a match fits at
+	if( start < 0 || start > until ) return -1;
+	if( needleLen == 0 ) return start;
+	if( needleLen == 1 && case_sensitive )
+	{
+		// memchr() is as quick as it gets for these
+		const char* p = (const char*) memchr( hay + start, needle[0], hayLen - start );
+		return p ? (int)(p - hay) : -1;
+	}
+	int pos = start;
+	int lastOffset = needleLen - 1;
+	char first = needle[0], last = needle[lastOffset];
+	if( !case_sensitive )
+	{
+		first = (char)_foldChar(first);
+		last = (char)_foldChar(last);
+	}
+#if STRING_SSE2
+	if( until - pos >= 16 && _cpuHasSSE2() )
+	{
+		__m128i vfirst = _mm_set1_epi8(first), vlast = _mm_set1_epi8(last);
+		for(; pos + 16 <= until + 1; pos += 16)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(hay + pos));
+			__m128i y = _mm_loadu_si128((const __m128i*)(hay + pos + lastOffset));
+			if( !case_sensitive )
+			{
+				x = _foldChars16(x);
+				y = _foldChars16(y);
+			}
+			int mask = _mm_movemask_epi8( _mm_and_si128(_mm_cmpeq_epi8(x, vfirst),
+														 _mm_cmpeq_epi8(y, vlast)) );
+			while( mask )
+			{
+				int match = pos + _lowestBit(mask);
+				if( _compareChars(hay + match + 1, needle + 1, needleLen - 2, case_sensitive) == 0 )
+					return match;
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+	if( case_sensitive )
+	{
+		// memchr() to the first char, then the rest
+		while( pos <= until )
+		{
+			const char* p = (const char*) memchr( hay + pos, first, until - pos + 1 );
+			if( !p ) break;
+			pos = (int)(p - hay);
+			if( hay[pos + lastOffset] == last &&
+				_compareChars(p + 1, needle + 1, needleLen - 2, true) == 0 )
+				return pos;
+			pos++;
+		}
+		return -1;
+	}
+	for(; pos <= until; pos++)
+		if( _foldChar(hay[pos]) == (unsigned char)first && _foldChar(hay[pos + lastOffset]) == (unsigned char)last &&
+			_compareChars(hay + pos + 1, needle + 1, needleLen - 2, false) == 0 )
+			return pos;
+	return -1;
+}
+
+// The last position, at or before start, of needle in hay, or
+// -1; like _findChars(), going backwards.
+inline int _findCharsReverse(const char* hay, int hayLen, const char* needle, int needleLen,
+							 int start, bool case_sensitive)
+{
+	if( start > hayLen - needleLen ) start = hayLen - needleLen;
+	if( start < 0 ) return -1;
+	if( needleLen == 0 ) return start;
+	int pos = start;
+	int lastOffset = needleLen - 1;
+	char first = needle[0], last = needle[lastOffset];
+	if( !case_sensitive )
+	{
+		first = (char)_foldChar(first);
+		last = (char)_foldChar(last);
+	}
+#if STRING_SSE2
+	if( pos >= 16 && _cpuHasSSE2() )
+	{
+		__m128i vfirst = _mm_set1_epi8(first), vlast = _mm_set1_epi8(last);
+		// the block of the positions pos-15..pos
+		for(; pos >= 15; pos -= 16)
+		{
+			int base = pos - 15;
+			__m128i x = _mm_loadu_si128((const __m128i*)(hay + base));
+			__m128i y = _mm_loadu_si128((const __m128i*)(hay + base + lastOffset));
+			if( !case_sensitive )
+			{
+				x = _foldChars16(x);
+				y = _foldChars16(y);
+			}
+			int mask = _mm_movemask_epi8( _mm_and_si128(_mm_cmpeq_epi8(x, vfirst),
+														 _mm_cmpeq_epi8(y, vlast)) );
+			while( mask )
+			{
+				int bit = _highestBit(mask);
+				if( _compareChars(hay + base + bit + 1, needle + 1, needleLen - 2, case_sensitive) == 0 )
+					return base + bit;
+				mask &= ~(1 << bit);
+			}
+		}
+	}
+#endif
+	for(; pos >= 0; pos--)
+	{
+		int c = case_sensitive ? (unsigned char)hay[pos] : _foldChar(hay[pos]);
+		int d = case_sensitive ? (unsigned char)hay[pos + lastOffset] : _foldChar(hay[pos + lastOffset]);
+		if( c == (unsigned char)first && d == (unsigned char)last &&
+			_compareChars(hay + pos + 1, needle + 1, needleLen - 2, case_sensitive) == 0 )
+			return pos;
+	}
+	return -1;
+}
+
+
+//------------------------------------------------------------
+// A set of chars: a bit for each of the 256, so looking one up
+// is a shift and a mask. Sets of up to CHAR_SET_SSE2_CHARS
+// chars are also searched for 16 chars at a time with SSE2.
+//------------------------------------------------------------
+#ifndef CHAR_SET_SSE2_CHARS
+	#define CHAR_SET_SSE2_CHARS  8
+#endif
+
+class _char_set_
+{
+public:
+	_char_set_				( )
+		{ clear(); }
+	explicit _char_set_		( LPCSTR chars )
+		{ clear(); add(chars, chars ? lstrlenA(chars) : 0); }
+	_char_set_				( LPCSTR chars, int length )
+		{ clear(); add(chars, length); }
+
+	void clear( )
+	{
+		memset( _bits, 0, sizeof(_bits) );
+		_count = 0;
+	}
+	void add( char chr )
+	{
+		if( contains(chr) ) return;
+		_bits[(unsigned char)chr >> 5] |= 1u << (chr & 31);
+		if( _count < CHAR_SET_SSE2_CHARS )
+			_chars[_count] = chr;
+		_count++;
+	}
+	void add( LPCSTR chars, int length )
+	{
+		for( int i = 0; i < length; i++ )
+			add( chars[i] );
+	}
+	inline bool contains( char chr ) const
+	{
+		return ( _bits[(unsigned char)chr >> 5] >> (chr & 31) ) & 1;
+	}
+	inline int	count	( ) const	{ return _count; }
+
+	// the first position in p, at or after start, of a char
+	// in the set, or -1
+	int findIn( const char* p, int len, int start = 0 ) const
+	{
+		if( start < 0 || _count == 0 ) return -1;
+		int pos = start;
+#if STRING_SSE2
+		if( _count <= CHAR_SET_SSE2_CHARS && len - pos >= 16 && _cpuHasSSE2() )
+		{
+			__m128i v[CHAR_SET_SSE2_CHARS];
+			int i;
+			for( i = 0; i < _count; i++ )
+				v[i] = _mm_set1_epi8( _chars[i] );
+			for(; pos + 16 <= len; pos += 16)
+			{
+				__m128i x = _mm_loadu_si128((const __m128i*)(p + pos));
+				__m128i m = _mm_cmpeq_epi8( x, v[0] );
+				for( i = 1; i < _count; i++ )
+					m = _mm_or_si128( m, _mm_cmpeq_epi8(x, v[i]) );
+				int mask = _mm_movemask_epi8(m);
+				if( mask )
+					return pos + _lowestBit(mask);
+			}
+		}
+#endif
+		for(; pos < len; pos++)
+			if( contains(p[pos]) )
+				return pos;
+		return -1;
+	}
+
+protected:
+	DWORD	_bits[8];
+	char	_chars[CHAR_SET_SSE2_CHARS];	// the first chars added
+	int		_count;
+};
+
+
+//------------------------------------------------------------
+// The _string_view_ class
+//------------------------------------------------------------
+class _string_view_
+{
+public:
+	_string_view_			( ) : _p(NULL), _len(0)
+		{ }
+	_string_view_			( LPCSTR lpstr ) : _p(lpstr), _len(lpstr ? lstrlenA(lpstr) : 0)
+		{ }
+	_string_view_			( LPCSTR lpstr, int length ) : _p(lpstr), _len(length)
+		{ }
+
+	inline LPCSTR	data	( ) const	{ return _p; }
+	inline int		length	( ) const	{ return _len; }
+	inline bool		isNull	( ) const	{ return ( _p == NULL ); }
+	inline bool		isEmpty	( ) const	{ return ( _len == 0 ); }
+	inline char		operator[]	( int pos ) const	{ return _p[pos]; }
+
+	bool		operator==	( const _string_view_& v ) const	{ return compare(v) == 0; }
+	bool		operator!=	( const _string_view_& v ) const	{ return compare(v) != 0; }
+	bool		operator<	( const _string_view_& v ) const	{ return compare(v) < 0; }
+
+	// the same order as _string_::compare()
+	int compare( const _string_view_& v, bool case_sensitive = true ) const
+	{
+		if( _p == v._p && _len == v._len ) return 0;
+		int n = (_len < v._len) ? _len : v._len;
+		int result = _compareChars(_p, v._p, n, case_sensitive);
+		if( result != 0 ) return result;
+		return ( _len == v._len ) ? 0 : ( (_len > v._len) ? 1 : -1 );
+	}
+	bool startsWith( const _string_view_& v, bool case_sensitive = true ) const
+	{
+		return ( v._len <= _len && left(v._len).compare(v, case_sensitive) == 0 );
+	}
+	bool endsWith( const _string_view_& v, bool case_sensitive = true ) const
+	{
+		return ( v._len <= _len && right(v._len).compare(v, case_sensitive) == 0 );
+	}
+
+	// the position of v at or after start, -1 if none
+	int find( const _string_view_& v, int start = 0, bool case_sensitive = true ) const
+	{
+		return _findChars( _p, _len, v._p, v._len, start, case_sensitive );
+	}
+	// the position of any of the chars of set at or after start
+	int find( const _char_set_& set, int start = 0 ) const
+	{
+		return set.findIn( _p, _len, start );
+	}
+	int find( char chr, int start = 0 ) const
+	{
+		if( start < 0 || start >= _len ) return -1;
+		LPCSTR p = (LPCSTR) memchr( _p + start, chr, _len - start );
+		return p ? (int)(p - _p) : -1;
+	}
+	// the last position of v at or before start
+	int findReverse( const _string_view_& v, int start = MAX_INT, bool case_sensitive = true ) const
+	{
+		return _findCharsReverse( _p, _len, v._p, v._len, start, case_sensitive );
+	}
+
+	// slices, clipped to the view
+	_string_view_ substring( int start, int count = MAX_INT ) const
+	{
+		if( start < 0 ) start = 0;
+		if( start > _len ) start = _len;
+		if( count > _len - start ) count = _len - start;
+		if( count < 0 ) count = 0;
+		return _string_view_( _p + start, count );
+	}
+	_string_view_ left( int count ) const
+	{
+		return substring( 0, count );
+	}
+	_string_view_ right( int count ) const
+	{
+		if( count > _len ) count = _len;
+		return substring( _len - count, count );
+	}
+
+	// these narrow the view itself
+	_string_view_& trim( char char_to_trim = ' ' )
+	{
+		return trimRight(char_to_trim).trimLeft(char_to_trim);
+	}
+	_string_view_& trimLeft( char char_to_trim = ' ' )
+	{
+		while( _len > 0 && *_p == char_to_trim ) { _p++; _len--; }
+		return *this;
+	}
+	_string_view_& trimRight( char char_to_trim = ' ' )
+	{
+		while( _len > 0 && _p[_len - 1] == char_to_trim ) _len--;
+		return *this;
+	}
+	_string_view_& chopLeft( int chars_to_chop )
+	{
+		*this = substring( chars_to_chop );
+		return *this;
+	}
+	_string_view_& chopRight( int chars_to_chop )
+	{
+		*this = left( _len - chars_to_chop );
+		return *this;
+	}
+
+	// Splits at the first delim: the part before it is returned,
+	// and this view is left with the part after it; with no delim
+	// the whole view is returned and this one is left empty.
+	// Loops over the tokens without any array:
+	// while( !rest.isEmpty() ) { token = rest.nextToken(","); ... }
+	_string_view_ nextToken( const _string_view_& delim, bool case_sensitive = true )
+	{
+		int pos = delim.isEmpty() ? -1 : find( delim, 0, case_sensitive );
+		_string_view_ token;
+		if( pos < 0 )
+		{
+			token = *this;
+			*this = _string_view_( _p + _len, 0 );
+		}
+		else
+		{
+			token = _string_view_( _p, pos );
+			*this = substring( pos + delim._len );
+		}
+		return token;
+	}
+
+#ifdef ALL_STRING_STUFF
+	// the same tokens as _string_::split(), as views; ret_arr keeps
+	// its memory from call to call, so it's reused without allocating
+	long split( _array_<_string_view_>& ret_arr, const _string_view_& delim = " ",
+				bool ignore_delim_case = false ) const
+	{
+		ret_arr.removeNAt( 0, ret_arr.length() );
+		if( _len <= 0 || delim.isEmpty() ) return 0;
+		_string_view_ rest( *this );
+		// a trailing delim makes an empty last token
+		for(;;)
+		{
+			int pos = rest.find( delim, 0, !ignore_delim_case );
+			if( pos < 0 ) break;
+			ret_arr.append( rest.left(pos) );
+			rest.chopLeft( pos + delim._len );
+		}
+		ret_arr.append( rest );
+		return ret_arr.length();
+	}
+	// the tokens between any of the chars of delims; runs of them
+	// make empty tokens unless skip_empty
+	long split( _array_<_string_view_>& ret_arr, const _char_set_& delims,
+				bool skip_empty = false ) const
+	{
+		ret_arr.removeNAt( 0, ret_arr.length() );
+		if( _len <= 0 ) return 0;
+		int start = 0;
+		for(;;)
+		{
+			int pos = delims.findIn( _p, _len, start );
+			int end = ( pos < 0 ) ? _len : pos;
+			if( !skip_empty || end > start )
+				ret_arr.append( _string_view_(_p + start, end - start) );
+			if( pos < 0 ) break;
+			start = pos + 1;
+		}
+		return ret_arr.length();
+	}
+#endif
+
+protected:
+	LPCSTR	_p;
+	int		_len;
+};
+
+
+//------------------------------------------------------------
+// Goes over the tokens of a text, a view at a time:
+//     _string_tokenizer_ tok( line.view(), _char_set_(" \t,;"), true );
+//     _string_view_ word;
+//     while( tok.next(word) )
+//         ...
+// The text has to stay put while the tokens are used.
+//------------------------------------------------------------
+class _string_tokenizer_
+{
+public:
+	// the tokens between the occurrences of delim, the same as
+	// split() gives (none if the text or delim is empty)
+	_string_tokenizer_( const _string_view_& text, const _string_view_& delim,
+						bool case_sensitive = true, bool skip_empty = false ) :
+		_rest(text), _delim(delim), _caseSensitive(case_sensitive),
+		_skipEmpty(skip_empty), _bySet(false), _done(text.isEmpty() || delim.isEmpty())
+		{ }
+	// the tokens between any of the chars of delims
+	_string_tokenizer_( const _string_view_& text, const _char_set_& delims,
+						bool skip_empty = false ) :
+		_rest(text), _set(delims), _caseSensitive(true),
+		_skipEmpty(skip_empty), _bySet(true), _done(text.isEmpty())
+		{ }
+
+	// the next token; false if there are no more
+	bool next( _string_view_& token )
+	{
+		while( !_done )
+		{
+			int pos, delimLen;
+			if( _bySet )
+			{
+				pos = _set.findIn( _rest.data(), _rest.length() );
+				delimLen = 1;
+			}
+			else
+			{
+				pos = _rest.find( _delim, 0, _caseSensitive );
+				delimLen = _delim.length();
+			}
+			if( pos < 0 )
+			{
+				token = _rest;
+				_rest.chopLeft( _rest.length() );
+				_done = true;
+			}
+			else
+			{
+				token = _rest.left( pos );
+				_rest.chopLeft( pos + delimLen );
+			}
+			if( !_skipEmpty || !token.isEmpty() )
+				return true;
+		}
+		return false;
+	}
+	inline bool	hasMore	( ) const	{ return !_done; }
+	// the text after the last token handed out
+	inline _string_view_ rest	( ) const	{ return _rest; }
+
+protected:
+	_string_view_	_rest;
+	_string_view_	_delim;
+	_char_set_		_set;
+	bool			_caseSensitive;
+	bool			_skipEmpty;
+	bool			_bySet;
+	bool			_done;
+};
+
+// global comparison func specialization
+template<> inline int _compare<_string_view_>( const _string_view_& a, const _string_view_& b )
+	{ return a.compare(b); }
+
+
+};	// namespace soige
+
+#endif  // __string_view_already_included_vasya__
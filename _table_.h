@@ -4,6 +4,12 @@
 // Provides a two-dimensional (rows-columns) table
 // of objects of one type.
 //
+// Copies of a table share its columns until one of them
+// changes a column, which is then cloned for it (copy on
+// write), so copying a table costs next to nothing. A copy
+// made on one thread can be read on another while the table
+// it was copied from goes on changing.
+//
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #ifndef __table_already_included_vasya__
@@ -17,6 +23,78 @@ namespace soige {
 
 template<typename elem_type> class _table_;
 
+//------------------------------------------------------------
+// What changed in a table during a beginUpdate()/endUpdate()
+// batch: the rows and columns to refresh, the number of rows
+// inserted and removed, and whether the columns or the row
+// order changed, in which case everything has to be refreshed
+//------------------------------------------------------------
+struct table_change
+{
+	bool	structure;			// columns, row order or the like changed
+	int		firstRow, lastRow;	// rows to refresh, -1 if none
+	int		firstCol, lastCol;	// columns to refresh, -1 if none
+	int		rowsInserted;
+	int		rowsRemoved;
+	int		cellUpdates;		// number of cells updated
+
+	table_change()
+	{
+		clear();
+	}
+	void clear()
+	{
+		structure = false;
+		firstRow = lastRow = firstCol = lastCol = -1;
+		rowsInserted = rowsRemoved = cellUpdates = 0;
+	}
+	bool isEmpty() const
+	{
+		return ( !structure && firstRow < 0 && rowsInserted == 0 && rowsRemoved == 0 );
+	}
+	void addCell(int row, int col)
+	{
+		addCells(row, row, col);
+	}
+	void addCells(int first, int last, int col)
+	{
+		_addRows(first, last);
+		if(firstCol < 0 || col < firstCol) firstCol = col;
+		if(col > lastCol) lastCol = col;
+		cellUpdates += last - first + 1;
+	}
+	// rows inserted (or removed) at row, in a table of colCount
+	// columns that now has rowCount rows: the rows after them moved
+	void addRows(int row, int inserted, int removed, int rowCount, int colCount)
+	{
+		rowsInserted += inserted;
+		rowsRemoved += removed;
+		if(lastRow >= rowCount)
+			lastRow = rowCount - 1;
+		if(firstRow >= rowCount)
+		{
+			// the rows to refresh are gone, and what became of
+			// them is anyone's guess: everything is refreshed
+			firstRow = lastRow = -1;
+			structure = true;
+		}
+		if(row < rowCount)
+			_addRows(row, rowCount - 1);
+		if(colCount > 0)
+		{
+			firstCol = 0;
+			lastCol = colCount - 1;
+		}
+	}
+
+protected:
+	void _addRows(int first, int last)
+	{
+		if(firstRow < 0 || first < firstRow) firstRow = first;
+		if(last > lastRow) lastRow = last;
+	}
+};
+
 template<typename elem_type> class table_listener
 {
 	friend class _table_<elem_type>;
@@ -25,6 +103,253 @@ template<typename elem_type> class table_listener
 protected:
 	virtual void onTableChanged(typed_table*) = 0;
 	virtual void onTableCellUpdated(typed_table*, int row, int col) = 0;
+	// a batch of changes made between beginUpdate() and endUpdate();
+	// listeners that don't care for the details refresh everything
+	virtual void onTableUpdated(typed_table* table, const table_change&)
+	{
+		onTableChanged(table);
+	}
+};
+
+//------------------------------------------------------------
+// A dictionary-encoded column of a _table_<>: each distinct
+// value is kept once, and each row holds the code of its
+// value - a byte while there are at most 256 distinct values,
+// two up to 65536, four beyond that. Values stay in the
+// dictionary even when no row has them any more.
+//------------------------------------------------------------
+template<typename elem_type> class _table_dict_column_
+{
+public:
+	_table_dict_column_()
+	{
+		_width = 1;
+		_length = 0;
+	}
+
+	int length() const
+	{
+		return _length;
+	}
+	// bytes per code: 1, 2 or 4
+	int getCodeWidth() const
+	{
+		return _width;
+	}
+
+	// Dictionary
+	int dictSize() const
+	{
+		return _values.length();
+	}
+	const elem_type& decode(int code) const
+	{
+		return _values[code];
+	}
+	// the code of a value, or -1 if it isn't in the dictionary
+	int findCode(const elem_type& val) const
+	{
+		int pos = _lowerBound(val);
+		if(pos < _byValue.length() && _compare(_values[_byValue[pos]], val) == 0)
+			return _byValue[pos];
+		return -1;
+	}
+	// the code of a value, adding it to the dictionary if it's new
+	int encode(const elem_type& val);
+	// the position of each code's value in the sorted dictionary,
+	// so that comparing ranks compares values
+	void getRanks(_array_<int>& ranks) const
+	{
+		ranks.resize(_byValue.length());
+		for(int i=0; i<_byValue.length(); i++)
+			ranks[_byValue[i]] = i;
+	}
+
+	// Rows
+	int getCode(int row) const
+	{
+		switch(_width)
+		{
+		case 1:		return ((const unsigned char*)_bytes())[row];
+		case 2:		return ((const unsigned short*)_bytes())[row];
+		default:	return ((const int*)_bytes())[row];
+		}
+	}
+	const elem_type& get(int row) const
+	{
+		return _values[getCode(row)];
+	}
+	void set(int row, const elem_type& val)
+	{
+		int code = encode(val);
+		_setCode(_bytes(), row, code);
+	}
+	// inserts count values at row
+	void insert(int row, const elem_type* values, int count);
+	// inserts count rows with the same value at row
+	void insertValue(int row, const elem_type& val, int count);
+	// adds rows with empty values at the end, or drops the last ones
+	void resize(int rows);
+	void remove(int row, int count)
+	{
+		_codes.removeNAt(row*_width, count*_width);
+		_length -= count;
+	}
+	void reserve(int rows)
+	{
+		_codes.reserve(rows*_width);
+	}
+	// clears the rows; the dictionary stays
+	void clear()
+	{
+		_codes.clear();
+		_length = 0;
+	}
+	void swap(int row1, int row2)
+	{
+		int code = getCode(row1);
+		_setCode(_bytes(), row1, getCode(row2));
+		_setCode(_bytes(), row2, code);
+	}
+	// moves row perm[i] to row i, for all the rows
+	void permute(const _array_<int>& perm);
+	// the first row from fromRow on that has the code, or -1
+	int findRow(int code, int fromRow) const;
+
+protected:
+	// the distinct values, by code
+	_array_<elem_type> _values;
+	// the codes in the order of their values, for lookups
+	_array_<int> _byValue;
+	// _length codes, _width bytes each
+	_array_<unsigned char> _codes;
+	int _width;
+	int _length;
+
+	// position in _byValue of the value, or where it would go
+	int _lowerBound(const elem_type& val) const;
+	unsigned char* _bytes()
+	{
+		return _codes.length() ? &_codes[0] : NULL;
+	}
+	const unsigned char* _bytes() const
+	{
+		return _codes.length() ? &_codes[0] : NULL;
+	}
+	void _setCode(unsigned char* codes, int row, int code)
+	{
+		switch(_width)
+		{
+		case 1:		((unsigned char*)codes)[row] = (unsigned char)code; break;
+		case 2:		((unsigned short*)codes)[row] = (unsigned short)code; break;
+		default:	((int*)codes)[row] = code; break;
+		}
+	}
+	// the codes of the rows become wider, once there are too
+	// many values for the current width
+	void _widen();
+};
+
+//------------------------------------------------------------
+// A key column of a multi-column sort
+//------------------------------------------------------------
+struct sort_key
+{
+	enum null_order
+	{
+		nulls_as_values,	// nulls sort like any other value
+		nulls_first,		// whatever the direction
+		nulls_last
+	};
+
+	int			col;
+	bool		descending;
+	null_order	nulls;
+
+	sort_key(int c = 0, bool desc = false, null_order n = nulls_as_values) :
+		col(c), descending(desc), nulls(n)
+	{ }
+};
+
+template<typename elem_type> struct _table_key_column_
+{
+	const elem_type*	values;	// the column's values
+	// for an encoded column, instead of the values: the rank of
+	// each row's value, and the rank of the null value (or -1)
+	const int*	ranks;
+	int	nullRank;
+	int	sign;		// 1 ascending, -1 descending
+	int	nullSide;	// -1 nulls first, 1 nulls last, 0 nulls as values
+};
+
+// What gets sorted: a row index along with its value of the
+// first key (or its rank, if the column is encoded), so that
+// most comparisons don't have to go and look it up
+template<typename elem_type> struct _table_sort_entry_
+{
+	elem_type	key;
+	int			rank;
+	int			row;
+};
+
+//------------------------------------------------------------
+// Orders sort entries on several columns, each ascending or
+// descending, with nulls first, last or as values; rows equal
+// on all the keys stay in their order
+//------------------------------------------------------------
+template<typename elem_type> class _table_row_order_
+{
+public:
+	_table_row_order_(const _table_key_column_<elem_type>* keys, int nkeys,
+			const elem_type* nullValue) :
+		_keys(keys), _nkeys(nkeys), _nullValue(nullValue)
+	{ }
+	int operator()(const _table_sort_entry_<elem_type>& e1,
+				   const _table_sort_entry_<elem_type>& e2) const
+	{
+		int c = _keys[0].ranks ? _compareRank(_keys[0], e1.rank, e2.rank) :
+								 _compareKey(_keys[0], e1.key, e2.key);
+		for(int i=1; c == 0 && i<_nkeys; i++)
+		{
+			const _table_key_column_<elem_type>& key = _keys[i];
+			if(key.ranks)
+				c = _compareRank(key, key.ranks[e1.row], key.ranks[e2.row]);
+			else
+				c = _compareKey(key, key.values[e1.row], key.values[e2.row]);
+		}
+		return c ? c : e1.row - e2.row;
+	}
+protected:
+	int _compareRank(const _table_key_column_<elem_type>& key, int r1, int r2) const
+	{
+		if(key.nullSide && (r1 == key.nullRank || r2 == key.nullRank))
+		{
+			if(r1 == r2)
+				return 0;
+			return (r1 == key.nullRank) ? key.nullSide : -key.nullSide;
+		}
+		return (r1 - r2) * key.sign;
+	}
+	int _compareKey(const _table_key_column_<elem_type>& key,
+					const elem_type& v1, const elem_type& v2) const
+	{
+		if(key.nullSide)
+		{
+			bool null1 = ( _compare(v1, *_nullValue) == 0 );
+			bool null2 = ( _compare(v2, *_nullValue) == 0 );
+			if(null1 || null2)
+			{
+				if(null1 && null2)
+					return 0;
+				return null1 ? key.nullSide : -key.nullSide;
+			}
+		}
+		return _compare(v1, v2) * key.sign;
+	}
+
+	const _table_key_column_<elem_type>*	_keys;
+	int			_nkeys;
+	const elem_type*	_nullValue;
 };
 
 //------------------------------------------------------------
@@ -35,20 +360,28 @@ template<typename elem_type> class _table_
 public:
 	typedef elem_type elem_type;
 	typedef _array_<elem_type> elem_array;
+	typedef _array_<int> index_array;
+	typedef _table_dict_column_<elem_type> dict_column;
 
 	//-------------------------------------------------
 	// constructors
-	_table_() : INSERTION_SORT_BOUND(16)
+	_table_()
 	{
 		_rowCount = 0;
+		_hasNullValue = false;
+		_updateDepth = 0;
 	}
-	_table_(const _table_& other) : INSERTION_SORT_BOUND(16)
+	_table_(const _table_& other)
 	{
+		_updateDepth = 0;
 		_rowCount = other._rowCount;
+		_nullValue = other._nullValue;
+		_hasNullValue = other._hasNullValue;
 		_colNames = other._colNames;
-		_data.clear();
-		for(int i=0; i<other._data.length(); i++)
-			_data.append(_ptr_<elem_array>(new elem_array(*(other._data[i]))));
+		// the columns are shared until one of the tables changes them
+		_data = other._data;
+		_indexes = other._indexes;
+		_dicts = other._dicts;
 		fireTableChanged();
 	}
 	virtual ~_table_()
@@ -60,13 +393,16 @@ public:
 	// operators
 	virtual _table_& operator=(const _table_& other)
 	{
-		if( this->operator==(other) )
+		if(this == &other)
 			return *this;
 		_rowCount = other._rowCount;
+		_nullValue = other._nullValue;
+		_hasNullValue = other._hasNullValue;
 		_colNames = other._colNames;
-		_data.clear();
-		for(int i=0; i<other._data.length(); i++)
-			_data.append(_ptr_<elem_array>(new elem_array(*(other._data[i]))));
+		// the columns are shared until one of the tables changes them
+		_data = other._data;
+		_indexes = other._indexes;
+		_dicts = other._dicts;
 		fireTableChanged();
 		return *this;
 	}
@@ -75,7 +411,20 @@ public:
 		if(this == &other) return true;
 		if(_rowCount != other._rowCount || _colNames != other._colNames) return false;
 		for(int i=0; i<_colNames.length(); i++)
-			if(*_data[i] != *other._data[i]) return false;
+		{
+			// a column shared with a copy is the same
+			if(_data[i] == other._data[i] && _dicts[i] == other._dicts[i])
+				continue;
+			if(_dicts[i] == NULL && other._dicts[i] == NULL)
+			{
+				if(*_data[i] != *other._data[i]) return false;
+			}
+			else
+			{
+				for(int row=0; row<_rowCount; row++)
+					if( !(_valueAt(i, row) == other._valueAt(i, row)) ) return false;
+			}
+		}
 		return true;
 	}
 	bool operator!=(const _table_& other) const
@@ -97,6 +446,8 @@ public:
 		_colNames.insert(colName, index);
 		// redimension the data array as well
 		_data.insert(_ptr_<elem_array>(new elem_array()), index);
+		_indexes.insert(_ptr_<index_array>(), index);
+		_dicts.insert(_ptr_<dict_column>(), index);
 		if(_rowCount > 0)
 			_data[index]->resize(_rowCount);
 		fireTableChanged();
@@ -107,6 +458,8 @@ public:
 		_colNames.removeAt(index);
 		// redimension the data array as well
 		_data.removeAt(index);
+		_indexes.removeAt(index);
+		_dicts.removeAt(index);
 		fireTableChanged();
 	}
 
@@ -117,6 +470,12 @@ public:
 		_ptr_<elem_array> temp = _data[col1];
 		_data[col1] = _data[col2];
 		_data[col2] = temp;
+		_ptr_<index_array> tempIndex = _indexes[col1];
+		_indexes[col1] = _indexes[col2];
+		_indexes[col2] = tempIndex;
+		_ptr_<dict_column> tempDict = _dicts[col1];
+		_dicts[col1] = _dicts[col2];
+		_dicts[col2] = tempDict;
 		fireTableChanged();
 		return true;
 	}
@@ -131,6 +490,8 @@ public:
 		_colNames.resize(cols);
 		// redimension the data array as well
 		_data.resize(cols);
+		_indexes.resize(cols);
+		_dicts.resize(cols);
 		int i;
 		for(i=0; i<cols; i++)
 			if(_data[i] == NULL) _data[i] = new elem_array();
@@ -175,6 +536,29 @@ public:
 	bool insertRow(const _array_<elem_type>& newRow, int index);
 	bool swapRows(int row1, int row2);
 
+	// Bulk loading: each column grows once, instead of once per row
+	// make room for this many rows in every column; a column
+	// shared with a copy of the table is left as it is (it gets
+	// its own room when it's cloned, on the first change)
+	void reserveRows(int rows)
+	{
+		for(int i=0; i<_data.length(); i++)
+		{
+			if(_dicts[i] != NULL)
+			{
+				if( !_dicts[i].isShared() )
+					_writeDict(i).reserve(rows);
+			}
+			else if( !_data[i].isShared() )
+				_writeData(i).reserve(rows);
+		}
+	}
+	// appends count rows, given row after row: rows[row*getColumnCount() + col]
+	void appendRows(const elem_type* rows, int count);
+	// sets the column's values in rows 0 to count-1, adding
+	// rows to the table (with empty values) if there are fewer
+	bool setColumnData(int col, const elem_type* values, int count);
+
 	int getRowCount() const
 	{
 		return _rowCount;
@@ -182,31 +566,76 @@ public:
 	
 	void setValueAt(int row, int col, const elem_type& newVal)
 	{
-		_data.get(col)->get(row) = newVal;
+		if(_indexes.get(col) == NULL)
+			_setValue(row, col, newVal);
+		else
+		{
+			// the row's entry moves to where the new value goes
+			_writeIndex(col).removeAt(_indexLowerBound(col, _valueAt(col, row), row));
+			_setValue(row, col, newVal);
+			_writeIndex(col).insert(row, _indexLowerBound(col, newVal, row));
+		}
 		fireTableCellUpdated(row, col);
 	}
 
 	const elem_type& getValueAt(int row, int col) const
 	{
+		if(_dicts.get(col) != NULL)
+			return _dicts[col]->get(row);
 		return _data.get(col)->get(row);
 	}
+	// the values of a whole column, in row order, for scanning
+	// it (see _query_.h); NULL if there are no rows, or if the
+	// column is encoded (see getDictColumn())
+	const elem_type* getColumnData(int col) const
+	{
+		if(col < 0 || col >= _colNames.length() || _rowCount == 0 || _dicts[col] != NULL)
+			return NULL;
+		return &(*_data[col])[0];
+	}
 	
 	bool removeRow(int row)
 	{
-		if(row < 0 || row >= _rowCount)
+		return removeRows(row, 1);
+	}
+	// removes count rows starting with row
+	bool removeRows(int row, int count)
+	{
+		if(row < 0 || row >= _rowCount || count < 1)
 			return false;
+		if(count > _rowCount - row)
+			count = _rowCount - row;
 		for(int i=0; i<_data.length(); i++)
-			_data[i]->removeAt(row);
-		_rowCount -= 1;
-		fireTableChanged();
+		{
+			if(_dicts[i] != NULL)
+				_writeDict(i).remove(row, count);
+			else
+				_writeData(i).removeNAt(row, count);
+		}
+		_rowCount -= count;
+		_indexRemoveRows(row, count);
+		_fireRowsChanged(row, 0, count);
 		return true;
 	}
 	
-	// Clear all the rows, but leave all column definitions intact
+	// Clear all the rows, but leave all column definitions intact;
+	// an encoded column shared with a copy of the table gets a new
+	// dictionary rather than a clone of the shared one
 	void removeAllRows()
 	{
 		for(int i=0; i<_data.length(); i++)
-			_data[i]->clear();
+		{
+			_writeData(i, false).clear();
+			if(_indexes[i] != NULL)
+				_writeIndex(i, false).clear();
+			if(_dicts[i] != NULL)
+			{
+				if(_dicts[i].isShared())
+					_dicts[i] = new dict_column();
+				else
+					_dicts[i]->clear();
+			}
+		}
 		_rowCount = 0;
 		fireTableChanged();
 	}
@@ -217,44 +646,222 @@ public:
 	{
 		_colNames.clear();
 		_data.clear();
+		_indexes.clear();
+		_dicts.clear();
 		_rowCount = 0;
 		fireTableChanged();
 	}
 	
-	//
+	// Nulls: the table has no nulls of its own, but a value can
+	// be picked to stand for null (see sort_key::null_order)
+	void setNullValue(const elem_type& nullValue)
+	{
+		_nullValue = nullValue;
+		_hasNullValue = true;
+		fireTableChanged();
+	}
+	void clearNullValue()
+	{
+		_hasNullValue = false;
+		fireTableChanged();
+	}
+	bool isNull(int row, int col) const
+	{
+		return ( _hasNullValue && _compare(getValueAt(row, col), _nullValue) == 0 );
+	}
+
+	// Sorting: the rows are ordered by sorting a list of row
+	// indexes on the values of the column(s), and then each
+	// column is rearranged once. Rows with equal keys keep
+	// their order.
 	bool sort(int col)
 	{
-		if(col >= _colNames.length())
+		sort_key key(col);
+		return sort(&key, 1);
+	}
+	// sorts on nkeys columns at once: keys[0] first, then keys[1]
+	// for rows equal on keys[0], and so on
+	bool sort(const sort_key* keys, int nkeys)
+	{
+		_array_<int> perm;
+		if( !getSortPermutation(keys, nkeys, perm) )
 			return false;
 		if(_rowCount < 2)
 			return true;
-		_quickSort(col, 0, _rowCount-1);
+		_permuteRows(perm);
+		_rebuildIndexes();
+		fireTableChanged();
 		return true;
 	}
 
+	// The row indexes in the order sort() would put the rows in
+	bool getSortPermutation(int col, _array_<int>& perm) const
+	{
+		sort_key key(col);
+		return getSortPermutation(&key, 1, perm);
+	}
+	bool getSortPermutation(const sort_key* keys, int nkeys, _array_<int>& perm) const;
+
+	// Sorted view: keeps the order of sort() as row indexes,
+	// without moving any data. The view is dropped when the
+	// table reports a change (other than to a value outside the
+	// view's key columns).
+	bool sortView(int col)
+	{
+		sort_key key(col);
+		return sortView(&key, 1);
+	}
+	bool sortView(const sort_key* keys, int nkeys)
+	{
+		dropSortedView();
+		if( !getSortPermutation(keys, nkeys, _view) )
+			return false;
+		for(int i=0; i<nkeys; i++)
+			_viewCols.append(keys[i].col);
+		return true;
+	}
+	bool hasSortedView() const
+	{
+		return (_viewCols.length() > 0);
+	}
+	// the view's first key column
+	int getSortedViewColumn() const
+	{
+		return hasSortedView() ? _viewCols[0] : -1;
+	}
+	void dropSortedView()
+	{
+		_view.clear();
+		_viewCols.clear();
+	}
+	// row index of the table row at position viewRow of the view
+	int getViewRow(int viewRow) const
+	{
+		return _view[viewRow];
+	}
+	const elem_type& getViewValueAt(int viewRow, int col) const
+	{
+		return getValueAt(_view[viewRow], col);
+	}
+
 	//
 	bool find(const elem_type& val, int* pRow, int* pCol, int fromRow = 0, int fromCol = 0) const;
 
+	// Indexes: an indexed column keeps its row indexes sorted on
+	// the values (and on the row for equal values), so looking
+	// a value up is a binary search instead of a scan. The index
+	// follows setValueAt(), insertRow(), removeRow() and the rest.
+	bool createIndex(int col)
+	{
+		if(col < 0 || col >= _colNames.length())
+			return false;
+		if(_indexes[col] == NULL)
+			_indexes[col] = new index_array();
+		return getSortPermutation(col, _writeIndex(col, false));
+	}
+	void dropIndex(int col)
+	{
+		if(col >= 0 && col < _colNames.length())
+			_indexes[col] = NULL;
+	}
+	bool hasIndex(int col) const
+	{
+		return ( col >= 0 && col < _colNames.length() && _indexes[col] != NULL );
+	}
+	// the first row having val in the column, or -1; scans the
+	// column if it isn't indexed
+	int findInColumn(int col, const elem_type& val) const;
+	// the rows having val in the column, as positions [*pFirst, *pLast)
+	// in the column's index (see getIndexRow()); false if the column
+	// isn't indexed
+	bool equalRange(int col, const elem_type& val, int* pFirst, int* pLast) const
+	{
+		if( !hasIndex(col) )
+			return false;
+		*pFirst = _indexLowerBound(col, val, -1);
+		*pLast = _indexLowerBound(col, val, _rowCount);
+		return true;
+	}
+	// row index of the table row at position pos of the column's index
+	int getIndexRow(int col, int pos) const
+	{
+		return _indexes.get(col)->get(pos);
+	}
+
+	// Dictionary encoding: an encoded column keeps each distinct
+	// value once and a code of 1, 2 or 4 bytes per row (see
+	// _table_dict_column_), which saves a lot of memory for
+	// columns with few distinct values. find(), findInColumn()
+	// and sort() work on the codes of an encoded column.
+	bool encodeColumn(int col);
+	// back to plain values
+	bool decodeColumn(int col);
+	bool isEncoded(int col) const
+	{
+		return ( col >= 0 && col < _colNames.length() && _dicts[col] != NULL );
+	}
+	// the codes and dictionary of an encoded column, NULL for another
+	const dict_column* getDictColumn(int col) const
+	{
+		return isEncoded(col) ? &(*_dicts[col]) : NULL;
+	}
+
 	// Table change notification
-	void addTableListener(table_listener* pL)
+	void addTableListener(table_listener<elem_type>* pL)
 	{
 		_listeners.append(pL);
 	}
-	void removeTableListener(table_listener* pL)
+	void removeTableListener(table_listener<elem_type>* pL)
 	{
 		_listeners.remove(pL);
 	}
 	void fireTableChanged()
 	{
+		dropSortedView();
+		if(_updateDepth > 0)
+		{
+			_pendingChange.structure = true;
+			return;
+		}
 		for(int i=0; i<_listeners.length(); i++)
 			_listeners[i]->onTableChanged(this);
 	}
 	void fireTableCellUpdated(int row, int col)
 	{
+		if(_viewCols.find(col) >= 0)
+			dropSortedView();
+		if(_updateDepth > 0)
+		{
+			_pendingChange.addCell(row, col);
+			return;
+		}
 		for(int i=0; i<_listeners.length(); i++)
 			_listeners[i]->onTableCellUpdated(this, row, col);
 	}
 
+	// Batched notification: the changes made between beginUpdate()
+	// and endUpdate() reach the listeners as one onTableUpdated()
+	// when the outermost endUpdate() is called
+	void beginUpdate()
+	{
+		_updateDepth++;
+	}
+	void endUpdate()
+	{
+		if(_updateDepth == 0 || --_updateDepth > 0)
+			return;
+		if(_pendingChange.isEmpty())
+			return;
+		table_change change = _pendingChange;
+		_pendingChange.clear();
+		for(int i=0; i<_listeners.length(); i++)
+			_listeners[i]->onTableUpdated(this, change);
+	}
+	bool isUpdating() const
+	{
+		return (_updateDepth > 0);
+	}
+
 protected:
 	// column names
 	_array_<_string_> _colNames;
@@ -270,13 +877,120 @@ protected:
 	// change listeners
 	_array_< table_listener<elem_type>* > _listeners;
 
-	// boundary point to use insertion sort
-	int const INSERTION_SORT_BOUND;
+	// the value standing for null, if _hasNullValue
+	elem_type _nullValue;
+	bool _hasNullValue;
+
+	// the sorted view: row indexes, and the columns they are sorted on
+	_array_<int> _view;
+	_array_<int> _viewCols;
+
+	// column indexes, parallel to _data: the column's rows sorted
+	// on their values, NULL for a column with no index
+	_array_< _ptr_<index_array> > _indexes;
+
+	// dictionaries, parallel to _data: the codes and values of an
+	// encoded column (whose _data array is left empty), NULL for
+	// a plain one
+	_array_< _ptr_<dict_column> > _dicts;
+
+	// beginUpdate() nesting, and the changes made meanwhile
+	int _updateDepth;
+	table_change _pendingChange;
 
 protected:
-	// @sortCol is the column to sort on
-	void _quickSort(int sortCol, int first, int last);
-	void _heapSort(int sortCol, int first, int cElems);
+	// moves row perm[i] to row i, for all the rows
+	void _permuteRows(const _array_<int>& perm);
+
+	// Values of plain and encoded columns alike
+	const elem_type& _valueAt(int col, int row) const
+	{
+		if(_dicts[col] != NULL)
+			return _dicts[col]->get(row);
+		return (*_data[col])[row];
+	}
+	void _setValue(int row, int col, const elem_type& val)
+	{
+		if(_dicts[col] != NULL)
+			_writeDict(col).set(row, val);
+		else
+			_writeData(col)[row] = val;
+	}
+	// count values into the column at row
+	void _insertValues(int col, int row, const elem_type* values, int count)
+	{
+		if(_dicts[col] != NULL)
+			_writeDict(col).insert(row, values, count);
+		else
+			_writeData(col).insertNAt(row, values, count);
+	}
+	// grows the column to rows rows with empty values
+	void _growColumn(int col, int rows)
+	{
+		if(_dicts[col] != NULL)
+			_writeDict(col).resize(rows);
+		else
+			_writeData(col).resize(rows);
+	}
+
+	// Copy on write: the copies of a table share its columns,
+	// indexes and dictionaries (see the copy constructor), and
+	// one is cloned when a table that shares it is to change it.
+	// These give them for changing; copy is false when the
+	// contents are about to be replaced, and needn't be cloned.
+	elem_array& _writeData(int col, bool copy = true)
+	{
+		if(_data[col].isShared())
+			_data[col] = copy ? new elem_array(*_data[col]) : new elem_array();
+		return *_data[col];
+	}
+	index_array& _writeIndex(int col, bool copy = true)
+	{
+		if(_indexes[col].isShared())
+			_indexes[col] = copy ? new index_array(*_indexes[col]) : new index_array();
+		return *_indexes[col];
+	}
+	dict_column& _writeDict(int col)
+	{
+		if(_dicts[col].isShared())
+			_dicts[col] = new dict_column(*_dicts[col]);
+		return *_dicts[col];
+	}
+
+	// rows inserted or removed at row
+	void _fireRowsChanged(int row, int inserted, int removed)
+	{
+		if(_updateDepth > 0)
+		{
+			dropSortedView();
+			_pendingChange.addRows(row, inserted, removed, _rowCount, _colNames.length());
+		}
+		else
+			fireTableChanged();
+	}
+
+	// Index upkeep
+	// position of (val, row) in the column's index, or where it would go
+	int _indexLowerBound(int col, const elem_type& val, int row) const;
+	// removes the row's entries from the indexes (before the row changes)
+	void _indexRemoveRow(int row);
+	// adds the row's entries to the indexes (after the row changes)
+	void _indexInsertRow(int row);
+	// adds delta to the rows from fromRow on, in all the indexes
+	void _indexShiftRows(int fromRow, int delta);
+	// drops count rows starting with row from the indexes,
+	// and moves the rows after them down
+	void _indexRemoveRows(int row, int count);
+	// adds the rows from fromRow on (the last ones) to the indexes:
+	// they're sorted and merged into each index
+	void _indexAppendRows(int fromRow);
+	void _indexAppendRows(int col, int fromRow);
+	void _rebuildIndexes()
+	{
+		for(int i=0; i<_indexes.length(); i++)
+			if(_indexes[i] != NULL)
+				getSortPermutation(i, _writeIndex(i, false));
+	}
 	
 	// Assignments
 	// to a temp array from table row
@@ -284,19 +998,19 @@ protected:
 	{
 		arr.resize(_colNames.length());
 		for(int i=0; i<arr.length(); i++)
-			arr[i] = _data.get(i)->get(row);
+			arr[i] = _valueAt(i, row);
 	}
 	// to a table row from temp array
 	void _assignRow(int row, elem_array& arr)
 	{
 		for(int i=0; i<_colNames.length(); i++)
-			_data.get(i)->get(row) = arr[i];
+			_setValue(row, i, arr[i]);
 	}
 	// from one table row (row2 == src) to another (row1 == dest)
 	void _assignRow(int row1, int row2)
 	{
 		for(int i=0; i<_colNames.length(); i++)
-			_data.get(i)->get(row1) = _data.get(i)->get(row2);
+			_setValue(row1, i, _valueAt(i, row2));
 	}
 };
 
@@ -308,6 +1022,8 @@ template<typename elem_type>
 	_colNames = colNames;
 	// redimension the data array as well
 	_data.resize(_colNames.length());
+	_indexes.resize(_colNames.length());
+	_dicts.resize(_colNames.length());
 	int i;
 	for(i=0; i<_colNames.length(); i++)
 		if(_data[i] == NULL) _data[i] = new elem_array();
@@ -327,16 +1043,99 @@ template<typename elem_type>
 	if(index > _rowCount)
 		index = _rowCount;
 
+	_indexShiftRows(index, 1);
 	for(int i=0; i<_data.length(); i++)
 	{
 		if(i < newRow.length())
-			_data[i]->insert(newRow[i], index);
+			_insertValues(i, index, &newRow[i], 1);
 		else
+		{
 		// supplied number of values is fewer than table's cols; fill with empty elems
-			_data[i]->insert(elem_type(), index);
+			elem_type empty = elem_type();
+			_insertValues(i, index, &empty, 1);
+		}
 	}
 	_rowCount += 1;
-	fireTableChanged();
+	_indexInsertRow(index);
+	_fireRowsChanged(index, 1, 0);
+	return true;
+}
+
+
+template<typename elem_type>
+	void _table_<elem_type>::appendRows ( const elem_type* rows, int count )
+{
+	if(count < 1)
+		return;
+	// each column's values are gathered, then copied in at once
+	int cols = _data.length();
+	elem_array values;
+	values.resize(count);
+	for(int i=0; i<cols; i++)
+	{
+		const elem_type* val = &rows[i];
+		for(int row=0; row<count; row++, val += cols)
+			values[row] = *val;
+		_insertValues(i, _rowCount, &values[0], count);
+	}
+	int prevRows = _rowCount;
+	_rowCount += count;
+	_indexAppendRows(prevRows);
+	_fireRowsChanged(prevRows, count, 0);
+}
+
+
+template<typename elem_type>
+	bool _table_<elem_type>::setColumnData ( int col, const elem_type* values, int count )
+{
+	if(col < 0 || col >= _colNames.length() || count < 0)
+		return false;
+	int prevRows = _rowCount;
+	if(count > _rowCount)
+	{
+		// the other columns get empty values
+		for(int i=0; i<_data.length(); i++)
+			if(i != col)
+				_growColumn(i, count);
+		_rowCount = count;
+	}
+	int row, toCopy = (count < prevRows) ? count : prevRows;
+	if(_dicts[col] != NULL)
+	{
+		dict_column& dict = _writeDict(col);
+		for(row=0; row<toCopy; row++)
+			dict.set(row, values[row]);
+	}
+	else
+	{
+		elem_array& column = _writeData(col);
+		for(row=0; row<toCopy; row++)
+			column[row] = values[row];
+	}
+	if(count > toCopy)
+		_insertValues(col, toCopy, &values[toCopy], count - toCopy);
+	// the column's index is sorted again; the others only get
+	// the empty values of any new rows
+	for(int i=0; i<_indexes.length(); i++)
+	{
+		if(_indexes[i] == NULL)
+			continue;
+		if(i == col)
+			getSortPermutation(i, _writeIndex(i, false));
+		else if(_rowCount > prevRows)
+			_indexAppendRows(i, prevRows);
+	}
+
+	dropSortedView();
+	if(_updateDepth > 0)
+	{
+		if(_rowCount > prevRows)
+			_pendingChange.addRows(prevRows, _rowCount - prevRows, 0, _rowCount, _colNames.length());
+		if(count > 0)
+			_pendingChange.addCells(0, count - 1, col);
+	}
+	else
+		fireTableChanged();
 	return true;
 }
 
@@ -346,18 +1145,27 @@ template<typename elem_type>
 {
 	if(row1 < 0 || row2 < 0 || row1 >= _rowCount || row2 >= _rowCount)
 		return false;
+	dropSortedView();
+	if(row1 == row2)
+		return true;
+	_indexRemoveRow(row1);
+	_indexRemoveRow(row2);
 
-	int i;
-	elem_array temp;
-	temp.resize(_colNames.length());
-	
-	for(i=0; i<temp.length(); i++)
-		temp[i] = _data.get(i)->get(row1);
-	for(i=0; i<temp.length(); i++)
-		_data.get(i)->get(row1) = _data.get(i)->get(row2);
-	for(i=0; i<temp.length(); i++)
-		_data.get(i)->get(row2) = temp[i];
+	for(int i=0; i<_colNames.length(); i++)
+	{
+		if(_dicts[i] != NULL)
+		{
+			_writeDict(i).swap(row1, row2);
+			continue;
+		}
+		elem_array& column = _writeData(i);
+		elem_type temp = column[row1];
+		column[row1] = column[row2];
+		column[row2] = temp;
+	}
 
+	_indexInsertRow(row1);
+	_indexInsertRow(row2);
 	return true;
 }
 
@@ -372,12 +1180,18 @@ template<typename elem_type>
 	if(fromRow >= _rowCount || fromCol >= _colNames.length())
 		return false;
 
+	// the value's code in each encoded column, -1 if it isn't there
 	int i, j;
+	_array_<int> codes;
+	codes.resize(_colNames.length());
+	for(j=fromCol; j<_colNames.length(); j++)
+		codes[j] = (_dicts[j] != NULL) ? _dicts[j]->findCode(val) : -1;
+
 	for(i=fromRow; i<_rowCount; i++)
 	{
 		for(j=fromCol; j<_colNames.length(); j++)
 		{
-			if(_data.get(j)->get(i) == val)
+			if(_dicts[j] != NULL ? _dicts[j]->getCode(i) == codes[j] : _data.get(j)->get(i) == val)
 			{
 				*pRow = i;
 				*pCol = j;
@@ -392,244 +1206,422 @@ template<typename elem_type>
 
 
 template<typename elem_type>
-	void _table_<elem_type>::_quickSort ( int sortCol, int first, int last )
+	int _table_<elem_type>::findInColumn ( int col, const elem_type& val ) const
 {
-	int stack_pointer = 0;
-	int first_stack[32];
-	int last_stack[32];
-
-	for (;;)
+	if(col < 0 || col >= _colNames.length())
+		return -1;
+	if(_indexes[col] == NULL)
 	{
-		if (last - first <= INSERTION_SORT_BOUND)
+		if(_dicts[col] != NULL)
 		{
-			// for small sort, use insertion sort
-			int indx;
-			elem_array prev_val;
-			elem_array cur_val;
-			_assignRow(prev_val, first);
+			// look the value up once, then compare the codes
+			int code = _dicts[col]->findCode(val);
+			return (code < 0) ? -1 : _dicts[col]->findRow(code, 0);
+		}
+		const elem_array& values = *_data[col];
+		for(int row=0; row<_rowCount; row++)
+			if(_compare(values[row], val) == 0)
+				return row;
+		return -1;
+	}
+	int pos = _indexLowerBound(col, val, -1);
+	if(pos < _rowCount && _compare(_valueAt(col, _indexes[col]->get(pos)), val) == 0)
+		return _indexes[col]->get(pos);
+	return -1;
+}
 
-			for (indx = first + 1; indx <= last; ++indx)
-			{
-				_assignRow(cur_val, indx);
-				if ( _compare(prev_val[sortCol], cur_val[sortCol]) > 0 )
-				{
-					int indx2;
-					// out of order
-					_assignRow(indx, prev_val);
-
-					for (indx2 = indx - 1; indx2 > first; --indx2)
-					{
-						elem_array temp_val;
-						_assignRow(temp_val, indx2 - 1);
-						if ( _compare(temp_val[sortCol], cur_val[sortCol]) > 0 )
-							_assignRow(indx2, temp_val);
-						else
-							break;
-					}
-					_assignRow(indx2, cur_val);
-				}
-				else
-				{
-					// in order, advance to next element
-					prev_val = cur_val;
-				}
-			}
-		} // end if (insertion sort)
+
+template<typename elem_type>
+	bool _table_<elem_type>::getSortPermutation ( const sort_key* keys, int nkeys,
+												_array_<int>& perm ) const
+{
+	int i;
+	if(nkeys < 1)
+		return false;
+	for(i=0; i<nkeys; i++)
+		if(keys[i].col < 0 || keys[i].col >= _colNames.length())
+			return false;
+
+	perm.resize(_rowCount);
+	if(_rowCount < 2)
+	{
+		if(_rowCount)
+			perm[0] = 0;
+		return true;
+	}
+
+	_array_< _table_key_column_<elem_type> > cols;
+	// the ranks of the rows' values in the encoded key columns
+	_array_<index_array> ranks;
+	cols.resize(nkeys);
+	ranks.resize(nkeys);
+	for(i=0; i<nkeys; i++)
+	{
+		const dict_column* dict = getDictColumn(keys[i].col);
+		cols[i].values = NULL;
+		cols[i].ranks = NULL;
+		cols[i].nullRank = -1;
+		if(dict == NULL)
+			cols[i].values = &(*_data[keys[i].col])[0];
 		else
 		{
-			// try quick sort
-			elem_array pivot;
-			int med = (first + last) >> 1;
-
-			// Choose pivot from first, last, and median position.
-			// Sort the three elements.
-			if ( _compare(_data.get(sortCol)->get(first), _data.get(sortCol)->get(last)) > 0 )
-				swapRows(first, last);
-
-			if ( _compare(_data.get(sortCol)->get(first), _data.get(sortCol)->get(med)) > 0 )
-				swapRows(med, first);
-
-			if ( _compare(_data.get(sortCol)->get(med), _data.get(sortCol)->get(last)) > 0 )
-				swapRows(last, med);
-
-			_assignRow(pivot, med);
-
-			int up;
-			int down;
-			// First and last element will be loop stopper.
-			// Split array into two partitions.
-			down = first;
-			up = last;
-			for (;;)
-			{
-				do
-				{
-					++down;
-				} while ( _compare(pivot[sortCol], _data.get(sortCol)->get(down)) > 0 );
-
-				do
-				{
-					--up;
-				} while ( _compare(_data.get(sortCol)->get(up), pivot[sortCol]) > 0 );
-
-				if (up > down)
-					swapRows(down, up);  // interchange L[down] and L[up]
-				else
-					break;
-			}
+			index_array codeRanks;
+			dict->getRanks(codeRanks);
+			index_array& rowRanks = ranks[i];
+			rowRanks.resize(_rowCount);
+			for(int row=0; row<_rowCount; row++)
+				rowRanks[row] = codeRanks[dict->getCode(row)];
+			cols[i].ranks = &rowRanks[0];
+			int nullCode = _hasNullValue ? dict->findCode(_nullValue) : -1;
+			if(nullCode >= 0)
+				cols[i].nullRank = codeRanks[nullCode];
+		}
+		cols[i].sign = keys[i].descending ? -1 : 1;
+		// null rows go before (-1) or after (1) all the others
+		cols[i].nullSide = 0;
+		if(_hasNullValue && keys[i].nulls != sort_key::nulls_as_values)
+			cols[i].nullSide = (keys[i].nulls == sort_key::nulls_first) ? -1 : 1;
+	}
 
-			int len1; // length of first segment
-			int len2; // length of second segment
-			len1 = up - first + 1;
-			len2 = last - up;
-			if (len1 >= len2)
-			{
-				if ( (len1 >> 5) > len2 )
-				{
-					// badly balanced partitions, heap sort first segment
-					_heapSort(sortCol, first, len1);
-				}
-				else
-				{
-					first_stack[stack_pointer] = first; // stack first segment
-					last_stack[stack_pointer++] = up;
-				} 
-				first = up + 1;
-				// tail recursion elimination of
-				// _quickSort(Array,fun_ptr,up + 1,last)
-			}
-			else
-			{
-				if ( (len2 >> 5) > len1 )
-				{
-					// badly balanced partitions, heap sort second segment
-					_heapSort(sortCol, up + 1, len2);
-				}
-				else
-				{
-					first_stack[stack_pointer] = up + 1; // stack second segment
-					last_stack[stack_pointer++] = last;
-				}
-				last = up;
-				// tail recursion elimination of
-				// _quickSort(Array,fun_ptr,first,up)
-			}
+	_array_< _table_sort_entry_<elem_type> > entries;
+	entries.resize(_rowCount);
+	for(i=0; i<_rowCount; i++)
+	{
+		if(cols[0].ranks)
+			entries[i].rank = cols[0].ranks[i];
+		else
+			entries[i].key = cols[0].values[i];
+		entries[i].row = i;
+	}
+	_sort_< _table_sort_entry_<elem_type> > sorter;
+	sorter.sort(&entries[0], _rowCount,
+		_table_row_order_<elem_type>(&cols[0], nkeys, _hasNullValue ? &_nullValue : NULL));
+	for(i=0; i<_rowCount; i++)
+		perm[i] = entries[i].row;
+	return true;
+}
+
+
+template<typename elem_type>
+	bool _table_<elem_type>::encodeColumn ( int col )
+{
+	if(col < 0 || col >= _colNames.length())
+		return false;
+	if(_dicts[col] != NULL)
+		return true;
+	// the values and their order stay the same, and so do the indexes
+	dict_column* dict = new dict_column();
+	if(_rowCount > 0)
+		dict->insert(0, &(*_data[col])[0], _rowCount);
+	_dicts[col] = dict;
+	_data[col] = new elem_array();
+	return true;
+}
+
+
+template<typename elem_type>
+	bool _table_<elem_type>::decodeColumn ( int col )
+{
+	if(col < 0 || col >= _colNames.length())
+		return false;
+	if(_dicts[col] == NULL)
+		return true;
+	elem_array* values = new elem_array();
+	values->resize(_rowCount);
+	for(int row=0; row<_rowCount; row++)
+		(*values)[row] = _dicts[col]->get(row);
+	_data[col] = values;
+	_dicts[col] = NULL;
+	return true;
+}
 
-			continue;
-		
-			// end of quick sort //
-		
-		} // end else
 
-		if (stack_pointer > 0)
+template<typename elem_type>
+	void _table_<elem_type>::_permuteRows ( const _array_<int>& perm )
+{
+	// gather each column into a new one, in the new order
+	for(int i=0; i<_data.length(); i++)
+	{
+		if(_dicts[i] != NULL)
 		{
-			// Sort segment from stack.
-			first = first_stack[--stack_pointer];
-			last = last_stack[stack_pointer];
+			_writeDict(i).permute(perm);
+			continue;
 		}
+		const elem_array& oldCol = *_data[i];
+		elem_array* newCol = new elem_array();
+		newCol->resize(_rowCount);
+		for(int row=0; row<_rowCount; row++)
+			(*newCol)[row] = oldCol[perm[row]];
+		_data[i] = newCol;
+	}
+}
+
+
+
+template<typename elem_type>
+	int _table_<elem_type>::_indexLowerBound ( int col, const elem_type& val, int row ) const
+{
+	const index_array& index = *_indexes[col];
+	int lo = 0, hi = index.length();
+	while(lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		int c = _compare(_valueAt(col, index[mid]), val);
+		if(c == 0)
+			c = index[mid] - row;
+		if(c < 0)
+			lo = mid + 1;
 		else
-			break;
-	} // end for
+			hi = mid;
+	}
+	return lo;
 }
 
 
 template<typename elem_type>
-	void _table_<elem_type>::_heapSort ( int sortCol, int first, int cElems )
+	void _table_<elem_type>::_indexRemoveRow ( int row )
 {
-	int half;
-	int parent;
+	for(int i=0; i<_indexes.length(); i++)
+		if(_indexes[i] != NULL)
+			_writeIndex(i).removeAt(_indexLowerBound(i, _valueAt(i, row), row));
+}
 
-	if (cElems <= 1)
-		return;
 
-	half = cElems >> 1;
-	for (parent = half; parent >= 1; --parent)
+template<typename elem_type>
+	void _table_<elem_type>::_indexInsertRow ( int row )
+{
+	for(int i=0; i<_indexes.length(); i++)
+		if(_indexes[i] != NULL)
+			_writeIndex(i).insert(row, _indexLowerBound(i, _valueAt(i, row), row));
+}
+
+
+template<typename elem_type>
+	void _table_<elem_type>::_indexShiftRows ( int fromRow, int delta )
+{
+	// the order of the entries stays the same
+	for(int i=0; i<_indexes.length(); i++)
 	{
-		elem_array temp;
-		int level = 0;
-		int child;
+		if(_indexes[i] == NULL)
+			continue;
+		index_array& index = _writeIndex(i);
+		for(int pos=0; pos<index.length(); pos++)
+			if(index[pos] >= fromRow)
+				index[pos] += delta;
+	}
+}
 
-		child = parent;
-		// bottom-up downheap
 
-		// leaf-search for largest child path
-		while (child <= half)
-		{
-			++level;
-			child += child;
-			if (
-				(child < cElems) &&
-				(_compare(_data.get(sortCol)->get(first + child), _data.get(sortCol)->get(first + child - 1)) > 0)
-			   )
-				++child;
-		}
-		// bottom-up-search for rotation point
-		_assignRow(temp, first + parent - 1);
-		for (;;)
-		{
-			if (parent == child)
-				break;
-			if ( _compare(temp[sortCol], _data.get(sortCol)->get(first + child - 1)) <= 0 )
-				break;
-			child >>= 1;
-			--level;
-		}
-		// rotate nodes from parent to rotation point
-		for (; level > 0; --level)
+
+template<typename elem_type>
+	void _table_<elem_type>::_indexAppendRows ( int fromRow )
+{
+	for(int i=0; i<_indexes.length(); i++)
+		if(_indexes[i] != NULL)
+			_indexAppendRows(i, fromRow);
+}
+
+
+template<typename elem_type>
+	void _table_<elem_type>::_indexAppendRows ( int col, int fromRow )
+{
+	int count = _rowCount - fromRow;
+	if(count < 1)
+		return;
+	// the new rows by value, then by row, as the index has them
+	_array_< _table_sort_entry_<elem_type> > entries;
+	entries.resize(count);
+	int k;
+	for(k=0; k<count; k++)
+	{
+		entries[k].key = _valueAt(col, fromRow + k);
+		entries[k].row = fromRow + k;
+	}
+	_table_key_column_<elem_type> key;
+	key.values = NULL;
+	key.ranks = NULL;
+	key.nullRank = -1;
+	key.sign = 1;
+	key.nullSide = 0;
+	_sort_< _table_sort_entry_<elem_type> > sorter;
+	sorter.sort(&entries[0], count, _table_row_order_<elem_type>(&key, 1, NULL));
+
+	// merged from the back: the new rows go after the old ones
+	// with the same value
+	index_array& index = _writeIndex(col);
+	int old = index.length(), pos = old + count;
+	index.resize(pos);
+	for(k=count-1; k>=0; )
+	{
+		if(old > 0 && _compare(_valueAt(col, index[old - 1]), entries[k].key) > 0)
+			index[--pos] = index[--old];
+		else
+			index[--pos] = entries[k--].row;
+	}
+}
+
+
+template<typename elem_type>
+	void _table_<elem_type>::_indexRemoveRows ( int row, int count )
+{
+	// one pass over each index, keeping the order of the entries
+	int end = row + count;
+	for(int i=0; i<_indexes.length(); i++)
+	{
+		if(_indexes[i] == NULL)
+			continue;
+		index_array& index = _writeIndex(i);
+		int pos, kept = 0;
+		for(pos=0; pos<index.length(); pos++)
 		{
-			_assignRow( first + (child >> level) - 1,
-						first + (child >> (level - 1)) - 1 );
+			int r = index[pos];
+			if(r >= row && r < end)
+				continue;
+			index[kept++] = (r >= end) ? r - count : r;
 		}
-		_assignRow(first + child - 1, temp);
+		index.removeNAt(kept, index.length() - kept);
 	}
+}
+
 
-	--cElems;
-	do
+
+//------------------------------------------------------------
+// _table_dict_column_
+//------------------------------------------------------------
+template<typename code_type>
+	inline int _findCode ( const code_type* codes, int fromRow, int rows, int code )
+{
+	for(int row=fromRow; row<rows; row++)
+		if(codes[row] == code)
+			return row;
+	return -1;
+}
+
+
+template<typename elem_type>
+	int _table_dict_column_<elem_type>::encode ( const elem_type& val )
+{
+	int pos = _lowerBound(val);
+	if(pos < _byValue.length() && _compare(_values[_byValue[pos]], val) == 0)
+		return _byValue[pos];
+	int code = _values.length();
+	_values.append(val);
+	_byValue.insert(code, pos);
+	if( (_width == 1 && code > 0xFF) || (_width == 2 && code > 0xFFFF) )
+		_widen();
+	return code;
+}
+
+
+template<typename elem_type>
+	void _table_dict_column_<elem_type>::insert ( int row, const elem_type* values, int count )
+{
+	if(count < 1)
+		return;
+	if(count == 1)
 	{
-		elem_array temp1;
-		int level = 0;
-		int child;
+		int code = encode(values[0]);
+		unsigned char bytes[4];
+		_setCode(bytes, 0, code);
+		_codes.insertNAt(row*_width, bytes, _width);
+		_length++;
+		return;
+	}
+	// all the values are encoded first: the codes may get wider meanwhile
+	_array_<int> codes;
+	codes.resize(count);
+	int i;
+	for(i=0; i<count; i++)
+		codes[i] = encode(values[i]);
+	_array_<unsigned char> bytes;
+	bytes.resize(count*_width);
+	for(i=0; i<count; i++)
+		_setCode(&bytes[0], i, codes[i]);
+	_codes.insertNAt(row*_width, &bytes[0], count*_width);
+	_length += count;
+}
 
-		// move max element to back of array
-		swapRows(first + cElems, first);
-		_assignRow(temp1, first + cElems);
 
-		child = parent = 1;
-		half = cElems >> 1;
+template<typename elem_type>
+	void _table_dict_column_<elem_type>::insertValue ( int row, const elem_type& val, int count )
+{
+	if(count < 1)
+		return;
+	int code = encode(val);
+	_array_<unsigned char> bytes;
+	bytes.resize(count*_width);
+	for(int i=0; i<count; i++)
+		_setCode(&bytes[0], i, code);
+	_codes.insertNAt(row*_width, &bytes[0], count*_width);
+	_length += count;
+}
 
-		// bottom-up downheap
 
-		// leaf-search for largest child path
-		while (child <= half)
-		{
-			++level;
-			child += child;
-			if (
-				(child < cElems) &&
-				(_compare(_data.get(sortCol)->get(first + child), _data.get(sortCol)->get(first + child - 1)) > 0)
-			   )
-				++child;
-		}
-		// bottom-up-search for rotation point
-		for (;;)
-		{
-			if (parent == child)
-				break;
-			if ( _compare(temp1[sortCol], _data.get(sortCol)->get(first + child - 1)) <= 0 )
-				break;
-			child >>= 1;
-			--level;
-		}
-		// rotate nodes from parent to rotation point
-		for (; level > 0; --level)
-		{
-			_assignRow( first + (child >> level) - 1,
-						first + (child >> (level - 1)) - 1 );
-		}
-		
-		_assignRow(first + child - 1, temp1);
+template<typename elem_type>
+	void _table_dict_column_<elem_type>::resize ( int rows )
+{
+	if(rows < _length)
+		remove(rows, _length - rows);
+	else
+		insertValue(_length, elem_type(), rows - _length);
+}
+
+
+template<typename elem_type>
+	void _table_dict_column_<elem_type>::permute ( const _array_<int>& perm )
+{
+	if(_length == 0)
+		return;
+	_array_<unsigned char> moved;
+	moved.resize(_codes.length());
+	for(int row=0; row<_length; row++)
+		_setCode(&moved[0], row, getCode(perm[row]));
+	_copyN<unsigned char>(&_codes[0], &moved[0], moved.length());
+}
+
+
+template<typename elem_type>
+	int _table_dict_column_<elem_type>::findRow ( int code, int fromRow ) const
+{
+	if(fromRow < 0)
+		fromRow = 0;
+	switch(_width)
+	{
+	case 1:		return _findCode((const unsigned char*)_bytes(), fromRow, _length, code);
+	case 2:		return _findCode((const unsigned short*)_bytes(), fromRow, _length, code);
+	default:	return _findCode((const int*)_bytes(), fromRow, _length, code);
+	}
+}
+
+
+template<typename elem_type>
+	int _table_dict_column_<elem_type>::_lowerBound ( const elem_type& val ) const
+{
+	int lo = 0, hi = _byValue.length();
+	while(lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if(_compare(_values[_byValue[mid]], val) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
 
-	} while (--cElems >= 1);
+
+template<typename elem_type>
+	void _table_dict_column_<elem_type>::_widen ( )
+{
+	_array_<int> codes;
+	codes.resize(_length);
+	int row;
+	for(row=0; row<_length; row++)
+		codes[row] = getCode(row);
+	_width = (_width == 1) ? 2 : 4;
+	_codes.resize(_length*_width);
+	for(row=0; row<_length; row++)
+		_setCode(_bytes(), row, codes[row]);
 }
 
 
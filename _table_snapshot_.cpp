@@ -0,0 +1,329 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _table_snapshot_.cpp - implementation file for the
+// _table_snapshot_ class.
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "_table_snapshot_.h"
+
+namespace soige {
+
+//------------------------------------------------------------
+// Strings to bytes and back
+//------------------------------------------------------------
+__int64 _snapshotBytes(const _string_* values, int count)
+{
+	__int64 bytes = (count + 1) * sizeof(__int64);
+	for(int i=0; i<count; i++)
+		bytes += values[i].length() + 1;
+	return bytes;
+}
+
+bool _snapshotWrite(_win32_file_& file, const _string_* values, int count)
+{
+	// the offsets, then the strings, through a buffer
+	_array_<char> buf;
+	buf.resize(0x10000);
+	int len = 0, i;
+	__int64 offset = 0;
+	for(i=0; i<=count; i++)
+	{
+		if(len + (int)sizeof(__int64) > buf.length())
+		{
+			if(file.write(&buf[0], len) != len)
+				return false;
+			len = 0;
+		}
+		memcpy(&buf[len], &offset, sizeof(__int64));
+		len += sizeof(__int64);
+		if(i < count)
+			offset += values[i].length() + 1;
+	}
+	for(i=0; i<count; i++)
+	{
+		int n = values[i].length() + 1;
+		if(len + n > buf.length())
+		{
+			if(len > 0 && file.write(&buf[0], len) != len)
+				return false;
+			len = 0;
+			if(n > buf.length())
+			{
+				// a string longer than the buffer, with its 0
+				if(file.write(values[i].c_str(), n) != n)
+					return false;
+				continue;
+			}
+		}
+		if(n > 1)
+			memcpy(&buf[len], values[i].c_str(), n - 1);
+		buf[len + n - 1] = '\0';
+		len += n;
+	}
+	return ( len == 0 || file.write(&buf[0], len) == len );
+}
+
+void _snapshotRead(const char* data, int count, _string_* values)
+{
+	for(int i=0; i<count; i++)
+	{
+		int len;
+		LPCSTR p = _snapshotString(data, count, i, &len);
+		if(len == 0)
+			values[i] = _string_();
+		else
+			values[i].replaceBytes(p, len, 0, values[i].length());
+	}
+}
+
+
+//------------------------------------------------------------
+// _table_snapshot_
+//------------------------------------------------------------
+_table_snapshot_::_table_snapshot_()
+{
+	_hMapping = NULL;
+	close();
+}
+
+_table_snapshot_::~_table_snapshot_()
+{
+	close();
+}
+
+bool _table_snapshot_::open(LPCTSTR fileName)
+{
+	close();
+	_file.reset(fileName);
+	if( !_file.open(access_read, share_read, open_existing) )
+		return false;
+	DWORD sizeHigh = 0;
+	DWORD sizeLow = GetFileSize(_file.getFileHandle(), &sizeHigh);
+	_fileSize = ((__int64)sizeHigh << 32) | sizeLow;
+
+	// the header, the columns and the names are read; the
+	// columns' values get mapped when they're used
+	bool ok = ( _file.read(&_header, sizeof(_header)) == sizeof(_header) &&
+				memcmp(_header.magic, "soigetbl", 8) == 0 && _header.version == 1 &&
+				_header.rows <= 0x7FFFFFFF &&
+				(__int64)_header.cols * sizeof(table_file_column) + _header.namesBytes <= _fileSize );
+	if(ok && _header.cols > 0)
+	{
+		_columns.resize(_header.cols);
+		long bytes = _header.cols * sizeof(table_file_column);
+		ok = ( _file.read(&_columns[0], bytes) == bytes );
+	}
+	if(ok)
+	{
+		_names.resize(_header.namesBytes + 1);
+		ok = ( _header.namesBytes == 0 ||
+			   _file.read(&_names[0], _header.namesBytes) == (long)_header.namesBytes );
+		_names[_header.namesBytes] = '\0';
+	}
+	int col;
+	for(col=0; ok && col<(int)_header.cols; col++)
+	{
+		const table_file_column& c = _columns[col];
+		ok = ( c.offset >= 0 && c.bytes >= 0 && c.offset + c.bytes <= _fileSize &&
+			   c.nameOffset < _header.namesBytes && c.type <= column_string &&
+			   (c.width == 0 || c.width == 1 || c.width == 2 || c.width == 4) &&
+			   c.dictSize <= 0x7FFFFFFF );
+	}
+	if(ok)
+	{
+		_hMapping = CreateFileMapping(_file.getFileHandle(), NULL, PAGE_READONLY, 0, 0, NULL);
+		ok = ( _hMapping != NULL );
+	}
+	if(ok)
+	{
+		_views.resize(_header.cols);
+		for(int i=0; i<_views.length(); i++)
+		{
+			_views[i].base = NULL;
+			_views[i].checked = false;
+		}
+	}
+	// each column has to hold what its rows take, so that
+	// nothing reads past it
+	for(col=0; ok && col<(int)_header.cols; col++)
+		ok = _checkSize(col);
+	if( !ok )
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void _table_snapshot_::close()
+{
+	for(int col=0; col<_views.length(); col++)
+		releaseColumn(col);
+	_views.clear();
+	if(_hMapping)
+		CloseHandle(_hMapping);
+	_hMapping = NULL;
+	_file.close();
+	memset(&_header, 0, sizeof(_header));
+	_columns.clear();
+	_names.clear();
+	_fileSize = 0;
+}
+
+int _table_snapshot_::getColumnByName(const _string_& colName) const
+{
+	for(int col=0; col<getColumnCount(); col++)
+		if(colName.compare(&_names[_columns[col].nameOffset]) == 0)
+			return col;
+	return -1;
+}
+
+LPCSTR _table_snapshot_::getString(int row, int col, int* pLen)
+{
+	const table_file_column& c = _columns[col];
+	if(c.type != column_string)
+		return NULL;
+	if(c.width != 0)
+		return getDictString(_code(getCodes(col), c.width, row), col, pLen);
+	const char* data = _columnBytes(col);
+	return data ? _snapshotString(data, getRowCount(), row, pLen) : NULL;
+}
+
+const void* _table_snapshot_::getCodes(int col)
+{
+	const table_file_column& c = _columns[col];
+	const char* data = (c.width != 0) ? _columnBytes(col) : NULL;
+	return data ? data + _codesOffset(c, data) : NULL;
+}
+
+const void* _table_snapshot_::getDictData(int col)
+{
+	const table_file_column& c = _columns[col];
+	return (c.width != 0) ? _columnBytes(col) : NULL;
+}
+
+LPCSTR _table_snapshot_::getDictString(int code, int col, int* pLen)
+{
+	const table_file_column& c = _columns[col];
+	if((DWORD)code >= c.dictSize)
+		return NULL;
+	const char* data = (c.type == column_string && c.width != 0) ? _columnBytes(col) : NULL;
+	return data ? _snapshotString(data, c.dictSize, code, pLen) : NULL;
+}
+
+void _table_snapshot_::releaseColumn(int col)
+{
+	if(_views[col].base)
+		UnmapViewOfFile(_views[col].base);
+	_views[col].base = NULL;
+}
+
+const char* _table_snapshot_::_columnBytes(int col)
+{
+	column_view& view = _views[col];
+	if(view.base)
+		return view.data;
+	const table_file_column& c = _columns[col];
+	if(c.bytes == 0)
+		return NULL;
+	// a view has to start at a multiple of the allocation granularity
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	__int64 start = c.offset / si.dwAllocationGranularity * si.dwAllocationGranularity;
+	__int64 bytes = c.offset + c.bytes - start;
+	if(bytes != (__int64)(size_t)bytes)
+		return NULL;	// more than the address space
+	view.base = MapViewOfFile(_hMapping, FILE_MAP_READ, (DWORD)(start >> 32),
+							  (DWORD)(start & 0xFFFFFFFF), (size_t)bytes);
+	if(view.base == NULL)
+		return NULL;
+	view.data = (const char*)view.base + (c.offset - start);
+	if( !view.checked && !_checkOffsets(col) )
+	{
+		releaseColumn(col);
+		return NULL;
+	}
+	view.checked = true;
+	return view.data;
+}
+
+bool _table_snapshot_::_checkSize(int col)
+{
+	const table_file_column& c = _columns[col];
+	__int64 rows = _header.rows;
+	if(c.width == 0 && c.type != column_string)
+		return ( c.bytes == rows * _valueBytes(c.type) );
+
+	// the values of the column or of its dictionary; of strings,
+	// the offsets, then as many bytes as the last offset says
+	__int64 values = (c.width == 0) ? rows : (__int64)c.dictSize;
+	__int64 bytes = values * _valueBytes(c.type);
+	if(c.type == column_string)
+	{
+		__int64 last;
+		bytes = (values + 1) * sizeof(__int64);
+		if(bytes > c.bytes || !_readAt(c.offset + bytes - sizeof(__int64), &last, sizeof(last)) ||
+		   last < 0 || last > c.bytes - bytes)
+			return false;
+		bytes += last;
+	}
+	if(c.width == 0)
+		return ( c.bytes == bytes );
+	// then the codes, at the next multiple of 8
+	return ( c.bytes == _align(bytes, 8) + rows * c.width );
+}
+
+bool _table_snapshot_::_checkOffsets(int col)
+{
+	// the strings' offsets, from 0 up to the last one, which
+	// _checkSize() has seen is within the column
+	const table_file_column& c = _columns[col];
+	if(c.type != column_string)
+		return true;
+	int count = (c.width == 0) ? getRowCount() : (int)c.dictSize;
+	const __int64* offsets = (const __int64*)_views[col].data;
+	if(offsets[0] != 0)
+		return false;
+	for(int i=0; i<count; i++)
+		if(offsets[i + 1] <= offsets[i])
+			return false;
+	return true;
+}
+
+bool _table_snapshot_::_readAt(__int64 pos, void* buf, int bytes)
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	__int64 start = pos / si.dwAllocationGranularity * si.dwAllocationGranularity;
+	void* base = MapViewOfFile(_hMapping, FILE_MAP_READ, (DWORD)(start >> 32),
+							   (DWORD)(start & 0xFFFFFFFF), (size_t)(pos + bytes - start));
+	if(base == NULL)
+		return false;
+	memcpy(buf, (const char*)base + (pos - start), bytes);
+	UnmapViewOfFile(base);
+	return true;
+}
+
+const char* _table_snapshot_::_plainData(int col, column_type type)
+{
+	const table_file_column& c = _columns[col];
+	if(c.type != (DWORD)type || c.width != 0)
+		return NULL;
+	return _columnBytes(col);
+}
+
+bool _table_snapshot_::_pad(_win32_file_& file, __int64& pos, __int64 to)
+{
+	static const char zeros[TABLE_SNAPSHOT_ALIGN] = { 0 };
+	while(pos < to)
+	{
+		int n = (to - pos > TABLE_SNAPSHOT_ALIGN) ? TABLE_SNAPSHOT_ALIGN : (int)(to - pos);
+		if(file.write(zeros, n) != n)
+			return false;
+		pos += n;
+	}
+	return true;
+}
+
+
+};	// namespace soige
@@ -0,0 +1,515 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// _table_snapshot_.h - header file for the _table_snapshot_
+// class.
+//
+// Saves a _table_<> to a binary file column by column, and
+// opens such a file to read it back. A file holds a header
+// (the number of rows and columns, and each column's name,
+// type and place in the file), then each column's values one
+// after another. A dictionary-encoded column is saved as its
+// dictionary and codes, and plain columns can be encoded in
+// the file too where it makes them smaller.
+//
+// An open snapshot maps each column of the file into memory
+// (with a file mapping) only when it's first asked for, so
+// opening a file of any size takes no time and only the
+// columns that are used get read in. Numeric columns can be
+// scanned right where they are mapped, by _column_query_<>
+// for instance; load() copies the whole file into a table.
+//
+// Usage:
+//     _table_snapshot_::save(tbl, _T("prices.tbl"));
+//     ...
+//     _table_snapshot_ snap;
+//     if( snap.open(_T("prices.tbl")) )
+//     {
+//         const double* prices = snap.getDoubleData(2);
+//         ...
+//     }
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifndef __table_snapshot_already_included_vasya__
+#define __table_snapshot_already_included_vasya__
+
+#include "_common_.h"
+#include "_array_.h"
+#include "_ptr_.h"
+#include "_string_.h"
+#include "_table_.h"
+#include "_column_table_.h"
+#include "_win32_file_.h"
+
+// where the columns start in a file written: at a multiple of
+// this many bytes (any multiple of 8 can be read)
+#ifndef TABLE_SNAPSHOT_ALIGN
+	#define TABLE_SNAPSHOT_ALIGN  64
+#endif
+
+namespace soige {
+
+//------------------------------------------------------------
+// The layout of the file: the header, a table_file_column
+// for each column, the column names (each followed by a 0),
+// and then the columns.
+//
+// A column of numbers is its values. A column of strings is
+// the offsets of its strings (rows+1 of them, __int64) from
+// the end of the offsets, then the strings, each followed by
+// a 0. An encoded column is its dictionary, laid out as a
+// column of dictSize values, then at the next multiple of 8
+// the codes of the rows, width bytes each.
+//------------------------------------------------------------
+struct table_file_header
+{
+	char	magic[8];	// "soigetbl"
+	DWORD	version;
+	DWORD	cols;
+	DWORD	rows;
+	DWORD	namesBytes;	// of all the names, with their 0s
+};
+
+struct table_file_column
+{
+	DWORD	type;		// a column_type
+	DWORD	flags;		// table_file_flags
+	DWORD	width;		// bytes per code of an encoded column, 0 if it's plain
+	DWORD	dictSize;	// values in the dictionary of an encoded column
+	DWORD	nameOffset;	// of the name, from the start of the names
+	DWORD	reserved;
+	__int64	offset;		// of the values, from the start of the file
+	__int64	bytes;
+};
+
+enum table_file_flags
+{
+	// encoded in the table it was saved from, not just in the file
+	table_file_encoded = 1
+};
+
+//------------------------------------------------------------
+// Values to bytes and back
+//------------------------------------------------------------
+
+// bytes taken in the file by count values
+template<typename value_type>
+	inline __int64 _snapshotBytes(const value_type* values, int count)
+{
+	return (__int64)count * sizeof(value_type);
+}
+__int64 _snapshotBytes(const _string_* values, int count);
+
+// writes count values, false on a failure
+template<typename value_type>
+	inline bool _snapshotWrite(_win32_file_& file, const value_type* values, int count)
+{
+	// in pieces, as write() takes a DWORD
+	const char* p = (const char*)values;
+	__int64 left = _snapshotBytes(values, count);
+	while(left > 0)
+	{
+		DWORD chunk = (left > 0x1000000) ? 0x1000000 : (DWORD)left;
+		if(file.write(p, chunk) != (long)chunk)
+			return false;
+		p += chunk;
+		left -= chunk;
+	}
+	return true;
+}
+bool _snapshotWrite(_win32_file_& file, const _string_* values, int count);
+
+// copies count values from data, laid out as _snapshotWrite() has them
+template<typename value_type>
+	inline void _snapshotRead(const char* data, int count, value_type* values)
+{
+	memcpy(values, data, count * sizeof(value_type));
+}
+void _snapshotRead(const char* data, int count, _string_* values);
+
+// the i-th of the strings in data, and its length
+inline LPCSTR _snapshotString(const char* data, int count, int i, int* pLen)
+{
+	const __int64* offsets = (const __int64*)data;
+	const char* chars = data + (count + 1) * sizeof(__int64);
+	if(pLen)
+		*pLen = (int)(offsets[i + 1] - offsets[i] - 1);
+	return chars + offsets[i];
+}
+
+
+//------------------------------------------------------------
+// A table saved to a file, and opened from it
+//------------------------------------------------------------
+class _table_snapshot_
+{
+public:
+	_table_snapshot_();
+	virtual ~_table_snapshot_();
+
+	// Writes the table to a file, replacing it if there's one.
+	// The table's encoded columns are saved encoded; with
+	// encode, so is any other column with few distinct values
+	// that takes less room that way. The table can have int,
+	// __int64, double or _string_ values. False if the file
+	// can't be written.
+	template<typename elem_type>
+		static bool save(const _table_<elem_type>& tbl, LPCTSTR fileName, bool encode = false)
+	{
+		typedef _table_dict_column_<elem_type> dict_column;
+		int cols = tbl.getColumnCount(), rows = tbl.getRowCount(), col;
+		column_type type = _columnType((const elem_type*)NULL);
+		_array_<table_file_column> dir;
+		dir.resize(cols);
+		// the columns encoded for the file only
+		_array_< _ptr_<dict_column> > fileDicts;
+		fileDicts.resize(cols);
+		_array_<char> names;
+
+		// where everything goes
+		for(col=0; col<cols; col++)
+		{
+			table_file_column& c = dir[col];
+			memset(&c, 0, sizeof(c));
+			c.type = type;
+			c.nameOffset = names.length();
+			_string_ name = tbl.getColumnName(col);
+			names.insertNAt(names.length(), name.c_str() ? name.c_str() : "", name.length());
+			names.append('\0');
+
+			const dict_column* dict = tbl.getDictColumn(col);
+			if(dict == NULL && encode && rows > 0)
+			{
+				fileDicts[col] = _fileDict(tbl.getColumnData(col), rows);
+				if(fileDicts[col] != NULL)
+					dict = &(*fileDicts[col]);
+			}
+			if(dict)
+			{
+				c.flags = tbl.isEncoded(col) ? table_file_encoded : 0;
+				c.width = dict->getCodeWidth();
+				c.dictSize = dict->dictSize();
+				c.bytes = _dictBytes(dict);
+			}
+			else
+				c.bytes = _snapshotBytes(tbl.getColumnData(col), rows);
+		}
+		table_file_header header;
+		memcpy(header.magic, "soigetbl", 8);
+		header.version = 1;
+		header.cols = cols;
+		header.rows = rows;
+		header.namesBytes = names.length();
+		__int64 pos = sizeof(header) + cols * sizeof(table_file_column) + names.length();
+		for(col=0; col<cols; col++)
+		{
+			pos = _align(pos, TABLE_SNAPSHOT_ALIGN);
+			dir[col].offset = pos;
+			pos += dir[col].bytes;
+		}
+
+		_win32_file_ file(fileName);
+		if( !file.open(access_write, share_read, create_always) )
+			return false;
+		bool ok = ( file.write(&header, sizeof(header)) == sizeof(header) &&
+					(cols == 0 || _snapshotWrite(file, &dir[0], cols)) &&
+					(names.length() == 0 || _snapshotWrite(file, &names[0], names.length())) );
+		pos = sizeof(header) + cols * sizeof(table_file_column) + names.length();
+		for(col=0; ok && col<cols; col++)
+		{
+			ok = _pad(file, pos, dir[col].offset);
+			const dict_column* dict = (fileDicts[col] != NULL) ? &(*fileDicts[col]) : tbl.getDictColumn(col);
+			if(ok && dict)
+				ok = _writeDict(file, dict);
+			else if(ok && rows > 0)
+				ok = _snapshotWrite(file, tbl.getColumnData(col), rows);
+			pos += dir[col].bytes;
+		}
+		file.close();
+		return ok;
+	}
+
+	// Opens a snapshot file; its columns are read when they're
+	// first used. False if it isn't a snapshot, or if a column
+	// doesn't have the bytes its rows and dictionary take. A
+	// column of strings whose offsets don't go up isn't mapped:
+	// its strings are NULL.
+	bool open(LPCTSTR fileName);
+	void close();
+	bool isOpen() const
+	{
+		return _hMapping != NULL;
+	}
+
+	int getRowCount() const
+	{
+		return _header.rows;
+	}
+	int getColumnCount() const
+	{
+		return _header.cols;
+	}
+	_string_ getColumnName(int col) const
+	{
+		return _string_(&_names[_columns[col].nameOffset]);
+	}
+	int getColumnByName(const _string_& colName) const;
+	column_type getColumnType(int col) const
+	{
+		return (column_type)_columns[col].type;
+	}
+	// whether the column is encoded in the file
+	bool isEncoded(int col) const
+	{
+		return ( _columns[col].width != 0 );
+	}
+
+	// The values of a plain column of numbers, in the file's
+	// memory; NULL if the column is encoded or of another type
+	const int* getIntData(int col)
+	{
+		return (const int*)_plainData(col, column_int);
+	}
+	const __int64* getInt64Data(int col)
+	{
+		return (const __int64*)_plainData(col, column_int64);
+	}
+	const double* getDoubleData(int col)
+	{
+		return (const double*)_plainData(col, column_double);
+	}
+	// a string of a column of strings, plain or encoded; its
+	// length goes to *pLen
+	LPCSTR getString(int row, int col, int* pLen = NULL);
+
+	// Encoded columns: the codes of the rows, getCodeWidth()
+	// bytes each, and the dictionary - the values by code, as
+	// numbers or with getDictString()
+	int getCodeWidth(int col) const
+	{
+		return _columns[col].width;
+	}
+	int getDictSize(int col) const
+	{
+		return _columns[col].dictSize;
+	}
+	const void* getCodes(int col);
+	const void* getDictData(int col);
+	LPCSTR getDictString(int code, int col, int* pLen = NULL);
+
+	// unmaps the column, until it's used again
+	void releaseColumn(int col);
+
+	// Copies the file into the table, replacing what it had; the
+	// columns that were encoded in the table saved are encoded
+	// again. False if the file's columns are of another type.
+	template<typename elem_type>
+		bool load(_table_<elem_type>& tbl)
+	{
+		if( !isOpen() )
+			return false;
+		int cols = getColumnCount(), rows = getRowCount(), col, row;
+		column_type type = _columnType((const elem_type*)NULL);
+		for(col=0; col<cols; col++)
+			if(getColumnType(col) != type)
+				return false;
+
+		tbl.beginUpdate();
+		tbl.clear();
+		_array_<_string_> header;
+		header.resize(cols);
+		for(col=0; col<cols; col++)
+			header[col] = getColumnName(col);
+		tbl.setHeader(header);
+		_array_<elem_type> values;
+		bool ok = true;
+		for(col=0; ok && col<cols; col++)
+		{
+			const char* data = _columnBytes(col);
+			ok = ( data != NULL || _columns[col].bytes == 0 );
+			if( !ok )
+				break;
+			const table_file_column& c = _columns[col];
+			if(c.width == 0)
+			{
+				if(type != column_string)
+				{
+					// straight from the file's memory
+					if(rows > 0)
+						tbl.setColumnData(col, (const elem_type*)data, rows);
+					releaseColumn(col);
+					continue;
+				}
+				values.resize(rows);
+				_snapshotRead(data, rows, rows ? &values[0] : (elem_type*)NULL);
+			}
+			else
+			{
+				// the values of the codes
+				_array_<elem_type> dict;
+				dict.resize(c.dictSize);
+				_snapshotRead(data, c.dictSize, c.dictSize ? &dict[0] : (elem_type*)NULL);
+				values.resize(rows);
+				const void* codes = data + _codesOffset(c, data);
+				for(row=0; ok && row<rows; row++)
+				{
+					DWORD code = (DWORD)_code(codes, c.width, row);
+					ok = ( code < c.dictSize );
+					if(ok)
+						values[row] = dict[code];
+				}
+				if( !ok )
+					break;
+			}
+			if(rows > 0)
+				tbl.setColumnData(col, &values[0], rows);
+			if(c.flags & table_file_encoded)
+				tbl.encodeColumn(col);
+			values.clear();
+			releaseColumn(col);
+		}
+		tbl.endUpdate();
+		return ok;
+	}
+
+protected:
+	_win32_file_	_file;
+	HANDLE	_hMapping;
+	__int64	_fileSize;
+	table_file_header	_header;
+	_array_<table_file_column>	_columns;
+	_array_<char>	_names;
+	// each column's view of the file, mapped when it's first used
+	struct column_view
+	{
+		void*	base;	// as mapped, from a multiple of the allocation granularity
+		const char*	data;
+		bool	checked;	// its strings' offsets, when it was first mapped
+	};
+	_array_<column_view>	_views;
+
+	// the column's data, mapping it if it isn't yet; NULL on a failure
+	const char* _columnBytes(int col);
+	const char* _plainData(int col, column_type type);
+	// whether the column's bytes are what its rows and dictionary
+	// take, and whether its strings' offsets go up, one string
+	// after another
+	bool _checkSize(int col);
+	bool _checkOffsets(int col);
+	// reads bytes at pos in the file, through a view of them
+	bool _readAt(__int64 pos, void* buf, int bytes);
+	static int _valueBytes(DWORD type)
+	{
+		return (type == column_int) ? sizeof(int) : sizeof(__int64);
+	}
+
+	// where the codes of an encoded column are, from its data
+	static int _codesOffset(const table_file_column& c, const char* data)
+	{
+		return (int)_align(_dictValuesBytes(c, data), 8);
+	}
+	static __int64 _dictValuesBytes(const table_file_column& c, const char* data)
+	{
+		if(c.type != column_string)
+			return (__int64)c.dictSize * _valueBytes(c.type);
+		// the offsets, then the strings up to the last offset
+		return (c.dictSize + 1) * sizeof(__int64) + ((const __int64*)data)[c.dictSize];
+	}
+	static int _code(const void* codes, int width, int row)
+	{
+		switch(width)
+		{
+		case 1:		return ((const unsigned char*)codes)[row];
+		case 2:		return ((const unsigned short*)codes)[row];
+		default:	return ((const int*)codes)[row];
+		}
+	}
+	static __int64 _align(__int64 pos, int alignment)
+	{
+		return (pos + alignment - 1) / alignment * alignment;
+	}
+	// writes zeros up to the position
+	static bool _pad(_win32_file_& file, __int64& pos, __int64 to);
+
+	// The values encoded, if that makes them smaller in the file,
+	// or NULL. Adding values to a dictionary gets slow when there
+	// are many, so it's only tried if the first rows have few
+	// distinct values, and given up past 65536 of them.
+	template<typename elem_type>
+		static _table_dict_column_<elem_type>* _fileDict(const elem_type* values, int rows)
+	{
+		_table_dict_column_<elem_type>* dict = new _table_dict_column_<elem_type>();
+		int sample = (rows < 4096) ? rows : 4096;
+		dict->insert(0, values, sample);
+		bool ok = ( dict->dictSize() <= sample / 4 );
+		for(int row=sample; ok && row<rows; row += 0x10000)
+		{
+			dict->insert(row, values + row, (rows - row < 0x10000) ? rows - row : 0x10000);
+			ok = ( dict->dictSize() <= 0x10000 );
+		}
+		if(ok && _dictBytes(dict) < _snapshotBytes(values, rows))
+			return dict;
+		delete dict;
+		return NULL;
+	}
+	// an encoded column in the file
+	template<typename elem_type>
+		static __int64 _dictBytes(const _table_dict_column_<elem_type>* dict)
+	{
+		__int64 bytes = _dictValues(dict, (_array_<elem_type>*)NULL);
+		return _align(bytes, 8) + (__int64)dict->length() * dict->getCodeWidth();
+	}
+	// the dictionary's values by code; their bytes in the file
+	template<typename elem_type>
+		static __int64 _dictValues(const _table_dict_column_<elem_type>* dict, _array_<elem_type>* values)
+	{
+		_array_<elem_type> temp;
+		if(values == NULL)
+			values = &temp;
+		values->resize(dict->dictSize());
+		for(int i=0; i<dict->dictSize(); i++)
+			(*values)[i] = dict->decode(i);
+		return _snapshotBytes(values->length() ? &(*values)[0] : (const elem_type*)NULL, values->length());
+	}
+	template<typename elem_type>
+		static bool _writeDict(_win32_file_& file, const _table_dict_column_<elem_type>* dict)
+	{
+		_array_<elem_type> values;
+		__int64 pos = _dictValues(dict, &values);
+		if(values.length() > 0 && !_snapshotWrite(file, &values[0], values.length()))
+			return false;
+		values.clear();
+		if( !_pad(file, pos, _align(pos, 8)) )
+			return false;
+		// the codes, a block of rows at a time
+		int width = dict->getCodeWidth(), rows = dict->length();
+		_array_<unsigned char> codes;
+		codes.resize(0x10000 * width);
+		for(int row=0; row<rows; row += 0x10000)
+		{
+			int n = (rows - row < 0x10000) ? rows - row : 0x10000;
+			for(int i=0; i<n; i++)
+			{
+				int code = dict->getCode(row + i);
+				switch(width)
+				{
+				case 1:		codes[i] = (unsigned char)code; break;
+				case 2:		((unsigned short*)&codes[0])[i] = (unsigned short)code; break;
+				default:	((int*)&codes[0])[i] = code; break;
+				}
+			}
+			if( !_snapshotWrite(file, &codes[0], n * width) )
+				return false;
+		}
+		return true;
+	}
+
+private:
+	// no byval operations
+	_table_snapshot_(const _table_snapshot_&) { }
+	_table_snapshot_& operator=(const _table_snapshot_&) { return *this; }
+};
+
+
+};	// namespace soige
+
+#endif // __table_snapshot_already_included_vasya__
@@ -4,6 +4,7 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include "_wstring_.h"
+#include "_num_conv_.h"
 
 namespace soige {
 
@@ -159,17 +160,19 @@ _wstring_& _wstring_::operator+=(WCHAR chr)
 
 _wstring_& _wstring_::operator+=(long val)
 {
-	WCHAR buf[32];
-	_ltow(val, buf, 10);
-	return this->operator+=(buf);
+	char buf[NUM_CONV_CHARS];
+	int len = _formatLong(val, buf);
+	WCHAR wbuf[NUM_CONV_CHARS];
+	for( int i = 0; i <= len; i++ ) wbuf[i] = buf[i];
+	return this->operator+=(wbuf);
 }
 
 _wstring_& _wstring_::operator+=(double val)
 {
-	char buf[64];
-	_gcvt(val, 8, buf);
-	WCHAR wbuf[64];
-	mbstowcs ( wbuf, buf, sizeof(wbuf)/sizeof(wbuf[0]) );
+	char buf[NUM_CONV_CHARS];
+	int len = _formatDouble(val, buf);
+	WCHAR wbuf[NUM_CONV_CHARS];
+	for( int i = 0; i <= len; i++ ) wbuf[i] = buf[i];
 	return this->operator+=(wbuf);
 }
 
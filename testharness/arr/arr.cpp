@@ -83,6 +83,10 @@ void check_array()
 	dbl_arr.sort();
 	dbl_arr.resize(34);
 	dbl_arr = dbl_arr;
+	d = dbl_arr[0];
+	dbl_arr.reserve(100);
+	if(dbl_arr.capacity() < 100 || dbl_arr.length() != 34 || dbl_arr[0] != d)
+		printf("Bad reserve\n");
 
 
 	test t;
@@ -145,5 +149,9 @@ void check_array()
 	str_arr.sort();
 	str_arr.resize(34);
 	str_arr = str_arr;
+	s = str_arr[0];
+	str_arr.reserve(1000);
+	if(str_arr.capacity() < 1000 || str_arr.length() != 34 || str_arr[0] != s)
+		printf("Bad reserve\n");
 }
 
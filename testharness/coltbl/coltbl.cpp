@@ -0,0 +1,227 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// coltbl.cpp - checks the column table class
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <crtdbg.h>
+
+#include <_column_table_.h>
+#include <_string_.h>
+
+using namespace soige;
+
+void check_column_table();
+void check_column_table_sort();
+void column_table_performance();
+
+int main(int argc, char* argv[])
+{
+	printf("Checking _column_table_\n");
+	check_column_table();
+	_CrtDumpMemoryLeaks();
+	check_column_table_sort();
+	_CrtDumpMemoryLeaks();
+	column_table_performance();
+	_CrtDumpMemoryLeaks();
+	return 0;
+}
+
+
+//------------------------------------
+// column table tests
+
+static const char* cities[] = { "Oslo", "Lima", "Pune", "Kyiv", "Graz" };
+
+// id, amount, total, name and city columns
+void fill_column_table(_column_table_& tbl, int rows)
+{
+	tbl.clear();
+	tbl.appendColumn(_string_("id"), column_int);
+	tbl.appendColumn(_string_("amount"), column_double);
+	tbl.appendColumn(_string_("total"), column_int64);
+	tbl.appendColumn(_string_("name"), column_string);
+	tbl.appendColumn(_string_("city"), column_dict_string);
+	tbl.reserveRows(rows);
+	char name[16];
+	for(int r=0; r < rows; r++)
+	{
+		int row = tbl.appendRow();
+		tbl.setInt(row, 0, r);
+		tbl.setDouble(row, 1, (rand() % 1000) / 4.0);
+		tbl.setInt64(row, 2, (__int64)r * 1000000);
+		sprintf(name, "n%d", r);
+		tbl.setString(row, 3, _string_(name));
+		tbl.setString(row, 4, _string_(cities[rand() % 5]));
+	}
+}
+
+void check_column_table()
+{
+	_column_table_ tbl;
+	fill_column_table(tbl, 1000);
+	if(tbl.getRowCount() != 1000 || tbl.getColumnCount() != 5 ||
+	   tbl.getColumnType(4) != column_dict_string || tbl.getColumnByName(_string_("total")) != 2)
+		printf("Bad column table shape\n");
+
+	// typed access, and the wider numeric types
+	if(tbl.getInt(7, 0) != 7 || tbl.getInt64(7, 0) != 7 || tbl.getDouble(7, 0) != 7.0 ||
+	   tbl.getInt64(7, 2) != 7000000 || tbl.getDouble(7, 2) != 7000000.0 ||
+	   tbl.getString(7, 3).compare("n7") != 0)
+		printf("Bad column table values\n");
+	bool thrown = false;
+	try {
+		tbl.getInt(0, 1);
+	}
+	catch(exception&) {
+		thrown = true;
+	}
+	if(!thrown)
+		printf("Bad column table type check\n");
+
+	// dense data
+	if(tbl.getIntData(0) == NULL || tbl.getIntData(0)[999] != 999 ||
+	   tbl.getDoubleData(0) != NULL || tbl.getInt64Data(2)[3] != 3000000)
+		printf("Bad column table data\n");
+
+	// the dictionary column keeps each city once
+	const dict_string_column* city = static_cast<const dict_string_column*>(tbl.getColumn(4));
+	if(city->dictSize() != 6 || city->getCodeWidth() != 1 ||
+	   city->decode(city->getCode(10)).compare(tbl.getString(10, 4)) != 0)
+		printf("Bad dictionary column\n");
+
+	// finding
+	int row = tbl.findString(4, _string_("Kyiv"));
+	if(row < 0 || tbl.getString(row, 4).compare("Kyiv") != 0 ||
+	   tbl.findString(4, _string_("Rome")) != -1 || tbl.findString(3, _string_("n500")) != 500 ||
+	   tbl.findInt(0, 123, 100) != 123 || tbl.findInt(0, 123, 124) != -1 ||
+	   tbl.findInt64(2, 5000000) != 5 || tbl.findDouble(0, 1.0) != -1)
+		printf("Bad column table find\n");
+	if(tbl.findInt(0, 0, -1000000) != 0 || tbl.findString(3, _string_("n0"), -1) != 0 ||
+	   tbl.findString(4, tbl.getString(0, 4), -1000000) != 0)
+		printf("Bad column table find from a negative row\n");
+
+	// rows and columns
+	_column_table_ copy = tbl;
+	if(copy != tbl)
+		printf("Bad column table copy\n");
+	tbl.insertRow(5);
+	if(tbl.getInt(5, 0) != 0 || tbl.getString(5, 3).length() != 0 ||
+	   tbl.getString(5, 4).length() != 0 || tbl.getInt(6, 0) != 5)
+		printf("Bad column table insertRow\n");
+	tbl.removeRow(5);
+	if(tbl != copy)
+		printf("Bad column table removeRow\n");
+	tbl.swapRows(1, 2);
+	if(tbl.getInt(1, 0) != 2 || tbl.getString(1, 3).compare("n2") != 0)
+		printf("Bad column table swapRows\n");
+	tbl.swapRows(1, 2);
+	tbl.removeRows(100, 800);
+	if(tbl.getRowCount() != 200 || tbl.getInt(100, 0) != 900)
+		printf("Bad column table removeRows\n");
+	tbl.insertColumn(_string_("flag"), column_int, 1);
+	if(tbl.getColumnCount() != 6 || tbl.getInt(150, 1) != 0 || tbl.getDouble(150, 2) != copy.getDouble(950, 1))
+		printf("Bad column table insertColumn\n");
+	tbl.swapColumns(0, 1);
+	tbl.removeColumn(1);
+	if(tbl.getColumnName(0).compare("flag") != 0 || tbl.getColumnType(1) != column_double)
+		printf("Bad column table swap/removeColumn\n");
+	tbl.removeAllRows();
+	if(tbl.getRowCount() != 0 || tbl.getColumnCount() != 5 || tbl.getIntData(0) != NULL)
+		printf("Bad column table removeAllRows\n");
+	tbl.clear();
+}
+
+void check_column_table_sort()
+{
+	_column_table_ tbl;
+	fill_column_table(tbl, 5000);
+
+	// by city, then amount descending; equal rows in id order
+	sort_key keys[2];
+	keys[0] = sort_key(4);
+	keys[1] = sort_key(1, true);
+	tbl.sort(keys, 2);
+	char name[16];
+	for(int r=1; r < tbl.getRowCount(); r++)
+	{
+		int c = tbl.getString(r - 1, 4).compare(tbl.getString(r, 4));
+		if(c == 0)
+			c = (tbl.getDouble(r - 1, 1) < tbl.getDouble(r, 1)) - (tbl.getDouble(r - 1, 1) > tbl.getDouble(r, 1));
+		if(c > 0 || (c == 0 && tbl.getInt(r - 1, 0) > tbl.getInt(r, 0)))
+		{
+			printf("Bad column table sort\n");
+			break;
+		}
+		sprintf(name, "n%d", tbl.getInt(r, 0));
+		if(tbl.getString(r, 3).compare(name) != 0)
+		{
+			printf("Bad column table sort: rows mixed up\n");
+			break;
+		}
+	}
+	tbl.sort(0);
+	for(int row=0; row < tbl.getRowCount(); row++)
+		if(tbl.getInt(row, 0) != row || tbl.getInt64(row, 2) != (__int64)row * 1000000)
+		{
+			printf("Bad column table sort back by id\n");
+			break;
+		}
+	if(tbl.sort(5))
+		printf("Bad column table sort on a missing column\n");
+}
+
+void column_table_performance()
+{
+	int const rows = 1000000;
+	_column_table_ tbl;
+	fill_column_table(tbl, rows);
+	int r;
+
+	// the same values in a table of strings, as they used to be kept
+	_table_<_string_> stbl;
+	_array_<_string_> header;
+	header.append(_string_("amount"));
+	stbl.setHeader(header);
+	_array_<_string_> row;
+	row.resize(1);
+	char buf[32];
+	for(r=0; r < rows; r++)
+	{
+		sprintf(buf, "%g", tbl.getDouble(r, 1));
+		row[0] = buf;
+		stbl.appendRow(row);
+	}
+
+	unsigned long c = GetTickCount();
+	double sum = 0;
+	for(r=0; r < rows; r++)
+		sum += atof(stbl.getValueAt(r, 0).c_str());
+	c = GetTickCount()-c;
+	printf("sum of 1M parsed strings: %u\n", c);
+
+	c = GetTickCount();
+	double sum1 = 0;
+	const double* amounts = tbl.getDoubleData(1);
+	for(r=0; r < rows; r++)
+		sum1 += amounts[r];
+	c = GetTickCount()-c;
+	printf("sum of a 1M double column: %u\n", c);
+	if(sum != sum1)
+		printf("Bad column sum\n");
+
+	// a value in the last row only: each scan goes through the column
+	tbl.setString(rows - 1, 4, _string_("Zagreb"));
+	c = GetTickCount();
+	int found = 0;
+	for(r=0; r < 20; r++)
+		found += (tbl.findString(4, _string_("Zagreb")) >= 0);
+	c = GetTickCount()-c;
+	printf("20 dictionary column scans, 1M rows: %u\n", c);
+	c = GetTickCount();
+	for(r=0; r < 20; r++)
+		found += (tbl.findString(3, _string_("n999999")) >= 0);
+	c = GetTickCount()-c;
+	printf("20 string column scans, 1M rows: %u\n", c);
+	if(found != 40)
+		printf("Bad column scans\n");
+}
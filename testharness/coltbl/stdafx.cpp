@@ -0,0 +1,3 @@
+
+#include <_string_.cpp>
+#include <_column_table_.cpp>
@@ -0,0 +1,427 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// csv.cpp - checks the CSV/TSV reader and writer
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <crtdbg.h>
+
+#include <_csv_.h>
+#include <_table_.h>
+#include <_string_.h>
+
+using namespace soige;
+
+_thread_pool_ pool;
+
+void check_csv_records();
+void check_csv_parse();
+void check_csv_table();
+void csv_performance();
+
+int main(int argc, char* argv[])
+{
+	printf("Checking _csv_reader_ and _csv_writer_\n");
+	check_csv_records();
+	_CrtDumpMemoryLeaks();
+	check_csv_parse();
+	_CrtDumpMemoryLeaks();
+	check_csv_table();
+	_CrtDumpMemoryLeaks();
+	csv_performance();
+	_CrtDumpMemoryLeaks();
+	return 0;
+}
+
+
+//------------------------------------
+// record tests
+
+LPCTSTR csvFile = _T("csv_test.csv");
+
+bool same_fields(const _array_<_string_>& fields, const char** expected, int count)
+{
+	if(fields.length() != count)
+		return false;
+	for(int i=0; i < count; i++)
+		if(fields[i].compare(expected[i]) != 0)
+			return false;
+	return true;
+}
+
+void check_csv_records()
+{
+	static const char* tricky[] = { "plain", "with,comma", "with \"quotes\"", "two\r\nlines",
+									"", "  spaced  ", "\"" };
+	static const char* empty[] = { "" };
+	static const char* gaps[] = { "a", "", "c", "" };
+	_array_<_string_> fields;
+	int i;
+
+	_csv_writer_ writer;
+	if(!writer.open(csvFile))
+		printf("Bad writer open\n");
+	for(i=0; i < 7; i++)
+		fields.append(_string_(tricky[i]));
+	writer.writeRecord(fields);
+	fields.clear();
+	fields.append(_string_());
+	writer.writeRecord(fields);
+	for(i=0; i < 4; i++)
+		writer.writeField(gaps[i], strlen(gaps[i]));
+	writer.endRecord();
+	if(!writer.close())
+		printf("Bad writer close\n");
+
+	_csv_reader_ reader;
+	if(!reader.open(csvFile))
+		printf("Bad reader open\n");
+	if(!reader.readRecord(fields) || !same_fields(fields, tricky, 7))
+		printf("Bad quoted fields\n");
+	if(!reader.readRecord(fields) || !same_fields(fields, empty, 1))
+		printf("Bad record of one empty field\n");
+	if(!reader.readRecord(fields) || !same_fields(fields, gaps, 4))
+		printf("Bad empty fields\n");
+	if(reader.readRecord(fields) || reader.getBytesRead() != writer.getBytesWritten())
+		printf("Bad end of file\n");
+	reader.close();
+
+	// TSV without quoting
+	static const char* plain[] = { "a,b", "\"q\"", "", "d" };
+	csv_options tsv('\t', false, 0);
+	_csv_writer_ tsvWriter(tsv);
+	tsvWriter.open(csvFile);
+	fields.clear();
+	for(i=0; i < 4; i++)
+		fields.append(_string_(plain[i]));
+	tsvWriter.writeRecord(fields);
+	tsvWriter.writeRecord(fields);
+	tsvWriter.close();
+	_csv_reader_ tsvReader(tsv);
+	tsvReader.open(csvFile);
+	if(!tsvReader.readRecord(fields) || !same_fields(fields, plain, 4) ||
+	   !tsvReader.readRecord(fields) || !same_fields(fields, plain, 4) || tsvReader.readRecord(fields))
+		printf("Bad TSV\n");
+	tsvReader.close();
+	DeleteFile(csvFile);
+}
+
+
+//------------------------------------
+// parsing tests, on text written by hand
+
+void check_csv_parse()
+{
+	_win32_file_ file(csvFile);
+	file.open(access_write, share_read, create_always);
+	file.writeString("\"name\",\"qty\",note\r\n");
+	file.writeString("apple,3,\"said \"\"hi\"\"\"\n");
+	file.writeString("\n");
+	file.writeString("\"multi\nline\",7\r\n");
+	file.writeString("pear,,x,extra\n");
+	file.writeString("\"plum\"");		// no line break at the end
+	file.close();
+
+	static const char* header[] = { "name", "qty", "note" };
+	static const char* apple[] = { "apple", "3", "said \"hi\"" };
+	static const char* multi[] = { "multi\nline", "7" };
+	static const char* pear[] = { "pear", "", "x", "extra" };
+	static const char* plum[] = { "plum" };
+	_array_<_string_> fields;
+	_csv_reader_ reader;
+	reader.open(csvFile);
+	if(!reader.readRecord(fields) || !same_fields(fields, header, 3) ||
+	   !reader.readRecord(fields) || !same_fields(fields, apple, 3) ||
+	   !reader.readRecord(fields) || !same_fields(fields, multi, 2) ||
+	   !reader.readRecord(fields) || !same_fields(fields, pear, 4) ||
+	   !reader.readRecord(fields) || !same_fields(fields, plum, 1) ||
+	   reader.readRecord(fields))
+		printf("Bad records\n");
+
+	// into a table: short rows are filled, long ones cut
+	_table_<_string_> tbl;
+	reader.open(csvFile);
+	if(!reader.readTable(tbl) || tbl.getColumnCount() != 3 || tbl.getRowCount() != 4 ||
+	   tbl.getColumnName(2).compare("note") != 0 || tbl.getValueAt(0, 2).compare(apple[2]) != 0 ||
+	   tbl.getValueAt(1, 2).length() != 0 || tbl.getValueAt(2, 2).compare("x") != 0 ||
+	   tbl.getValueAt(3, 0).compare("plum") != 0)
+		printf("Bad table from CSV\n");
+
+	// without a header, the first record is a row
+	csv_options noHeader;
+	noHeader.header = false;
+	_csv_reader_ rowReader(noHeader);
+	rowReader.open(csvFile);
+	_table_<_string_> rows;
+	rowReader.readTable(rows);
+	if(rows.getColumnCount() != 3 || rows.getRowCount() != 5 || rows.getValueAt(0, 1).compare("qty") != 0)
+		printf("Bad table from CSV without a header\n");
+	rowReader.close();
+	reader.close();
+
+	// quotes that aren't at the start of a field are characters, in
+	// the split of the blocks as in the records: small blocks parsed
+	// in parts give what reading the records one by one gives
+	int const records = 20000;
+	int r;
+	file.open(access_write, share_read, create_always);
+	for(r=0; r < records; r++)
+	{
+		static const char* middles[] = { "a\"b", "\"q,\"\"x\"\"\nline\"", "\"c\"d\"", "5\" tall", "plain" };
+		char buf[64];
+		sprintf(buf, "%d,%s,%s\n", r, middles[r % 5], (r % 3) ? "x" : "x\"");
+		file.writeString(buf);
+	}
+	file.close();
+	_csv_reader_ seqReader(noHeader);
+	seqReader.open(csvFile);
+	_table_<_string_> seq;
+	seq.setColumnCount(3);
+	_array_<_string_> row;
+	while( seqReader.readRecord(fields) )
+	{
+		row.resize(3);
+		for(int i=0; i < 3; i++)
+			row[i] = (i < fields.length()) ? fields[i] : _string_();
+		seq.appendRow(row);
+	}
+	seqReader.close();
+	_csv_reader_ parReader(noHeader, 1024);
+	parReader.open(csvFile);
+	_table_<_string_> par;
+	parReader.readTable(par, &pool, 4);
+	parReader.close();
+	if(seq.getRowCount() != records || par != seq || seq.getValueAt(1, 1).compare("q,\"x\"\nline") != 0 ||
+	   seq.getValueAt(0, 1).compare("a\"b") != 0 || seq.getValueAt(2, 1).compare("c") != 0)
+		printf("Bad split of stray quotes\n");
+	DeleteFile(csvFile);
+}
+
+
+//------------------------------------
+// table tests: what is written reads back the same, in
+// small blocks split into parts
+
+bool round_trip(const _table_<int>& tbl, _thread_pool_* tp, int parts)
+{
+	_csv_writer_ writer;
+	writer.open(csvFile);
+	writer.writeTable(tbl);
+	writer.close();
+	_csv_reader_ reader(csv_options(), 256 * 1024);
+	reader.open(csvFile);
+	_table_<int> read;
+	reader.readTable(read, tp, parts);
+	return ( read == tbl && reader.getBytesRead() == writer.getBytesWritten() );
+}
+
+void check_csv_table()
+{
+	int const rows = 100000;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("value"));
+	header.append(_string_("name"));
+	int r;
+
+	_table_<int> ints;
+	ints.setHeader(header);
+	_array_<int> row;
+	row.resize(3);
+	for(r=0; r < rows; r++)
+	{
+		row[0] = r;
+		row[1] = rand() * (rand() % 2 ? 1 : -1);
+		row[2] = -r;
+		ints.appendRow(row);
+	}
+	if(!round_trip(ints, NULL, 1) || !round_trip(ints, &pool, 4) || !round_trip(ints, &pool, 7))
+		printf("Bad int table round trip\n");
+
+	// doubles read back exactly
+	_table_<double> doubles;
+	doubles.setHeader(header);
+	_array_<double> drow;
+	drow.resize(3);
+	for(r=0; r < 1000; r++)
+	{
+		drow[0] = r / 3.0;
+		drow[1] = rand() * 1e-300;
+		drow[2] = -rand() * 12345.678;
+		doubles.appendRow(drow);
+	}
+	_csv_writer_ writer;
+	writer.open(csvFile);
+	writer.writeTable(doubles);
+	writer.close();
+	_csv_reader_ reader;
+	reader.open(csvFile);
+	_table_<double> dread;
+	reader.readTable(dread);
+	reader.close();
+	if(dread != doubles)
+		printf("Bad double table round trip\n");
+
+	// strings with delimiters, quotes and line breaks, across the
+	// boundaries of the blocks and parts; then appended to a table
+	// that already has the rows
+	_table_<_string_> strings;
+	strings.setHeader(header);
+	_array_<_string_> srow;
+	srow.resize(3);
+	char buf[64];
+	for(r=0; r < rows; r++)
+	{
+		sprintf(buf, "%d", r);
+		srow[0] = buf;
+		sprintf(buf, "v,%d\n\"%d\"", rand(), r % 7);
+		srow[1] = (r % 3) ? buf : "";
+		srow[2] = (r % 5) ? "plain" : "two\r\nlines";
+		strings.appendRow(srow);
+	}
+	_csv_writer_ tsvWriter(csv_options('\t'));
+	tsvWriter.open(csvFile);
+	tsvWriter.writeTable(strings);
+	tsvWriter.close();
+	_table_<_string_> sread = strings;
+	_csv_reader_ tsvReader(csv_options('\t'), 128 * 1024);
+	tsvReader.open(csvFile);
+	tsvReader.readTable(sread, &pool, 5);
+	tsvReader.close();
+	sread.removeRows(0, rows);
+	if(sread != strings)
+		printf("Bad string table round trip\n");
+	DeleteFile(csvFile);
+}
+
+
+//------------------------------------
+// performance
+
+void csv_performance()
+{
+	int const rows = 1000000;
+	_table_<_string_> tbl;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("city"));
+	header.append(_string_("amount"));
+	header.append(_string_("note"));
+	tbl.setHeader(header);
+	_array_<_string_> row;
+	row.resize(4);
+	static const char* cities[] = { "Oslo", "Lima", "Pune", "Kyiv", "Graz" };
+	char buf[64];
+	int r;
+	for(r=0; r < rows; r++)
+	{
+		sprintf(buf, "%d", r);
+		row[0] = buf;
+		row[1] = cities[rand() % 5];
+		sprintf(buf, "%d.%02d", rand(), rand() % 100);
+		row[2] = buf;
+		row[3] = (r % 10) ? "some longer text for the note column" : "quoted, \"note\"";
+		tbl.appendRow(row);
+	}
+
+	unsigned long c = GetTickCount();
+	_csv_writer_ writer;
+	writer.open(csvFile);
+	writer.writeTable(tbl);
+	writer.close();
+	c = GetTickCount()-c;
+	double mb = writer.getBytesWritten() / (1024.0 * 1024.0);
+	printf("write %.0f MB: %u ms, %.0f MB/s\n", mb, c, c ? mb * 1000 / c : 0.0);
+
+	// line by line, as it used to be done (no quoting)
+	c = GetTickCount();
+	_win32_file_ file(csvFile);
+	file.open(access_read, share_read, open_existing);
+	_table_<_string_> lines;
+	lines.setHeader(header);
+	char line[1024];
+	_array_<_string_> fields;
+	fields.resize(4);
+	file.readLine(line, sizeof(line));
+	while(file.readLine(line, sizeof(line)) >= 0)
+	{
+		char* p = line;
+		for(int i=0; i < 4; i++)
+		{
+			char* comma = strchr(p, ',');
+			if(comma)
+				*comma = '\0';
+			fields[i] = p;
+			p = comma ? comma + 1 : p + strlen(p);
+		}
+		lines.appendRow(fields);
+	}
+	file.close();
+	c = GetTickCount()-c;
+	printf("readLine + appendRow: %u ms, %.0f MB/s\n", c, c ? mb * 1000 / c : 0.0);
+
+	// the parsing alone
+	c = GetTickCount();
+	_csv_reader_ reader;
+	reader.open(csvFile);
+	while( reader.readRecord(fields) )
+		;
+	reader.close();
+	c = GetTickCount()-c;
+	printf("readRecord: %u ms, %.0f MB/s\n", c, c ? mb * 1000 / c : 0.0);
+
+	// most of the rest is making the strings
+	c = GetTickCount();
+	reader.open(csvFile);
+	_table_<_string_> read;
+	reader.readTable(read);
+	reader.close();
+	c = GetTickCount()-c;
+	printf("readTable: %u ms, %.0f MB/s\n", c, c ? mb * 1000 / c : 0.0);
+	if(read != tbl)
+		printf("Bad readTable\n");
+
+	c = GetTickCount();
+	reader.open(csvFile);
+	_table_<_string_> parallel;
+	reader.readTable(parallel, &pool);
+	reader.close();
+	c = GetTickCount()-c;
+	printf("readTable on threads: %u ms, %.0f MB/s\n", c, c ? mb * 1000 / c : 0.0);
+	if(parallel != tbl)
+		printf("Bad parallel readTable\n");
+
+	// numbers
+	_table_<int> ints;
+	ints.setHeader(header);
+	_array_<int> irow;
+	irow.resize(4);
+	for(r=0; r < rows; r++)
+	{
+		irow[0] = r;
+		irow[1] = rand() % 5;
+		irow[2] = (rand() % 30000) * 100 + rand() % 100;
+		irow[3] = -rand();
+		ints.appendRow(irow);
+	}
+	writer.open(csvFile);
+	writer.writeTable(ints);
+	writer.close();
+	mb = writer.getBytesWritten() / (1024.0 * 1024.0);
+	c = GetTickCount();
+	reader.open(csvFile);
+	_table_<int> iread;
+	reader.readTable(iread);
+	reader.close();
+	c = GetTickCount()-c;
+	printf("readTable of %.0f MB of ints: %u ms, %.0f MB/s\n", mb, c, c ? mb * 1000 / c : 0.0);
+	c = GetTickCount();
+	reader.open(csvFile);
+	_table_<int> iparallel;
+	reader.readTable(iparallel, &pool);
+	reader.close();
+	c = GetTickCount()-c;
+	printf("readTable of ints on threads: %u ms, %.0f MB/s\n", c, c ? mb * 1000 / c : 0.0);
+	if(iread != ints || iparallel != ints)
+		printf("Bad readTable of ints\n");
+	DeleteFile(csvFile);
+}
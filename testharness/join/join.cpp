@@ -0,0 +1,477 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// join.cpp - checks the hash and sort-merge joins and the
+// hash group-by
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <crtdbg.h>
+
+#include <_join_.h>
+#include <_query_.h>
+#include <_table_.h>
+#include <_string_.h>
+
+using namespace soige;
+
+_thread_pool_ pool;
+
+void check_joins();
+void check_join_tables();
+void check_hash_group_by();
+void join_performance();
+
+int main(int argc, char* argv[])
+{
+	printf("Checking _join_\n");
+	check_joins();
+	_CrtDumpMemoryLeaks();
+	check_join_tables();
+	_CrtDumpMemoryLeaks();
+	check_hash_group_by();
+	_CrtDumpMemoryLeaks();
+	join_performance();
+	_CrtDumpMemoryLeaks();
+	return 0;
+}
+
+
+//------------------------------------
+// joins of key columns
+
+// the pairs of a join by nested loops, ordered by the left row
+template<typename T> void nested_join(const T* left, int leftCount, const T* right, int rightCount,
+									   join_kind kind, _join_pairs_& pairs)
+{
+	pairs.clear();
+	for(int l=0; l < leftCount; l++)
+	{
+		bool matched = false;
+		for(int r=0; r < rightCount; r++)
+			if(left[l] == right[r])
+			{
+				pairs.append(l, r);
+				matched = true;
+			}
+		if(!matched && kind == join_left)
+			pairs.append(l, -1);
+	}
+}
+
+bool same_pairs(const _join_pairs_& a, const _join_pairs_& b)
+{
+	return a.length() == b.length() &&
+		   (a.length() == 0 || (memcmp(a.leftRows(), b.leftRows(), a.length()*sizeof(int)) == 0 &&
+								memcmp(a.rightRows(), b.rightRows(), a.length()*sizeof(int)) == 0));
+}
+
+// the pairs ordered by the left row, then the right one
+void order_pairs(const _join_pairs_& pairs, _join_pairs_& ordered)
+{
+	_array_<__int64> both;
+	int i;
+	for(i=0; i < pairs.length(); i++)
+		both.append(((__int64)pairs.getLeft(i) << 32) + (pairs.getRight(i) + 1));
+	both.sort();
+	ordered.clear();
+	for(i=0; i < both.length(); i++)
+		ordered.append((int)(both[i] >> 32), (int)(both[i] & 0xFFFFFFFF) - 1);
+}
+
+// the hash and merge joins, both kinds, against nested loops
+template<typename T> bool joins_match(const T* left, int leftCount, const T* right, int rightCount,
+									   _thread_pool_* tp, int parts)
+{
+	_join_<T> join(tp, parts);
+	_join_pairs_ expected, pairs, ordered;
+	for(int kind=join_inner; kind <= join_left; kind++)
+	{
+		nested_join(left, leftCount, right, rightCount, (join_kind)kind, expected);
+		join.hashJoin(left, leftCount, right, rightCount, pairs, (join_kind)kind);
+		if(!same_pairs(pairs, expected))
+			return false;
+		join.mergeJoin(left, leftCount, right, rightCount, pairs, (join_kind)kind);
+		// in key order, then by the left row and the right one
+		for(int i=1; i < pairs.length(); i++)
+		{
+			int c = _compare(left[pairs.getLeft(i - 1)], left[pairs.getLeft(i)]);
+			if(c > 0 || (c == 0 && pairs.getLeft(i - 1) > pairs.getLeft(i)) ||
+			   (c == 0 && pairs.getLeft(i - 1) == pairs.getLeft(i) && pairs.getRight(i - 1) >= pairs.getRight(i)))
+				return false;
+		}
+		order_pairs(pairs, ordered);
+		if(!same_pairs(ordered, expected))
+			return false;
+	}
+	return true;
+}
+
+void check_joins()
+{
+	// ints: the left side smaller, larger, empty; keys with no match
+	int const n = 3000;
+	int* left = new int[n];
+	int* right = new int[n];
+	int i;
+	for(i=0; i < n; i++)
+	{
+		left[i] = rand() % 500;
+		right[i] = rand() % 700 - 100;
+	}
+	if(!joins_match(left, n, right, n / 3, NULL, 0) || !joins_match(left, n / 4, right, n, NULL, 0) ||
+	   !joins_match(left, 0, right, n, NULL, 0) || !joins_match(left, n, right, 0, NULL, 0))
+		printf("Bad int joins\n");
+	// keys that are multiples of a power of 2 all go to a few
+	// buckets unless the hash is mixed; they still have to match
+	for(i=0; i < n; i++)
+		right[i] = (i % 100) << 12;
+	for(i=0; i < n; i++)
+		left[i] = (rand() % 120) << 12;
+	if(!joins_match(left, n, right, n, NULL, 0))
+		printf("Bad joins of clustered keys\n");
+
+	// large columns, in parts on the pool: against one part
+	int const big = 200000;
+	int* bigLeft = new int[big];
+	int* bigRight = new int[big];
+	for(i=0; i < big; i++)
+	{
+		bigLeft[i] = rand() % 150000;
+		bigRight[i] = rand() % 150000;
+	}
+	_join_<int> serial;
+	_join_<int> parallel(&pool, 4);
+	_join_pairs_ expected, pairs, ordered;
+	for(int kind=join_inner; kind <= join_left; kind++)
+	{
+		serial.hashJoin(bigLeft, big, bigRight, big / 2, expected, (join_kind)kind);
+		parallel.hashJoin(bigLeft, big, bigRight, big / 2, pairs, (join_kind)kind);
+		if(!same_pairs(pairs, expected))
+			printf("Bad hash join in parts\n");
+		parallel.hashJoin(bigLeft, big / 2, bigRight, big, pairs, (join_kind)kind);
+		serial.hashJoin(bigLeft, big / 2, bigRight, big, expected, (join_kind)kind);
+		if(!same_pairs(pairs, expected))
+			printf("Bad hash join in parts, the left side indexed\n");
+		parallel.mergeJoin(bigLeft, big / 2, bigRight, big, pairs, (join_kind)kind);
+		order_pairs(pairs, ordered);
+		if(!same_pairs(ordered, expected))
+			printf("Bad merge join of large columns\n");
+	}
+	delete [] bigLeft;
+	delete [] bigRight;
+	delete [] left;
+	delete [] right;
+
+	// strings, with empty ones
+	_array_<_string_> sleft, sright;
+	char buf[32];
+	for(i=0; i < 1000; i++)
+	{
+		sprintf(buf, "key %d", rand() % 300);
+		sleft.append((i % 50) ? _string_(buf) : _string_());
+		sprintf(buf, "key %d", rand() % 400);
+		sright.append((i % 70) ? _string_(buf) : _string_());
+	}
+	if(!joins_match(&sleft[0], sleft.length(), &sright[0], sright.length(), NULL, 0))
+		printf("Bad string joins\n");
+
+	// doubles: 0.0 and -0.0 are equal
+	double dleft[] = { 1.5, 0.0, -2.0, 3.25, 1.5 };
+	double dright[] = { -0.0, 1.5, 7.0, 3.25 };
+	if(!joins_match(dleft, 5, dright, 4, NULL, 0))
+		printf("Bad double joins\n");
+	_join_<double> djoin;
+	djoin.hashJoin(dleft, 5, dright, 4, pairs);
+	if(pairs.length() != 4 || pairs.getLeft(1) != 1 || pairs.getRight(1) != 0)
+		printf("Bad join of 0.0 and -0.0\n");
+
+	// NaNs are equal to nothing, in either join
+	double zero = 0.0;
+	double nan = zero / zero;
+	double nleft[] = { nan, 1.5, nan, 2.0, 1.5 };
+	double nright[] = { nan, 2.0, 1.5, nan };
+	for(int kind=join_inner; kind <= join_left; kind++)
+	{
+		_join_pairs_ merged;
+		djoin.hashJoin(nleft, 5, nright, 4, pairs, (join_kind)kind);
+		djoin.mergeJoin(nleft, 5, nright, 4, merged, (join_kind)kind);
+		order_pairs(merged, ordered);
+		if(pairs.length() != ((kind == join_inner) ? 3 : 5) || !same_pairs(ordered, pairs))
+			printf("Bad join of NaNs\n");
+	}
+}
+
+
+//------------------------------------
+// joins of tables
+
+void check_join_tables()
+{
+	_table_<_string_> customers, orders;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("name"));
+	header.append(_string_("city"));
+	customers.setHeader(header);
+	header.clear();
+	header.append(_string_("order"));
+	header.append(_string_("customer"));
+	orders.setHeader(header);
+	static const char* cities[] = { "Oslo", "Lima", "Kyiv" };
+	_array_<_string_> row;
+	row.resize(3);
+	char buf[32];
+	int r, c;
+	for(r=0; r < 50; r++)
+	{
+		sprintf(buf, "c%d", r);
+		row[0] = buf;
+		sprintf(buf, "name %d", r);
+		row[1] = buf;
+		row[2] = cities[r % 3];
+		customers.appendRow(row);
+	}
+	customers.encodeColumn(2);
+	row.resize(2);
+	for(r=0; r < 300; r++)
+	{
+		sprintf(buf, "o%d", r);
+		row[0] = buf;
+		// some orders of customers that aren't there
+		sprintf(buf, "c%d", rand() % 60);
+		row[1] = buf;
+		orders.appendRow(row);
+	}
+	orders.encodeColumn(1);
+
+	_join_<_string_> join;
+	for(int sortMerge=0; sortMerge < 2; sortMerge++)
+	{
+		_table_<_string_> result;
+		if(!join.joinTables(orders, 1, customers, 0, result, join_left, sortMerge != 0) ||
+		   result.getColumnCount() != 5 || result.getRowCount() != 300 ||
+		   result.getColumnName(1).compare("customer") != 0 || result.getColumnName(3).compare("name") != 0 ||
+		   !result.isEncoded(1) || !result.isEncoded(4) || result.isEncoded(0))
+			printf("Bad joined table\n");
+		// every order once, with its customer's columns, or empty ones
+		int* seen = new int[300];
+		memset(seen, 0, 300*sizeof(int));
+		for(r=0; r < result.getRowCount(); r++)
+		{
+			int order = atoi(result.getValueAt(r, 0).c_str() + 1);
+			int customer = atoi(result.getValueAt(r, 1).c_str() + 1);
+			seen[order]++;
+			bool ok = ( result.getValueAt(r, 1) == orders.getValueAt(order, 1) );
+			if(customer < 50)
+				for(c=0; c < 3; c++)
+					ok = ok && ( result.getValueAt(r, 2 + c) == customers.getValueAt(customer, c) );
+			else
+				for(c=0; c < 3; c++)
+					ok = ok && ( result.getValueAt(r, 2 + c).length() == 0 );
+			if(!ok)
+			{
+				printf("Bad joined row\n");
+				break;
+			}
+		}
+		for(r=0; r < 300; r++)
+			if(seen[r] != 1)
+			{
+				printf("Bad orders in a joined table\n");
+				break;
+			}
+		delete [] seen;
+
+		join.joinTables(orders, 1, customers, 0, result, join_inner, sortMerge != 0);
+		for(r=0; r < result.getRowCount(); r++)
+			if(result.getValueAt(r, 2).length() == 0)
+				printf("Bad inner join of tables\n");
+	}
+
+	_table_<_string_> result;
+	if(join.joinTables(orders, 2, customers, 0, result))
+		printf("Bad join on a column that isn't there\n");
+	_table_<_string_> empty;
+	empty.setHeader(header);
+	if(!join.joinTables(empty, 1, customers, 0, result) || result.getColumnCount() != 5 || result.getRowCount() != 0)
+		printf("Bad join of an empty table\n");
+}
+
+
+//------------------------------------
+// hash group-by
+
+void check_hash_group_by()
+{
+	int const rows = 300000;
+	int* keys = new int[rows];
+	int* values = new int[rows];
+	int r;
+	for(r=0; r < rows; r++)
+	{
+		keys[r] = (rand() % 1000) * 7;
+		values[r] = rand() % 10000 - 5000;
+	}
+	_column_query_<int> query(values, rows);
+	_column_query_<int> parallel(values, rows, &pool, 4);
+	_selection_ sel;
+	query.filter(op_greater, 0, sel);
+
+	for(int pass=0; pass < 4; pass++)
+	{
+		const _selection_* rowsOf = (pass & 1) ? &sel : NULL;
+		const _column_query_<int>& q = (pass & 2) ? parallel : query;
+		_array_<int> sortedKeys, hashKeys;
+		_array_< _aggregate_<int> > sorted, hashed;
+		query.groupBy(keys, rowsOf, sortedKeys, sorted);
+		q.hashGroupBy(keys, rowsOf, hashKeys, hashed);
+		if(hashKeys.length() != sortedKeys.length() || hashed.length() != hashKeys.length())
+		{
+			printf("Bad hash group-by keys\n");
+			continue;
+		}
+		// in the order of their first rows
+		int first = rowsOf ? (*rowsOf)[0] : 0;
+		if(hashKeys[0] != keys[first])
+			printf("Bad order of hash groups\n");
+		for(int g=0; g < hashKeys.length(); g++)
+		{
+			int s = 0;
+			while(sortedKeys[s] != hashKeys[g])
+				s++;
+			if(hashed[g].count != sorted[s].count || hashed[g].sum != sorted[s].sum ||
+			   hashed[g].min != sorted[s].min || hashed[g].max != sorted[s].max)
+			{
+				printf("Bad hash group-by aggregates\n");
+				break;
+			}
+		}
+	}
+
+	// string keys
+	_array_<_string_> names;
+	static const char* cities[] = { "Oslo", "Lima", "", "Kyiv" };
+	__int64 limaSum = 0;
+	for(r=0; r < 1000; r++)
+	{
+		names.append(_string_(cities[r % 4]));
+		if(r % 4 == 1)
+			limaSum += values[r];
+	}
+	_column_query_<int> small(values, 1000);
+	_array_<_string_> groupNames;
+	_array_< _aggregate_<int> > groups;
+	small.hashGroupBy(&names[0], (_selection_*)NULL, groupNames, groups);
+	if(groupNames.length() != 4 || groupNames[2].length() != 0 || groupNames[3].compare("Kyiv") != 0 ||
+	   groups[1].count != 250 || groups[1].sum != limaSum)
+		printf("Bad hash group-by of strings\n");
+	_selection_ none;
+	small.hashGroupBy(&names[0], &none, groupNames, groups);
+	if(groupNames.length() != 0 || groups.length() != 0)
+		printf("Bad hash group-by of no rows\n");
+
+	delete [] keys;
+	delete [] values;
+}
+
+
+//------------------------------------
+// performance
+
+void join_performance()
+{
+	int const rows = 20000;
+	_table_<int> left, right;
+	_array_<_string_> header;
+	header.append(_string_("key"));
+	header.append(_string_("value"));
+	left.setHeader(header);
+	right.setHeader(header);
+	int* data = new int[rows];
+	int r, c;
+	for(c=0; c < 2; c++)
+	{
+		for(r=0; r < rows; r++)
+			data[r] = rand() % rows;
+		left.setColumnData(c, data, rows);
+		for(r=0; r < rows; r++)
+			data[r] = rand() % rows;
+		right.setColumnData(c, data, rows);
+	}
+	delete [] data;
+
+	// nested loops, as it used to be done
+	unsigned long t = GetTickCount();
+	_table_<int> nested;
+	nested.setColumnCount(4);
+	_array_<int> row;
+	row.resize(4);
+	for(r=0; r < rows; r++)
+		for(int r2=0; r2 < rows; r2++)
+			if(left.getValueAt(r, 0) == right.getValueAt(r2, 0))
+			{
+				row[0] = left.getValueAt(r, 0);
+				row[1] = left.getValueAt(r, 1);
+				row[2] = right.getValueAt(r2, 0);
+				row[3] = right.getValueAt(r2, 1);
+				nested.appendRow(row);
+			}
+	t = GetTickCount()-t;
+	printf("nested loop join, 20K x 20K rows: %u ms, %d rows\n", t, nested.getRowCount());
+
+	_join_<int> join;
+	_table_<int> result;
+	t = GetTickCount();
+	join.joinTables(left, 0, right, 0, result);
+	t = GetTickCount()-t;
+	printf("hash join of the tables: %u ms\n", t);
+	if(result.getRowCount() != nested.getRowCount())
+		printf("Bad hash join of tables\n");
+	t = GetTickCount();
+	join.joinTables(left, 0, right, 0, result, join_inner, true);
+	t = GetTickCount()-t;
+	printf("merge join of the tables: %u ms\n", t);
+	if(result.getRowCount() != nested.getRowCount())
+		printf("Bad merge join of tables\n");
+
+	// large columns
+	int const big = 5000000;
+	int* keys1 = new int[big];
+	int* keys2 = new int[big];
+	for(r=0; r < big; r++)
+	{
+		keys1[r] = (int)(((unsigned)rand() * 32768 + rand()) % big);
+		keys2[r] = (int)(((unsigned)rand() * 32768 + rand()) % big);
+	}
+	_join_<int> parallel(&pool);
+	_join_pairs_ pairs, expected;
+	t = GetTickCount();
+	join.hashJoin(keys1, big, keys2, big, expected);
+	t = GetTickCount()-t;
+	printf("hash join, 5M x 5M keys: %u ms, %d pairs\n", t, expected.length());
+	t = GetTickCount();
+	parallel.hashJoin(keys1, big, keys2, big, pairs);
+	t = GetTickCount()-t;
+	printf("hash join on the pool: %u ms\n", t);
+	if(!same_pairs(pairs, expected))
+		printf("Bad hash join on the pool\n");
+	t = GetTickCount();
+	join.mergeJoin(keys1, big, keys2, big, pairs);
+	t = GetTickCount()-t;
+	printf("merge join, 5M x 5M keys: %u ms\n", t);
+	if(pairs.length() != expected.length())
+		printf("Bad merge join\n");
+
+	_column_query_<int> query(keys2, big);
+	_array_<int> groupKeys;
+	_array_< _aggregate_<int> > groups;
+	t = GetTickCount();
+	query.groupBy(keys1, (_selection_*)NULL, groupKeys, groups);
+	t = GetTickCount()-t;
+	printf("sort group-by, 5M rows: %u ms, %d groups\n", t, groupKeys.length());
+	t = GetTickCount();
+	query.hashGroupBy(keys1, (_selection_*)NULL, groupKeys, groups);
+	t = GetTickCount()-t;
+	printf("hash group-by: %u ms\n", t);
+	delete [] keys1;
+	delete [] keys2;
+}
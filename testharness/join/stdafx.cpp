@@ -0,0 +1,3 @@
+
+#include <_string_.cpp>
+#include <_thread_pool_.cpp>
@@ -11,17 +11,37 @@
 
 using namespace soige;
 
+void check_match_views();
 void check_match_algs();
 
 int main(int argc, char* argv[])
 {
 	printf("Checking string matching algorithms\n");
+	check_match_views();
+	_CrtDumpMemoryLeaks();
 	check_match_algs();
 	_CrtDumpMemoryLeaks();
 	return 0;
 }
 
 
+//------------------------------------
+// matching parts of strings, as views
+
+void check_match_views()
+{
+	_string_view_ text("alpha, Beta,gamma ,,delta");
+	long matchPos = 0, matchLen = 0;
+	_boyer_moore_ bm("gam");
+	if(!bm.match(text, &matchPos, &matchLen) || matchPos != 12 || matchLen != 3 ||
+	   bm.match(text.left(12)) || !bm.match(text.substring(12, 3)))
+		printf("Bad Boyer-Moore match of a view\n");
+	bm.initPattern("beta", false, true, true);
+	if(!bm.match(text.substring(7, 4)) || bm.match(text.substring(7, 5)))
+		printf("Bad Boyer-Moore match of a whole view\n");
+}
+
+
 //------------------------------------
 // string matching algorithms tests -
 //_boyer_moore_ and _soundex_
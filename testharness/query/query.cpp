@@ -0,0 +1,305 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// query.cpp - checks the column filters and aggregates
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <crtdbg.h>
+
+#include <_query_.h>
+#include <_table_.h>
+#include <_string_.h>
+
+using namespace soige;
+
+_thread_pool_ pool;
+
+void check_filters();
+void check_aggregates();
+void check_group_by();
+void query_performance();
+
+int main(int argc, char* argv[])
+{
+	printf("Checking _column_query_\n");
+	check_filters();
+	_CrtDumpMemoryLeaks();
+	check_aggregates();
+	_CrtDumpMemoryLeaks();
+	check_group_by();
+	_CrtDumpMemoryLeaks();
+	query_performance();
+	_CrtDumpMemoryLeaks();
+	return 0;
+}
+
+
+//------------------------------------
+// filter tests
+
+template<typename T> bool passes(const T& a, query_op op, const T& b)
+{
+	switch(op)
+	{
+	case op_equal:			return a == b;
+	case op_not_equal:		return a != b;
+	case op_less:			return a < b;
+	case op_less_equal:		return a <= b;
+	case op_greater:		return a > b;
+	default:				return a >= b;
+	}
+}
+
+// every op, on all the rows and on a selection, against a plain loop
+template<typename T> bool filters_match(const T* values, int count, const T& constant,
+										 _thread_pool_* tp, int parts)
+{
+	_column_query_<T> query(values, count, tp, parts);
+	_selection_ odd, sel, expected;
+	for(int row=1; row < count; row += 2)
+		odd.append(row);
+	for(int op=op_equal; op <= op_greater_equal; op++)
+	{
+		query.filter((query_op)op, constant, sel);
+		expected.clear();
+		int i;
+		for(i=0; i < count; i++)
+			if(passes(values[i], (query_op)op, constant))
+				expected.append(i);
+		if(sel.length() != expected.length())
+			return false;
+		for(i=0; i < sel.length(); i++)
+			if(sel[i] != expected[i])
+				return false;
+
+		query.filter(odd, (query_op)op, constant, sel);
+		int n = 0;
+		for(i=0; i < expected.length(); i++)
+			if(expected[i] % 2 == 1 && (n >= sel.length() || sel[n++] != expected[i]))
+				return false;
+		if(n != sel.length())
+			return false;
+	}
+	return true;
+}
+
+void check_filters()
+{
+	int const count = 100003;
+	int* ints = new int[count];
+	float* floats = new float[count];
+	double* doubles = new double[count];
+	for(int i=0; i < count; i++)
+	{
+		ints[i] = rand() % 200 - 100;
+		floats[i] = ints[i] / 4.0f;
+		doubles[i] = ints[i] / 8.0;
+	}
+	floats[5] = floats[11] = 0.0f / (floats[0] - floats[0]);	// NaN
+
+	// short ranges take the scalar tails only
+	if(!filters_match(ints, 3, ints[1], NULL, 1) || !filters_match(doubles, 7, doubles[2], NULL, 1))
+		printf("Bad filter on a few values\n");
+	if(!filters_match(ints, count, 17, NULL, 1) || !filters_match(ints, count, -100, NULL, 1) ||
+	   !filters_match(floats, count, 2.5f, NULL, 1) || !filters_match(doubles, count, -3.25, NULL, 1))
+		printf("Bad filter\n");
+	// split over threads: the rows still come out in order
+	if(!filters_match(ints, count, 17, &pool, 4) || !filters_match(floats, count, 2.5f, &pool, 3) ||
+	   !filters_match(doubles, count, -3.25, &pool, 0))
+		printf("Bad parallel filter\n");
+	// types with no SSE2 kernel
+	__int64* longs = new __int64[count];
+	for(int j=0; j < count; j++)
+		longs[j] = (__int64)ints[j] << 33;
+	if(!filters_match(longs, count, (__int64)5 << 33, &pool, 2))
+		printf("Bad __int64 filter\n");
+
+	delete [] longs;
+	delete [] doubles;
+	delete [] floats;
+	delete [] ints;
+}
+
+
+//------------------------------------
+// aggregate tests
+
+template<typename T> bool aggregate_matches(const _aggregate_<T>& agg, const T* values, const int* rows, int count)
+{
+	_aggregate_<T> expected;
+	for(int i=0; i < count; i++)
+		expected.add(values[rows ? rows[i] : i]);
+	return ( agg.count == expected.count && agg.sum == expected.sum &&
+			 agg.min == expected.min && agg.max == expected.max );
+}
+
+template<typename T> bool aggregates_match(const T* values, int count, _thread_pool_* tp, int parts)
+{
+	_column_query_<T> query(values, count, tp, parts);
+	_selection_ sel;
+	query.filter(op_greater, values[0], sel);
+	return ( aggregate_matches(query.getAggregate(), values, NULL, count) &&
+			 aggregate_matches(query.getAggregate(sel), values, sel.rows(), sel.length()) );
+}
+
+void check_aggregates()
+{
+	// the values are exact in binary, so the sums don't depend on the order
+	int const count = 200001;
+	int* ints = new int[count];
+	float* floats = new float[count];
+	double* doubles = new double[count];
+	for(int i=0; i < count; i++)
+	{
+		ints[i] = (rand() % 500000) * (rand() % 2 ? 1 : -1) * 4;
+		floats[i] = (rand() % 1000) / 8.0f;
+		doubles[i] = ints[i] / 16.0;
+	}
+	if(!aggregates_match(ints, count, NULL, 1) || !aggregates_match(floats, count, NULL, 1) ||
+	   !aggregates_match(doubles, count, NULL, 1) || !aggregates_match(ints, 5, NULL, 1) ||
+	   !aggregates_match(doubles, 11, NULL, 1))
+		printf("Bad aggregate\n");
+	if(!aggregates_match(ints, count, &pool, 4) || !aggregates_match(floats, count, &pool, 5) ||
+	   !aggregates_match(doubles, count, &pool, 0))
+		printf("Bad parallel aggregate\n");
+
+	_column_query_<int> empty(ints, 0);
+	_aggregate_<int> agg = empty.getAggregate();
+	if(agg.count != 0 || agg.sum != 0 || agg.avg() != 0.0)
+		printf("Bad aggregate of nothing\n");
+	_column_query_<int> one(ints, 1);
+	agg = one.getAggregate();
+	if(agg.count != 1 || agg.min != ints[0] || agg.max != ints[0] || agg.avg() != ints[0])
+		printf("Bad aggregate of one value\n");
+
+	delete [] doubles;
+	delete [] floats;
+	delete [] ints;
+}
+
+
+//------------------------------------
+// group-by tests, on table columns
+
+void check_group_by()
+{
+	_table_<int> tbl;
+	_array_<_string_> header;
+	header.append(_string_("region"));
+	header.append(_string_("amount"));
+	tbl.setHeader(header);
+	int const rows = 50000;
+	int* sums = new int[10];
+	int* counts = new int[10];
+	int r;
+	for(r=0; r < 10; r++)
+		sums[r] = counts[r] = 0;
+	_array_<int> row;
+	row.resize(2);
+	for(r=0; r < rows; r++)
+	{
+		row[0] = 2 * (rand() % 10);
+		row[1] = rand() % 1000;
+		tbl.appendRow(row);
+		// amounts over 500 only
+		if(row[1] > 500)
+		{
+			sums[row[0] / 2] += row[1];
+			counts[row[0] / 2]++;
+		}
+	}
+
+	_column_query_<int> amounts(tbl.getColumnData(1), tbl.getRowCount(), &pool);
+	_selection_ sel;
+	amounts.filter(op_greater, 500, sel);
+	_array_<int> regions;
+	_array_< _aggregate_<int> > groups;
+	amounts.groupBy(tbl.getColumnData(0), &sel, regions, groups);
+	if(regions.length() != 10)
+		printf("Bad group-by keys\n");
+	for(r=0; r < regions.length(); r++)
+		if(regions[r] != 2 * r || groups[r].sum != sums[r] || groups[r].count != counts[r] ||
+		   groups[r].min <= 500 || groups[r].max >= 1000)
+		{
+			printf("Bad group-by aggregates\n");
+			break;
+		}
+
+	// all the rows
+	amounts.groupBy(tbl.getColumnData(0), (_selection_*)NULL, regions, groups);
+	int total = 0;
+	for(r=0; r < groups.length(); r++)
+		total += groups[r].count;
+	if(total != rows)
+		printf("Bad group-by of all the rows\n");
+
+	delete [] counts;
+	delete [] sums;
+}
+
+void query_performance()
+{
+	int const rows = 10000000;
+	_table_<int> tbl;
+	_array_<_string_> header;
+	header.append(_string_("amount"));
+	tbl.setHeader(header);
+	int* data = new int[rows];
+	int r;
+	for(r=0; r < rows; r++)
+		data[r] = rand() % 1000;
+	tbl.setColumnData(0, data, rows);
+
+	// cell by cell, as it used to be done
+	unsigned long c = GetTickCount();
+	__int64 sum = 0;
+	int count = 0;
+	for(r=0; r < rows; r++)
+	{
+		int val = tbl.getValueAt(r, 0);
+		if(val < 100)
+		{
+			sum += val;
+			count++;
+		}
+	}
+	c = GetTickCount()-c;
+	printf("getValueAt filter+sum, 10M ints: %u\n", c);
+
+	_selection_ sel;
+	_column_query_<int> query(tbl.getColumnData(0), rows);
+	c = GetTickCount();
+	query.filter(op_less, 100, sel);
+	_aggregate_<int> agg = query.getAggregate(sel);
+	c = GetTickCount()-c;
+	printf("filter+sum, 10M ints: %u\n", c);
+	if(agg.sum != sum || agg.count != count)
+		printf("Bad filter+sum\n");
+
+	_column_query_<int> parallel(tbl.getColumnData(0), rows, &pool);
+	c = GetTickCount();
+	parallel.filter(op_less, 100, sel);
+	agg = parallel.getAggregate(sel);
+	c = GetTickCount()-c;
+	printf("filter+sum on threads, 10M ints: %u\n", c);
+	if(agg.sum != sum || agg.count != count)
+		printf("Bad parallel filter+sum\n");
+
+	c = GetTickCount();
+	sum = 0;
+	for(r=0; r < rows; r++)
+		sum += tbl.getValueAt(r, 0);
+	c = GetTickCount()-c;
+	printf("getValueAt sum, 10M ints: %u\n", c);
+	c = GetTickCount();
+	agg = query.getAggregate();
+	c = GetTickCount()-c;
+	printf("aggregate, 10M ints: %u\n", c);
+	c = GetTickCount();
+	agg = parallel.getAggregate();
+	c = GetTickCount()-c;
+	printf("aggregate on threads, 10M ints: %u\n", c);
+	if(agg.sum != sum)
+		printf("Bad aggregate sum\n");
+
+	delete [] data;
+}
@@ -0,0 +1,393 @@
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// snapshot.cpp - checks saving tables to snapshot files
+// and reading them back
+//
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <crtdbg.h>
+#include <stddef.h>
+
+#include <_table_snapshot_.h>
+#include <_query_.h>
+#include <_table_.h>
+#include <_string_.h>
+
+using namespace soige;
+
+void check_snapshot_numbers();
+void check_snapshot_strings();
+void check_snapshot_errors();
+void snapshot_performance();
+static void read_image(_array_<char>& image);
+static bool open_patched(_table_snapshot_& snap, const _array_<char>& image, long pos, const void* bytes, int size);
+
+int main(int argc, char* argv[])
+{
+	printf("Checking _table_snapshot_\n");
+	check_snapshot_numbers();
+	_CrtDumpMemoryLeaks();
+	check_snapshot_strings();
+	_CrtDumpMemoryLeaks();
+	check_snapshot_errors();
+	_CrtDumpMemoryLeaks();
+	snapshot_performance();
+	_CrtDumpMemoryLeaks();
+	return 0;
+}
+
+
+LPCTSTR snapFile = _T("snapshot_test.tbl");
+
+//------------------------------------
+// tables of numbers
+
+void check_snapshot_numbers()
+{
+	int const rows = 100003;
+	_table_<int> tbl;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("region"));
+	header.append(_string_("amount"));
+	tbl.setHeader(header);
+	_array_<int> row;
+	row.resize(3);
+	int r;
+	for(r=0; r < rows; r++)
+	{
+		row[0] = r;
+		row[1] = rand() % 10;
+		row[2] = rand() - 1000;
+		tbl.appendRow(row);
+	}
+	tbl.encodeColumn(1);
+
+	if(!_table_snapshot_::save(tbl, snapFile))
+		printf("Bad save\n");
+	_table_snapshot_ snap;
+	if(!snap.open(snapFile) || snap.getRowCount() != rows || snap.getColumnCount() != 3 ||
+	   snap.getColumnName(2).compare("amount") != 0 || snap.getColumnByName(_string_("region")) != 1 ||
+	   snap.getColumnType(0) != column_int || snap.isEncoded(0) || !snap.isEncoded(1))
+		printf("Bad snapshot header\n");
+
+	// the columns right in the file
+	const int* ids = snap.getIntData(0);
+	const int* amounts = snap.getIntData(2);
+	if(ids == NULL || amounts == NULL || snap.getIntData(1) != NULL || snap.getDoubleData(2) != NULL ||
+	   memcmp(ids, tbl.getColumnData(0), rows * sizeof(int)) != 0 ||
+	   memcmp(amounts, tbl.getColumnData(2), rows * sizeof(int)) != 0)
+		printf("Bad mapped columns\n");
+	const unsigned char* codes = (const unsigned char*)snap.getCodes(1);
+	const int* dict = (const int*)snap.getDictData(1);
+	if(snap.getCodeWidth(1) != 1 || snap.getDictSize(1) != 10 || codes == NULL || dict == NULL)
+		printf("Bad encoded column\n");
+	else
+		for(r=0; r < rows; r++)
+			if(dict[codes[r]] != tbl.getValueAt(r, 1))
+			{
+				printf("Bad encoded values\n");
+				break;
+			}
+	// a query over the file's memory
+	_column_query_<int> query(amounts, rows);
+	_aggregate_<int> agg = query.getAggregate();
+	_column_query_<int> tblQuery(tbl.getColumnData(2), rows);
+	if(agg.sum != tblQuery.getAggregate().sum)
+		printf("Bad query over a snapshot\n");
+	snap.releaseColumn(2);
+	if(snap.getIntData(2) == NULL || snap.getIntData(2)[rows - 1] != tbl.getValueAt(rows - 1, 2))
+		printf("Bad column mapped again\n");
+
+	_table_<int> loaded;
+	if(!snap.load(loaded) || loaded != tbl || !loaded.isEncoded(1) || loaded.isEncoded(0))
+		printf("Bad load\n");
+	snap.close();
+
+	// doubles, encoded only in the file; an empty table
+	_table_<double> doubles;
+	doubles.setHeader(header);
+	_array_<double> drow;
+	drow.resize(3);
+	for(r=0; r < 1000; r++)
+	{
+		drow[0] = r / 3.0;
+		drow[1] = (r % 4) * 0.5;
+		drow[2] = -r;
+		doubles.appendRow(drow);
+	}
+	_table_snapshot_::save(doubles, snapFile, true);
+	snap.open(snapFile);
+	_table_<double> dloaded;
+	if(snap.isEncoded(0) || !snap.isEncoded(1) || snap.isEncoded(2) ||
+	   !snap.load(dloaded) || dloaded != doubles || dloaded.isEncoded(1))
+		printf("Bad double snapshot\n");
+	_table_<int> wrongType;
+	if(snap.load(wrongType))
+		printf("Bad load of another type\n");
+	snap.close();
+
+	_table_<double> empty;
+	_table_snapshot_::save(empty, snapFile);
+	if(!snap.open(snapFile) || snap.getColumnCount() != 0 || !snap.load(dloaded) || dloaded.getColumnCount() != 0)
+		printf("Bad empty snapshot\n");
+	doubles.removeAllRows();
+	_table_snapshot_::save(doubles, snapFile, true);
+	if(!snap.open(snapFile) || snap.getColumnCount() != 3 || snap.getRowCount() != 0 ||
+	   !snap.load(dloaded) || dloaded != doubles)
+		printf("Bad snapshot without rows\n");
+	snap.close();
+	DeleteFile(snapFile);
+}
+
+
+//------------------------------------
+// tables of strings
+
+void check_snapshot_strings()
+{
+	int const rows = 70000;
+	_table_<_string_> tbl;
+	_array_<_string_> header;
+	header.append(_string_("name"));
+	header.append(_string_("city"));
+	header.append(_string_(""));
+	header.append(_string_("note"));
+	tbl.setHeader(header);
+	static const char* cities[] = { "Oslo", "Lima", "", "Kyiv" };
+	_array_<_string_> row;
+	row.resize(4);
+	char buf[32];
+	int r;
+	for(r=0; r < rows; r++)
+	{
+		sprintf(buf, "name %d", r);
+		row[0] = buf;
+		row[1] = cities[rand() % 4];
+		row[2] = (r % 3) ? buf : "";
+		row[3] = _string_('x', r % 100);
+		tbl.appendRow(row);
+	}
+	// a long one, past the writer's buffer
+	tbl.setValueAt(5, 3, _string_('y', 100000));
+	tbl.encodeColumn(1);
+
+	_table_snapshot_::save(tbl, snapFile, true);
+	_table_snapshot_ snap;
+	if(!snap.open(snapFile) || snap.getColumnType(0) != column_string || snap.isEncoded(0) ||
+	   !snap.isEncoded(1) || snap.isEncoded(2) || !snap.isEncoded(3) || snap.getColumnName(2).length() != 0)
+		printf("Bad string snapshot header\n");
+	int c, len;
+	for(r=0; r < rows; r++)
+		for(c=0; c < 4; c++)
+		{
+			LPCSTR s = snap.getString(r, c, &len);
+			const _string_& val = tbl.getValueAt(r, c);
+			if(s == NULL || len != val.length() || (len > 0 && memcmp(s, val.c_str(), len) != 0) || s[len] != '\0')
+			{
+				printf("Bad string in a snapshot\n");
+				r = rows;
+				break;
+			}
+		}
+	if(snap.getIntData(0) != NULL || snap.getDictString(0, 0) != NULL)
+		printf("Bad snapshot of strings read as something else\n");
+
+	_table_<_string_> loaded;
+	if(!snap.load(loaded) || loaded != tbl || !loaded.isEncoded(1) || loaded.isEncoded(3))
+		printf("Bad load of strings\n");
+	snap.close();
+	DeleteFile(snapFile);
+}
+
+
+//------------------------------------
+// files that aren't snapshots
+
+void check_snapshot_errors()
+{
+	_table_snapshot_ snap;
+	if(snap.open(_T("no such file.tbl")) || snap.isOpen())
+		printf("Bad open of a missing file\n");
+	_win32_file_ file(snapFile);
+	file.open(access_write, share_read, create_always);
+	file.writeString("id,region,amount\r\n1,2,3\r\n");
+	file.close();
+	if(snap.open(snapFile))
+		printf("Bad open of a text file\n");
+
+	// a snapshot cut short: its column goes past the end of the file
+	_table_<int> tbl;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	tbl.setHeader(header);
+	_array_<int> values;
+	values.resize(1000);
+	tbl.setColumnData(0, &values[0], 1000);
+	_table_snapshot_::save(tbl, snapFile);
+	if(!snap.open(snapFile))
+		printf("Bad open of a snapshot\n");
+	snap.close();
+	_win32_file_ truncated(_T("snapshot_test2.tbl"));
+	truncated.open(access_write, share_read, create_always);
+	file.open(access_read, share_read, open_existing);
+	char buf[1024];
+	truncated.write(buf, file.read(buf, sizeof(buf)));
+	truncated.close();
+	file.close();
+	if(snap.open(_T("snapshot_test2.tbl")))
+		printf("Bad open of a truncated snapshot\n");
+
+	// more rows than the column has values
+	_array_<char> image;
+	read_image(image);
+	DWORD moreRows = 2000;
+	if(open_patched(snap, image, offsetof(table_file_header, rows), &moreRows, sizeof(moreRows)))
+		printf("Bad open of a snapshot with too many rows\n");
+
+	// strings: the last offset past the column, an offset going
+	// back, and a dictionary larger than it is
+	_table_<_string_> strings;
+	header.append(_string_("city"));
+	strings.setHeader(header);
+	_array_<_string_> row;
+	row.resize(2);
+	for(int r=0; r < 1000; r++)
+	{
+		row[0] = _string_('x', r % 10);
+		row[1] = (r % 2) ? "Oslo" : "Lima";
+		strings.appendRow(row);
+	}
+	strings.encodeColumn(1);
+	_table_snapshot_::save(strings, snapFile);
+	read_image(image);
+	table_file_column cols[2];
+	memcpy(cols, &image[sizeof(table_file_header)], sizeof(cols));
+	__int64 offset = 1000000;
+	if(open_patched(snap, image, (long)cols[0].offset + 1000 * sizeof(__int64), &offset, sizeof(offset)))
+		printf("Bad open of a snapshot with strings past the column\n");
+	offset = 0;
+	if(!open_patched(snap, image, (long)cols[0].offset + 500 * sizeof(__int64), &offset, sizeof(offset)) ||
+	   snap.getString(0, 0) != NULL || snap.getString(0, 1) == NULL)
+		printf("Bad snapshot with an offset going back\n");
+	snap.close();
+	DWORD dictSize = 3;
+	if(open_patched(snap, image, sizeof(table_file_header) + sizeof(table_file_column) +
+					offsetof(table_file_column, dictSize), &dictSize, sizeof(dictSize)))
+		printf("Bad open of a snapshot with a dictionary too large\n");
+	if(!open_patched(snap, image, 0, &image[0], 1) || snap.getDictString(2, 1) != NULL)
+		printf("Bad dictionary string past the dictionary\n");
+	snap.close();
+	DeleteFile(_T("snapshot_test2.tbl"));
+	DeleteFile(snapFile);
+}
+
+// the snapshot file's bytes
+static void read_image(_array_<char>& image)
+{
+	_win32_file_ file(snapFile);
+	file.open(access_read, share_read, open_existing);
+	image.resize(_win32_file_::fileSize(snapFile));
+	file.read(&image[0], image.length());
+	file.close();
+}
+
+// opens a copy of the snapshot, with size bytes at pos replaced
+static bool open_patched(_table_snapshot_& snap, const _array_<char>& image, long pos, const void* bytes, int size)
+{
+	snap.close();
+	_array_<char> patched;
+	patched = image;
+	memcpy(&patched[pos], bytes, size);
+	_win32_file_ file(_T("snapshot_test2.tbl"));
+	file.open(access_write, share_read, create_always);
+	file.write(&patched[0], patched.length());
+	file.close();
+	return snap.open(_T("snapshot_test2.tbl"));
+}
+
+
+//------------------------------------
+// performance
+
+void snapshot_performance()
+{
+	int const rows = 5000000;
+	_table_<int> tbl;
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("region"));
+	header.append(_string_("amount"));
+	header.append(_string_("qty"));
+	tbl.setHeader(header);
+	int* data = new int[rows];
+	int r, c;
+	for(c=0; c < 4; c++)
+	{
+		for(r=0; r < rows; r++)
+			data[r] = (c == 0) ? r : (c == 1) ? rand() % 20 : rand();
+		tbl.setColumnData(c, data, rows);
+	}
+	delete [] data;
+
+	// cell by cell, as it used to be done
+	unsigned long t = GetTickCount();
+	_win32_file_ file(snapFile);
+	file.open(access_write, share_read, create_always);
+	for(r=0; r < rows; r++)
+		for(c=0; c < 4; c++)
+		{
+			int val = tbl.getValueAt(r, c);
+			file.write(&val, sizeof(val));
+		}
+	file.close();
+	t = GetTickCount()-t;
+	printf("write cell by cell, 5M rows x 4 ints: %u ms\n", t);
+	t = GetTickCount();
+	file.open(access_read, share_read, open_existing);
+	_table_<int> cells;
+	cells.setHeader(header);
+	_array_<int> row;
+	row.resize(4);
+	for(r=0; r < rows; r++)
+	{
+		for(c=0; c < 4; c++)
+			file.read(&row[c], sizeof(int));
+		cells.appendRow(row);
+	}
+	file.close();
+	t = GetTickCount()-t;
+	printf("read cell by cell: %u ms\n", t);
+
+	t = GetTickCount();
+	_table_snapshot_::save(tbl, snapFile);
+	t = GetTickCount()-t;
+	printf("save: %u ms\n", t);
+	t = GetTickCount();
+	_table_snapshot_ snap;
+	snap.open(snapFile);
+	_table_<int> loaded;
+	snap.load(loaded);
+	snap.close();
+	t = GetTickCount()-t;
+	printf("open+load: %u ms\n", t);
+	if(loaded != tbl)
+		printf("Bad load\n");
+
+	// one column, in place
+	t = GetTickCount();
+	snap.open(snapFile);
+	_column_query_<int> query(snap.getIntData(2), snap.getRowCount());
+	_aggregate_<int> agg = query.getAggregate();
+	t = GetTickCount()-t;
+	printf("open+sum of one column: %u ms\n", t);
+	snap.close();
+	_column_query_<int> tblQuery(tbl.getColumnData(2), rows);
+	if(agg.sum != tblQuery.getAggregate().sum)
+		printf("Bad sum over a snapshot\n");
+
+	t = GetTickCount();
+	_table_snapshot_::save(tbl, snapFile, true);
+	t = GetTickCount()-t;
+	printf("save, encoding: %u ms, %ld bytes\n", t, _win32_file_::fileSize(snapFile));
+	DeleteFile(snapFile);
+}
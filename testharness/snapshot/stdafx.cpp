@@ -0,0 +1,5 @@
+
+#include <_string_.cpp>
+#include <_win32_file_.cpp>
+#include <_thread_pool_.cpp>
+#include <_table_snapshot_.cpp>
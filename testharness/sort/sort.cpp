@@ -6,16 +6,49 @@
 #include <crtdbg.h>
 
 #include <_sort_.h>
+#include <_array_.h>
+#include <_string_.h>
+#include <_cstring_.h>
+#include <_external_sort_.h>
 
 using namespace soige;
 
 void check_sort();
+void check_radix_sort();
+void radix_performance();
+void check_stable_sort();
+void check_selection();
+void selection_performance();
+void check_network_sort();
+void network_performance();
+void check_external_sort();
 
 int main(int argc, char* argv[])
 {
 	printf("Checking sorting\n");
 	check_sort();
 	_CrtDumpMemoryLeaks();
+	printf("Checking radix sorting\n");
+	check_radix_sort();
+	_CrtDumpMemoryLeaks();
+	radix_performance();
+	_CrtDumpMemoryLeaks();
+	printf("Checking stable sorting\n");
+	check_stable_sort();
+	_CrtDumpMemoryLeaks();
+	printf("Checking partial sorting and selection\n");
+	check_selection();
+	_CrtDumpMemoryLeaks();
+	selection_performance();
+	_CrtDumpMemoryLeaks();
+	printf("Checking sorting networks\n");
+	check_network_sort();
+	_CrtDumpMemoryLeaks();
+	network_performance();
+	_CrtDumpMemoryLeaks();
+	printf("Checking external sorting\n");
+	check_external_sort();
+	_CrtDumpMemoryLeaks();
 	return 0;
 }
 
@@ -80,3 +113,803 @@ void check_sort()
 	delete [] str_array[indx-1];
 }
 
+
+//------------------------------------
+// radix sort tests
+int rand32()
+{
+	return (rand() << 17) ^ (rand() << 4) ^ rand();
+}
+
+void make_key(char* buf)
+{
+	// short keys with plenty of shared prefixes
+	int len = rand() % 12;
+	for(int i=0; i<len; i++)
+		buf[i] = "ABCDab01"[rand() % 8];
+	buf[len] = '\0';
+}
+
+void check_radix_sort()
+{
+	int indx;
+	int const count = 100000;
+
+	// -- ints, including negatives and the extremes
+	int* ints = new int[count];
+	for(indx=0; indx < count; ++indx)
+		ints[indx] = rand32();
+	ints[0] = 0x7fffffff;
+	ints[1] = 0x80000000;
+	_sort_<int> intsort;
+	intsort.sort(ints, count);
+	for(indx=1; indx < count; ++indx)
+		if(ints[indx - 1] > ints[indx])
+		{
+			_tprintf(_T("Bad int radix sort\n"));
+			break;
+		}
+	delete [] ints;
+
+	// -- 64-bit ints
+	__int64* longs = new __int64[count];
+	for(indx=0; indx < count; ++indx)
+		longs[indx] = ((__int64)rand32() << 32) ^ (unsigned int)rand32();
+	_sort_<__int64> longsort;
+	longsort.sort(longs, count);
+	for(indx=1; indx < count; ++indx)
+		if(longs[indx - 1] > longs[indx])
+		{
+			_tprintf(_T("Bad __int64 radix sort\n"));
+			break;
+		}
+	delete [] longs;
+
+	// -- doubles, mixing signs and magnitudes
+	double* dbls = new double[count];
+	for(indx=0; indx < count; ++indx)
+		dbls[indx] = (rand32() / 1000.0) * ((rand() & 1) ? 1e-5 : 1e5);
+	dbls[0] = 0.0;
+	dbls[1] = -0.0;
+	_sort_<double> dblsort;
+	dblsort.sort(dbls, count);
+	for(indx=1; indx < count; ++indx)
+		if(dbls[indx - 1] > dbls[indx])
+		{
+			_tprintf(_T("Bad double radix sort\n"));
+			break;
+		}
+	delete [] dbls;
+
+	// -- strings, through _array_ so that sort() dispatches by itself
+	char buf[16];
+	_array_<_string_> strs;
+	for(indx=0; indx < count; ++indx)
+	{
+		make_key(buf);
+		strs.append(_string_(buf));
+	}
+	strs.sort();
+	for(indx=1; indx < count; ++indx)
+		if(strs[indx - 1].compare(strs[indx]) > 0)
+		{
+			_tprintf(_T("Bad _string_ radix sort\n"));
+			break;
+		}
+	strs.sort(true);
+	for(indx=1; indx < count; ++indx)
+		if(strs[indx - 1].compare(strs[indx]) < 0)
+		{
+			_tprintf(_T("Bad descending _string_ radix sort\n"));
+			break;
+		}
+
+	_array_<_cstring_> cstrs;
+	for(indx=0; indx < count; ++indx)
+	{
+		make_key(buf);
+		cstrs.append(_cstring_(buf));
+	}
+	cstrs.sort();
+	for(indx=1; indx < count; ++indx)
+		if(cstrs[indx - 1].compare(cstrs[indx]) > 0)
+		{
+			_tprintf(_T("Bad _cstring_ radix sort\n"));
+			break;
+		}
+}
+
+//------------------------------------
+// radix vs. quick/heap/insertion sort
+void radix_performance()
+{
+	int indx;
+	int const count = 1000000;
+	unsigned long c;
+
+	int* ints = new int[count];
+	int* ints2 = new int[count];
+	for(indx=0; indx < count; ++indx)
+		ints[indx] = ints2[indx] = rand32();
+	_sort_<int> intsort;
+	_sort_<int> intcmpsort(16, -1);
+	c = GetTickCount();
+	intcmpsort.sort(ints2, count);
+	c = GetTickCount()-c;
+	printf("comparison sort, 1M ints: %u\n", c);
+	c = GetTickCount();
+	intsort.sort(ints, count);
+	c = GetTickCount()-c;
+	printf("radix sort, 1M ints: %u\n", c);
+	delete [] ints;
+	delete [] ints2;
+
+	double* dbls = new double[count];
+	double* dbls2 = new double[count];
+	for(indx=0; indx < count; ++indx)
+		dbls[indx] = dbls2[indx] = rand32() / 1000.0;
+	_sort_<double> dblsort;
+	_sort_<double> dblcmpsort(16, -1);
+	c = GetTickCount();
+	dblcmpsort.sort(dbls2, count);
+	c = GetTickCount()-c;
+	printf("comparison sort, 1M doubles: %u\n", c);
+	c = GetTickCount();
+	dblsort.sort(dbls, count);
+	c = GetTickCount()-c;
+	printf("radix sort, 1M doubles: %u\n", c);
+	delete [] dbls;
+	delete [] dbls2;
+
+	char buf[16];
+	_string_* strs = new _string_[count];
+	_string_* strs2 = new _string_[count];
+	for(indx=0; indx < count; ++indx)
+	{
+		make_key(buf);
+		strs[indx] = strs2[indx] = buf;
+	}
+	_sort_<_string_> strsort;
+	_sort_<_string_> strcmpsort(16, -1);
+	c = GetTickCount();
+	strcmpsort.sort(strs2, count);
+	c = GetTickCount()-c;
+	printf("comparison sort, 1M _string_ keys: %u\n", c);
+	c = GetTickCount();
+	strsort.sort(strs, count);
+	c = GetTickCount()-c;
+	printf("radix sort, 1M _string_ keys: %u\n", c);
+	delete [] strs;
+	delete [] strs2;
+}
+
+
+//------------------------------------
+// stable sort tests
+struct record
+{
+	int key;
+	int seq;	// input position
+	bool operator==(const record& r) const { return key == r.key && seq == r.seq; }
+	bool operator<(const record& r) const { return key < r.key || (key == r.key && seq < r.seq); }
+};
+
+class record_key
+{
+public:
+	typedef int key_type;
+	int operator()(const record& r) const { return r.key; }
+};
+
+class record_key_desc
+{
+public:
+	int operator()(const record& a, const record& b) const { return _compare(b.key, a.key); }
+};
+
+// fills in keys with one of a few typical patterns
+void fill_records(record* recs, int count, int pattern)
+{
+	for(int indx=0; indx < count; ++indx)
+	{
+		switch(pattern)
+		{
+		case 0:	recs[indx].key = rand() % 100; break;						// random, many equal
+		case 1:	recs[indx].key = indx / 3; break;							// ascending
+		case 2:	recs[indx].key = (count - indx) / 3; break;				// descending
+		case 3:	recs[indx].key = (indx % 1000) + (rand() % 5); break;	// ascending runs
+		default: recs[indx].key = (indx & 1) ? indx : rand() % 50; break;	// interleaved
+		}
+		recs[indx].seq = indx;
+	}
+}
+
+bool records_stable(const record* recs, int count, bool descending)
+{
+	long long seqsum = 0;
+	for(int indx=0; indx < count; ++indx)
+	{
+		seqsum += recs[indx].seq;
+		if(indx == 0)
+			continue;
+		int c = descending ? recs[indx].key - recs[indx - 1].key : recs[indx - 1].key - recs[indx].key;
+		if(c > 0 || (c == 0 && recs[indx - 1].seq > recs[indx].seq))
+			return false;
+	}
+	return seqsum == (long long)count * (count - 1) / 2;
+}
+
+void check_stable_sort()
+{
+	int const count = 100000;
+	record* recs = new record[count];
+	int pattern;
+
+	for(pattern=0; pattern < 5; ++pattern)
+	{
+		_sort_<record> sorter;
+		fill_records(recs, count, pattern);
+		sorter.stableSortByKey(recs, count, record_key());
+		if(!records_stable(recs, count, false))
+			printf("Bad stable sort by key, pattern %d\n", pattern);
+
+		fill_records(recs, count, pattern);
+		sorter.stableSort(recs, count, record_key_desc());
+		if(!records_stable(recs, count, true))
+			printf("Bad stable sort by comparator, pattern %d\n", pattern);
+
+		// a tiny scratch buffer forces the in-place merges
+		_sort_<record> smallsorter(16, 256, 64);
+		fill_records(recs, count, pattern);
+		smallsorter.stableSortByKey(recs, count, record_key());
+		if(!records_stable(recs, count, false))
+			printf("Bad stable sort with bounded scratch, pattern %d\n", pattern);
+
+		fill_records(recs, count, pattern);
+		sorter.sortByKey(recs, count, record_key());
+		for(int indx=1; indx < count; ++indx)
+			if(recs[indx - 1].key > recs[indx].key)
+			{
+				printf("Bad sort by key, pattern %d\n", pattern);
+				break;
+			}
+	}
+	delete [] recs;
+
+	// strings through _array_
+	_array_<_string_> strs;
+	char buf[16];
+	for(int indx=0; indx < 10000; ++indx)
+	{
+		make_key(buf);
+		strs.append(_string_(buf));
+	}
+	strs.stableSort(true);
+	for(int i=1; i < strs.length(); ++i)
+		if(strs[i - 1].compare(strs[i]) < 0)
+		{
+			printf("Bad descending stable _string_ sort\n");
+			break;
+		}
+}
+
+
+//------------------------------------
+// partial sort / selection tests
+void fill_ints(int* ints, int count, int pattern)
+{
+	for(int indx=0; indx < count; ++indx)
+	{
+		switch(pattern)
+		{
+		case 0:	ints[indx] = rand32(); break;								// random
+		case 1:	ints[indx] = rand() % 10; break;							// many equal
+		case 2:	ints[indx] = indx; break;									// ascending
+		case 3:	ints[indx] = count - indx; break;							// descending
+		default: ints[indx] = (indx < count/2) ? indx : count - indx; break;	// organ pipe
+		}
+	}
+}
+
+void check_selection()
+{
+	int const count = 50000;
+	int* ints = new int[count];
+	int* orig = new int[count];
+	int* sorted = new int[count];
+	int const ks[] = { 1, 2, 17, 100, count/8 + 1, count/2, count - 1, count };
+	int pattern;
+	int indx;
+
+	for(pattern=0; pattern < 5; ++pattern)
+	{
+		_sort_<int> sorter;
+		fill_ints(orig, count, pattern);
+		for(indx=0; indx < count; ++indx)
+			sorted[indx] = orig[indx];
+		sorter.sort(sorted, count);
+
+		for(int ik=0; ik < sizeof(ks)/sizeof(ks[0]); ++ik)
+		{
+			int k = ks[ik];
+
+			memcpy(ints, orig, count * sizeof(int));
+			sorter.nthElement(ints, count, k - 1);
+			if(ints[k - 1] != sorted[k - 1])
+				printf("Bad nthElement, pattern %d, index %d\n", pattern, k - 1);
+			for(indx=0; indx < count; ++indx)
+				if( (indx < k - 1 && ints[indx] > ints[k - 1]) ||
+					(indx > k - 1 && ints[indx] < ints[k - 1]) )
+				{
+					printf("Bad nthElement partition, pattern %d, index %d\n", pattern, k - 1);
+					break;
+				}
+
+			memcpy(ints, orig, count * sizeof(int));
+			sorter.partialSort(ints, count, k);
+			for(indx=0; indx < k; ++indx)
+				if(ints[indx] != sorted[indx])
+				{
+					printf("Bad partialSort, pattern %d, k %d\n", pattern, k);
+					break;
+				}
+
+			// largest k, streamed one by one
+			memcpy(ints, orig, count * sizeof(int));
+			_top_k_<int, _reverse_comparator_< _comparator_<int> > > top(k);
+			for(indx=0; indx < count; ++indx)
+				top.push(ints[indx]);
+			top.sort();
+			if(top.size() != k)
+				printf("Bad _top_k_ size, pattern %d, k %d\n", pattern, k);
+			for(indx=0; indx < top.size(); ++indx)
+				if(top[indx] != sorted[count - 1 - indx])
+				{
+					printf("Bad _top_k_, pattern %d, k %d\n", pattern, k);
+					break;
+				}
+		}
+
+		// no insertion sort at all: quickselect down to single items
+		_sort_<int> tinysorter(0);
+		memcpy(ints, orig, count * sizeof(int));
+		tinysorter.nthElement(ints, count, count/3);
+		if(ints[count/3] != sorted[count/3])
+			printf("Bad nthElement without insertion sort, pattern %d\n", pattern);
+	}
+	delete [] ints;
+	delete [] orig;
+	delete [] sorted;
+
+	// strings through _array_, descending
+	_array_<_string_> strs;
+	char buf[16];
+	for(indx=0; indx < 10000; ++indx)
+	{
+		make_key(buf);
+		strs.append(_string_(buf));
+	}
+	_array_<_string_> strs2 = strs;
+	strs2.sort(true);
+	strs.partialSort(50, true);
+	for(indx=0; indx < 50; ++indx)
+		if(strs[indx].compare(strs2[indx]) != 0)
+		{
+			printf("Bad descending _string_ partialSort\n");
+			break;
+		}
+	strs.nthElement(5000, true);
+	if(strs[5000].compare(strs2[5000]) != 0)
+		printf("Bad descending _string_ nthElement\n");
+
+	// pushing after sort() and clear()
+	_top_k_<_string_> top(3);
+	top.push(_string_("d"));
+	top.push(_string_("b"));
+	top.push(_string_("c"));
+	top.sort();
+	if(!top.push(_string_("a")) || top.push(_string_("e")))
+		printf("Bad _top_k_ push after sort\n");
+	top.sort();
+	if(top[0].compare("a") != 0 || top[2].compare("c") != 0 || top.threshold().compare("c") != 0)
+		printf("Bad _top_k_ order after sort\n");
+	top.clear();
+	if(top.size() != 0 || !top.push(_string_("z")))
+		printf("Bad _top_k_ clear\n");
+}
+
+//------------------------------------
+// top 100 out of 5M: full sort vs. partial sort vs. _top_k_
+void selection_performance()
+{
+	int indx;
+	int const count = 5000000;
+	int const k = 100;
+	unsigned long c;
+
+	int* ints = new int[count];
+	int* ints2 = new int[count];
+	for(indx=0; indx < count; ++indx)
+		ints[indx] = ints2[indx] = rand32();
+
+	_sort_<int> cmpsort(16, -1);
+	c = GetTickCount();
+	cmpsort.sort(ints2, count);
+	c = GetTickCount()-c;
+	printf("comparison sort, 5M ints: %u\n", c);
+
+	for(indx=0; indx < count; ++indx)
+		ints2[indx] = ints[indx];
+	c = GetTickCount();
+	cmpsort.partialSort(ints2, count, k);
+	c = GetTickCount()-c;
+	printf("partialSort, first 100 of 5M ints: %u\n", c);
+
+	c = GetTickCount();
+	cmpsort.nthElement(ints2, count, count/2);
+	c = GetTickCount()-c;
+	printf("nthElement, median of 5M ints: %u\n", c);
+
+	c = GetTickCount();
+	_top_k_<int> top(k);
+	for(indx=0; indx < count; ++indx)
+		top.push(ints[indx]);
+	top.sort();
+	c = GetTickCount()-c;
+	printf("_top_k_, first 100 of 5M ints: %u\n", c);
+
+	delete [] ints;
+	delete [] ints2;
+}
+
+
+//------------------------------------
+// sorting network tests
+
+// same order as the default, but no network for it
+class int_order
+{
+public:
+	int operator()(int a, int b) const { return _compare(a, b); }
+};
+
+template<typename T> bool is_sorted(const T* a, int count)
+{
+	for(int indx=1; indx < count; ++indx)
+		if(a[indx] < a[indx - 1])
+			return false;
+	return true;
+}
+
+template<typename T> bool same_items(const T* a, const T* b, int count)
+{
+	// both sorted: same multiset iff same sequence
+	for(int indx=0; indx < count; ++indx)
+		if(!(a[indx] == b[indx]))
+			return false;
+	return true;
+}
+
+template<typename T> void check_network_type(T* dummy, const char* name, int const* values, int valueCount)
+{
+	int const arrays = 11;	// not a multiple of the lanes
+	T* batch = new T[arrays * 64];
+	T* check = new T[arrays * 64];
+	for(int len=1; len <= 64; ++len)
+	{
+		int indx;
+		for(indx=0; indx < arrays * len; ++indx)
+			batch[indx] = check[indx] = (T)values[rand() % valueCount];
+
+		// single arrays, straight through the network
+		T one[64];
+		for(indx=0; indx < len; ++indx)
+			one[indx] = batch[indx];
+		if(!_networkSort(one, len, _comparator_<T>()))
+			printf("No %s network for %d items\n", name, len);
+		if(!is_sorted(one, len))
+			printf("Bad %s network, %d items\n", name, len);
+
+		_networkSortN(batch, arrays, len);
+		for(int i=0; i < arrays; ++i)
+		{
+			_sort_<T> sorter(16, -1);
+			sorter.stableSort(check + i * len, len);
+			if(!same_items(batch + i * len, check + i * len, len))
+			{
+				printf("Bad %s batch network sort, %d items\n", name, len);
+				break;
+			}
+		}
+	}
+	delete [] batch;
+	delete [] check;
+}
+
+// the bits of each item, sorted, to compare as multisets
+template<typename T> void sorted_bits(const T* items, int count, unsigned __int64* bits)
+{
+	for(int indx=0; indx < count; ++indx)
+	{
+		bits[indx] = 0;
+		memcpy(&bits[indx], &items[indx], sizeof(T));
+	}
+	_sort_<unsigned __int64> sorter;
+	sorter.sort(bits, count);
+}
+
+// a NaN and -0.0 among the items: nothing is sorted by <, but the
+// networks must still only move the items around
+template<typename T> void check_network_nan(T* dummy, const char* name)
+{
+	int const arrays = 8;
+	T batch[arrays * 64], before[arrays * 64];
+	unsigned __int64 a[64], b[64];
+	T zero = 0;
+	for(int len=2; len <= 64; ++len)
+	{
+		int indx;
+		for(indx=0; indx < arrays * len; ++indx)
+		{
+			int i = indx % len;
+			batch[indx] = (T)i;
+			if(i == (indx / len) % len)
+				batch[indx] = zero / zero;
+			else if(i == ((indx / len) + 3) % len)
+				batch[indx] = -zero;
+		}
+		memcpy(before, batch, sizeof(T) * arrays * len);
+		_networkSortN(batch, arrays, len);
+		for(int i=0; i < arrays; ++i)
+		{
+			sorted_bits(before + i * len, len, a);
+			sorted_bits(batch + i * len, len, b);
+			if(memcmp(a, b, sizeof(a[0]) * len))
+			{
+				printf("Bad %s batch network sort with NaN and -0, %d items\n", name, len);
+				len = 64;
+				break;
+			}
+		}
+		T one[64];
+		memcpy(one, before, sizeof(T) * len);
+		_networkSort(one, len, _comparator_<T>());
+		sorted_bits(before, len, a);
+		sorted_bits(one, len, b);
+		if(memcmp(a, b, sizeof(a[0]) * len))
+			printf("Bad %s network sort with NaN and -0, %d items\n", name, len);
+	}
+}
+
+void check_network_sort()
+{
+	int values[1000];
+	int indx;
+	for(indx=0; indx < 1000; ++indx)
+		values[indx] = rand32();
+	values[0] = 0x7fffffff;
+	values[1] = 0x80000000;
+	values[2] = 0;
+	int few[3] = { -1, 0, 1 };
+
+	check_network_type((int*)NULL, "int", values, 1000);
+	check_network_type((int*)NULL, "int", few, 3);
+	check_network_type((unsigned int*)NULL, "unsigned int", values, 1000);
+	check_network_type((__int64*)NULL, "__int64", values, 1000);
+	check_network_type((float*)NULL, "float", values, 1000);
+	check_network_type((double*)NULL, "double", values, 1000);
+	check_network_type((double*)NULL, "double", few, 3);
+	check_network_nan((float*)NULL, "float");
+	check_network_nan((double*)NULL, "double");
+
+	// a longer sort with the networks as its base case
+	int const count = 100000;
+	int* ints = new int[count];
+	for(indx=0; indx < count; ++indx)
+		ints[indx] = rand32();
+	_sort_<int> sorter(32, -1);
+	sorter.sort(ints, count);
+	if(!is_sorted(ints, count))
+		printf("Bad int sort with sorting networks\n");
+	delete [] ints;
+}
+
+//------------------------------------
+// 16-item arrays: insertion sort vs. sorting networks
+void network_performance()
+{
+	int indx;
+	int const len = 16;
+	int const arrays = 250000;
+	unsigned long c;
+
+	int* ints = new int[arrays * len];
+	int* work = new int[arrays * len];
+	for(indx=0; indx < arrays * len; ++indx)
+		ints[indx] = rand32();
+	_sort_<int> sorter(16, -1);
+
+	memcpy(work, ints, arrays * len * sizeof(int));
+	c = GetTickCount();
+	for(indx=0; indx < arrays; ++indx)
+		sorter.sort(work + indx * len, len, int_order());
+	c = GetTickCount()-c;
+	printf("insertion sort, 250K x 16 ints: %u\n", c);
+
+	memcpy(work, ints, arrays * len * sizeof(int));
+	c = GetTickCount();
+	for(indx=0; indx < arrays; ++indx)
+		sorter.sort(work + indx * len, len);
+	c = GetTickCount()-c;
+	printf("sorting network, 250K x 16 ints: %u\n", c);
+
+	memcpy(work, ints, arrays * len * sizeof(int));
+	c = GetTickCount();
+	_networkSortN(work, arrays, len);
+	c = GetTickCount()-c;
+	printf("batch sorting network, 250K x 16 ints: %u\n", c);
+
+	int const count = 1000000;
+	memcpy(work, ints, count * sizeof(int));
+	c = GetTickCount();
+	sorter.sort(work, count, int_order());
+	c = GetTickCount()-c;
+	printf("quick sort + insertion sort, 1M ints: %u\n", c);
+
+	memcpy(work, ints, count * sizeof(int));
+	c = GetTickCount();
+	sorter.sort(work, count);
+	c = GetTickCount()-c;
+	printf("quick sort + sorting networks, 1M ints: %u\n", c);
+
+	delete [] ints;
+	delete [] work;
+}
+
+
+//------------------------------------
+// external sort tests
+class progress_check : public external_sort_listener
+{
+public:
+	int reports;
+	__int64 lastDone;
+	int cancelAt;	// report number to cancel at, -1 for never
+	bool bad;
+	progress_check(int cancel = -1) : reports(0), lastDone(-1), cancelAt(cancel), bad(false) { }
+	bool onSortProgress(sort_phase phase, __int64 done, __int64 total)
+	{
+		if(phase == phase_merge && (done < lastDone || done > total))
+			bad = true;
+		if(phase == phase_merge)
+			lastDone = done;
+		return (reports++ != cancelAt);
+	}
+};
+
+// writes count records (pattern as in fill_records) to a record file
+bool write_record_file(LPCTSTR fileName, int count, int pattern)
+{
+	record* recs = new record[count];
+	fill_records(recs, count, pattern);
+	_file_output_stream_ out(fileName);
+	// odd-sized blocks, not what the sort writes
+	_record_writer_<record> writer(&out, 1000);
+	for(int indx=0; indx < count; ++indx)
+		writer.write(recs[indx]);
+	bool ok = writer.flush();
+	out.close();
+	delete [] recs;
+	return ok;
+}
+
+// reads the file back: all count records, sorted on key,
+// and each input record there once
+bool check_record_file(LPCTSTR fileName, int count)
+{
+	_file_input_stream_ in(fileName);
+	_record_reader_<record> reader(&in);
+	char* seen = new char[count];
+	memset(seen, 0, count);
+	record rec;
+	int n = 0;
+	int prevKey = 0;
+	bool ok = true;
+	while(ok && reader.read(rec))
+	{
+		if( (n > 0 && rec.key < prevKey) || rec.seq < 0 || rec.seq >= count || seen[rec.seq] )
+			ok = false;
+		else
+			seen[rec.seq] = 1;
+		prevKey = rec.key;
+		++n;
+	}
+	delete [] seen;
+	return ok && !reader.failed() && n == count;
+}
+
+void check_external_sort()
+{
+	LPCTSTR inFile = _T("extsort_in.dat");
+	LPCTSTR outFile = _T("extsort_out.dat");
+	int const count = 200000;	// 1.6MB of records
+
+	for(int pattern=0; pattern < 5; ++pattern)
+	{
+		if(!write_record_file(inFile, count, pattern))
+		{
+			printf("Can't write %s\n", inFile);
+			return;
+		}
+
+		// all in memory: one run, no merge
+		_external_sort_<record> sorter1(4 * 1024 * 1024);
+		if( !sorter1.sort(inFile, outFile) || !check_record_file(outFile, count) ||
+			sorter1.runCount() != 1 || sorter1.mergePasses() != 0 )
+			printf("Bad in-memory external sort, pattern %d\n", pattern);
+
+		// 25 runs, one merge
+		_external_sort_<record> sorter2(64 * 1024);
+		progress_check progress;
+		sorter2.setListener(&progress);
+		if( !sorter2.sort(inFile, outFile) || !check_record_file(outFile, count) ||
+			sorter2.mergePasses() != 1 || progress.bad || progress.lastDone != count )
+			printf("Bad external sort, pattern %d\n", pattern);
+
+		// 100 runs (2017 records each, beside the block of the run writer), two merge passes
+		_external_sort_<record> sorter3(16 * 1024);
+		if( !sorter3.sort(inFile, outFile) || !check_record_file(outFile, count) ||
+			sorter3.runCount() != 100 || sorter3.mergePasses() != 2 )
+			printf("Bad multi-pass external sort, pattern %d\n", pattern);
+		if( sorter3.recordCount() != count )
+			printf("Bad external sort record count, pattern %d\n", pattern);
+	}
+
+	// cancelling: no output, no runs left behind
+	_external_sort_<record> sorter(16 * 1024);
+	progress_check cancel(40);
+	sorter.setListener(&cancel);
+	if( sorter.sort(inFile, outFile) || _win32_file_::exists(outFile) )
+		printf("Bad cancelled external sort\n");
+
+	// a file of other records
+	_file_output_stream_ out(inFile);
+	int ints[10] = { 0 };
+	out.writeArray(ints, sizeof(int), 10);
+	out.close();
+	if( sorter.sort(inFile, outFile) )
+		printf("Bad external sort of a file of other records\n");
+
+	// timing: 2M ints with a 1MB budget
+	int const bigCount = 2000000;
+	{
+		_file_output_stream_ bigOut(inFile);
+		_record_writer_<int> writer(&bigOut);
+		for(int indx=0; indx < bigCount; ++indx)
+			writer.write(rand32());
+		writer.flush();
+		bigOut.close();
+	}
+	_external_sort_<int> intsorter(1024 * 1024);
+	unsigned long c = GetTickCount();
+	bool ok = intsorter.sort(inFile, outFile);
+	c = GetTickCount()-c;
+	printf("external sort, 2M ints, 1MB of memory, %d runs: %u\n", intsorter.runCount(), c);
+	{
+		_file_input_stream_ in(outFile);
+		_record_reader_<int> reader(&in);
+		int prev = 0x80000000, cur, n = 0;
+		while(reader.read(cur))
+		{
+			if(cur < prev)
+				ok = false;
+			prev = cur;
+			++n;
+		}
+		if(!ok || n != bigCount)
+			printf("Bad external sort of ints\n");
+	}
+
+	DeleteFile(inFile);
+	DeleteFile(outFile);
+}
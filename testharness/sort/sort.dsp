@@ -87,6 +87,10 @@ LINK32=link.exe
 
 SOURCE=.\sort.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=.\stdafx.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
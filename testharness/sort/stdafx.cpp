@@ -0,0 +1,9 @@
+
+#include <_string_.cpp>
+#include <_cstring_.cpp>
+#include <_wstring_.cpp>
+
+#include <_io_streams_defs_.h>
+#include <_byte_streams_defs_.h>
+#include <_file_streams_defs_.h>
+#include <_win32_file_.cpp>
@@ -7,15 +7,43 @@
 // #undefine ALL_STRING_STUFF in project settings
 
 #include <crtdbg.h>
+#include <limits.h>
 
 #include <_cstring_.h>
 #include <_wstring_.h>
 #include <_string_.h>
+#include <_array_.h>
+#include <_string_view_.h>
+#include <_dictionary_.h>
+#include <_hash_.h>
+#include <_string_builder_.h>
+#include <_rope_.h>
+#include <_string_pool_.h>
+#include <_thread_pool_.h>
+#include <_num_conv_.h>
+#include <_format_.h>
 
 using namespace soige;
 
 void check_strings();
 void test_lstring();
+void check_local_strings();
+void local_strings_performance();
+void check_string_views();
+void string_views_performance();
+void check_string_search();
+void string_search_performance();
+void check_string_builder();
+void check_rope();
+void builder_and_rope_performance();
+void check_tokenizer();
+void tokenizer_performance();
+void check_string_pool();
+void string_pool_performance();
+void check_num_conv();
+void num_conv_performance();
+void check_format();
+void format_performance();
 
 int main(int argc, char* argv[])
 {
@@ -27,6 +55,56 @@ int main(int argc, char* argv[])
 	test_lstring();
 	_CrtDumpMemoryLeaks();
 
+	printf("Checking short strings\n");
+	check_local_strings();
+	_CrtDumpMemoryLeaks();
+	local_strings_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking _string_view_\n");
+	check_string_views();
+	_CrtDumpMemoryLeaks();
+	string_views_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking find() and compare()\n");
+	check_string_search();
+	_CrtDumpMemoryLeaks();
+	string_search_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking _string_builder_ and _rope_\n");
+	check_string_builder();
+	_CrtDumpMemoryLeaks();
+	check_rope();
+	_CrtDumpMemoryLeaks();
+	builder_and_rope_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking _string_tokenizer_ and join()\n");
+	check_tokenizer();
+	_CrtDumpMemoryLeaks();
+	tokenizer_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking _string_pool_\n");
+	check_string_pool();
+	_CrtDumpMemoryLeaks();
+	string_pool_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking numbers to text and back\n");
+	check_num_conv();
+	_CrtDumpMemoryLeaks();
+	num_conv_performance();
+	_CrtDumpMemoryLeaks();
+
+	printf("Checking type-safe format()\n");
+	check_format();
+	_CrtDumpMemoryLeaks();
+	format_performance();
+	_CrtDumpMemoryLeaks();
+
 	return 0;
 }
 
@@ -325,3 +403,1722 @@ void test_lstring()
 	wstr.append( L"went to school" );
 }
 
+
+//------------------------------------
+// short strings, kept in the string object
+
+void check_local_strings()
+{
+	// 23 chars fit, 24 don't
+	_string_ s1("12345678901234567890123");
+	_string_ s2("123456789012345678901234");
+	if(s1.capacity() != STRING_LOCAL_SIZE - 1 || s2.capacity() < 24 || s1.length() != 23 || s2.length() != 24)
+		printf("Bad local string capacity\n");
+	if(_string_().c_str() != NULL || !_string_().isNull() || _string_("").isNull() || _string_("").length() != 0)
+		printf("Bad null and empty strings\n");
+
+	// a copy of a short string has chars of its own; a long one is shared until written
+	_string_ c1(s1), c2(s2);
+	if(c1.c_str() == s1.c_str() || c1 != s1 || c2.c_str() != s2.c_str())
+		printf("Bad copy\n");
+	c1[0] = 'x';
+	c2[0] = 'x';
+	if(s1[0] != '1' || s2[0] != '1' || c1[0] != 'x' || c2.c_str() == s2.c_str())
+		printf("Bad write to a copy\n");
+	c1 = s1;
+	if(c1 != s1 || c1.c_str() == s1.c_str())
+		printf("Bad assignment\n");
+
+	// growing out of the object, with the embedded 0s
+	_string_ g("ab");
+	g.append('\0').append("cd");
+	_string_ before(g);
+	for(int i=0; i < 30; i++)
+		g += 'e';
+	if(g.length() != 35 || g[2] != '\0' || memcmp(g.c_str(), before.c_str(), 5) != 0 || g[34] != 'e')
+		printf("Bad growing string\n");
+	g.chopRight(30);
+	if(g != before)
+		printf("Bad chopped string\n");
+
+	// swaps between short and long
+	_string_ a("short"), b("a string that is much too long to be short");
+	_string_ a0(a), b0(b);
+	a.swap(b);
+	if(a != b0 || b != a0)
+		printf("Bad swap of a short and a long string\n");
+	_string_ c("other");
+	b.swap(c);
+	if(b != "other" || c != a0)
+		printf("Bad swap of short strings\n");
+	a.swap(a);
+	if(a != b0)
+		printf("Bad swap with itself\n");
+
+	// a string that gave out a char& stays unshareable when it
+	// gets short chars, and when those are swapped or grow
+	_string_ u("a string that is much too long to be short");
+	u[0] = 'A';
+	u = "short";
+	_string_ u1(b0);
+	u = u1;
+	if(u != b0 || u.c_str() == u1.c_str())
+		printf("Bad unshareable string made short\n");
+	_string_ v("short");
+	v[0] = 'S';
+	v.swap(u1);
+	_string_ v1(v);
+	if(v != b0 || v1.c_str() == v.c_str() || u1 != "Short")
+		printf("Bad unshareable short string swapped\n");
+	_string_ w("short");
+	w[0] = 'S';
+	w += " and then long enough to leave the object";
+	_string_ w1(w);
+	if(w1 != w || w1.c_str() == w.c_str())
+		printf("Bad unshareable short string grown\n");
+
+	// assigning a string its own chars
+	a = "abcdef";
+	a = a.c_str() + 2;
+	b = "a string that is much too long to be short";
+	b = b.c_str() + 2;
+	if(a != "cdef" || b != "string that is much too long to be short")
+		printf("Bad assignment from itself\n");
+	a = "abcdef";
+	a = a.substring(1, 3);
+	if(a != "bcd")
+		printf("Bad substring\n");
+
+	// sorting swaps them about
+	_array_<_string_> keys;
+	char buf[64];
+	int i;
+	for(i=0; i < 1000; i++)
+	{
+		sprintf(buf, (i % 3) ? "key %d" : "a much longer key, number %d", rand());
+		keys.append(_string_(buf));
+	}
+	_radixSort(&keys[0], keys.length());
+	for(i=1; i < keys.length(); i++)
+		if(keys[i] < keys[i - 1])
+		{
+			printf("Bad sort of short and long strings\n");
+			break;
+		}
+
+	// the same for _cstring_
+	_cstring_ cs1("12345678901234567890123");
+	_cstring_ cs2("123456789012345678901234");
+	if(cs1.capacity() != CSTRING_LOCAL_SIZE - 1 || cs2.capacity() < 24)
+		printf("Bad local _cstring_ capacity\n");
+	_cstring_ cc(cs1);
+	cc[0] = 'x';
+	if(cs1[0] != '1' || cc[0] != 'x' || (LPCSTR)cc == (LPCSTR)cs1)
+		printf("Bad _cstring_ copy\n");
+	_cstring_ cg("ab");
+	for(i=0; i < 30; i++)
+		cg += 'e';
+	if(cg.length() != 32 || cg.getChar(1) != 'b' || cg.getChar(31) != 'e')
+		printf("Bad growing _cstring_\n");
+	_cstring_ ca("short"), cb("a string that is much too long to be short");
+	ca.swap(cb);
+	if(ca != "a string that is much too long to be short" || cb != "short")
+		printf("Bad _cstring_ swap\n");
+	ca = "other";
+	ca.swap(cb);
+	if(ca != "short" || cb != "other")
+		printf("Bad swap of short _cstring_s\n");
+	ca.append(ca);
+	if(ca != "shortshort")
+		printf("Bad _cstring_ appended to itself\n");
+}
+
+
+//------------------------------------
+// performance
+
+// keys as they come: mostly short codes and names, some long
+void make_keys(_array_<_string_>& keys, int count)
+{
+	char buf[128];
+	for(int i=0; i < count; i++)
+	{
+		switch(i % 10)
+		{
+		case 0: case 1: case 2:
+			sprintf(buf, "%d", rand() % 1000000); break;
+		case 3: case 4: case 5:
+			sprintf(buf, "cust-%06d", i); break;
+		case 6: case 7:
+			sprintf(buf, "%s %d", (i % 3) ? "Oslo" : "Lima", i % 100); break;
+		case 8:
+			sprintf(buf, "user%d@example.com", i); break;
+		default:
+			sprintf(buf, "https://example.com/catalog/items/%d?ref=%d", i, rand()); break;
+		}
+		keys.append(_string_(buf));
+	}
+}
+
+void local_strings_performance()
+{
+	int const count = 1000000;
+	_array_<_string_> keys;
+	make_keys(keys, count);
+	int i, r;
+
+	unsigned long t = GetTickCount();
+	for(r=0; r < 5; r++)
+	{
+		_string_* strs = new _string_[count];
+		for(i=0; i < count; i++)
+			strs[i] = keys[i].c_str();
+		delete [] strs;
+	}
+	t = GetTickCount()-t;
+	printf("_string_, 5 x 1M keys constructed and destroyed: %u ms\n", t);
+
+	t = GetTickCount();
+	for(r=0; r < 5; r++)
+	{
+		_array_<_string_> copies(keys);
+		copies[0] += 'x';
+	}
+	t = GetTickCount()-t;
+	printf("_string_, 5 x 1M keys copied and destroyed: %u ms\n", t);
+
+	t = GetTickCount();
+	for(r=0; r < 5; r++)
+	{
+		_cstring_* strs = new _cstring_[count];
+		for(i=0; i < count; i++)
+			strs[i] = keys[i].c_str();
+		_cstring_* copies = new _cstring_[count];
+		for(i=0; i < count; i++)
+			copies[i] = strs[i];
+		delete [] copies;
+		delete [] strs;
+	}
+	t = GetTickCount()-t;
+	printf("_cstring_, 5 x 1M keys constructed, copied and destroyed: %u ms\n", t);
+}
+
+
+//------------------------------------
+// string views
+
+void check_string_views()
+{
+	_string_ s("  alpha, Beta,gamma ,,delta  ");
+	_string_view_ v = s.view();
+	if(v.data() != s.c_str() || v.length() != s.length() || !_string_view_().isNull() || !_string_view_().isEmpty())
+		printf("Bad view of a string\n");
+
+	// slices and searches
+	_string_view_ t(v);
+	t.trim();
+	if(t != "alpha, Beta,gamma ,,delta" || t.data() != s.c_str() + 2)
+		printf("Bad trim\n");
+	if(t.find("Beta") != 7 || t.find("beta") != -1 || t.find("beta", 0, false) != 7 ||
+	   t.find(',') != 5 || t.find(',', 6) != 11 || t.findReverse(",") != 19 || t.findReverse(",", 18) != 18 ||
+	   t.find("") != 0 || t.find("delta!") != -1)
+		printf("Bad find in a view\n");
+	if(!t.startsWith("alpha") || !t.startsWith("ALPHA", false) || t.startsWith("alpha, Beta,gamma ,,delta!") ||
+	   !t.endsWith("delta") || t.left(5) != "alpha" || t.right(5) != "delta" || t.substring(7, 4) != "Beta" ||
+	   t.substring(100).length() != 0 || t.substring(-3, 2) != "al" || t.left(100) != t)
+		printf("Bad view slices\n");
+	if(_string_view_("abc").compare("abd") >= 0 || _string_view_("abc").compare("ab") <= 0 ||
+	   _string_view_("ABC").compare("abc", false) != 0 || _compare(_string_view_("b"), _string_view_("a")) <= 0)
+		printf("Bad view compare\n");
+
+	// tokens
+	_string_view_ rest(t), token;
+	static const char* tokens[] = { "alpha", " Beta", "gamma ", "", "delta" };
+	int i = 0;
+	for(;;)
+	{
+		token = rest.nextToken(",");
+		if(i >= 5 || token != tokens[i])
+			printf("Bad token %d\n", i);
+		i++;
+		if(rest.isEmpty())
+			break;
+	}
+	if(i != 5)
+		printf("Bad count of tokens\n");
+#ifdef ALL_STRING_STUFF
+	_array_<_string_view_> parts;
+	if(t.split(parts, ",") != 5 || parts[1] != " Beta" || parts[3].length() != 0 ||
+	   _string_view_("a--b--").split(parts, "--") != 3 || parts[2].length() != 0 ||
+	   _string_view_("aXbxc").split(parts, "x", true) != 3)
+		printf("Bad split into views\n");
+#endif
+
+	// _string_ and _cstring_ with views
+	_string_ fromView(t.substring(7, 4));
+	if(fromView != "Beta" || fromView != t.substring(7, 4) || fromView.compare(_string_view_("Beta")) != 0 ||
+	   s.find(_string_view_("gamma")) != 14 || !s.startsWith(_string_view_("  al")) || !s.endsWith(_string_view_("a  ")) ||
+	   s.view(2, 5) != "alpha" || !_string_(_string_view_()).isNull())
+		printf("Bad _string_ and views\n");
+	fromView = s.view(2, 5);
+	fromView += _string_view_("!!");
+	fromView.append(fromView.view(0, 2));
+	if(fromView != "alpha!!al")
+		printf("Bad _string_ assigned from views\n");
+	fromView = fromView.view(1, 3);
+	if(fromView != "lph")
+		printf("Bad _string_ assigned its own view\n");
+	_cstring_ cs(t.substring(7, 4));
+	cs += t.left(5);
+	cs.append(cs.view(0, 1));
+	if(cs != _string_view_("BetaalphaB") || cs.find(t.left(5)) != 4 || !cs.startsWith(_string_view_("Beta")) ||
+	   cs.compare(_string_view_("Betb")) >= 0 || cs.view(4) != "alphaB")
+		printf("Bad _cstring_ and views\n");
+	cs = cs.view(4, 5);
+	if(cs != _string_view_("alpha"))
+		printf("Bad _cstring_ assigned its own view\n");
+
+	// lookups by views
+	_dictionary_<_string_, int> dict;
+	dict.put(_string_("alpha"), 1);
+	dict.put(_string_("Beta"), 2);
+	dict.put(_string_("gamma"), 3);
+	int* pVal = dict.lookup(t.substring(12, 5));
+	if(pVal == NULL || *pVal != 3 || dict.lookup(t.left(4)) != NULL || *dict.lookup(_string_view_("alpha")) != 1)
+		printf("Bad dictionary lookup by a view\n");
+	if(_hashOf(_string_("gamma")) != _hashOf(t.substring(12, 5)))
+		printf("Bad hash of a view\n");
+}
+
+
+void string_views_performance()
+{
+	// a log of comma separated records
+	int const rows = 200000;
+	_string_ text;
+	char buf[128];
+	int i, r;
+	for(i=0; i < rows; i++)
+	{
+		sprintf(buf, "%d,cust-%06d,%s,%d.%02d,OK\n", i, rand() % 100000, (i % 3) ? "Oslo" : "Lima", rand() % 1000, i % 100);
+		text += buf;
+	}
+
+	// lines and fields as substrings
+	unsigned long t = GetTickCount();
+	int fields = 0;
+	long sum = 0;
+	for(r=0; r < 5; r++)
+	{
+		int pos = 0, eol;
+		while((eol = text.find("\n", pos)) >= 0)
+		{
+			_string_ line = text.substring(pos, eol - pos);
+			int fpos = 0, comma;
+			while((comma = line.find(",", fpos)) >= 0)
+			{
+				_string_ field = line.substring(fpos, comma - fpos);
+				sum += field.length();
+				fields++;
+				fpos = comma + 1;
+			}
+			pos = eol + 1;
+		}
+	}
+	t = GetTickCount()-t;
+	printf("5 x 200K lines split with substring(): %u ms (%d fields)\n", t, fields);
+
+	// the same as views
+	t = GetTickCount();
+	int vfields = 0;
+	long vsum = 0;
+	for(r=0; r < 5; r++)
+	{
+		_string_view_ rest = text.view();
+		while(!rest.isEmpty())
+		{
+			_string_view_ line = rest.nextToken("\n");
+			while(line.find(',') >= 0)
+			{
+				vsum += line.nextToken(",").length();
+				vfields++;
+			}
+		}
+	}
+	t = GetTickCount()-t;
+	printf("5 x 200K lines split as views: %u ms\n", t);
+	if(vfields != fields || vsum != sum)
+		printf("Bad fields of views\n");
+}
+
+
+//------------------------------------
+// find() and compare(), with and without SSE2
+
+// the char by char search find() used to do
+int naive_find(const char* hay, int hayLen, const char* needle, int needleLen, int start, bool case_sensitive)
+{
+	for(; start <= hayLen - needleLen; start++)
+	{
+		int i = 0;
+		while(i < needleLen && (hay[start+i] == needle[i] ||
+			  (!case_sensitive && tolower((unsigned char)hay[start+i]) == tolower((unsigned char)needle[i]))))
+			i++;
+		if(i == needleLen)
+			return start;
+	}
+	return -1;
+}
+
+int sign(int val)
+{
+	return (val > 0) - (val < 0);
+}
+
+void check_string_search()
+{
+	// a small alphabet, so that there are lots of partial matches;
+	// nulls and chars past 0x7F too
+	static const char alphabet[] = { 'a', 'A', 'b', 'B', 'z', 'Z', '@', '[', '\0', (char)0xC1, (char)0xE1 };
+	char hay[300], needle[40];
+	int bad = 0;
+	for(int round=0; round < 20000; round++)
+	{
+		int hayLen = rand() % 300;
+		int needleLen = 1 + rand() % ((round % 4) ? 3 : 40);
+		int i;
+		for(i=0; i < hayLen; i++)
+			hay[i] = alphabet[rand() % 4 + ((rand() % 8) ? 0 : rand() % 7)];
+		if(hayLen > needleLen && rand() % 2)
+			memcpy(needle, hay + rand() % (hayLen - needleLen), needleLen);
+		else
+			for(i=0; i < needleLen; i++)
+				needle[i] = alphabet[rand() % 4];
+		if(rand() % 2)
+			needle[0] ^= 0x20;
+		bool cs = (rand() % 2) != 0;
+		int start = rand() % (hayLen + 1);
+
+		_string_view_ h(hay, hayLen), n(needle, needleLen);
+		int found = naive_find(hay, hayLen, needle, needleLen, start, cs);
+		if(h.find(n, start, cs) != found)
+			bad++;
+		// the last one at or before start
+		int last = -1;
+		for(i=0; i <= start; i++)
+			if(naive_find(hay, hayLen, needle, needleLen, i, cs) == i)
+				last = i;
+		if(h.findReverse(n, start, cs) != last)
+			bad++;
+
+		_string_ str(h), sub(n);
+		_cstring_ cstr(h), csub(n);
+		if(start < hayLen && (str.find(sub, start, cs) != found || cstr.find(csub, start, cs) != found))
+			bad++;
+		// findReverse() gives a match at or after start, if there is one
+		if(memchr(needle, 0, needleLen) == NULL && start < hayLen)
+		{
+			char lpstr[41];
+			memcpy(lpstr, needle, needleLen);
+			lpstr[needleLen] = '\0';
+			int rev = (found >= 0) ? found : last;
+			if(str.findReverse(lpstr, start, cs) != rev || cstr.findReverse(lpstr, start, cs) != rev ||
+			   str.find(lpstr, start, cs) != found || cstr.find(lpstr, start, cs) != found)
+				bad++;
+		}
+
+		// compare() against a prefix of the haystack, which is equal
+		// up to the case or differs somewhere
+		int cmpLen = (hayLen < needleLen) ? hayLen : needleLen;
+		int expected = cs ? memcmp(hay, needle, cmpLen) : 0;
+		if(!cs)
+			for(i=0; i < cmpLen && expected == 0; i++)
+				expected = tolower((unsigned char)hay[i]) - tolower((unsigned char)needle[i]);
+		if(expected == 0)
+			expected = hayLen - needleLen;
+		if(sign(h.compare(n, cs)) != sign(expected) || sign(str.compare(sub, cs)) != sign(expected) ||
+		   sign(cstr.compare(csub, cs)) != sign(expected))
+			bad++;
+		bool same = (hayLen == needleLen && memcmp(hay, needle, hayLen) == 0);
+		if(str != _string_(h) || (str == sub) != same || (cstr == csub) != same ||
+		   str.startsWith(n, cs) != (naive_find(hay, (hayLen < needleLen) ? hayLen : needleLen, needle, needleLen, 0, cs) == 0))
+			bad++;
+	}
+	if(bad)
+		printf("Bad find() or compare(): %d\n", bad);
+
+	// the blocks of 16 chars and the chars left after them
+	_string_ text('x', 100);
+	text[99] = 'y';
+	if(text.find("xy") != 98 || text.find("XY", 0, false) != 98 || text.find("yx") != -1 ||
+	   text.findReverse("xx") != 97 || text.findReverse("Xx", 50, false) != 50 ||
+	   text.view().findReverse("xY", MAX_INT, false) != 98)
+		printf("Bad find() at the end\n");
+	if(_string_("abcdefghijklmnopqrstuvwxyz0123456789").compare("ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", false) != 0 ||
+	   _string_("abcdefghijklmnopqrstuvwxyz0123456789").compare(_string_("abcdefghijklmnopqrstuvwxyz0123456788")) <= 0 ||
+	   _cstring_("abcdefghijklmnopqrstuvwxyz0123456789").endsWith("XYZ0123456789", false) != true)
+		printf("Bad compare() of long strings\n");
+}
+
+void string_search_performance()
+{
+	// short haystacks: field names
+	_array_<_string_> names;
+	make_keys(names, 100000);
+	unsigned long t = GetTickCount();
+	int found = 0, r, i;
+	for(r=0; r < 20; r++)
+		for(i=0; i < names.length(); i++)
+			found += naive_find(names[i].c_str(), names[i].length(), "id", 2, 0, false) >= 0;
+	t = GetTickCount()-t;
+	printf("20 x 100K short strings, case-insensitive find, char by char: %u ms\n", t);
+	t = GetTickCount();
+	int found2 = 0;
+	for(r=0; r < 20; r++)
+		for(i=0; i < names.length(); i++)
+			found2 += names[i].find("id", 0, false) >= 0;
+	t = GetTickCount()-t;
+	printf("the same with find(): %u ms\n", t);
+	if(found != found2)
+		printf("Bad find() of short strings\n");
+
+	// a long haystack: a 2MB log, looking for the last line
+	_string_ text;
+	char buf[128];
+	for(i=0; i < 60000; i++)
+	{
+		sprintf(buf, "%d,cust-%06d,%s,%d.%02d,OK\n", i, rand() % 100000, (i % 3) ? "Oslo" : "Lima", rand() % 1000, i % 100);
+		text += buf;
+	}
+	text += "59999,cust-END,Kyiv,0.00,FAILED\n";
+	int pos = -1;
+	t = GetTickCount();
+	for(r=0; r < 20; r++)
+		pos = naive_find(text.c_str(), text.length(), "Kyiv,0.00,failed", 16, 0, false);
+	t = GetTickCount()-t;
+	printf("20 x 2MB case-insensitive find, char by char: %u ms\n", t);
+	int pos2 = -1;
+	t = GetTickCount();
+	for(r=0; r < 20; r++)
+		pos2 = text.find("Kyiv,0.00,failed", 0, false);
+	t = GetTickCount()-t;
+	printf("the same with find(): %u ms\n", t);
+	t = GetTickCount();
+	for(r=0; r < 20; r++)
+		if(text.find("Kyiv,0.00,FAILED") != pos)
+			pos2 = -1;
+	t = GetTickCount()-t;
+	printf("20 x 2MB find(), case-sensitive: %u ms\n", t);
+	t = GetTickCount();
+	for(r=0; r < 20; r++)
+		if(text.findReverse("cust-0") >= pos)
+			pos2 = -1;
+	t = GetTickCount()-t;
+	printf("20 x findReverse() from the end: %u ms\n", t);
+	if(pos < 0 || pos != pos2)
+		printf("Bad find() of a long string\n");
+
+	// comparing long strings that differ near the end
+	_string_ other(text);
+	other[other.length() - 2] = '?';
+	t = GetTickCount();
+	int cmp = 0;
+	for(r=0; r < 20; r++)
+		cmp += memicmp(text.c_str(), other.c_str(), text.length()) > 0;
+	t = GetTickCount()-t;
+	printf("20 x 2MB memicmp(): %u ms\n", t);
+	t = GetTickCount();
+	int cmp2 = 0;
+	for(r=0; r < 20; r++)
+		cmp2 += text.compare(other, false) > 0;
+	t = GetTickCount()-t;
+	printf("the same with compare(): %u ms\n", t);
+	if(cmp != cmp2)
+		printf("Bad compare() of a long string\n");
+}
+
+
+//------------------------------------
+// _string_builder_ and _rope_
+
+void check_string_builder()
+{
+	_string_builder_ sb;
+	if(sb.toString() != "" || sb.toString().isNull() || sb.length() != 0)
+		printf("Bad empty builder\n");
+	_string_ expected;
+	char buf[64];
+	int i;
+	for(i=0; i < 5000; i++)
+	{
+		sprintf(buf, "line %d: ", i);
+		sb.append(buf).append((long)i).append(',').append(_string_("x")).append(_string_view_("yz", 1));
+		sb += '\n';
+		expected += buf;
+		expected += (long)i;
+		expected += ",xy\n";
+	}
+	// nulls, and a run longer than any chunk
+	sb.append(_string_view_("a\0b", 3)).append('-', 3000000);
+	expected += _string_view_("a\0b", 3);
+	expected += _string_('-', 3000000);
+	if(sb.length() != expected.length() || sb.toString() != expected)
+		printf("Bad built string\n");
+	_string_ shared(expected);
+	sb.toString(shared);
+	if(shared != expected || shared.length() != expected.length())
+		printf("Bad built string into a shared one\n");
+
+	// the chunks are reused after clear()
+	sb.clear();
+	if(sb.length() != 0 || sb.toString().length() != 0)
+		printf("Bad cleared builder\n");
+	sb.append("again").append(1.5);
+	if(sb.toString() != "again1.5")
+		printf("Bad builder after clear()\n");
+}
+
+void check_rope()
+{
+	_rope_ empty;
+	if(empty.length() != 0 || empty.toString() != "" || empty.substring(0).length() != 0 ||
+	   empty.piece(0).length() != 0 || empty.charAt(5) != '\0')
+		printf("Bad empty rope\n");
+
+	// random edits of a rope and of a _string_, side by side
+	_string_ text('a', 5000);
+	int i;
+	for(i=0; i < text.length(); i++)
+		text[i] = (char)('a' + i % 26);
+	_rope_ rope(text);
+	_rope_ first(rope);
+	_string_ original(text);
+	char buf[64];
+	int bad = 0;
+	for(i=0; i < 3000; i++)
+	{
+		int pos = rand() % (text.length() + 1);
+		switch(rand() % 5)
+		{
+		case 0: case 1:
+			sprintf(buf, "<%d>", i);
+			rope.insert(buf, pos);
+			text.insert(buf, pos);
+			break;
+		case 2:
+		{
+			int count = rand() % 50;
+			rope.remove(pos, count);
+			text.replace("", pos, count);
+			break;
+		}
+		case 3:
+			rope.append(_string_view_("\0tail", 5));
+			text += _string_view_("\0tail", 5);
+			break;
+		default:
+		{
+			// a piece of itself
+			int count = rand() % 300;
+			_rope_ sub = rope.substring(pos, count);
+			if(sub.toString() != text.substring(pos, count))
+				bad++;
+			rope.insert(sub, rand() % (rope.length() + 1));
+			text = _string_(rope.toString());
+			break;
+		}
+		}
+		if(rope.length() != text.length() || (i % 100 == 0 && rope.toString() != text))
+			bad++;
+	}
+	if(rope.toString() != text)
+		bad++;
+	// the pieces, one after another
+	_string_ pieces;
+	for(int p=0; p < rope.length(); )
+	{
+		_string_view_ v = rope.piece(p);
+		pieces += v;
+		p += v.length();
+	}
+	for(i=0; i < text.length(); i += 97)
+		if(rope[i] != text[i])
+			bad++;
+	char part[200];
+	rope.copyTo(part, 1000, 200);
+	if(pieces != text || memcmp(part, text.c_str() + 1000, 200) != 0)
+		bad++;
+	// the copy made at first is as it was
+	if(first.toString() != original || first.charAt(27) != 'b')
+		bad++;
+	rope.append(rope);
+	text += text;
+	if(rope.toString() != text)
+		bad++;
+	if(bad)
+		printf("Bad rope: %d\n", bad);
+
+	// appends in order, and inserts all at the front, stay balanced
+	_rope_ log, stack;
+	for(i=0; i < 100000; i++)
+	{
+		sprintf(buf, "%d;", i);
+		log += buf;
+		stack.insert(buf, 0);
+	}
+	if(log.depth() > 40 || stack.depth() > 60)
+		printf("Bad rope depth: %d, %d\n", log.depth(), stack.depth());
+	if(log.substring(log.length() - 6).toString() != "99999;" || stack.substring(0, 6).toString() != "99999;")
+		printf("Bad rope of many parts\n");
+	log.clear();
+	if(!log.isEmpty())
+		printf("Bad cleared rope\n");
+}
+
+void builder_and_rope_performance()
+{
+	// a report of 400K lines, 16MB, appended a field at a time
+	int const lines = 400000;
+	char buf[128];
+	int i;
+	_array_<_string_> fields;
+	for(i=0; i < 1000; i++)
+	{
+		sprintf(buf, "%8d | cust-%06d | %-10s | %10.2f\n", i, i % 100000, (i % 3) ? "Oslo" : "Lima", i * 0.37);
+		fields.append(_string_(buf));
+	}
+	unsigned long t = GetTickCount();
+	_string_ report;
+	for(i=0; i < lines; i++)
+	{
+		report += fields[i % 1000].view(0, 9);
+		report += fields[i % 1000].view(9);
+	}
+	t = GetTickCount()-t;
+	printf("16MB report, _string_ +=: %u ms\n", t);
+	t = GetTickCount();
+	_string_builder_ sb;
+	for(i=0; i < lines; i++)
+	{
+		sb += fields[i % 1000].view(0, 9);
+		sb += fields[i % 1000].view(9);
+	}
+	_string_ built = sb.toString();
+	t = GetTickCount()-t;
+	printf("the same with _string_builder_: %u ms\n", t);
+	if(built != report)
+		printf("Bad report\n");
+
+	// 2000 edits all over the text
+	t = GetTickCount();
+	_string_ text(report);
+	srand(1);
+	for(i=0; i < 2000; i++)
+	{
+		int pos = (int)(((__int64)rand() * 32768 + rand()) % text.length());
+		if(i % 2) text.insert("[edit]", pos);
+		else	  text.replace("", pos, 6);
+	}
+	t = GetTickCount()-t;
+	printf("2000 inserts and removes in a 16MB _string_: %u ms\n", t);
+	t = GetTickCount();
+	_rope_ rope(report);
+	srand(1);
+	for(i=0; i < 2000; i++)
+	{
+		int pos = (int)(((__int64)rand() * 32768 + rand()) % rope.length());
+		if(i % 2) rope.insert("[edit]", pos);
+		else	  rope.remove(pos, 6);
+	}
+	_string_ edited = rope.toString();
+	t = GetTickCount()-t;
+	printf("the same with _rope_: %u ms\n", t);
+	if(edited != text)
+		printf("Bad edited rope\n");
+}
+
+
+//------------------------------------
+// _string_tokenizer_, _char_set_ and join()
+
+void check_tokenizer()
+{
+	// the same tokens as split()
+	static const char* texts[] = { "a,b,,c", ",a,", "", "abc", ",", "x,,", "1,22,333,4444,55555,666666,7777777,88888888,999999999" };
+	int i, n;
+	_string_view_ token;
+	for(i=0; i < sizeof(texts)/sizeof(texts[0]); i++)
+	{
+		_string_ text(texts[i]);
+		_array_<_string_> parts;
+		text.split(parts, ",");
+		_string_tokenizer_ tok(text.view(), ",");
+		for(n=0; tok.next(token); n++)
+			if(n >= parts.length() || parts[n] != token)
+				break;
+		if(n != parts.length() || tok.hasMore() || tok.next(token))
+			printf("Bad tokens of \"%s\"\n", texts[i]);
+	}
+	_string_tokenizer_ multi(_string_view_("a<>b<>"), "<>");
+	if(!multi.next(token) || token != "a" || multi.rest() != "b<>" || !multi.next(token) || token != "b" ||
+	   !multi.next(token) || !token.isEmpty() || multi.next(token))
+		printf("Bad tokens of a delimiter string\n");
+	_string_tokenizer_ nocase(_string_view_("oneANDtwoandthree"), "and", false);
+	n = 0;
+	while(nocase.next(token))
+		n++;
+	if(n != 3 || token != "three")
+		printf("Bad case-insensitive tokens\n");
+
+	// a set of delimiters, with and without the empty tokens
+	_char_set_ set(" \t,;");
+	if(!set.contains('\t') || set.contains('x') || set.count() != 4 || _char_set_().findIn("abc", 3) != -1)
+		printf("Bad _char_set_\n");
+	_string_view_ line("  alpha,beta;;\tgamma  delta ");
+	_string_tokenizer_ words(line, set, true);
+	static const char* expected[] = { "alpha", "beta", "gamma", "delta" };
+	for(n=0; words.next(token); n++)
+		if(n >= 4 || token != expected[n])
+			break;
+	if(n != 4)
+		printf("Bad tokens of a set\n");
+	_string_tokenizer_ fields(_string_view_(";a;"), _char_set_(";"));
+	n = 0;
+	while(fields.next(token))
+		n++;
+	if(n != 3)
+		printf("Bad empty tokens of a set\n");
+
+	// long texts, with and without SSE2, against the set lookup
+	char buf[500];
+	static const char alphabet[] = "abc ,;\xE9\x80";
+	for(int round=0; round < 2000; round++)
+	{
+		int len = rand() % 500;
+		for(i=0; i < len; i++)
+			buf[i] = alphabet[rand() % 8];
+		_char_set_ delims;
+		int count = 1 + rand() % 12;
+		for(i=0; i < count; i++)
+			delims.add((char)(rand() % 4 ? alphabet[rand() % 8] : rand()));
+		int start = rand() % (len + 1);
+		int found = -1;
+		for(i=start; i < len && found < 0; i++)
+			if(delims.contains(buf[i]))
+				found = i;
+		if(_string_view_(buf, len).find(delims, start) != found)
+		{
+			printf("Bad find() of a set\n");
+			break;
+		}
+	}
+	_array_<_string_view_> views;
+	_string_view_(line).split(views, set, true);
+	if(views.length() != 4 || views[3] != "delta")
+		printf("Bad split() at a set\n");
+
+	// join()
+	_array_<_string_> strs;
+	if(!_string_::join(strs).isNull())
+		printf("Bad join() of nothing\n");
+	strs.append(_string_("a"));
+	strs.append(_string_(""));
+	strs.append(_string_(_string_view_("b\0c", 3)));
+	if(_string_::join(strs, ", ") != _string_view_("a, , b\0c", 8) || _string_::join(strs, NULL) != _string_view_("ab\0c", 4) ||
+	   _string_::join(strs, "-", 1, 1).length() != 0 || _string_::join(strs, "-", 1) != _string_view_("-b\0c", 4))
+		printf("Bad join()\n");
+	_string_view_("x|y||z").split(views, "|");
+	if(_string_::join(views, "+") != "x+y++z" || _string_::join(views, "", 2) != "z")
+		printf("Bad join() of views\n");
+	_array_<_cstring_> cstrs;
+	cstrs.append(_cstring_("a"));
+	cstrs.append(_cstring_("bc"));
+	if(_cstring_::join(cstrs, "--") != "a--bc" || _cstring_::join(cstrs).length() != 4)
+		printf("Bad _cstring_ join()\n");
+}
+
+void tokenizer_performance()
+{
+	// 200K lines of words and numbers
+	int const rows = 200000;
+	_string_builder_ sb;
+	char buf[128];
+	int i, r;
+	for(i=0; i < rows; i++)
+	{
+		sprintf(buf, "%d cust-%06d\t%s;%d.%02d, OK\n", i, rand() % 100000, (i % 3) ? "Oslo" : "Lima", rand() % 1000, i % 100);
+		sb += buf;
+	}
+	_string_ text = sb.toString();
+
+	// split() into an array of strings
+	unsigned long t = GetTickCount();
+	_array_<_string_> parts;
+	long sum = 0;
+	for(r=0; r < 5; r++)
+	{
+		text.split(parts, ";");
+		for(i=0; i < parts.length(); i++)
+			sum += parts[i].length();
+	}
+	t = GetTickCount()-t;
+	printf("5 x split() at ';' into %d strings: %u ms\n", parts.length(), t);
+	t = GetTickCount();
+	long vsum = 0;
+	for(r=0; r < 5; r++)
+	{
+		_string_tokenizer_ tok(text.view(), ";");
+		_string_view_ token;
+		while(tok.next(token))
+			vsum += token.length();
+	}
+	t = GetTickCount()-t;
+	printf("the same with _string_tokenizer_: %u ms\n", t);
+	if(vsum != sum)
+		printf("Bad tokens\n");
+
+	// words between any of five delimiters
+	_char_set_ set(" \t;,\n");
+	t = GetTickCount();
+	int words = 0;
+	for(r=0; r < 5; r++)
+	{
+		const char* p = text.c_str();
+		const char* end = p + text.length();
+		while(p < end)
+		{
+			const char* w = p;
+			while(p < end && !strchr(" \t;,\n", *p))
+				p++;
+			words += (p > w);
+			p++;
+		}
+	}
+	t = GetTickCount()-t;
+	printf("5 x words, char by char with strchr(): %u ms (%d words)\n", t, words);
+	t = GetTickCount();
+	int vwords = 0;
+	for(r=0; r < 5; r++)
+	{
+		_string_tokenizer_ tok(text.view(), set, true);
+		_string_view_ word;
+		while(tok.next(word))
+			vwords++;
+	}
+	t = GetTickCount()-t;
+	printf("the same with a _char_set_: %u ms\n", t);
+	if(vwords != words)
+		printf("Bad words\n");
+
+	// join() of the 200K lines, and appending them one by one
+	text.split(parts, "\n");
+	t = GetTickCount();
+	_string_ appended;
+	for(r=0; r < 5; r++)
+	{
+		appended = _string_();
+		for(i=0; i < parts.length(); i++)
+		{
+			appended.append(parts[i]);
+			if(i != parts.length() - 1)
+				appended.append("\n");
+		}
+	}
+	t = GetTickCount()-t;
+	printf("5 x 200K lines appended one by one: %u ms\n", t);
+	t = GetTickCount();
+	_string_ joined;
+	for(r=0; r < 5; r++)
+		joined = _string_::join(parts, "\n");
+	t = GetTickCount()-t;
+	printf("the same with join(): %u ms\n", t);
+	if(joined != text || appended != text)
+		printf("Bad join()\n");
+}
+
+
+//------------------------------------
+// _string_pool_
+
+// interns the same values as the other jobs, in another order
+struct intern_job
+{
+	_string_pool_*	pool;
+	_string_*		results;
+	int				count;
+	int				step;
+	long*			pending;
+	HANDLE			done;
+};
+
+int __stdcall intern_run(void* p)
+{
+	intern_job* job = (intern_job*)p;
+	char buf[64];
+	for(int i=0; i < job->count; i++)
+	{
+		int v = (i * job->step) % job->count;
+		sprintf(buf, (v % 2) ? "value %d" : "a longer value, not kept in the string: %d", v);
+		job->results[v] = job->pool->intern(buf);
+	}
+	if(InterlockedDecrement(job->pending) == 0)
+		SetEvent(job->done);
+	return 0;
+}
+
+void check_string_pool()
+{
+	_string_pool_ pool;
+	_string_ a = pool.intern("Oslo");
+	_string_ b = pool.intern(_string_("Oslo"));
+	_string_ c = pool.intern(_string_view_("Oslo, Norway").left(4));
+	if(!a.isInterned() || !_string_pool_::same(a, b) || !_string_pool_::same(a, c) || pool.count() != 1 ||
+	   a.internedHash() != _hashOf(_string_view_("Oslo")) || _hashOf(a) != _hashOf(_string_("Oslo")))
+		printf("Bad interned string\n");
+	if(_string_("Oslo").isInterned() || _string_("Oslo").internedHash() != 0)
+		printf("Bad string that isn't interned\n");
+
+	// changing a copy doesn't change the pool's string
+	_string_ d = a;
+	d += "!";
+	_string_ e = a;
+	e.upper();
+	_string_ f = a;
+	f[0] = 'K';
+	if(a != "Oslo" || d != "Oslo!" || e != "OSLO" || f != "Kslo" || d.isInterned() || e.isInterned() ||
+	   f.isInterned() || !_string_pool_::same(a, pool.intern("Oslo")))
+		printf("Bad change to an interned string\n");
+	_string_builder_ sb;
+	sb.append("Bergen");
+	sb.toString(d = a);
+	if(d != "Bergen" || a != "Oslo")
+		printf("Bad _string_builder_ into an interned string\n");
+	// swapping with an unshareable string leaves the pool's string
+	// shareable, and the other one has its chars to itself
+	_string_ u('u', 100);
+	u[0] = 'U';
+	_string_ o = a;
+	u.swap(o);
+	_string_ o1(o), u1(u);
+	if(u != "Oslo" || !_string_pool_::same(u, a) || !_string_pool_::same(pool.intern("Oslo"), a) ||
+	   !_string_pool_::same(u1, a) || o.c_str()[0] != 'U' || o1.c_str() != o.c_str())
+		printf("Bad swap with an interned string\n");
+
+	// NULL, empty, long and binary strings
+	_string_view_ binary("a\0b", 3);
+	if(!pool.intern((LPCSTR)NULL).isNull() || !pool.intern(_string_()).isNull() || pool.intern("").isNull() ||
+	   !pool.intern("").isInterned() || pool.intern("").length() != 0 || pool.intern(binary) != binary ||
+	   _string_pool_::same(pool.intern(binary), pool.intern(_string_view_("a\0c", 3))) ||
+	   !_string_pool_::same(pool.intern(binary), pool.intern(binary)))
+		printf("Bad interning of empty and binary strings\n");
+	_string_ text('x', 1000);
+	if(pool.intern(text) != text || !_string_pool_::same(pool.intern(text), pool.intern(text.view())))
+		printf("Bad interning of a long string\n");
+	if(!pool.find("Lima").isNull() || !_string_pool_::same(pool.find("Oslo"), a) || pool.count() != 5)
+		printf("Bad find()\n");
+
+	// many strings, growing the tables, and ==
+	char buf[64];
+	_array_<_string_> first;
+	int i;
+	for(i=0; i < 20000; i++)
+	{
+		sprintf(buf, "string %d", i);
+		first.append(pool.intern(buf));
+	}
+	for(i=0; i < 20000; i++)
+	{
+		sprintf(buf, "string %d", i);
+		_string_ again = pool.intern(_string_(buf));
+		if(!_string_pool_::same(first[i], again) || first[i] != again || !(first[i] == _string_(buf)) ||
+		   first[i] == first[(i + 1) % 20000])
+			break;
+	}
+	if(i != 20000 || pool.count() != 20005)
+		printf("Bad interning of many strings\n");
+
+	// another pool has its own strings, equal to these
+	_string_pool_ other;
+	_string_ g = other.intern("Oslo");
+	if(_string_pool_::same(a, g) || a != g || !(a == g) || a.compare(g) != 0)
+		printf("Bad strings of two pools\n");
+
+	// the strings outlive the pool's tables
+	_string_ only = pool.intern("only this one");
+	pool.clear();
+	if(pool.count() != 0 || a != "Oslo" || !a.isInterned() || only != "only this one")
+		printf("Bad clear()\n");
+	only += "!";
+	if(only != "only this one!" || _string_pool_::same(a, pool.intern("Oslo")))
+		printf("Bad strings after clear()\n");
+
+	// threads interning the same strings at once
+	int const values = 20000, jobs = 4;
+	static const int steps[jobs] = { 1, 7919, 7927, 7933 };
+	intern_job job[jobs];
+	_thread_pool_ threads;
+	threads.setMaxThreads(jobs);
+	long pending = jobs;
+	HANDLE done = CreateEvent(NULL, FALSE, FALSE, NULL);
+	for(i=0; i < jobs; i++)
+	{
+		job[i].pool = &other;
+		job[i].results = new _string_[values];
+		job[i].count = values;
+		job[i].step = steps[i];
+		job[i].pending = &pending;
+		job[i].done = done;
+		threads.queueJob(intern_run, &job[i]);
+	}
+	WaitForSingleObject(done, INFINITE);
+	CloseHandle(done);
+	for(i=0; i < values; i++)
+	{
+		int j;
+		for(j=1; j < jobs; j++)
+			if(!_string_pool_::same(job[0].results[i], job[j].results[i]))
+				break;
+		if(j != jobs || job[0].results[i].isNull())
+			break;
+	}
+	if(i != values || other.count() != values + 1)
+		printf("Bad interning by threads\n");
+	for(i=0; i < jobs; i++)
+		delete [] job[i].results;
+}
+
+void string_pool_performance()
+{
+	// 1M cells of a column with 2000 values, half of them short
+	int const rows = 1000000, values = 2000;
+	_array_<_string_> plain, interned;
+	_string_pool_ pool;
+	char buf[64];
+	int i;
+	for(i=0; i < rows; i++)
+	{
+		int v = (int)(((unsigned)i * 2654435761u) % values);
+		sprintf(buf, (v % 2) ? "Company %d" : "Company %d, Consolidated Holdings", v);
+		plain.append(_string_(buf));
+	}
+	interned.resize(rows);
+	unsigned long t = GetTickCount();
+	for(i=0; i < rows; i++)
+		interned[i] = pool.intern(plain[i]);
+	t = GetTickCount()-t;
+	printf("1M intern() of 2000 values: %u ms\n", t);
+
+	// comparing each cell to a few others
+	int r, equal = 0;
+	t = GetTickCount();
+	for(r=1; r <= 10; r++)
+		for(i=0; i < rows; i++)
+			equal += (plain[i] == plain[(i + r * 4001) % rows]);
+	t = GetTickCount()-t;
+	printf("10M == of strings: %u ms\n", t);
+	int iequal = 0;
+	t = GetTickCount();
+	for(r=1; r <= 10; r++)
+		for(i=0; i < rows; i++)
+			iequal += (interned[i] == interned[(i + r * 4001) % rows]);
+	t = GetTickCount()-t;
+	printf("the same, interned: %u ms\n", t);
+	int same = 0;
+	t = GetTickCount();
+	for(r=1; r <= 10; r++)
+		for(i=0; i < rows; i++)
+			same += _string_pool_::same(interned[i], interned[(i + r * 4001) % rows]);
+	t = GetTickCount()-t;
+	printf("the same with same(): %u ms\n", t);
+	if(equal != iequal || equal != same)
+		printf("Bad compares\n");
+
+	// hashing them, as a hash join or group-by does
+	DWORD h = 0;
+	t = GetTickCount();
+	for(r=0; r < 10; r++)
+		for(i=0; i < rows; i++)
+			h += _hashOf(plain[i]);
+	t = GetTickCount()-t;
+	printf("10M _hashOf() of strings: %u ms\n", t);
+	DWORD ih = 0;
+	t = GetTickCount();
+	for(r=0; r < 10; r++)
+		for(i=0; i < rows; i++)
+			ih += _hashOf(interned[i]);
+	t = GetTickCount()-t;
+	printf("the same, interned: %u ms\n", t);
+	if(h != ih)
+		printf("Bad hashes\n");
+}
+
+
+//------------------------------------
+// _num_conv_
+
+static unsigned __int64 bits_of(double val)
+{
+	unsigned __int64 bits;
+	memcpy(&bits, &val, sizeof(bits));
+	return bits;
+}
+
+static double double_of(unsigned __int64 bits)
+{
+	double val;
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+// xorshift, for the same random numbers everywhere
+static unsigned __int64 next_random(unsigned __int64& x)
+{
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+// the significant digits of a number as text
+static int significant_digits(const char* p)
+{
+	int n = 0, zeros = 0;
+	bool started = false;
+	for(; *p && *p != 'e'; p++)
+	{
+		if(*p < '0' || *p > '9') continue;
+		if(*p == '0')
+		{
+			if(started) zeros++;
+			continue;
+		}
+		n += zeros + 1;
+		zeros = 0;
+		started = true;
+	}
+	return n;
+}
+
+// a random number as text, now and then too long or too large
+static int random_number_text(unsigned __int64& x, char* buf)
+{
+	char* p = buf;
+	DWORD r = (DWORD)next_random(x);
+	if(r & 1) *p++ = '-';
+	int digits = 1 + (int)((r >> 1) % 25);
+	int point = (r & 0x100) ? (int)((r >> 9) % (digits + 1)) : -1;
+	for(int i=0; i < digits; i++)
+	{
+		if(i == point) *p++ = '.';
+		*p++ = (char)('0' + (int)(next_random(x) % 10));
+	}
+	if(r & 0x80000)
+		p += sprintf(p, "e%d", (int)((r >> 20) % 680) - 350);
+	*p = '\0';
+	return (int)(p - buf);
+}
+
+void check_num_conv()
+{
+	char buf[NUM_CONV_CHARS];
+	int i;
+
+	// the layout
+	static const struct { double val; const char* text; } layouts[] = {
+		{ 0.0, "0" }, { 100.0, "100" }, { 1.5, "1.5" }, { -1.5, "-1.5" }, { 0.001, "0.001" },
+		{ 1e21, "1e+21" }, { 1e20, "100000000000000000000" }, { 1.5e-7, "1.5e-7" }, { 0.000001, "0.000001" },
+		{ 0.1 + 0.2, "0.30000000000000004" }, { 123456.789, "123456.789" }, { 5e-324, "5e-324" },
+		{ 1.7976931348623157e308, "1.7976931348623157e+308" }, { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+		{ 9007199254740993.0, "9007199254740992" }, { 1.0 / 3, "0.3333333333333333" }
+	};
+	for(i=0; i < sizeof(layouts) / sizeof(layouts[0]); i++)
+	{
+		int len = _formatDouble(layouts[i].val, buf);
+		if(strcmp(buf, layouts[i].text) || len != (int)strlen(buf))
+			printf("Bad _formatDouble(): %s, not %s\n", buf, layouts[i].text);
+	}
+	double zero = 0.0, val;
+	if(_formatDouble(-zero, buf) != 2 || strcmp(buf, "-0") || _formatDouble(1 / zero, buf) != 8 ||
+	   strcmp(buf, "Infinity") || _formatDouble(-1 / zero, buf) != 9 || strcmp(buf, "-Infinity") ||
+	   _formatDouble(zero / zero, buf) != 3 || strcmp(buf, "NaN"))
+		printf("Bad _formatDouble() of -0, Infinity or NaN\n");
+	if(_parseDouble("Infinity", 8, &val) != 8 || val != 1 / zero || _parseDouble("-inf", 4, &val) != 4 ||
+	   val != -1 / zero || _parseDouble("NaN", 3, &val) != 3 || val == val ||
+	   _parseDouble("-0", 2, &val) != 2 || bits_of(val) != bits_of(-zero))
+		printf("Bad _parseDouble() of Infinity, NaN or -0\n");
+
+	// integers
+	long l;
+	__int64 ll;
+	char lmax[NUM_CONV_CHARS], lmin[NUM_CONV_CHARS];
+	sprintf(lmax, "%ld", LONG_MAX);
+	sprintf(lmin, "%ld", LONG_MIN);
+	__int64 int64max = ((__int64)0x7FFFFFFF << 32) | 0xFFFFFFFF;
+	if(_formatLong(0, buf) != 1 || strcmp(buf, "0") || _formatLong(-7, buf) != 2 || strcmp(buf, "-7") ||
+	   _formatLong(LONG_MAX, buf) != (int)strlen(lmax) || strcmp(buf, lmax) ||
+	   _formatLong(LONG_MIN, buf) != (int)strlen(lmin) || strcmp(buf, lmin) ||
+	   _formatInt64(int64max, buf) != 19 || strcmp(buf, "9223372036854775807") ||
+	   _formatInt64(-int64max - 1, buf) != 20 || strcmp(buf, "-9223372036854775808") ||
+	   _formatInt64(1000000000, buf) != 10 || strcmp(buf, "1000000000"))
+		printf("Bad _formatLong() or _formatInt64()\n");
+	if(_parseLong(lmin, strlen(lmin), &l) != (int)strlen(lmin) || l != LONG_MIN ||
+	   _parseLong("99999999999999999999", 20, &l) != 20 || l != LONG_MAX ||
+	   _parseLong(" -99999999999999999999", 22, &l) != 22 || l != LONG_MIN ||
+	   _parseLong("+42xyz", 6, &l) != 3 || l != 42 || _parseLong("4299", 2, &l) != 2 || l != 42 ||
+	   _parseLong("xyz", 3, &l) != 0 || l != 0 || _parseLong("-", 1, &l) != 0 || l != 0 ||
+	   _parseInt64("-9223372036854775808", 20, &ll) != 20 || ll != -int64max - 1 ||
+	   _parseInt64("9223372036854775807", 19, &ll) != 19 || ll != int64max ||
+	   _parseInt64("123456789012345678901234", 24, &ll) != 24 || ll != int64max)
+		printf("Bad _parseLong() or _parseInt64()\n");
+	for(i=-100000; i <= 100000; i += 7)
+	{
+		int len = _formatLong(i * 10007, buf);
+		if(atol(buf) != i * 10007 || _parseLong(buf, len, &l) != len || l != i * 10007)
+			break;
+	}
+	if(i <= 100000)
+		printf("Bad _formatLong() and back\n");
+
+	// what's read, and what's not
+	if(_parseDouble("  1.5e3x", 8, &val) != 7 || val != 1500 || _parseDouble("1.5e", 4, &val) != 3 ||
+	   val != 1.5 || _parseDouble(".5", 2, &val) != 2 || val != 0.5 || _parseDouble("5.", 2, &val) != 2 ||
+	   val != 5 || _parseDouble(".", 1, &val) != 0 || _parseDouble("-.e1", 4, &val) != 0 || val != 0 ||
+	   _parseDouble("1e400", 5, &val) != 5 || val != 1 / zero || _parseDouble("1e-400", 6, &val) != 6 ||
+	   val != 0 || _parseDouble("0.1234", 3, &val) != 3 || val != 0.1)
+		printf("Bad _parseDouble() of a part of the text\n");
+
+	// the hard ones, against strtod()
+	static const char* hard[] = {
+		"2.2250738585072011e-308", "2.2250738585072012e-308", "4.9e-324", "2.4703282292062327e-324",
+		"2.4703282292062328e-324", "1.7976931348623157e308", "1.7976931348623158e308",
+		"1.7976931348623159e308", "9007199254740993", "9007199254740992.99999999999999999999",
+		"9007199254740993.00000000000000000001", "1e23", "8.98846567431158e307", "0.1", "3.14159265358979323846",
+		"7.2057594037927933e16", "123456789012345678901234567890", "0.000000000000000000000000000001",
+		"1448997445238699", "6.631236846766476e-316", "3.4e38", "1e-5", "1e22", "1e-22"
+	};
+	for(i=0; i < sizeof(hard) / sizeof(hard[0]); i++)
+	{
+		int len = strlen(hard[i]);
+		if(_parseDouble(hard[i], len, &val) != len || bits_of(val) != bits_of(strtod(hard[i], NULL)))
+			printf("Bad _parseDouble() of %s\n", hard[i]);
+	}
+
+	// random bits to text and back, and against strtod()
+	unsigned __int64 x = ((unsigned __int64)0x9E3779B9 << 32) | 0x7F4A7C15;
+	int bad = 0, notShortest = 0;
+	for(i=0; i < 1000000; i++)
+	{
+		unsigned __int64 bits = next_random(x);
+		double d = double_of(bits);
+		if(d != d || d - d != 0) continue;
+		int len = _formatDouble(d, buf);
+		if(_parseDouble(buf, len, &val) != len || bits_of(val) != bits ||
+		   bits_of(strtod(buf, NULL)) != bits || len != (int)strlen(buf))
+		{
+			if(bad++ < 5) printf("Bad _formatDouble() and back: %s\n", buf);
+		}
+
+		// the fewest digits of printf() that read back as d
+		if(i % 20) continue;
+		char g[40];
+		int p;
+		for(p=1; p < 17; p++)
+		{
+			sprintf(g, "%.*g", p, d);
+			if(strtod(g, NULL) == d) break;
+		}
+		if(significant_digits(buf) > p && notShortest++ < 5)
+			printf("Bad _formatDouble(): %s, not %s\n", buf, g);
+	}
+	if(bad)
+		printf("Bad _formatDouble() and back: %d of 1000000\n", bad);
+	if(notShortest)
+		printf("Bad _formatDouble(): %d of 50000 not the shortest\n", notShortest);
+
+	// floats: the layout, and random bits to text and back
+	static const struct { float val; const char* text; } floats[] = {
+		{ 0.1f, "0.1" }, { 1.5f, "1.5" }, { -100.0f, "-100" }, { 16777216.0f, "16777216" },
+		{ 3.4028235e38f, "3.4028235e+38" }, { 1.1754944e-38f, "1.1754944e-38" }, { 1e-45f, "1e-45" },
+		{ 1.0f / 3, "0.33333334" }, { 0.0f, "0" }
+	};
+	for(i=0; i < sizeof(floats) / sizeof(floats[0]); i++)
+	{
+		int len = _formatFloat(floats[i].val, buf);
+		if(strcmp(buf, floats[i].text) || len != (int)strlen(buf))
+			printf("Bad _formatFloat(): %s, not %s\n", buf, floats[i].text);
+	}
+	if(_formatFloat((float)-zero, buf) != 2 || strcmp(buf, "-0") || _formatFloat((float)(1 / zero), buf) != 8 ||
+	   strcmp(buf, "Infinity") || _formatFloat((float)(zero / zero), buf) != 3 || strcmp(buf, "NaN"))
+		printf("Bad _formatFloat() of -0, Infinity or NaN\n");
+	bad = notShortest = 0;
+	for(i=0; i < 1000000; i++)
+	{
+		DWORD bits = (DWORD)next_random(x);
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		if(f != f || f - f != 0) continue;
+		int len = _formatFloat(f, buf);
+		if(_parseDouble(buf, len, &val) != len || (float)val != f || len != (int)strlen(buf))
+		{
+			if(bad++ < 5) printf("Bad _formatFloat() and back: %s\n", buf);
+		}
+		if(i % 20) continue;
+		char g[40];
+		int p;
+		for(p=1; p < 9; p++)
+		{
+			sprintf(g, "%.*g", p, (double)f);
+			if((float)strtod(g, NULL) == f) break;
+		}
+		if(significant_digits(buf) > p && notShortest++ < 5)
+			printf("Bad _formatFloat(): %s, not %s\n", buf, g);
+	}
+	if(bad)
+		printf("Bad _formatFloat() and back: %d of 1000000\n", bad);
+	if(notShortest)
+		printf("Bad _formatFloat(): %d of 50000 not the shortest\n", notShortest);
+
+	// random text, against strtod()
+	bad = 0;
+	char text[64];
+	for(i=0; i < 1000000; i++)
+	{
+		int len = random_number_text(x, text);
+		if(_parseDouble(text, len, &val) != len || bits_of(val) != bits_of(strtod(text, NULL)))
+		{
+			if(bad++ < 5) printf("Bad _parseDouble() of %s\n", text);
+		}
+	}
+	if(bad)
+		printf("Bad _parseDouble(): %d of 1000000\n", bad);
+
+	// the strings
+	_string_ s(0.1 + 0.2);
+	_string_ s2(1e21);
+	s2 += ", ";
+	s2 += -123456789L;
+	s2 += ", ";
+	s2 += 0.001;
+	if(s != "0.30000000000000004" || s2 != "1e+21, -123456789, 0.001" || _string_(" -12.5e1xyz").doubleVal() != -125 ||
+	   _string_("99999999999999999999").longVal() != LONG_MAX || _string_(" +77 ").longVal() != 77 ||
+	   _string_("").doubleVal() != 0 || _string_().longVal() != 0)
+		printf("Bad _string_ numbers\n");
+	if(!_string_(" -.5").isNumeric() || !_string_("0x").isNumeric() || !_string_("1e").isNumeric() ||
+	   _string_("-").isNumeric() || _string_(".e5").isNumeric() || _string_("+-1").isNumeric() ||
+	   _string_("Infinity").isNumeric() || _string_("").isNumeric() || _string_().isNumeric())
+		printf("Bad _string_::isNumeric()\n");
+	_cstring_ cs;
+	cs += 1.5;
+	cs += _T(" ");
+	cs += -42L;
+	if(cs != _T("1.5 -42") || _cstring_(_T("2.5e2")).doubleVal() != 250 || !_cstring_(_T("  .5")).isNumeric() ||
+	   _cstring_(_T("abc")).isNumeric())
+		printf("Bad _cstring_ numbers\n");
+	_string_builder_ sb;
+	sb.append(-1L).append(" ").append(2.5);
+	if(sb.toString() != "-1 2.5")
+		printf("Bad _string_builder_ numbers\n");
+}
+
+void num_conv_performance()
+{
+	// 1M doubles: half of them any bits, half prices with cents
+	int const count = 1000000;
+	double* vals = new double[count];
+	long* longs = new long[count];
+	char* texts = new char[count * NUM_CONV_CHARS];
+	unsigned __int64 x = ((unsigned __int64)0x9E3779B9 << 32) | 0x7F4A7C15;
+	int i;
+	for(i=0; i < count; i++)
+	{
+		double d;
+		do
+			d = double_of(next_random(x));
+		while(d != d || d - d != 0);
+		vals[i] = (i % 2) ? d : (double)(int)(next_random(x) % 10000000) / 100;
+		longs[i] = (long)next_random(x) >> (i % 31);
+	}
+
+	char buf[NUM_CONV_CHARS];
+	int total = 0;
+	unsigned long t = GetTickCount();
+	for(i=0; i < count; i++)
+		total += sprintf(buf, "%.17g", vals[i]);
+	t = GetTickCount()-t;
+	printf("1M sprintf(\"%%.17g\"): %u ms\n", t);
+	int ntotal = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		ntotal += _formatDouble(vals[i], texts + i * NUM_CONV_CHARS);
+	t = GetTickCount()-t;
+	printf("1M _formatDouble(): %u ms, %d chars rather than %d\n", t, ntotal, total);
+
+	double sum = 0, nsum = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		sum += strtod(texts + i * NUM_CONV_CHARS, NULL);
+	t = GetTickCount()-t;
+	printf("1M strtod(): %u ms\n", t);
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		double val;
+		const char* p = texts + i * NUM_CONV_CHARS;
+		_parseDouble(p, strlen(p), &val);
+		nsum += val;
+	}
+	t = GetTickCount()-t;
+	printf("1M _parseDouble(): %u ms\n", t);
+	if(sum != nsum)
+		printf("Bad _parseDouble() sum\n");
+
+	total = ntotal = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		total += strlen(_ltoa(longs[i], buf, 10));
+	t = GetTickCount()-t;
+	printf("1M _ltoa(): %u ms\n", t);
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		ntotal += _formatLong(longs[i], texts + i * NUM_CONV_CHARS);
+	t = GetTickCount()-t;
+	printf("1M _formatLong(): %u ms\n", t);
+	if(total != ntotal)
+		printf("Bad _formatLong() lengths\n");
+
+	unsigned long lsum = 0, nlsum = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		lsum += atol(texts + i * NUM_CONV_CHARS);
+	t = GetTickCount()-t;
+	printf("1M atol(): %u ms\n", t);
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		long val;
+		const char* p = texts + i * NUM_CONV_CHARS;
+		_parseLong(p, strlen(p), &val);
+		nlsum += val;
+	}
+	t = GetTickCount()-t;
+	printf("1M _parseLong(): %u ms\n", t);
+	if(lsum != nlsum)
+		printf("Bad _parseLong() sum\n");
+
+	// appending them to a string
+	_string_ s;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		s += vals[i];
+	t = GetTickCount()-t;
+	printf("1M _string_ += double: %u ms\n", t);
+
+	delete [] vals;
+	delete [] longs;
+	delete [] texts;
+}
+
+
+//------------------------------------
+// type-safe format()
+
+static double pow10_of(int n)
+{
+	double p = 1;
+	while(n-- > 0) p *= 10;
+	return p;
+}
+
+// the format() of _string_ that takes ..., which the calls with
+// arguments of the types of _format_arg_ don't get to
+typedef _string_& (_string_::*vformat_func)(LPCSTR format_spec, ...);
+
+void check_format()
+{
+	char buf[512], crt[512];
+	int i, len;
+
+	// the same as sprintf()
+	static const char* int_specs[] = {
+		"%d", "%5d", "%-5d|", "%05d", "%+d", "% d", "%.3d", "%8.3d", "%-8.3d|", "%+05d", "%i", "%u",
+		"%x", "%X", "%#x", "%#X", "%08x", "%#10x", "%o", "%#o", "%hd", "%hu", "%.0d", "%5.0d|", "%c|"
+	};
+	static const int ints[] = { 0, 1, -1, 42, -42, 255, 70000, -70000, 2147483647, -2147483647 - 1 };
+	for(i=0; i < sizeof(int_specs) / sizeof(int_specs[0]); i++)
+		for(int j=0; j < sizeof(ints) / sizeof(ints[0]); j++)
+		{
+			if(int_specs[i][1] == 'c' && (ints[j] <= 0 || ints[j] > 127)) continue;
+			sprintf(crt, int_specs[i], ints[j]);
+			len = _formatTo(buf, sizeof(buf), int_specs[i], ints[j]);
+			if(strcmp(buf, crt) || len != (int)strlen(crt))
+				printf("Bad format(\"%s\", %d): %s, not %s\n", int_specs[i], ints[j], buf, crt);
+		}
+	static const char* double_specs[] = {
+		"%f", "%.2f", "%10.3f", "%-10.1f|", "%+.1e", "%e", "%E", "%g", "%G", "%.3g", "%010.2f", "% f", "%+f",
+		"%#.0f", "%.0f", "%12.4e", "%-+12.2f|"
+	};
+	static const double doubles[] = { 0.0, 3.14159, -2.5, 1e300, 1e-5, 123456789.125, -0.000123 };
+	for(i=0; i < sizeof(double_specs) / sizeof(double_specs[0]); i++)
+		for(int j=0; j < sizeof(doubles) / sizeof(doubles[0]); j++)
+		{
+			sprintf(crt, double_specs[i], doubles[j]);
+			len = _formatTo(buf, sizeof(buf), double_specs[i], doubles[j]);
+			if(strcmp(buf, crt) || len != (int)strlen(crt))
+				printf("Bad format(\"%s\", %g): %s, not %s\n", double_specs[i], doubles[j], buf, crt);
+		}
+	// %f of random values, many of them with few decimals
+	unsigned __int64 x = ((unsigned __int64)0x9E3779B9 << 32) | 0x7F4A7C15;
+	for(i=0; i < 200000; i++)
+	{
+		DWORD r = (DWORD)next_random(x);
+		double d = (double)(int)(r >> 8) / pow10_of(r % 8);
+		if(r & 0x80) d = -d;
+		if((r & 0x70) == 0) d = double_of(next_random(x));
+		char spec[8];
+		sprintf(spec, "%%.%df", (int)((r >> 3) % 11));
+		sprintf(crt, spec, d);
+		len = _formatTo(buf, sizeof(buf), spec, d);
+		if(strcmp(buf, crt) || len != (int)strlen(crt))
+		{
+			printf("Bad format(\"%s\"): %s, not %s\n", spec, buf, crt);
+			break;
+		}
+	}
+	static const char* string_specs[] = { "%s", "%10s", "%-10s|", "%.3s", "%10.3s", "%-10.3s|", "%.0s|" };
+	for(i=0; i < sizeof(string_specs) / sizeof(string_specs[0]); i++)
+	{
+		sprintf(crt, string_specs[i], "formatted");
+		len = _formatTo(buf, sizeof(buf), string_specs[i], "formatted");
+		if(strcmp(buf, crt) || len != (int)strlen(crt))
+			printf("Bad format(\"%s\"): %s, not %s\n", string_specs[i], buf, crt);
+	}
+	sprintf(crt, "%s=%d, %5.1f%% of %c%s", "rows", 12, 99.44, 'x', "yz");
+	_formatTo(buf, sizeof(buf), "%s=%d, %5.1f%% of %c%s", "rows", 12, 99.44, 'x', "yz");
+	if(strcmp(buf, crt))
+		printf("Bad format() of many arguments: %s\n", buf);
+
+	// the sizes of the arguments
+	__int64 big = ((__int64)0x7FFFFFFF << 32) | 0xFFFFFFFF;
+	unsigned __int64 ubig = ((unsigned __int64)0xFFFFFFFF << 32) | 0xFFFFFFFF;
+	_formatTo(buf, sizeof(buf), "%d %I64d %u %llu %x %X %d", big, -big - 1, ubig, ubig, ubig, -1, (short)-5);
+	if(strcmp(buf, "9223372036854775807 -9223372036854775808 18446744073709551615 18446744073709551615 "
+				   "ffffffffffffffff FFFFFFFF -5"))
+		printf("Bad format() of 64-bit integers: %s\n", buf);
+	_formatTo(buf, sizeof(buf), "%hd %hhd %hu %hhx", 70000, 300, -1, -1);
+	if(strcmp(buf, "4464 44 65535 ff"))
+		printf("Bad format() of h and hh: %s\n", buf);
+	_formatTo(buf, sizeof(buf), "%*d|%-*d|%.*f|%*s|", 5, 1, 4, 2, 2, 3.14159, -4, "a");
+	if(strcmp(buf, "    1|2   |3.14|a   |"))
+		printf("Bad format() with *: %s\n", buf);
+	if(_formatTo(buf, sizeof(buf), "%p", (void*)buf) != 2 * sizeof(void*))
+		printf("Bad format() of a pointer: %s\n", buf);
+
+	// the arguments that don't match the spec
+	_formatTo(buf, sizeof(buf), "%d|%s|%s|%d|%f|%s|%c", 2.9, 42, 0.1, "abc", 3, 'q', "xy");
+	if(strcmp(buf, "2|42|0.1|abc|3.000000|q|xy"))
+		printf("Bad format() of arguments of other types: %s\n", buf);
+	_formatTo(buf, sizeof(buf), "[%d][%s][%5s] 100%% %n%q", 1);
+	if(strcmp(buf, "[1][][     ] 100% "))
+		printf("Bad format() of arguments that aren't there: %s\n", buf);
+	_formatTo(buf, sizeof(buf), "%s|%5S|%s|%s", (LPCSTR)NULL, L"wide", _string_("str"), _string_view_("viewed", 4));
+	if(strcmp(buf, "(null)| wide|str|view"))
+		printf("Bad format() of strings: %s\n", buf);
+
+	// the caller's buffer: as much as fits, and the whole length
+	if(_formatTo(buf, 5, "%d", 123456) != 6 || strcmp(buf, "1234") || _formatTo(NULL, 0, "%s-%d", "ab", 10) != 5 ||
+	   _formatTo(buf, 1, "abc") != 3 || buf[0] != '\0' || _formatTo(buf, 0, "%300d", 1) != 300)
+		printf("Bad _formatTo() into a short buffer\n");
+
+	// the strings
+	_string_ s;
+	s.format("%-6s|%5d|%.2f|%s", _string_("ab"), 42, 3.14159, "yes");
+	if(s != "ab    |   42|3.14|yes")
+		printf("Bad _string_::format(): %s\n", s.c_str());
+	s = "abc";
+	s.format("%s-%s", s, s.view());
+	if(s != "abc-abc")
+		printf("Bad format() of the string itself: %s\n", s.c_str());
+	_string_ text('x', 1000);
+	s = text;
+	s.format("<%s>%300d", s, 7);
+	if(s.length() != 1302 || s.left(1001) != "<" + text || s.right(2) != " 7")
+		printf("Bad format() of a long string\n");
+	_string_pool_ pool;
+	_string_ interned = pool.intern("Oslo");
+	s = interned;
+	s.format("%s, %s", s, "Norway");
+	if(s != "Oslo, Norway" || interned != "Oslo")
+		printf("Bad format() of an interned string\n");
+	_string_ v;
+	vformat_func vformat = &_string_::format;
+	(v.*vformat)("%s=%d", "x", 5);
+	if(v != "x=5")
+		printf("Bad format(...)\n");
+}
+
+void format_performance()
+{
+	int const count = 1000000;
+	_string_ name("column");
+	_string_ s;
+	vformat_func vformat = &_string_::format;
+	int i;
+	unsigned __int64 total = 0;
+
+	unsigned long t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		(s.*vformat)("row %d: %s = %.2f (%08x)", i, name.c_str(), i * 0.25, i);
+		total += s.length();
+	}
+	t = GetTickCount()-t;
+	printf("1M format(...): %u ms\n", t);
+	unsigned __int64 ntotal = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		s.format("row %d: %s = %.2f (%08x)", i, name, i * 0.25, i);
+		ntotal += s.length();
+	}
+	t = GetTickCount()-t;
+	printf("the same, type-safe: %u ms\n", t);
+	if(total != ntotal)
+		printf("Bad format() lengths\n");
+
+	// integers and strings only, without the CRT
+	total = ntotal = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		(s.*vformat)("%s[%d] = %u, %s", name.c_str(), i, i * 7u, "done");
+		total += s.length();
+	}
+	t = GetTickCount()-t;
+	printf("1M format(...) of integers: %u ms\n", t);
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+	{
+		s.format("%s[%d] = %u, %s", name, i, i * 7u, "done");
+		ntotal += s.length();
+	}
+	t = GetTickCount()-t;
+	printf("the same, type-safe: %u ms\n", t);
+	if(total != ntotal)
+		printf("Bad format() lengths\n");
+
+	// into a buffer on the stack
+	char buf[64];
+	total = ntotal = 0;
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		total += sprintf(buf, "%s[%d] = %u, %s", "column", i, i * 7u, "done");
+	t = GetTickCount()-t;
+	printf("1M sprintf(): %u ms\n", t);
+	t = GetTickCount();
+	for(i=0; i < count; i++)
+		ntotal += _formatTo(buf, sizeof(buf), "%s[%d] = %u, %s", "column", i, i * 7u, "done");
+	t = GetTickCount()-t;
+	printf("1M _formatTo(): %u ms\n", t);
+	if(total != ntotal)
+		printf("Bad _formatTo() lengths\n");
+}
@@ -11,12 +11,54 @@
 using namespace soige;
 
 void check_table();
+void check_table_sort();
+void table_sort_performance();
+void check_multi_column_sort();
+void multi_column_sort_performance();
+void check_table_index();
+void table_index_performance();
+void check_batched_update();
+void batched_update_performance();
+void check_bulk_load();
+void bulk_load_performance();
+void check_dict_encoding();
+void dict_encoding_performance();
+void check_copy_on_write();
+void copy_on_write_performance();
 
 int main(int argc, char* argv[])
 {
 	printf("Checking _table_\n");
 	check_table();
 	_CrtDumpMemoryLeaks();
+	check_table_sort();
+	_CrtDumpMemoryLeaks();
+	table_sort_performance();
+	_CrtDumpMemoryLeaks();
+	check_multi_column_sort();
+	_CrtDumpMemoryLeaks();
+	multi_column_sort_performance();
+	_CrtDumpMemoryLeaks();
+	check_table_index();
+	_CrtDumpMemoryLeaks();
+	table_index_performance();
+	_CrtDumpMemoryLeaks();
+	check_batched_update();
+	_CrtDumpMemoryLeaks();
+	batched_update_performance();
+	_CrtDumpMemoryLeaks();
+	check_bulk_load();
+	_CrtDumpMemoryLeaks();
+	bulk_load_performance();
+	_CrtDumpMemoryLeaks();
+	check_dict_encoding();
+	_CrtDumpMemoryLeaks();
+	dict_encoding_performance();
+	_CrtDumpMemoryLeaks();
+	check_copy_on_write();
+	_CrtDumpMemoryLeaks();
+	copy_on_write_performance();
+	_CrtDumpMemoryLeaks();
 	return 0;
 }
 
@@ -72,3 +114,1072 @@ void check_table()
 }
 
 
+//------------------------------------
+// table sort tests
+
+// a table with a row id in column 0, a sort key with plenty of
+// duplicates in column 1, and the other columns made from the id
+void fill_table(_table_<int>& tbl, int rows, int cols)
+{
+	_array_<_string_> header;
+	char name[16];
+	for(int col=0; col < cols; col++)
+	{
+		sprintf(name, "col%d", col);
+		header.append(_string_(name));
+	}
+	tbl.clear();
+	tbl.setHeader(header);
+	_array_<int> row;
+	row.resize(cols);
+	for(int r=0; r < rows; r++)
+	{
+		row[0] = r;
+		row[1] = rand() % 1000;
+		for(int col=2; col < cols; col++)
+			row[col] = r * col;
+		tbl.appendRow(row);
+	}
+}
+
+// rows intact, sorted on column 1, equal keys in id order
+bool table_sorted(const _table_<int>& tbl)
+{
+	for(int r=0; r < tbl.getRowCount(); r++)
+	{
+		int id = tbl.getValueAt(r, 0);
+		for(int col=2; col < tbl.getColumnCount(); col++)
+			if(tbl.getValueAt(r, col) != id * col)
+				return false;
+		if(r == 0)
+			continue;
+		int c = tbl.getValueAt(r - 1, 1) - tbl.getValueAt(r, 1);
+		if(c > 0 || (c == 0 && tbl.getValueAt(r - 1, 0) > id))
+			return false;
+	}
+	return true;
+}
+
+void check_table_sort()
+{
+	_table_<int> tbl;
+	fill_table(tbl, 20000, 6);
+	_table_<int> orig = tbl;
+
+	// the view orders the rows without moving them
+	if(!tbl.sortView(1) || !tbl.hasSortedView())
+		printf("Bad sortView\n");
+	if(tbl != orig)
+		printf("Bad sortView: the table changed\n");
+	int r;
+	for(r=1; r < tbl.getRowCount(); r++)
+	{
+		int c = tbl.getViewValueAt(r - 1, 1) - tbl.getViewValueAt(r, 1);
+		if(c > 0 || (c == 0 && tbl.getViewRow(r - 1) > tbl.getViewRow(r)))
+		{
+			printf("Bad sorted view order\n");
+			break;
+		}
+	}
+	// values outside the view's column don't affect it, others drop it
+	tbl.setValueAt(0, 2, 0);
+	if(!tbl.hasSortedView())
+		printf("Bad sorted view: dropped on an unrelated change\n");
+	tbl.setValueAt(0, 1, 5);
+	if(tbl.hasSortedView())
+		printf("Bad sorted view: kept after a change to its column\n");
+	tbl.setValueAt(0, 1, orig.getValueAt(0, 1));
+
+	// sorting moves the rows the way the view had them
+	_array_<int> perm;
+	tbl.getSortPermutation(1, perm);
+	tbl.sort(1);
+	if(!table_sorted(tbl))
+		printf("Bad table sort\n");
+	for(r=0; r < tbl.getRowCount(); r++)
+		if(tbl.getValueAt(r, 0) != perm[r])
+		{
+			printf("Bad table sort permutation\n");
+			break;
+		}
+	if(tbl.sort(6) || tbl.sort(-1))
+		printf("Bad table sort on a missing column\n");
+
+	// sorting on the row id restores the table
+	tbl.sort(0);
+	if(tbl != orig)
+		printf("Bad table sort back to the original order\n");
+
+	// string table
+	_table_<_string_> stbl;
+	_array_<_string_> header;
+	header.append(_string_("name"));
+	header.append(_string_("value"));
+	stbl.setHeader(header);
+	_array_<_string_> row;
+	row.append(_string_("pear")); row.append(_string_("1"));
+	stbl.appendRow(row);
+	row[0] = "apple"; row[1] = "2";
+	stbl.appendRow(row);
+	row[0] = "fig"; row[1] = "3";
+	stbl.appendRow(row);
+	stbl.sort(0);
+	if(stbl.getValueAt(0, 0).compare("apple") != 0 || stbl.getValueAt(0, 1).compare("2") != 0 ||
+	   stbl.getValueAt(2, 0).compare("pear") != 0 || stbl.getValueAt(2, 1).compare("1") != 0)
+		printf("Bad _string_ table sort\n");
+}
+
+void table_sort_performance()
+{
+	_table_<int> tbl;
+	fill_table(tbl, 1000000, 20);
+	unsigned long c = GetTickCount();
+	tbl.sortView(1);
+	c = GetTickCount()-c;
+	printf("sorted view, 1M rows x 20 columns: %u\n", c);
+	c = GetTickCount();
+	tbl.sort(1);
+	c = GetTickCount()-c;
+	printf("sort, 1M rows x 20 columns: %u\n", c);
+	if(!table_sorted(tbl))
+		printf("Bad large table sort\n");
+}
+
+
+//------------------------------------
+// multi-column sort tests
+
+// row id in column 0, small-range keys in the others, -1 for null
+void fill_key_table(_table_<int>& tbl, int rows)
+{
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("region"));
+	header.append(_string_("year"));
+	header.append(_string_("amount"));
+	tbl.clear();
+	tbl.setHeader(header);
+	_array_<int> row;
+	row.resize(4);
+	for(int r=0; r < rows; r++)
+	{
+		row[0] = r;
+		row[1] = rand() % 10;
+		row[2] = 2000 + rand() % 20;
+		row[3] = (rand() % 8 == 0) ? -1 : rand() % 100;
+		tbl.appendRow(row);
+	}
+}
+
+// rows in order for the keys, equal rows in their order before
+// the sort (prevPos[id]: row of id before), or else in id order
+bool rows_in_order(const _table_<int>& tbl, const sort_key* keys, int nkeys, bool nullsAreSet,
+				   const int* prevPos = NULL)
+{
+	for(int r=1; r < tbl.getRowCount(); r++)
+	{
+		int c = 0;
+		for(int k=0; k < nkeys && c == 0; k++)
+		{
+			int v1 = tbl.getValueAt(r - 1, keys[k].col);
+			int v2 = tbl.getValueAt(r, keys[k].col);
+			if(nullsAreSet && keys[k].nulls != sort_key::nulls_as_values && (v1 == -1 || v2 == -1))
+			{
+				if(v1 != v2)
+					c = ((v1 == -1) == (keys[k].nulls == sort_key::nulls_first)) ? -1 : 1;
+				continue;
+			}
+			c = (v1 > v2) - (v1 < v2);
+			if(keys[k].descending)
+				c = -c;
+		}
+		int id1 = tbl.getValueAt(r - 1, 0);
+		int id2 = tbl.getValueAt(r, 0);
+		if(prevPos)
+		{
+			id1 = prevPos[id1];
+			id2 = prevPos[id2];
+		}
+		if(c > 0 || (c == 0 && id1 > id2))
+			return false;
+	}
+	return true;
+}
+
+// sorts and checks the order, stability included
+bool sort_in_order(_table_<int>& tbl, const sort_key* keys, int nkeys, bool nullsAreSet)
+{
+	int* prevPos = new int[tbl.getRowCount()];
+	for(int r=0; r < tbl.getRowCount(); r++)
+		prevPos[tbl.getValueAt(r, 0)] = r;
+	bool ok = tbl.sort(keys, nkeys) && rows_in_order(tbl, keys, nkeys, nullsAreSet, prevPos);
+	delete [] prevPos;
+	return ok;
+}
+
+void check_multi_column_sort()
+{
+	_table_<int> tbl;
+	fill_key_table(tbl, 30000);
+
+	sort_key keys[3];
+	keys[0] = sort_key(1);
+	keys[1] = sort_key(2, true);
+	keys[2] = sort_key(3, false, sort_key::nulls_last);
+
+	// no null value yet: -1 is just the smallest amount
+	if(!sort_in_order(tbl, keys, 3, false))
+		printf("Bad multi-column sort\n");
+
+	tbl.setNullValue(-1);
+	if(!tbl.isNull(0, 3) && tbl.getValueAt(0, 3) == -1)
+		printf("Bad isNull\n");
+	if(!sort_in_order(tbl, keys, 3, true))
+		printf("Bad multi-column sort, nulls last\n");
+
+	keys[2] = sort_key(3, true, sort_key::nulls_first);
+	tbl.sortView(keys, 3);
+	_array_<int> perm;
+	tbl.getSortPermutation(keys, 3, perm);
+	for(int r=0; r < perm.length(); r++)
+		if(tbl.getViewRow(r) != perm[r])
+		{
+			printf("Bad multi-column sorted view\n");
+			break;
+		}
+	tbl.setValueAt(0, 2, 1999);
+	if(tbl.hasSortedView())
+		printf("Bad multi-column sorted view: kept after a change to a key\n");
+	if(!sort_in_order(tbl, keys, 3, true))
+		printf("Bad multi-column sort, descending nulls first\n");
+
+	// a single descending key, then back by id
+	keys[0] = sort_key(2, true);
+	if(!sort_in_order(tbl, keys, 1, true))
+		printf("Bad descending sort\n");
+	tbl.sort(0);
+	for(int r=0; r < tbl.getRowCount(); r++)
+		if(tbl.getValueAt(r, 0) != r)
+		{
+			printf("Bad sort back by id\n");
+			break;
+		}
+
+	keys[0] = sort_key(4);
+	if(tbl.sort(keys, 1) || tbl.sort(keys, 0))
+		printf("Bad multi-column sort on missing columns\n");
+}
+
+void multi_column_sort_performance()
+{
+	int const rows = 2000000;
+	_table_<int> tbl;
+	fill_key_table(tbl, rows);
+	_table_<int> copy = tbl;
+	tbl.setNullValue(-1);
+
+	sort_key keys[3];
+	keys[0] = sort_key(1);
+	keys[1] = sort_key(2, true);
+	keys[2] = sort_key(3, false, sort_key::nulls_last);
+	unsigned long c = GetTickCount();
+	tbl.sort(keys, 3);
+	c = GetTickCount()-c;
+	printf("3-key sort, 2M rows: %u\n", c);
+	if(!rows_in_order(tbl, keys, 3, true))
+		printf("Bad 3-key sort\n");
+
+	// one stable sort per key, minor key first
+	keys[2] = sort_key(3);
+	c = GetTickCount();
+	copy.sort(3);
+	copy.sort(2);
+	copy.sort(1);
+	c = GetTickCount()-c;
+	printf("3 single-key sorts, 2M rows: %u\n", c);
+}
+
+
+//------------------------------------
+// index tests
+
+// the index agrees with a scan of the column for every value
+bool index_consistent(const _table_<int>& tbl, int col, int maxValue)
+{
+	for(int val=0; val <= maxValue; val++)
+	{
+		int first, last;
+		if(!tbl.equalRange(col, val, &first, &last))
+			return false;
+		int pos = first;
+		for(int r=0; r < tbl.getRowCount(); r++)
+		{
+			if(tbl.getValueAt(r, col) != val)
+				continue;
+			if(pos >= last || tbl.getIndexRow(col, pos) != r)
+				return false;
+			if(pos == first && tbl.findInColumn(col, val) != r)
+				return false;
+			pos++;
+		}
+		if(pos != last || (first == last && tbl.findInColumn(col, val) != -1))
+			return false;
+	}
+	return true;
+}
+
+void check_table_index()
+{
+	_table_<int> tbl;
+	fill_key_table(tbl, 2000);
+	if(tbl.hasIndex(1) || tbl.createIndex(4))
+		printf("Bad createIndex on a missing column\n");
+	int first, last;
+	if(tbl.equalRange(1, 5, &first, &last))
+		printf("Bad equalRange on a column with no index\n");
+	int unindexed = tbl.findInColumn(1, 5);
+	tbl.createIndex(1);
+	tbl.createIndex(2);
+	if(!tbl.hasIndex(1) || tbl.findInColumn(1, 5) != unindexed)
+		printf("Bad createIndex\n");
+	if(!index_consistent(tbl, 1, 10) || !index_consistent(tbl, 2, 2020))
+		printf("Bad index\n");
+
+	// the indexes follow the changes to the table
+	_array_<int> row;
+	row.resize(4);
+	for(int i=0; i < 3000; i++)
+	{
+		int r = rand() % tbl.getRowCount();
+		switch(rand() % 4)
+		{
+		case 0:
+			tbl.setValueAt(r, 1 + rand() % 2, (rand() % 2) ? rand() % 10 : 2000 + rand() % 20);
+			break;
+		case 1:
+			row[0] = tbl.getRowCount(); row[1] = rand() % 10; row[2] = 2000 + rand() % 20;
+			tbl.insertRow(row, r);
+			break;
+		case 2:
+			tbl.removeRow(r);
+			break;
+		case 3:
+			tbl.swapRows(r, rand() % tbl.getRowCount());
+			break;
+		}
+	}
+	if(!index_consistent(tbl, 1, 10) || !index_consistent(tbl, 2, 2020))
+		printf("Bad index after updates\n");
+
+	// rows appended in blocks, encoded or not, and a column
+	// replaced by a longer one
+	_array_<int> block;
+	block.resize(4 * 100);
+	int b, k;
+	for(b=0; b < 6; b++)
+	{
+		if(b == 3)
+			tbl.encodeColumn(1);
+		for(k=0; k < 100; k++)
+		{
+			block[k * 4] = tbl.getRowCount() + k;
+			block[k * 4 + 1] = rand() % 10;
+			block[k * 4 + 2] = 2000 + rand() % 20;
+			block[k * 4 + 3] = 0;
+		}
+		tbl.appendRows(&block[0], 100);
+	}
+	if(!index_consistent(tbl, 1, 10) || !index_consistent(tbl, 2, 2020))
+		printf("Bad index after appendRows\n");
+	_array_<int> values;
+	values.resize(tbl.getRowCount() + 50);
+	for(k=0; k < values.length(); k++)
+		values[k] = (k % 3) ? 2000 + rand() % 20 : rand() % 10;
+	tbl.setColumnData(2, &values[0], values.length());
+	tbl.decodeColumn(1);
+	if(!index_consistent(tbl, 1, 10) || !index_consistent(tbl, 2, 2020))
+		printf("Bad index after setColumnData\n");
+
+	sort_key keys[2];
+	keys[0] = sort_key(2, true);
+	keys[1] = sort_key(3);
+	tbl.sort(keys, 2);
+	tbl.insertColumn(_string_("new"), 0);
+	if(tbl.hasIndex(1) || !tbl.hasIndex(2) || !tbl.hasIndex(3))
+		printf("Bad index after insertColumn\n");
+	_table_<int> copy = tbl;
+	if(!index_consistent(copy, 2, 10) || !index_consistent(copy, 3, 2020))
+		printf("Bad index after sort and copy\n");
+	// a table with the same values still takes the indexes and
+	// the null value of the one assigned to it
+	_table_<int> same = copy;
+	same.dropIndex(2);
+	same.dropIndex(3);
+	copy.setNullValue(copy.getValueAt(0, 2));
+	same = copy;
+	if(!same.hasIndex(2) || !same.hasIndex(3) || !same.isNull(0, 2))
+		printf("Bad assignment of an equal table\n");
+	tbl.dropIndex(2);
+	if(tbl.hasIndex(2) || tbl.findInColumn(2, 5) != copy.findInColumn(2, 5))
+		printf("Bad dropIndex\n");
+	tbl.removeAllRows();
+	if(tbl.findInColumn(3, 2005) != -1 || !index_consistent(tbl, 3, 2020))
+		printf("Bad index after removeAllRows\n");
+}
+
+void table_index_performance()
+{
+	_table_<int> tbl;
+	fill_table(tbl, 200000, 4);
+	int const lookups = 2000;
+	int i, found = 0;
+	unsigned long c = GetTickCount();
+	for(i=0; i < lookups; i++)
+		found += (tbl.findInColumn(2, (rand() % 400000) * 2) >= 0);
+	c = GetTickCount()-c;
+	printf("2000 lookups, 200K rows, no index: %u\n", c);
+
+	c = GetTickCount();
+	tbl.createIndex(2);
+	c = GetTickCount()-c;
+	printf("index on 200K rows: %u\n", c);
+	c = GetTickCount();
+	for(i=0; i < lookups * 1000; i++)
+		found += (tbl.findInColumn(2, (rand() % 400000) * 2) >= 0);
+	c = GetTickCount()-c;
+	printf("2M lookups, 200K rows, indexed: %u\n", c);
+
+	// loading in blocks, as the CSV reader does, with an index
+	_table_<int> loaded;
+	_array_<_string_> header;
+	for(i=0; i < 4; i++)
+		header.append(_string_("col"));
+	loaded.setHeader(header);
+	loaded.createIndex(2);
+	_array_<int> block;
+	block.resize(4 * 1000);
+	c = GetTickCount();
+	for(int b=0; b < 200; b++)
+	{
+		for(i=0; i < block.length(); i++)
+			block[i] = rand();
+		loaded.appendRows(&block[0], 1000);
+	}
+	c = GetTickCount()-c;
+	printf("200 blocks of 1000 rows appended, indexed: %u\n", c);
+}
+
+
+//------------------------------------
+// batched notification tests
+
+class counting_listener : public table_listener<int>
+{
+public:
+	int changed, cellUpdated, updated;
+	table_change last;
+	counting_listener() : changed(0), cellUpdated(0), updated(0) { }
+protected:
+	void onTableChanged(_table_<int>*) { changed++; }
+	void onTableCellUpdated(_table_<int>*, int, int) { cellUpdated++; }
+	void onTableUpdated(_table_<int>*, const table_change& change) { updated++; last = change; }
+};
+
+// a listener that only knows the per-change calls
+class plain_listener : public table_listener<int>
+{
+public:
+	int changed;
+	plain_listener() : changed(0) { }
+protected:
+	void onTableChanged(_table_<int>*) { changed++; }
+	void onTableCellUpdated(_table_<int>*, int, int) { }
+};
+
+void check_batched_update()
+{
+	_table_<int> tbl;
+	fill_key_table(tbl, 100);
+	counting_listener l;
+	plain_listener pl;
+	tbl.addTableListener(&l);
+	tbl.addTableListener(&pl);
+
+	// unbatched: one call per change
+	tbl.setValueAt(3, 1, 7);
+	tbl.removeRow(99);
+	if(l.cellUpdated != 1 || l.changed != 1 || l.updated != 0)
+		printf("Bad unbatched notification\n");
+
+	// cell updates: the rows and columns they span
+	tbl.beginUpdate();
+	tbl.setValueAt(10, 2, 2001);
+	tbl.beginUpdate();
+	tbl.setValueAt(20, 1, 3);
+	tbl.endUpdate();
+	if(l.updated != 0 || !tbl.isUpdating())
+		printf("Bad nested endUpdate\n");
+	tbl.setValueAt(15, 3, 50);
+	tbl.endUpdate();
+	if(l.updated != 1 || l.cellUpdated != 1 || pl.changed != 2 || tbl.isUpdating() ||
+	   l.last.structure || l.last.cellUpdates != 3 || l.last.rowsInserted || l.last.rowsRemoved ||
+	   l.last.firstRow != 10 || l.last.lastRow != 20 || l.last.firstCol != 1 || l.last.lastCol != 3)
+		printf("Bad batched cell updates\n");
+
+	// rows: everything from the first row inserted or removed on
+	_array_<int> row;
+	row.resize(4);
+	tbl.beginUpdate();
+	tbl.setValueAt(5, 1, 1);
+	tbl.insertRow(row, 50);
+	tbl.appendRow(row);
+	tbl.removeRow(40);
+	tbl.endUpdate();
+	if(l.updated != 2 || l.last.structure || l.last.rowsInserted != 2 || l.last.rowsRemoved != 1 ||
+	   l.last.firstRow != 5 || l.last.lastRow != 99 || l.last.firstCol != 0 || l.last.lastCol != 3)
+		printf("Bad batched row changes\n");
+
+	// cells updated in rows that are then removed
+	tbl.beginUpdate();
+	tbl.setValueAt(95, 1, 1);
+	tbl.setValueAt(97, 2, 2001);
+	for(int r=tbl.getRowCount() - 1; r >= 90; r--)
+		tbl.removeRow(r);
+	tbl.endUpdate();
+	if(l.updated != 3 || !l.last.structure || l.last.firstRow > l.last.lastRow ||
+	   l.last.lastRow >= tbl.getRowCount() || l.last.rowsRemoved != 10)
+		printf("Bad batched update of removed rows\n");
+
+	// anything else is a change of structure; an empty batch says nothing
+	tbl.beginUpdate();
+	tbl.sortView(1);
+	tbl.setValueAt(0, 1, 1);
+	if(tbl.hasSortedView())
+		printf("Bad batched update: the sorted view was kept\n");
+	tbl.sort(2);
+	tbl.endUpdate();
+	tbl.beginUpdate();
+	tbl.endUpdate();
+	tbl.endUpdate();
+	if(l.updated != 4 || !l.last.structure || l.changed != 1 || pl.changed != 5)
+		printf("Bad batched structure change\n");
+
+	tbl.removeTableListener(&l);
+	tbl.removeTableListener(&pl);
+}
+
+void batched_update_performance()
+{
+	_table_<int> tbl;
+	fill_key_table(tbl, 0);
+	counting_listener l;
+	tbl.addTableListener(&l);
+	_array_<int> row;
+	row.resize(4);
+	int const rows = 1000000;
+	int i;
+	unsigned long c = GetTickCount();
+	for(i=0; i < rows; i++)
+	{
+		row[0] = i;
+		tbl.appendRow(row);
+	}
+	c = GetTickCount()-c;
+	printf("append 1M rows, unbatched (%d calls): %u\n", l.changed, c);
+
+	tbl.removeAllRows();
+	l.changed = 0;
+	c = GetTickCount();
+	tbl.beginUpdate();
+	for(i=0; i < rows; i++)
+	{
+		row[0] = i;
+		tbl.appendRow(row);
+	}
+	tbl.endUpdate();
+	c = GetTickCount()-c;
+	printf("append 1M rows, batched (%d calls): %u\n", l.changed + l.updated, c);
+	if(l.last.rowsInserted != rows || l.last.firstRow != 0 || l.last.lastRow != rows - 1)
+		printf("Bad batched append\n");
+	tbl.removeTableListener(&l);
+}
+
+
+//------------------------------------
+// bulk loading tests
+
+void check_bulk_load()
+{
+	_table_<int> tbl, bulk;
+	fill_key_table(tbl, 5000);
+	fill_key_table(bulk, 0);
+	int const rows = tbl.getRowCount(), cols = tbl.getColumnCount();
+	int r, col;
+
+	// row after row
+	int* data = new int[rows * cols];
+	for(r=0; r < rows; r++)
+		for(col=0; col < cols; col++)
+			data[r * cols + col] = tbl.getValueAt(r, col);
+	bulk.createIndex(1);
+	bulk.reserveRows(rows);
+	bulk.appendRows(data, 1000);
+	bulk.appendRows(&data[1000 * cols], rows - 1000);
+	if(bulk != tbl || !index_consistent(bulk, 1, 10))
+		printf("Bad appendRows\n");
+
+	// column after column
+	int* column = new int[rows];
+	bulk.clear();
+	fill_key_table(bulk, 0);
+	bulk.createIndex(2);
+	for(col=cols - 1; col >= 0; col--)
+	{
+		for(r=0; r < rows; r++)
+			column[r] = tbl.getValueAt(r, col);
+		if(!bulk.setColumnData(col, column, (col == 2) ? 100 : rows))
+			printf("Bad setColumnData\n");
+	}
+	for(r=0; r < rows; r++)
+		column[r] = tbl.getValueAt(r, 2);
+	bulk.setColumnData(2, column, rows);
+	if(bulk != tbl || !index_consistent(bulk, 2, 2020))
+		printf("Bad setColumnData\n");
+	if(bulk.setColumnData(cols, column, rows))
+		printf("Bad setColumnData on a missing column\n");
+
+	// a range of rows, and what the listeners hear of it
+	counting_listener l;
+	bulk.addTableListener(&l);
+	bulk.beginUpdate();
+	if(!bulk.removeRows(100, 1000) || bulk.removeRows(rows, 1) || bulk.removeRows(0, 0))
+		printf("Bad removeRows\n");
+	bulk.removeRows(bulk.getRowCount() - 10, 50);
+	bulk.endUpdate();
+	if(l.last.rowsRemoved != 1010 || l.last.firstRow != 100 || l.last.lastRow != rows - 1011)
+		printf("Bad removeRows notification\n");
+	bulk.removeTableListener(&l);
+	tbl.removeRows(rows - 10, 10);
+	for(r=0; r < 1000; r++)
+		tbl.removeRow(100);
+	if(bulk != tbl || !index_consistent(bulk, 2, 2020))
+		printf("Bad removeRows\n");
+
+	delete [] column;
+	delete [] data;
+}
+
+void bulk_load_performance()
+{
+	int const rows = 2000000, cols = 4;
+	int* data = new int[rows * cols];
+	int r;
+	for(r=0; r < rows * cols; r++)
+		data[r] = r;
+	_table_<int> tbl;
+	fill_key_table(tbl, 0);
+	_array_<int> row;
+	row.resize(cols);
+
+	unsigned long c = GetTickCount();
+	for(r=0; r < rows; r++)
+	{
+		row[0] = data[r * cols]; row[1] = data[r * cols + 1];
+		row[2] = data[r * cols + 2]; row[3] = data[r * cols + 3];
+		tbl.appendRow(row);
+	}
+	c = GetTickCount()-c;
+	printf("appendRow, 2M rows: %u\n", c);
+
+	_table_<int> bulk;
+	fill_key_table(bulk, 0);
+	c = GetTickCount();
+	bulk.appendRows(data, rows);
+	c = GetTickCount()-c;
+	printf("appendRows, 2M rows: %u\n", c);
+	if(bulk != tbl)
+		printf("Bad appendRows\n");
+
+	int* column = new int[rows];
+	bulk.clear();
+	fill_key_table(bulk, 0);
+	c = GetTickCount();
+	for(int col=0; col < cols; col++)
+	{
+		for(r=0; r < rows; r++)
+			column[r] = data[r * cols + col];
+		bulk.setColumnData(col, column, rows);
+	}
+	c = GetTickCount()-c;
+	printf("setColumnData, 2M rows: %u\n", c);
+	if(bulk != tbl)
+		printf("Bad setColumnData\n");
+
+	c = GetTickCount();
+	bulk.removeRows(1000, rows / 2);
+	c = GetTickCount()-c;
+	printf("removeRows, 1M of 2M rows: %u\n", c);
+	delete [] column;
+	delete [] data;
+}
+
+
+//------------------------------------
+// dictionary encoding tests
+
+static const char* statuses[] = { "new", "open", "closed", "", "held" };
+
+// a string table with a unique id, a status with a few values
+// and a code with up to codes values
+void fill_string_table(_table_<_string_>& tbl, int rows, int codes)
+{
+	tbl.clear();
+	_array_<_string_> header;
+	header.append(_string_("id"));
+	header.append(_string_("status"));
+	header.append(_string_("code"));
+	tbl.setHeader(header);
+	_array_<_string_> row;
+	row.resize(3);
+	char buf[16];
+	for(int r=0; r < rows; r++)
+	{
+		sprintf(buf, "%d", r);
+		row[0] = buf;
+		row[1] = statuses[rand() % 5];
+		sprintf(buf, "c%d", rand() % codes);
+		row[2] = buf;
+		tbl.appendRow(row);
+	}
+}
+
+void check_dict_encoding()
+{
+	_table_<_string_> tbl;
+	fill_string_table(tbl, 3000, 300);
+	_table_<_string_> plain = tbl;
+	if(!tbl.encodeColumn(1) || !tbl.encodeColumn(2) || tbl.encodeColumn(3) ||
+	   !tbl.isEncoded(1) || tbl.isEncoded(0) || tbl.getDictColumn(0) != NULL)
+		printf("Bad encodeColumn\n");
+	const _table_dict_column_<_string_>* status = tbl.getDictColumn(1);
+	const _table_dict_column_<_string_>* code = tbl.getDictColumn(2);
+	if(status->dictSize() != 5 || status->getCodeWidth() != 1 ||
+	   code->dictSize() != 300 || code->getCodeWidth() != 2 ||
+	   tbl.getColumnData(1) != NULL || tbl.getColumnData(0) == NULL)
+		printf("Bad dictionary\n");
+	if(tbl != plain || plain != tbl ||
+	   tbl.getValueAt(17, 1).compare(plain.getValueAt(17, 1)) != 0)
+		printf("Bad encoded values\n");
+
+	// changes on both tables give the same tables
+	_array_<_string_> row;
+	row.append(_string_("new row"));
+	row.append(_string_("reopened"));
+	tbl.insertRow(row, 10);
+	plain.insertRow(row, 10);
+	tbl.appendRow(row);
+	plain.appendRow(row);
+	tbl.setValueAt(20, 1, _string_("held"));
+	plain.setValueAt(20, 1, _string_("held"));
+	tbl.setValueAt(21, 2, _string_("c1000"));
+	plain.setValueAt(21, 2, _string_("c1000"));
+	tbl.swapRows(0, 2000);
+	plain.swapRows(0, 2000);
+	tbl.removeRows(100, 50);
+	plain.removeRows(100, 50);
+	if(tbl != plain || status->dictSize() != 6 || tbl.getValueAt(10, 2).length() != 0)
+		printf("Bad encoded row changes\n");
+
+	// finding on codes
+	int r, c;
+	if(tbl.findInColumn(1, _string_("reopened")) != 10 || tbl.findInColumn(1, _string_("lost")) != -1 ||
+	   tbl.findInColumn(2, _string_("c1000")) != 21 ||
+	   tbl.findInColumn(1, _string_("held")) != plain.findInColumn(1, _string_("held")))
+		printf("Bad encoded findInColumn\n");
+	if(!tbl.find(_string_("c1000"), &r, &c) || r != 21 || c != 2 ||
+	   !tbl.find(_string_("reopened"), &r, &c, 11) || r != tbl.getRowCount() - 1 || c != 1 ||
+	   tbl.find(_string_("lost"), &r, &c))
+		printf("Bad encoded find\n");
+
+	// sorting on ranks: the same order as on the values
+	sort_key keys[3];
+	keys[0] = sort_key(1, false, sort_key::nulls_last);
+	keys[1] = sort_key(2, true);
+	keys[2] = sort_key(0);
+	tbl.setNullValue(_string_());
+	plain.setNullValue(_string_());
+	tbl.sort(keys, 3);
+	plain.sort(keys, 3);
+	if(tbl != plain || tbl.getValueAt(tbl.getRowCount() - 1, 1).length() != 0)
+		printf("Bad encoded sort\n");
+	keys[0] = sort_key(2, true);
+	keys[1] = sort_key(1, false, sort_key::nulls_first);
+	tbl.sort(keys, 3);
+	plain.sort(keys, 3);
+	if(tbl != plain)
+		printf("Bad encoded sort\n");
+
+	// indexes on encoded columns
+	tbl.createIndex(1);
+	tbl.setValueAt(5, 1, _string_("lost"));
+	tbl.removeRow(7);
+	plain.setValueAt(5, 1, _string_("lost"));
+	plain.removeRow(7);
+	int first, last, pfirst, plast;
+	plain.createIndex(1);
+	for(r=0; r < 5; r++)
+	{
+		tbl.equalRange(1, _string_(statuses[r]), &first, &last);
+		plain.equalRange(1, _string_(statuses[r]), &pfirst, &plast);
+		if(first != pfirst || last != plast ||
+		   (first < last && tbl.getIndexRow(1, first) != plain.getIndexRow(1, pfirst)))
+			printf("Bad encoded index\n");
+	}
+
+	// bulk loading, copies, and back to plain values
+	_string_* values = new _string_[tbl.getRowCount() + 10];
+	for(r=0; r < tbl.getRowCount(); r++)
+		values[r] = tbl.getValueAt(tbl.getRowCount() - 1 - r, 1);
+	values[r] = values[r + 1] = _string_("new");
+	tbl.setColumnData(1, values, tbl.getRowCount() + 2);
+	plain.setColumnData(1, values, plain.getRowCount() + 2);
+	tbl.appendRows(values, 3);
+	plain.appendRows(values, 3);
+	_table_<_string_> copy = tbl;
+	if(tbl != plain || copy != plain || !copy.isEncoded(2))
+		printf("Bad encoded bulk load\n");
+	tbl.decodeColumn(1);
+	tbl.decodeColumn(2);
+	if(tbl != plain || tbl.isEncoded(1) || tbl.getColumnData(2) == NULL)
+		printf("Bad decodeColumn\n");
+	delete [] values;
+
+	// codes get wider with more distinct values
+	fill_string_table(tbl, 70000, 300);
+	tbl.encodeColumn(0);
+	if(tbl.getDictColumn(0)->getCodeWidth() != 4 || tbl.getDictColumn(1) != NULL || tbl.findInColumn(0, _string_("69999")) != 69999)
+		printf("Bad wide codes\n");
+	tbl.encodeColumn(1);
+	tbl.setValueAt(0, 1, _string_("a"));
+	for(r=0; r < 300; r++)
+	{
+		char buf[16];
+		sprintf(buf, "s%d", r);
+		tbl.setValueAt(r + 1, 1, _string_(buf));
+	}
+	if(tbl.getDictColumn(1)->getCodeWidth() != 2 || tbl.getValueAt(0, 1).compare("a") != 0 ||
+	   tbl.getValueAt(300, 1).compare("s299") != 0 || tbl.findInColumn(1, _string_("s150")) != 151)
+		printf("Bad widening\n");
+}
+
+void dict_encoding_performance()
+{
+	int const rows = 1000000;
+	_table_<_string_> plain;
+	fill_string_table(plain, rows, 200);
+	_table_<_string_> tbl = plain;
+	tbl.encodeColumn(1);
+	tbl.encodeColumn(2);
+	printf("status column: %d bytes of _string_, %d bytes of codes\n",
+		   (int)(rows * sizeof(_string_)), rows * tbl.getDictColumn(1)->getCodeWidth());
+
+	// a value in the last row only: each scan goes through the column
+	plain.setValueAt(rows - 1, 1, _string_("lost"));
+	tbl.setValueAt(rows - 1, 1, _string_("lost"));
+	int r, found = 0;
+	unsigned long c = GetTickCount();
+	for(r=0; r < 20; r++)
+		found += (plain.findInColumn(1, _string_("lost")) >= 0);
+	c = GetTickCount()-c;
+	printf("20 string column scans, 1M rows: %u\n", c);
+	c = GetTickCount();
+	for(r=0; r < 20; r++)
+		found += (tbl.findInColumn(1, _string_("lost")) >= 0);
+	c = GetTickCount()-c;
+	printf("20 encoded column scans, 1M rows: %u\n", c);
+	if(found != 40)
+		printf("Bad encoded scans\n");
+
+	sort_key keys[2];
+	keys[0] = sort_key(1);
+	keys[1] = sort_key(2);
+	c = GetTickCount();
+	plain.sort(keys, 2);
+	c = GetTickCount()-c;
+	printf("sort on 2 string columns, 1M rows: %u\n", c);
+	c = GetTickCount();
+	tbl.sort(keys, 2);
+	c = GetTickCount()-c;
+	printf("sort on 2 encoded columns, 1M rows: %u\n", c);
+	if(tbl != plain)
+		printf("Bad encoded sort\n");
+}
+
+
+//------------------------------------
+// copy on write tests
+
+// a copy that shares nothing, made cell by cell
+void deep_copy(const _table_<int>& tbl, _table_<int>& copy)
+{
+	copy.clear();
+	copy.setColumnCount(tbl.getColumnCount());
+	_array_<int> row;
+	row.resize(tbl.getColumnCount());
+	for(int r=0; r < tbl.getRowCount(); r++)
+	{
+		for(int c=0; c < tbl.getColumnCount(); c++)
+			row[c] = tbl.getValueAt(r, c);
+		copy.appendRow(row);
+	}
+}
+
+bool same_cells(const _table_<int>& tbl1, const _table_<int>& tbl2)
+{
+	if(tbl1.getRowCount() != tbl2.getRowCount() || tbl1.getColumnCount() != tbl2.getColumnCount())
+		return false;
+	for(int r=0; r < tbl1.getRowCount(); r++)
+		for(int c=0; c < tbl1.getColumnCount(); c++)
+			if(tbl1.getValueAt(r, c) != tbl2.getValueAt(r, c))
+				return false;
+	return true;
+}
+
+void check_copy_on_write()
+{
+	_table_<int> tbl;
+	fill_key_table(tbl, 2000);
+	tbl.createIndex(1);
+	tbl.encodeColumn(2);
+	_table_<int> before;
+	deep_copy(tbl, before);
+
+	// a copy shares the columns until it writes one
+	_table_<int> copy = tbl;
+	if(copy.getColumnData(0) != tbl.getColumnData(0) || copy.getColumnData(3) != tbl.getColumnData(3) ||
+	   copy.getDictColumn(2) != tbl.getDictColumn(2) || copy != tbl)
+		printf("Bad copy: columns not shared\n");
+	copy.setValueAt(5, 3, -7);
+	if(copy.getColumnData(3) == tbl.getColumnData(3) || copy.getColumnData(0) != tbl.getColumnData(0) ||
+	   tbl.getValueAt(5, 3) != before.getValueAt(5, 3) || copy.getValueAt(5, 3) != -7)
+		printf("Bad write to a copy\n");
+	copy.setValueAt(5, 2, 1999);
+	if(copy.getDictColumn(2) == tbl.getDictColumn(2) || tbl.getValueAt(5, 2) == 1999 ||
+	   tbl.findInColumn(2, 1999) != -1 || copy.findInColumn(2, 1999) != 5)
+		printf("Bad write to an encoded column of a copy\n");
+	copy.setValueAt(7, 1, 42);
+	if(tbl.findInColumn(1, 42) != -1 || copy.findInColumn(1, 42) != 7 ||
+	   !index_consistent(tbl, 1, 50) || !index_consistent(copy, 1, 50))
+		printf("Bad index of a copy\n");
+
+	// reserving rows in a copy, or removing them all, clones nothing
+	_table_<int> cleared = tbl;
+	cleared.reserveRows(5000);
+	if(cleared.getColumnData(0) != tbl.getColumnData(0) || cleared.getDictColumn(2) != tbl.getDictColumn(2))
+		printf("Bad reserveRows of a copy\n");
+	cleared.removeAllRows();
+	if(cleared.getRowCount() != 0 || !cleared.isEncoded(2) || cleared.getDictColumn(2) == tbl.getDictColumn(2) ||
+	   cleared.getDictColumn(2)->dictSize() != 0 || !same_cells(tbl, before))
+		printf("Bad removeAllRows of a copy\n");
+	_array_<int> newRow;
+	newRow.resize(4);
+	newRow[0] = newRow[1] = newRow[3] = 0;
+	newRow[2] = 2005;
+	cleared.appendRow(newRow);
+	if(cleared.getValueAt(0, 2) != 2005 || cleared.findInColumn(1, 0) != 0 || !same_cells(tbl, before))
+		printf("Bad row appended to a cleared copy\n");
+
+	// every kind of change, to copies of copies; the table stays put
+	_table_<int> copies[3];
+	_array_<int> row;
+	row.resize(4);
+	for(int i=0; i < 3000; i++)
+	{
+		_table_<int>& t = copies[rand() % 3];
+		if(rand() % 50 == 0)
+			t = (rand() % 2) ? tbl : copies[rand() % 3];
+		if(t.getRowCount() == 0)
+			t = tbl;
+		int r = rand() % t.getRowCount();
+		switch(rand() % 8)
+		{
+		case 0:
+			t.setValueAt(r, rand() % 4, rand() % 10);
+			break;
+		case 1:
+			row[0] = t.getRowCount(); row[1] = rand() % 10; row[2] = 2000 + rand() % 20;
+			t.insertRow(row, r);
+			break;
+		case 2:
+			t.removeRow(r);
+			break;
+		case 3:
+			t.swapRows(r, rand() % t.getRowCount());
+			break;
+		case 4:
+			if(rand() % 20 == 0)
+				t.sort(rand() % 4);
+			break;
+		case 5:
+			t.appendRow(row);
+			break;
+		case 6:
+			if(rand() % 20 == 0)
+				t.removeAllRows();
+			break;
+		case 7:
+			if(rand() % 20 == 0)
+				t.setColumnData(3, t.getColumnData(0), t.getRowCount());
+			break;
+		}
+	}
+	for(int k=0; k < 3; k++)
+		if(!index_consistent(copies[k], 1, 10))
+			printf("Bad index of a changed copy\n");
+	if(!same_cells(tbl, before) || !index_consistent(tbl, 1, 10) || !tbl.isEncoded(2))
+		printf("Bad table after its copies changed\n");
+
+	// and the other way round: the copies stay put
+	_table_<int> kept, keptBefore;
+	kept = tbl;
+	deep_copy(kept, keptBefore);
+	tbl.sort(2);
+	tbl.removeRows(0, 100);
+	tbl.decodeColumn(2);
+	tbl.dropIndex(1);
+	if(!same_cells(kept, keptBefore) || !kept.isEncoded(2) || !kept.hasIndex(1) || !index_consistent(kept, 1, 10))
+		printf("Bad copy after its table changed\n");
+}
+
+void copy_on_write_performance()
+{
+	_table_<int> tbl;
+	fill_table(tbl, 1000000, 8);
+	unsigned long c = GetTickCount();
+	_table_<int> deep;
+	_array_<_string_> header;
+	int col;
+	for(col=0; col < 8; col++)
+		header.append(tbl.getColumnName(col));
+	deep.setHeader(header);
+	for(col=0; col < 8; col++)
+		deep.setColumnData(col, tbl.getColumnData(col), tbl.getRowCount());
+	c = GetTickCount()-c;
+	printf("copy of 1M x 8 table, column by column: %u\n", c);
+	c = GetTickCount();
+	for(int i=0; i < 1000; i++)
+	{
+		_table_<int> copy = tbl;
+		if(copy.getRowCount() != tbl.getRowCount())
+			printf("Bad copy\n");
+	}
+	c = GetTickCount()-c;
+	printf("1000 copies sharing the columns: %u\n", c);
+	_table_<int> copy = tbl;
+	c = GetTickCount();
+	copy.setValueAt(0, 3, -1);
+	c = GetTickCount()-c;
+	printf("first write to the copy (clones a column): %u\n", c);
+	if(tbl.getValueAt(0, 3) == -1 || deep != tbl)
+		printf("Bad copy on write\n");
+}
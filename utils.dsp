@@ -107,10 +107,18 @@ SOURCE=.\_byte_output_stream_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_column_table_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_cstring_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_csv_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_file_finder_.cpp
 # End Source File
 # Begin Source File
@@ -123,6 +131,10 @@ SOURCE=.\_file_output_stream_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_format_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_input_stream_.cpp
 # End Source File
 # Begin Source File
@@ -131,6 +143,10 @@ SOURCE=.\_ipc_channel_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_num_conv_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_num_eval_.cpp
 # End Source File
 # Begin Source File
@@ -143,6 +159,10 @@ SOURCE=.\_regex_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_rope_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_runtime_.cpp
 # End Source File
 # Begin Source File
@@ -163,6 +183,18 @@ SOURCE=.\_string_.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\_string_builder_.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\_string_pool_.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\_table_snapshot_.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\_thread_pool_.cpp
 # End Source File
 # Begin Source File
@@ -211,6 +243,10 @@ SOURCE=.\_byte_streams_defs_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_column_table_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_common_.h
 # End Source File
 # Begin Source File
@@ -219,10 +255,18 @@ SOURCE=.\_cstring_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_csv_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_dictionary_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_external_sort_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_file_finder_.h
 # End Source File
 # Begin Source File
@@ -235,6 +279,14 @@ SOURCE=.\_file_streams_defs_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_format_.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\_hash_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_io_streams_defs_.h
 # End Source File
 # Begin Source File
@@ -243,6 +295,10 @@ SOURCE=.\_ipc_channel_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_join_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_list_.h
 # End Source File
 # Begin Source File
@@ -251,6 +307,10 @@ SOURCE=.\_lock_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_num_conv_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_num_eval_.h
 # End Source File
 # Begin Source File
@@ -259,6 +319,10 @@ SOURCE=.\_ptr_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_query_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_queue_.h
 # End Source File
 # Begin Source File
@@ -267,6 +331,10 @@ SOURCE=.\_regex_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_rope_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_runtime_.h
 # End Source File
 # Begin Source File
@@ -307,10 +375,26 @@ SOURCE=.\_string_array_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_string_builder_.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\_string_pool_.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\_string_view_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_table_.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\_table_snapshot_.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\_thread_pool_.h
 # End Source File
 # Begin Source File